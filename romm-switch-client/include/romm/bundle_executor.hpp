@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace romm {
+
+// Run task(i) for every i in [0, count) with at most maxConcurrent tasks in flight.
+// - Tasks start in index order on worker threads.
+// - After the first failure (or once shouldStop() returns true) no new task starts; in-flight
+//   tasks run to completion so their partial work stays resumable.
+// - The calling thread invokes onTick every tickMs until all workers exit (aggregate progress).
+// Returns true only if every task ran and succeeded. shouldStop may be called from any worker.
+inline bool runBoundedTasks(size_t count,
+                            int maxConcurrent,
+                            const std::function<bool(size_t)>& task,
+                            const std::function<bool()>& shouldStop = {},
+                            const std::function<void()>& onTick = {},
+                            int tickMs = 200) {
+    if (count == 0) return true;
+    const size_t workers = std::min<size_t>(count, maxConcurrent > 1 ? static_cast<size_t>(maxConcurrent) : 1);
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> succeeded{0};
+    std::atomic<size_t> running{workers};
+    std::atomic<bool> failed{false};
+
+    auto workerFn = [&]() {
+        while (!failed.load() && !(shouldStop && shouldStop())) {
+            const size_t i = next.fetch_add(1);
+            if (i >= count) break;
+            if (task(i)) {
+                succeeded.fetch_add(1);
+            } else {
+                failed.store(true);
+            }
+        }
+        running.fetch_sub(1);
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for (size_t w = 0; w < workers; ++w) threads.emplace_back(workerFn);
+    while (running.load() > 0) {
+        if (onTick) onTick();
+        std::this_thread::sleep_for(std::chrono::milliseconds(tickMs > 0 ? tickMs : 1));
+    }
+    for (auto& t : threads) t.join();
+    if (onTick) onTick();
+    return succeeded.load() == count;
+}
+
+// Byte accounting for files of one bundle that download side by side. Each file adds to its own
+// counter and to the shared total in lockstep, so undoing a file's failed attempt must take back
+// only what its own counter gained: a delta of the shared total would also take what the sibling
+// files added meanwhile.
+
+// Set a file's counter back to `keep` and take what it had gained off the total (never below 0).
+inline void rollbackFileCredit(std::atomic<uint64_t>& fileBytes, std::atomic<uint64_t>& totalBytes, uint64_t keep) {
+    const uint64_t had = fileBytes.exchange(keep);
+    if (had <= keep) return;
+    const uint64_t drop = had - keep;
+    uint64_t total = totalBytes.load();
+    while (!totalBytes.compare_exchange_weak(total, total - std::min(drop, total))) {}
+}
+
+// Raise a file's counter to `now` (bytes it has durably, e.g. after a retry kept the last attempt's
+// checkpoints) and add the difference to the total.
+inline void creditFileBytes(std::atomic<uint64_t>& fileBytes, std::atomic<uint64_t>& totalBytes, uint64_t now) {
+    const uint64_t had = fileBytes.exchange(now);
+    if (now > had) totalBytes.fetch_add(now - had);
+}
+
+} // namespace romm
@@ -25,8 +25,32 @@ struct Config {
     bool fat32Safe{false};
     // Logging verbosity (debug, info, warn, error)
     std::string logLevel{"info"};
-    // Optional URL to fetch ~10MB for a quick throughput estimate; blank to skip.
+    // Deprecated: the startup speed test was replaced by live download tuning; parsed but ignored.
     std::string speedTestUrl;
+    // Parallel Range connections per file (1 = single stream; clamped to 8)
+    int downloadConnections{1};
+    // Files of one bundle (base/update/DLC) downloaded at once (clamped 1..4)
+    int bundleConcurrency{2};
+    // Upcoming queue items resolved/preflighted in background while downloading (0 disables; max 10)
+    int lookaheadDepth{3};
+    // Extend each part file to its final size before writing (fewer FAT cluster-chain updates)
+    bool preallocateParts{true};
+    // Part-file write path: "stdio" (FILE* + 256KB buffer) or "raw" (fd + 2MB aligned write() calls)
+    std::string writeBackend{"stdio"};
+    // SHA-256 each part while writing; resume spot-checks parts against the recorded hashes
+    bool hashParts{true};
+    // Fetch multi-file bundles as one server-side ZIP and extract it while it streams
+    bool archiveBundles{false};
+    // Offer HTTP/2 (ALPN on https, h2c on http) for API and cover requests; downloads stay on 1.1
+    bool http2{false};
+    // SD-card cache of API/cover responses, revalidated with ETag/Last-Modified, in MB (0 disables)
+    int httpCacheMb{32};
+    // Download bandwidth cap shared by all connections, in KB/s (0 = unlimited)
+    int rateLimitKBps{0};
+    // Token-bucket burst in KB (0 = one second at the current cap)
+    int rateLimitBurstKB{0};
+    // Local time-of-day caps overriding rateLimitKBps: "HH:MM-HH:MM=KB[,...]" (0 = unlimited)
+    std::string rateLimitSchedule;
     // Platform prefs source selection
     std::string platformPrefsMode{"auto"};      // auto | sd | romfs
     std::string platformPrefsPathSd{"sdmc:/switch/SwitchRomM/platform_prefs.json"};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+
+namespace romm {
+
+// Keep-alive counters of a ConnectionPool; read lock-free by the UI/diagnostics.
+struct ConnectionStats {
+    std::atomic<uint64_t> requests{0};  // requests sent through the pool
+    std::atomic<uint64_t> reused{0};    // ...that went out on a connection left open by an earlier one
+    std::atomic<uint64_t> opened{0};    // new connections (TCP connect, plus a TLS handshake on HTTPS)
+    std::atomic<uint64_t> connectMs{0}; // time spent in those connects/handshakes
+    std::atomic<uint64_t> evicted{0};   // idle handles closed because the pool was full
+
+    void reset() {
+        requests.store(0);
+        reused.store(0);
+        opened.store(0);
+        connectMs.store(0);
+        evicted.store(0);
+    }
+};
+
+// Idle HTTP handles kept between requests, keyed by origin ("scheme://host:port"). Their open
+// connections live on in the HTTP engine's connection cache, so the next request to the same
+// origin skips the connect and TLS handshake. A handle is checked out for one request at a time
+// and may move between threads; the pool itself is thread-safe. Handles are opaque here: the HTTP
+// layer creates them and `destroy` frees them.
+class ConnectionPool {
+public:
+    using Destroy = void (*)(void* handle);
+
+    explicit ConnectionPool(size_t maxIdle = 8, Destroy destroy = nullptr);
+    ~ConnectionPool();
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // Counters to update (nullptr = none). Set before handing the pool to requests.
+    void setStats(ConnectionStats* stats) { stats_ = stats; }
+    ConnectionStats* stats() const { return stats_; }
+
+    // Most recently parked handle for `origin`, or nullptr (the caller opens a new one).
+    void* acquire(const std::string& origin);
+    // Park a handle after its request. Beyond maxIdle the least recently parked handle is closed.
+    void release(const std::string& origin, void* handle);
+    // Record one finished request; `newConnections` is how many connects it needed (0 = reused).
+    void noteRequest(uint64_t newConnections, uint64_t connectMs);
+
+    // Close every idle handle.
+    void clear();
+    size_t idleCount() const;
+
+private:
+    struct Idle {
+        std::string origin;
+        void* handle{nullptr};
+    };
+
+    void destroyHandle(void* handle) const;
+
+    const size_t maxIdle_;
+    const Destroy destroy_;
+    ConnectionStats* stats_{nullptr};
+    mutable std::mutex mutex_;
+    std::list<Idle> idle_; // most recently parked first
+};
+
+} // namespace romm
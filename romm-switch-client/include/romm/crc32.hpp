@@ -0,0 +1,61 @@
+#pragma once
+
+#include "romm/download_segments.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace romm {
+
+// CRC-32 as used by ZIP, zlib and RomM's crc_hash (reflected 0x04C11DB7). Runs on the ARMv8 CRC32
+// instructions when the target has them (Switch build: -march=armv8-a+crc), on zlib otherwise.
+// Pass 0 to start; the value returned is final and can be fed back in to continue.
+uint32_t crc32Update(uint32_t crc, const void* data, size_t len);
+// CRC of A followed by B, from crc(A), crc(B) and B's length (no data needed).
+uint32_t crc32Combine(uint32_t crcA, uint32_t crcB, uint64_t lenB);
+// True when compiled with the hardware path.
+bool crc32Accelerated();
+
+// 8 lowercase hex digits; parse accepts either case and fails on anything but 8 hex digits.
+std::string crc32ToHex(uint32_t crc);
+bool crc32FromHex(const std::string& hex, uint32_t& out);
+
+// Whole-file CRC-32 assembled from writes in any order (segments, hedges, resumed gaps): each
+// write extends the run of contiguous bytes it continues or starts a new one, and runs that meet
+// are merged with crc32Combine. Once one run covers [0, size) the file's CRC is known without
+// reading anything back. Fed by the writer thread; not thread-safe.
+class FileCrc {
+public:
+    // Continue from a prefix [0, end) whose CRC is known (resume).
+    void seed(uint64_t end, uint32_t crc);
+    void update(uint64_t offset, const char* data, size_t len);
+    // Forget runs that are not entirely inside `keep` (bytes that were trimmed or never flushed).
+    void keepInside(const RangeSet& keep);
+    void clear() { runs_.clear(); }
+
+    // Leading run [0, prefixEnd()) and its CRC; 0 / 0 when byte 0 was not seen.
+    uint64_t prefixEnd() const;
+    uint32_t prefixCrc() const;
+    // CRC of [0, size) when one run covers it exactly.
+    bool whole(uint64_t size, uint32_t& crc) const;
+    // Bytes in [0, size) no run covers.
+    std::vector<ByteRange> missing(uint64_t size) const;
+    size_t runCount() const { return runs_.size(); }
+
+private:
+    struct Run {
+        uint64_t end{0};
+        uint32_t crc{0};
+    };
+    std::map<uint64_t, Run> runs_; // start -> run; disjoint, never touching (touching runs merge)
+};
+
+// Read the bytes `crc` is missing back from the NN.part files in `dir` and fold them in, so that
+// crc.whole(totalSize) holds. `readBytes` (optional) receives how much had to be read.
+bool completeFileCrc(const std::string& dir, uint64_t partSize, uint64_t totalSize, FileCrc& crc,
+                     std::string& err, uint64_t* readBytes = nullptr);
+
+} // namespace romm
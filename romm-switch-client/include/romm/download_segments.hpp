@@ -0,0 +1,143 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace romm {
+
+// Half-open byte range [start, end) of a remote file.
+struct ByteRange {
+    uint64_t start{0};
+    uint64_t end{0};
+    uint64_t size() const { return end > start ? end - start : 0; }
+};
+
+constexpr uint64_t kSegmentAlignBytes = 64ULL * 1024ULL;
+
+// Split [start, end) into at most maxSegments contiguous ranges, each at least minSegmentBytes
+// (except when the whole span is smaller). Interior boundaries are aligned to kSegmentAlignBytes.
+inline std::vector<ByteRange> planSegments(uint64_t start, uint64_t end, int maxSegments, uint64_t minSegmentBytes) {
+    std::vector<ByteRange> out;
+    if (end <= start) return out;
+    const uint64_t span = end - start;
+    uint64_t count = maxSegments > 1 ? static_cast<uint64_t>(maxSegments) : 1;
+    if (minSegmentBytes > 0) count = std::min<uint64_t>(count, std::max<uint64_t>(1, span / minSegmentBytes));
+    const uint64_t step = span / count;
+    uint64_t cur = start;
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t next = end;
+        if (i + 1 < count) {
+            next = start + step * (i + 1);
+            next -= next % kSegmentAlignBytes;
+            if (next <= cur) continue; // tiny spans collapse into the following segment
+        }
+        out.push_back(ByteRange{cur, next});
+        cur = next;
+    }
+    return out;
+}
+
+// Sorted, coalesced set of half-open byte ranges: the bytes of a file (or part) known to be on
+// disk. Adjacent and overlapping ranges merge, so the set stays small however bytes arrive.
+class RangeSet {
+public:
+    RangeSet() = default;
+
+    void add(uint64_t start, uint64_t end) {
+        if (end <= start) return;
+        // First range that ends at or after start (touching ranges merge).
+        auto it = std::lower_bound(ranges_.begin(), ranges_.end(), start,
+                                   [](const ByteRange& r, uint64_t v) { return r.end < v; });
+        auto last = it;
+        while (last != ranges_.end() && last->start <= end) {
+            start = std::min(start, last->start);
+            end = std::max(end, last->end);
+            ++last;
+        }
+        it = ranges_.erase(it, last);
+        ranges_.insert(it, ByteRange{start, end});
+    }
+    void add(const ByteRange& r) { add(r.start, r.end); }
+    void add(const RangeSet& other) {
+        for (const auto& r : other.ranges_) add(r);
+    }
+    void clear() { ranges_.clear(); }
+
+    bool empty() const { return ranges_.empty(); }
+    const std::vector<ByteRange>& ranges() const { return ranges_; }
+
+    uint64_t covered() const {
+        uint64_t sum = 0;
+        for (const auto& r : ranges_) sum += r.size();
+        return sum;
+    }
+    // True when every byte of [start, end) is in the set.
+    bool contains(uint64_t start, uint64_t end) const {
+        if (end <= start) return true;
+        for (const auto& r : ranges_) {
+            if (r.start <= start && end <= r.end) return true;
+        }
+        return false;
+    }
+    // End of the covered run that starts at `from` (`from` itself when that byte is missing).
+    uint64_t runEnd(uint64_t from) const {
+        for (const auto& r : ranges_) {
+            if (r.start <= from && from < r.end) return r.end;
+        }
+        return from;
+    }
+    // Intersection with [start, end).
+    RangeSet clipped(uint64_t start, uint64_t end) const {
+        RangeSet out;
+        for (const auto& r : ranges_) {
+            const uint64_t s = std::max(r.start, start);
+            const uint64_t e = std::min(r.end, end);
+            if (s < e) out.ranges_.push_back(ByteRange{s, e});
+        }
+        return out;
+    }
+    // Gaps of [start, end) not in the set, in order.
+    std::vector<ByteRange> missing(uint64_t start, uint64_t end) const {
+        std::vector<ByteRange> out;
+        uint64_t cur = start;
+        for (const auto& r : ranges_) {
+            if (r.end <= cur) continue;
+            if (r.start >= end) break;
+            if (r.start > cur) out.push_back(ByteRange{cur, r.start});
+            cur = std::max(cur, r.end);
+            if (cur >= end) break;
+        }
+        if (cur < end) out.push_back(ByteRange{cur, end});
+        return out;
+    }
+
+private:
+    std::vector<ByteRange> ranges_;
+};
+
+// Split a list of gaps into Range segments for up to maxSegments connections: each gap gets a
+// share of the connections proportional to its size (at least one segment per gap).
+inline std::vector<ByteRange> planSegmentsOver(const std::vector<ByteRange>& gaps, int maxSegments,
+                                               uint64_t minSegmentBytes) {
+    std::vector<ByteRange> out;
+    uint64_t total = 0;
+    for (const auto& g : gaps) total += g.size();
+    if (total == 0) return out;
+    const uint64_t target = maxSegments > 1 ? static_cast<uint64_t>(maxSegments) : 1;
+    for (const auto& g : gaps) {
+        if (g.size() == 0) continue;
+        const uint64_t share = std::max<uint64_t>(1, (g.size() * target + total / 2) / total);
+        const auto segs = planSegments(g.start, g.end, static_cast<int>(share), minSegmentBytes);
+        out.insert(out.end(), segs.begin(), segs.end());
+    }
+    return out;
+}
+
+// HTTP Range header value for a segment ("bytes=<first>-<last>", inclusive).
+inline std::string rangeHeaderValue(const ByteRange& r) {
+    return "bytes=" + std::to_string(r.start) + "-" + std::to_string(r.end - 1);
+}
+
+} // namespace romm
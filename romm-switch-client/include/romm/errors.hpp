@@ -154,8 +154,13 @@ inline ErrorInfo classifyError(const std::string& detail, ErrorCategory hint = E
         set(ErrorCategory::Network, ErrorCode::ConnectFailure, "Failed to connect to server.", true);
     } else if (l.find("timeout") != std::string::npos || l.find("timed out") != std::string::npos) {
         set(ErrorCategory::Network, ErrorCode::Timeout, "Network operation timed out.", true);
+    } else if (l.find("stream stalled") != std::string::npos || l.find("stall timeout") != std::string::npos) {
+        set(ErrorCategory::Network, ErrorCode::Timeout, "Download stalled.", true);
     } else if (l.find("recv failed") != std::string::npos || l.find("send failed") != std::string::npos ||
-               l.find("transport") != std::string::npos || l.find("http request failed") != std::string::npos) {
+               l.find("transport") != std::string::npos || l.find("http request failed") != std::string::npos ||
+               l.find("short read") != std::string::npos || l.find("short segment") != std::string::npos ||
+               l.find("short body") != std::string::npos || l.find("short http body") != std::string::npos ||
+               l.find("connection closed") != std::string::npos || l.find("receiving data") != std::string::npos) {
         set(ErrorCategory::Network, ErrorCode::TransportFailure, "Network transport failed.", true);
     } else if (l.find("parse") != std::string::npos || l.find("malformed") != std::string::npos || l.find("json") != std::string::npos) {
         set(ErrorCategory::Parse, ErrorCode::ParseFailure, "Received malformed data.", false);
@@ -2,6 +2,8 @@
 
 #include <string>
 #include <cstdint>
+#include <cstddef>
+#include <functional>
 #include "romm/models.hpp"
 #include "romm/config.hpp"
 
@@ -13,6 +15,19 @@ bool ensureDirectory(const std::string& path);
 bool fileExists(const std::string& path);
 // Best-effort free-space query for a path (bytes).
 uint64_t getFreeSpace(const std::string& path);
+// Replace path so a crash leaves either the old or the new content: write path.tmp, fsync it,
+// then rename over path (remove + rename where the filesystem refuses to overwrite).
+bool writeFileAtomic(const std::string& path, const std::string& data, std::string& err);
+// Read what writeFileAtomic last completed: path, or path.tmp if a replace stopped after the remove.
+bool readFileAtomic(const std::string& path, std::string& out);
+
+// Called after each chunk of a streaming copy.
+using CopyProgressFn = std::function<void(uint64_t copied, uint64_t total)>;
+constexpr size_t kCopyBufferBytes = 4 * 1024 * 1024;
+// Copy src to dst (replacing it) through one large buffer and fsync dst. A failed copy removes
+// the partial dst; src is never modified.
+bool copyFileStreaming(const std::string& src, const std::string& dst, const CopyProgressFn& progress,
+                       std::string& err, size_t bufferBytes = kCopyBufferBytes);
 
 // Determine if a game's final output appears to be on disk (ID-suffixed, with/without extension).
 bool isGameCompletedOnDisk(const Game& g, const Config& cfg);
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "romm/http_common.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace romm {
+
+// Where the process-wide cache keeps its files.
+constexpr const char* kHttpCacheDir = "sdmc:/switch/romm_switch_client/http_cache";
+
+// Counters of an HttpResponseCache; read lock-free by diagnostics.
+struct HttpCacheStats {
+    std::atomic<uint64_t> revalidations{0}; // conditional requests sent
+    std::atomic<uint64_t> hits{0};          // ...answered 304 and served from disk
+    std::atomic<uint64_t> hitBytes{0};      // body bytes those hits did not download
+    std::atomic<uint64_t> stores{0};        // 200 responses written to the cache
+    std::atomic<uint64_t> evictions{0};     // entries dropped to stay under the budget
+};
+
+// Responses to GET requests kept on the SD card together with their validators (ETag,
+// Last-Modified). A request for a stored URL goes out with If-None-Match/If-Modified-Since; a 304
+// is answered from the stored copy, so an unchanged platform list, ROM page or cover costs one
+// round trip and no body. Nothing is served without asking the server first. Only 200 responses
+// that carry a validator (and no Cache-Control: no-store) are stored, and no single response may
+// take more than an eighth of the budget. The total size stays under a byte budget by evicting the
+// least recently used entries; after a restart, recency is the order in which entries were last
+// written. Thread-safe.
+class HttpResponseCache {
+public:
+    struct Validators {
+        std::string etag;
+        std::string lastModified;
+    };
+
+    HttpResponseCache() = default;
+    HttpResponseCache(const HttpResponseCache&) = delete;
+    HttpResponseCache& operator=(const HttpResponseCache&) = delete;
+
+    // Use `dir` (created if missing) with at most `budgetBytes` of entries; picks up what an
+    // earlier run stored and drops unreadable files. A budget of 0 leaves the cache disabled.
+    bool open(const std::string& dir, uint64_t budgetBytes, std::string& err);
+    bool enabled() const;
+
+    // Entry key of a request: method, URL and credentials (one user's responses are never served
+    // to another). A hash, so the Authorization value is not written to the SD card.
+    static std::string keyFor(const std::string& method,
+                              const std::string& url,
+                              const std::vector<std::pair<std::string, std::string>>& headers);
+
+    bool validators(const std::string& key, Validators& out) const;
+    // The stored response as a 200 (status, headers, body). False, and the entry is dropped, when
+    // its file is gone or damaged.
+    bool load(const std::string& key, ParsedHttpResponse& parsed, std::string& body);
+    // Keep a response if it qualifies (see above); false if it was not stored. `body` must be
+    // decoded: the stored headers drop Content-Encoding and give its length as Content-Length.
+    bool store(const std::string& key, const std::string& url, const ParsedHttpResponse& parsed,
+               const std::string& body);
+    void remove(const std::string& key);
+
+    uint64_t bytes() const;
+    size_t entries() const;
+    HttpCacheStats& stats() { return stats_; }
+    const HttpCacheStats& stats() const { return stats_; }
+
+private:
+    struct Entry {
+        std::string etag;
+        std::string lastModified;
+        uint64_t size{0}; // file size
+        std::list<std::string>::iterator lru;
+    };
+
+    std::string pathFor(const std::string& key) const;
+    void dropLocked(const std::string& key);
+    void evictLocked();
+
+    mutable std::mutex mutex_;
+    std::string dir_;
+    uint64_t budget_{0};
+    uint64_t bytes_{0};
+    uint64_t tmpSeq_{0};
+    std::unordered_map<std::string, Entry> entries_;
+    std::list<std::string> lru_; // most recently used first
+    HttpCacheStats stats_;
+};
+
+// The cache API calls and the update check use; disabled until main() opens it.
+HttpResponseCache& httpResponseCache();
+
+} // namespace romm
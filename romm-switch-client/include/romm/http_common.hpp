@@ -4,12 +4,17 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 namespace romm {
 
+class ConnectionPool;
+class HttpResponseCache;
+class HttpSingleFlight;
+
 // Send entire buffer, handling short writes and EINTR.
 bool sendAll(int fd, const char* data, size_t len);
 
@@ -28,6 +33,10 @@ struct ParsedHttpResponse {
     bool connectionClose{false};
     std::string headersRaw;
     std::string location;
+    std::string contentEncoding; // lowercased; empty = identity
+    std::string etag;            // validators, as sent
+    std::string lastModified;
+    std::string cacheControl;    // lowercased
 };
 
 // Parse HTTP status line + headers (headerBlock excludes the trailing CRLFCRLF).
@@ -39,7 +48,16 @@ struct HttpRequestOptions {
     bool keepAlive{false};
     bool decodeChunked{true};
     size_t maxBodyBytes{0}; // 0 = unlimited
+    size_t recvBufferBytes{0}; // libcurl receive buffer and SO_RCVBUF; 0 = built-in 256KB, OS socket default
     bool followRedirects{false}; // off by default (avoid auth leaks / unexpected cross-host redirects)
+    // Buffered requests only: send "Accept-Encoding: gzip, deflate" and decode such a body;
+    // maxBodyBytes then caps the decoded size.
+    bool acceptCompressed{false};
+    ConnectionPool* pool{nullptr}; // take/park the handle here and keep its connection open (implies keepAlive)
+    // Buffered GETs: revalidate against this cache and answer 304s from it (see http_cache.hpp).
+    HttpResponseCache* cache{nullptr};
+    // Buffered GETs without cancelRequested: share the transfer of an identical request in flight.
+    HttpSingleFlight* singleFlight{nullptr};
     std::atomic<bool>* cancelRequested{nullptr};
     std::atomic<int>* activeSocketFd{nullptr};
 };
@@ -47,8 +65,50 @@ struct HttpRequestOptions {
 struct HttpTransaction {
     ParsedHttpResponse parsed;
     std::string body;
+    bool fromCache{false}; // the server answered 304; parsed/body are the stored 200
+};
+
+// Undoes a gzip or deflate Content-Encoding as the body arrives, appending the decoded bytes.
+// "deflate" is taken with or without its zlib header (servers send both).
+class HttpBodyDecoder {
+public:
+    enum class Coding { Gzip, Deflate };
+
+    // The coding named by a Content-Encoding value; false for identity and anything else.
+    static bool codingOf(const std::string& contentEncoding, Coding& out);
+
+    // `maxOutBytes` caps the decoded size (0 = unlimited).
+    HttpBodyDecoder(Coding coding, size_t maxOutBytes);
+    ~HttpBodyDecoder();
+
+    HttpBodyDecoder(const HttpBodyDecoder&) = delete;
+    HttpBodyDecoder& operator=(const HttpBodyDecoder&) = delete;
+
+    bool write(const char* data, size_t len, std::string& out, std::string& err);
+    // The body ended: fails unless the compressed stream was complete.
+    bool finish(std::string& err);
+    // write() failed because the decoded body would pass maxOutBytes.
+    bool exceeded() const { return exceeded_; }
+
+private:
+    struct Inflater;
+
+    bool start(const char* data, std::string& err);
+
+    const Coding coding_;
+    const size_t maxOutBytes_;
+    std::unique_ptr<Inflater> inflater_;
+    std::string head_; // first bytes of a deflate body, until its wrapper is known
+    size_t outBytes_{0};
+    bool ended_{false};
+    bool exceeded_{false};
 };
 
+// "scheme://host:port" of an http(s) URL (the port filled in from the scheme when absent).
+bool httpOriginOf(const std::string& url, std::string& origin, std::string& err);
+
+// Blocking requests, run on the HTTP engine's I/O thread (see http_engine.hpp). Never call them
+// from an engine callback.
 bool httpRequestBuffered(const std::string& method,
                          const std::string& url,
                          const std::vector<std::pair<std::string, std::string>>& headers,
@@ -64,6 +124,9 @@ bool httpRequestStreamed(const std::string& method,
                          const std::function<bool(const char*, size_t)>& onData,
                          std::string& err);
 
+// ConnectionPool::Destroy for handles the HTTP layer parked in a pool (libcurl easy handles).
+void destroyHttpHandle(void* handle);
+
 // Best-effort shutdown for the HTTP stack (libcurl TLS/global state).
 // Intended to be called during app shutdown after all background HTTP workers have stopped.
 void httpShutdown();
@@ -0,0 +1,242 @@
+#pragma once
+
+#include "romm/http_common.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace romm {
+
+// Counters of the HTTP engine; read lock-free by diagnostics.
+struct HttpEngineStats {
+    std::atomic<uint64_t> submitted{0};  // requests handed to the engine
+    std::atomic<uint64_t> completed{0};  // ...that ended with a response
+    std::atomic<uint64_t> failed{0};     // ...that ended in a transport error or an aborted sink
+    std::atomic<uint64_t> cancelled{0};  // ...that were cancelled
+    std::atomic<uint64_t> active{0};     // transfers on the I/O thread right now
+    std::atomic<uint64_t> peakActive{0};
+    std::atomic<uint64_t> pauses{0};     // times a stream paused because its reader fell behind
+
+    // Shared caches, counted over requests that reached the server. DNS counts only new connections;
+    // a lookup under 1ms is taken as a cache hit (IP-literal hosts land there too: nothing to pay).
+    std::atomic<uint64_t> connReused{0};     // request went out on a cached connection
+    std::atomic<uint64_t> connOpened{0};     // ...or had to open one
+    std::atomic<uint64_t> dnsCached{0};
+    std::atomic<uint64_t> dnsResolved{0};
+    std::atomic<uint64_t> tlsHandshakes{0};  // full or resumed; a resumed one shows as less time
+    std::atomic<uint64_t> tlsHandshakeMs{0};
+    std::atomic<uint64_t> shareLockWaits{0}; // share-lock acquisitions that had to wait
+
+    std::atomic<uint64_t> http2Requests{0};  // responses that came over HTTP/2
+    std::atomic<uint64_t> http2Fallbacks{0}; // HTTP/2 offered, HTTP/1.1 used (ALPN said no, or h2c failed)
+
+    // Buffered responses that came gzip/deflate-encoded, and their size on the wire vs decoded.
+    std::atomic<uint64_t> decodedResponses{0};
+    std::atomic<uint64_t> decodedWireBytes{0};
+    std::atomic<uint64_t> decodedBodyBytes{0};
+};
+
+// Outcome of one request. `ok` means a complete response arrived (any status code).
+struct HttpResult {
+    bool ok{false};
+    std::string err;
+    ParsedHttpResponse parsed;
+    std::string body;        // buffered requests only
+    uint64_t bodyBytes{0};   // body bytes delivered (buffered or streamed)
+    uint64_t wireBytes{0};   // buffered only: body bytes as received, before any decoding
+};
+
+// Bounded hand-off of a streamed body from the I/O thread to the thread that consumes it. The
+// engine push()es chunks; when the queue is full the transfer pauses (the socket is not read, so
+// the server sees TCP backpressure) until the reader has drained half of it. Keeping the sink on
+// the reader's thread means a slow sink (disk, rate limiter) never holds up other transfers.
+class HttpBodyQueue {
+public:
+    enum class Push { Accepted, Full, Closed };
+
+    explicit HttpBodyQueue(size_t capacityBytes);
+
+    HttpBodyQueue(const HttpBodyQueue&) = delete;
+    HttpBodyQueue& operator=(const HttpBodyQueue&) = delete;
+
+    // I/O side. Headers come first; a chunk is taken whole, and always when the queue is empty.
+    void setHeaders(const ParsedHttpResponse& parsed);
+    Push push(const char* data, size_t len);
+    // No more chunks: the transfer ended (either way).
+    void finish();
+    // Called by the reader when a Full push may be retried; set before the first push.
+    void setOnResume(std::function<void()> onResume);
+
+    // Reader side. Blocks until the next chunk (true) or the end of the body (false). `headers` is
+    // filled before the first chunk is returned.
+    bool take(std::string& chunk, ParsedHttpResponse& headers);
+    // Give a consumed chunk's buffer back for reuse.
+    void recycle(std::string&& chunk);
+    // Stop reading: pending and future chunks are dropped and push() reports Closed.
+    void close();
+
+    size_t bufferedBytes() const;
+
+private:
+    void resumeIfDrained(std::unique_lock<std::mutex>& lock);
+
+    const size_t capacity_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::string> chunks_;
+    std::vector<std::string> spare_;
+    size_t bytes_{0};
+    ParsedHttpResponse headers_;
+    bool headersSet_{false};
+    bool headersTaken_{false};
+    bool producerPaused_{false};
+    bool finished_{false};
+    bool closed_{false};
+    std::function<void()> onResume_;
+};
+
+// The atomics and pool `options` points at must outlive the request.
+struct HttpRequest {
+    std::string method{"GET"};
+    std::string url;
+    std::vector<std::pair<std::string, std::string>> headers;
+    HttpRequestOptions options;
+    // Streamed body, in one of two ways (neither = buffer it into HttpResult::body):
+    //  - onData runs on the I/O thread for every chunk, after the headers are parsed; it must not
+    //    block, since every other transfer waits on it. Return false to abort.
+    //  - bodyQueue hands the chunks to another thread (see HttpBodyQueue).
+    // Streams fail on chunked responses unless options.decodeChunked is set.
+    std::function<bool(const ParsedHttpResponse&, const char*, size_t)> onData;
+    std::shared_ptr<HttpBodyQueue> bodyQueue;
+    // Runs once when the request ends, success or not: on the I/O thread, or inside submit() when
+    // the engine cannot take requests. Must not block.
+    std::function<void(HttpResult&)> onDone;
+};
+
+class HttpEngine;
+
+// One submitted request: wait for it, poll it, or cancel it from any thread.
+class HttpCall {
+public:
+    explicit HttpCall(HttpEngine* engine) : engine_(engine) {}
+
+    HttpCall(const HttpCall&) = delete;
+    HttpCall& operator=(const HttpCall&) = delete;
+
+    // Abort the transfer; it ends with "Cancelled" shortly after (at most one poll interval).
+    void cancel();
+    bool cancelled() const { return cancel_.load(std::memory_order_acquire); }
+
+    bool done() const;
+    // Block until the request ended. The result stays owned by the call; move out of it freely.
+    HttpResult& wait();
+    // As wait(), giving up after `timeoutMs`; false if the request is still running.
+    bool waitFor(int timeoutMs);
+
+    // Engine side: publish the result and wake waiters.
+    void complete(HttpResult&& result);
+
+private:
+    HttpEngine* engine_{nullptr};
+    std::atomic<bool> cancel_{false};
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool done_{false};
+    HttpResult result_;
+};
+
+using HttpCallPtr = std::shared_ptr<HttpCall>;
+
+// Every HTTP transfer runs on one I/O thread driving a libcurl multi handle, so any number of
+// requests can be in flight without a thread each; connections are cached by the multi handle, and
+// a share handle gives every easy handle the same DNS cache and TLS session cache. The thread
+// starts with the first request and idles on a condition variable while nothing is in flight.
+// httpRequestBuffered/httpRequestStreamed are blocking wrappers over submit().
+class HttpEngine {
+public:
+    HttpEngine();
+    ~HttpEngine();
+
+    HttpEngine(const HttpEngine&) = delete;
+    HttpEngine& operator=(const HttpEngine&) = delete;
+
+    HttpCallPtr submit(HttpRequest request);
+
+    // Cancel everything in flight, wait for it to end and stop the I/O thread. Later submissions
+    // fail with "HTTP engine stopped".
+    void shutdown();
+
+    const HttpEngineStats& stats() const { return stats_; }
+
+    // Offer HTTP/2 on buffered requests (API pages, details, covers): ALPN on https, prior
+    // knowledge (h2c) on plain http. Concurrent requests to one server then share a single
+    // connection. Streamed bodies (downloads) stay on HTTP/1.1, where each segment keeps its own
+    // TCP connection. An http server that fails h2c is retried on HTTP/1.1 and remembered. Returns
+    // false (and stays on HTTP/1.1) when libcurl was built without HTTP/2.
+    bool setHttp2(bool enabled);
+    bool http2() const { return http2_.load(std::memory_order_relaxed); }
+    static bool http2Supported();
+
+    // Interrupt the I/O thread's wait (new work, cancellation, a queue that drained).
+    void wake();
+    // True on the I/O thread (inside onData/onDone), where blocking on a request would deadlock.
+    bool onIoThread() const;
+
+    struct Transfer;
+    struct Share;
+
+private:
+    struct Command {
+        enum class Kind { Start, Resume };
+        Kind kind{Kind::Start};
+        uint64_t id{0};
+        std::unique_ptr<Transfer> transfer;
+    };
+
+    bool ensureStarted(std::string& err);
+    void post(Command&& cmd);
+    void run();
+    void startTransfer(std::unique_ptr<Transfer> transfer);
+    void finishTransfer(uint64_t id, int curlCode);
+    void failTransfer(std::unique_ptr<Transfer> transfer, const std::string& err);
+    void complete(Transfer& transfer, HttpResult& result);
+    void* takeEasyHandle(Transfer& transfer, std::string& err);
+    void releaseEasyHandle(Transfer& transfer);
+
+    HttpEngineStats stats_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Command> commands_;
+    bool started_{false};
+    bool stopping_{false};
+    bool stopped_{false};
+    std::thread thread_;
+    std::atomic<std::thread::id> ioThreadId_{};
+    std::atomic<uint64_t> nextId_{1};
+    std::atomic<bool> http2_{false};
+
+    // Owned by the I/O thread.
+    void* multi_{nullptr};
+    std::unique_ptr<Share> share_; // DNS cache and TLS sessions of every handle
+    std::unordered_map<uint64_t, std::unique_ptr<Transfer>> transfers_;
+    std::vector<void*> idleEasy_; // handles of finished keep-alive requests without a pool
+    std::unordered_set<std::string> h1Origins_; // plain-http origins that failed h2c
+    std::unordered_set<std::string> h2Origins_; // ...and those that answered over it
+};
+
+// The process-wide engine the blocking HTTP calls use.
+HttpEngine& httpEngine();
+
+} // namespace romm
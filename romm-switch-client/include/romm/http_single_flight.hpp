@@ -0,0 +1,63 @@
+#pragma once
+
+#include "romm/http_common.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace romm {
+
+// Counters of an HttpSingleFlight; read lock-free by diagnostics.
+struct HttpSingleFlightStats {
+    std::atomic<uint64_t> leaders{0}; // requests that went to the network
+    std::atomic<uint64_t> joined{0};  // ...and identical ones that waited for them instead
+    std::atomic<uint64_t> peakWaiters{0};
+};
+
+// Coalesces identical requests that are in flight at the same time: the first caller for a key
+// runs the request, later callers block until it ends and get a copy of its outcome (response or
+// error). Nothing is kept once the request ends, so a caller arriving after that makes a new one.
+// The UI asks for the same cover, ROM details or identifier page from several places at once;
+// this turns those into one transfer. Thread-safe.
+class HttpSingleFlight {
+public:
+    using Fetch = std::function<bool(HttpTransaction& out, std::string& err)>;
+
+    HttpSingleFlight() = default;
+    HttpSingleFlight(const HttpSingleFlight&) = delete;
+    HttpSingleFlight& operator=(const HttpSingleFlight&) = delete;
+
+    // Requests with the same key must produce the same response: method, URL and credentials
+    // (one user's response is never handed to another), plus the body cap, which decides whether
+    // a large response fails.
+    static std::string keyFor(const std::string& method,
+                              const std::string& url,
+                              const std::vector<std::pair<std::string, std::string>>& headers,
+                              size_t maxBodyBytes);
+
+    // Run `fetch` unless a request for `key` is already running, in which case wait for that one.
+    bool run(const std::string& key, const Fetch& fetch, HttpTransaction& out, std::string& err);
+
+    size_t inFlight() const;
+    HttpSingleFlightStats& stats() { return stats_; }
+    const HttpSingleFlightStats& stats() const { return stats_; }
+
+private:
+    struct Flight;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<Flight>> flights_;
+    HttpSingleFlightStats stats_;
+};
+
+// The instance API calls and the update check use.
+HttpSingleFlight& httpSingleFlight();
+
+} // namespace romm
@@ -6,6 +6,7 @@
 #include <cstdint>
 #include <functional>
 #include <mutex>
+#include <deque>
 #include <optional>
 #include <thread>
 
@@ -150,4 +151,87 @@ private:
     std::optional<Result> result_;
 };
 
+// Single-worker FIFO job runner: every submitted job runs, in order, one at a time.
+// finish() lets the worker drain what is queued before joining (nothing is dropped).
+template <typename Job>
+class SerialJobWorker {
+public:
+    using WorkFn = std::function<void(const Job&)>;
+
+    SerialJobWorker() = default;
+    ~SerialJobWorker() { finish(); }
+
+    SerialJobWorker(const SerialJobWorker&) = delete;
+    SerialJobWorker& operator=(const SerialJobWorker&) = delete;
+
+    void start(WorkFn work) {
+        finish();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            work_ = std::move(work);
+            closing_ = false;
+            running_ = false;
+            queue_.clear();
+        }
+        worker_ = std::thread(&SerialJobWorker::workerLoop, this);
+    }
+
+    // Run every queued job, then stop the worker. Returns once the last job completed.
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closing_ = true;
+        }
+        cv_.notify_one();
+        if (worker_.joinable()) worker_.join();
+    }
+
+    // False once finish() started (or before start()); the job is not queued then.
+    bool submit(Job job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (closing_) return false;
+            queue_.push_back(std::move(job));
+        }
+        cv_.notify_one();
+        return true;
+    }
+
+    // Jobs not yet completed (queued + running).
+    size_t pending() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return queue_.size() + (running_ ? 1 : 0);
+    }
+
+private:
+    void workerLoop() {
+        while (true) {
+            Job job;
+            WorkFn work;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&] { return closing_ || !queue_.empty(); });
+                if (queue_.empty()) break; // closing and drained
+                job = std::move(queue_.front());
+                queue_.pop_front();
+                running_ = true;
+                work = work_;
+            }
+            work(job);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                running_ = false;
+            }
+        }
+    }
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread worker_;
+    bool closing_{true};
+    bool running_{false};
+    WorkFn work_{};
+    std::deque<Job> queue_;
+};
+
 } // namespace romm
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "romm/status.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace romm {
+
+// Preflight result resolved ahead of time for an upcoming file.
+struct PreparedPreflight {
+    uint64_t contentLength{0};
+    bool supportsRanges{false};
+};
+
+// Thread-safe URL -> preflight cache filled by the look-ahead stage and consumed by the worker.
+// Entries are single-use and expire after ttl so a stale HEAD never outlives a server change.
+class PreflightCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit PreflightCache(std::chrono::milliseconds ttl = std::chrono::minutes(2), size_t capacity = 64)
+        : ttl_(ttl), capacity_(capacity > 0 ? capacity : 1) {}
+
+    void put(const std::string& url, const PreparedPreflight& pf, Clock::time_point now = Clock::now()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pruneLocked(now);
+        if (entries_.size() >= capacity_ && entries_.find(url) == entries_.end()) {
+            // Drop the oldest entry; capacity is small so a linear scan is fine.
+            auto oldest = entries_.begin();
+            for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+                if (it->second.storedAt < oldest->second.storedAt) oldest = it;
+            }
+            entries_.erase(oldest);
+        }
+        entries_[url] = Entry{pf, now};
+    }
+
+    std::optional<PreparedPreflight> take(const std::string& url, Clock::time_point now = Clock::now()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(url);
+        if (it == entries_.end()) return std::nullopt;
+        Entry e = it->second;
+        entries_.erase(it);
+        if (now - e.storedAt > ttl_) return std::nullopt;
+        return e.pf;
+    }
+
+    bool contains(const std::string& url, Clock::time_point now = Clock::now()) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(url);
+        return it != entries_.end() && now - it->second.storedAt <= ttl_;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.size();
+    }
+
+private:
+    struct Entry {
+        PreparedPreflight pf;
+        Clock::time_point storedAt;
+    };
+
+    void pruneLocked(Clock::time_point now) {
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            if (now - it->second.storedAt > ttl_) {
+                it = entries_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    std::chrono::milliseconds ttl_;
+    size_t capacity_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+};
+
+// Upcoming queue entries the look-ahead stage should prepare: up to depth Pending items after the
+// active front entry (call with the status lock held; returns copies).
+inline std::vector<QueueItem> lookaheadWindow(const std::vector<QueueItem>& queue, size_t depth) {
+    std::vector<QueueItem> out;
+    for (size_t i = 1; i < queue.size() && out.size() < depth; ++i) {
+        if (queue[i].state != QueueState::Pending) continue;
+        out.push_back(queue[i]);
+    }
+    return out;
+}
+
+// True when a queued bundle still needs metadata (files/URLs) before it can be downloaded.
+inline bool bundleNeedsResolve(const QueueItem& q) {
+    if (q.bundle.files.empty()) return q.game.downloadUrl.empty();
+    for (const auto& f : q.bundle.files) {
+        if (f.url.empty()) return true;
+    }
+    return false;
+}
+
+} // namespace romm
@@ -4,14 +4,29 @@
 #include <vector>
 #include <cstdint>
 #include "romm/models.hpp"
+#include "romm/download_segments.hpp"
 
 namespace romm {
 
 struct ManifestPart {
     int index{0};
     uint64_t size{0};
-    std::string sha256; // optional
+    std::string sha256; // hex digest of the whole part (set once the in-flight hash covered it)
     bool completed{false}; // true if part finished and flushed
+    // Part file was extended to `size` before data arrived; only the first `written` bytes are real.
+    // Resume trusts `written` (never the on-disk length) while this is set.
+    bool preallocated{false};
+    uint64_t written{0};
+    // In-flight hash of a partially written part: SHA-256 state after hashOffset bytes (hex),
+    // so a resumed transfer keeps hashing without re-reading the part.
+    uint64_t hashOffset{0};
+    std::string hashState{};
+    // Earlier state at checkOffset; resume re-hashes only [checkOffset, hashOffset or size)
+    // and compares the result with hashState / sha256.
+    uint64_t checkOffset{0};
+    std::string checkState{};
+    // Durable byte ranges of this part (part-relative), kept when the manifest has a range map.
+    RangeSet ranges{};
 };
 
 struct Manifest {
@@ -22,21 +37,42 @@ struct Manifest {
     uint64_t totalSize{0};
     uint64_t partSize{0};
     std::vector<ManifestPart> parts;
+    // Whole-file bytes flushed and fsynced at the last checkpoint. Once set, resume never trusts
+    // part bytes beyond it (they may be unflushed garbage after a crash).
+    bool hasDurableOffset{false};
+    uint64_t durableOffset{0};
+    // Parts carry a sparse map of durable ranges ("ranges" in JSON); resume then keeps every
+    // recorded range instead of only the contiguous prefix. Older manifests have none.
+    bool hasRangeMap{false};
     std::string failureReason; // optional: set when download aborted (e.g., preflight fail)
+    // Digests RomM reported for the file; the finished parts are checked against them.
+    FileChecksums checksums;
+    // Whole-file CRC-32 of the durable bytes [0, crcOffset) (8 hex digits), so resume keeps
+    // checksumming where it stopped instead of reading the prefix back.
+    uint64_t crcOffset{0};
+    std::string crcState{};
 };
 
 // Serialize/deserialize manifest as JSON strings (host-testable).
 std::string manifestToJson(const Manifest& m);
 bool manifestFromJson(const std::string& json, Manifest& out, std::string& err);
 
+// Store `have` (whole-file offsets, already durable) as the per-part range map and move
+// durableOffset to the end of its leading run, which is what older readers resume from.
+void recordDurableRanges(Manifest& m, const RangeSet& have);
+
 // Given a manifest and observed parts (sizes/hashes), decide what to resume/delete.
+// Without a range map resume is contiguous: everything after the first gap is invalid.
+// With one, every recorded range that is still on disk is kept, in any part, in any order.
 struct ResumePlan {
     std::vector<int> validParts;
     std::vector<int> invalidParts;
     uint64_t bytesHave{0};
     uint64_t bytesNeed{0};
-    int partialIndex{-1};
+    int partialIndex{-1};    // first part that is neither complete nor empty
     uint64_t partialBytes{0};
+    RangeSet have;                   // whole-file bytes to keep
+    std::vector<ByteRange> missing;  // whole-file ranges still to download, in order
 };
 
 ResumePlan planResume(const Manifest& m,
@@ -13,6 +13,16 @@ struct Platform {
     int romCount{0};
 };
 
+// Digests RomM computed for a file (lowercase hex; empty when the server did not hash it).
+struct FileChecksums {
+    std::string crc32; // 8 hex digits
+    std::string md5;
+    std::string sha1;
+    bool empty() const { return crc32.empty() && md5.empty() && sha1.empty(); }
+    bool operator==(const FileChecksums& o) const { return crc32 == o.crc32 && md5 == o.md5 && sha1 == o.sha1; }
+    bool operator!=(const FileChecksums& o) const { return !(*this == o); }
+};
+
 struct RomFile {
     std::string id;
     std::string name;
@@ -20,6 +30,7 @@ struct RomFile {
     std::string url;
     uint64_t sizeBytes{0};
     std::string category; // e.g., "game", "dlc", "update"
+    FileChecksums checksums;
 };
 
 struct Game {
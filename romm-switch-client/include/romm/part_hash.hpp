@@ -0,0 +1,57 @@
+#pragma once
+
+#include "romm/manifest.hpp"
+#include "romm/sha256.hpp"
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace romm {
+
+// Resume spot-check granularity: only bytes after the second-to-last 64KB boundary of the hashed
+// prefix (at most 128KB) are read back, never the whole part.
+constexpr uint64_t kHashCheckWindowBytes = 64 * 1024;
+
+// SHA-256 of one part's contiguous prefix, fed by the writer thread as bytes are committed.
+class PartHasher {
+public:
+    PartHasher();
+    // Continue a prefix hashed by an earlier transfer (seed.bytes = part offset).
+    explicit PartHasher(const Sha256::State& seed);
+
+    uint64_t offset() const { return sha_.bytes(); }
+    void update(const char* data, size_t len);
+
+    // Store the digest (prefix reached part.size) or the resumable state, plus a check anchor.
+    void record(ManifestPart& part) const;
+    // Rebuild from a manifest record whose hashed prefix ends exactly at partOffset.
+    static bool fromRecord(const ManifestPart& part, uint64_t partOffset, PartHasher& out);
+
+private:
+    const Sha256::State& checkAnchor() const;
+
+    Sha256 sha_;
+    Sha256::State anchors_[2]; // states at the two latest window boundaries (or the seed)
+};
+
+// Part index -> hasher. Parts written out of order (segmented) only hash their leading run.
+using PartHashes = std::map<uint64_t, PartHasher>;
+
+// 64 hex chars of chaining value followed by the hex tail (bytes % 64 bytes).
+std::string encodeHashState(const Sha256::State& s);
+bool decodeHashState(const std::string& hex, uint64_t bytes, Sha256::State& out);
+
+void clearPartHash(ManifestPart& part);
+
+// Forget hashers whose prefix reaches into bytes at or beyond durableEnd (those were trimmed).
+void dropHashesBeyond(PartHashes& hashes, uint64_t partSize, uint64_t durableEnd);
+// Same for a sparse durable set: keep a hasher only if its whole prefix is durable.
+void dropHashesOutside(PartHashes& hashes, uint64_t partSize, const RangeSet& durable);
+
+// Re-hash the check window of a part file and compare it with the manifest record.
+// Returns false only when the record proves the on-disk bytes wrong (err says why); parts
+// without a usable record, or whose size no longer matches it, are left to size checks.
+bool verifyPartHash(const std::string& path, const ManifestPart& part, uint64_t observedSize, std::string& err);
+
+} // namespace romm
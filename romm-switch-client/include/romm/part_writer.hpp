@@ -0,0 +1,143 @@
+#pragma once
+
+#include "romm/crc32.hpp"
+#include "romm/download_segments.hpp"
+#include "romm/part_hash.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace romm {
+
+// "00.part", "01.part", ... (two-digit minimum, matching finalize's sort order).
+std::string partFileName(uint64_t index);
+std::string partFilePath(const std::string& dir, uint64_t index);
+
+// How PartWriter moves bytes to the part files.
+//  Stdio: FILE* with a setvbuf buffer of ioBufferBytes (stdio picks the write boundaries).
+//  Raw:   plain fd; bytes are staged in an ioBufferBytes block and written with one write() per
+//         block, on offsets aligned to the block size. Aligned full blocks skip the staging copy.
+enum class WriteBackend { Stdio, Raw };
+
+// "stdio" / "raw"; anything else falls back to Stdio and returns false.
+bool parseWriteBackend(const std::string& name, WriteBackend& out);
+const char* writeBackendName(WriteBackend backend);
+
+// Writes bytes at absolute (whole-file) offsets into FAT32-friendly NN.part files.
+// Offsets are split by partSize; each part file is opened lazily and kept open with its own
+// buffer so writers that jump between parts (segmented downloads) don't reopen per write.
+// Not thread-safe: use one writer per thread (disjoint ranges may target the same part files).
+class PartWriter {
+public:
+    // Called before a part file is first opened; return false (and set err) to abort the write.
+    using OpenHook = std::function<bool(uint64_t partIndex, uint64_t globalOffset, std::string& err)>;
+    // Called right before a part file is extended to its full length (persist the unwritten extent).
+    using PreallocHook = std::function<void(uint64_t partIndex)>;
+
+    static constexpr size_t kDefaultOpenParts = 4;
+
+    PartWriter(std::string dir,
+               uint64_t partSize,
+               size_t ioBufferBytes = 256 * 1024,
+               WriteBackend backend = WriteBackend::Stdio);
+    ~PartWriter();
+
+    PartWriter(const PartWriter&) = delete;
+    PartWriter& operator=(const PartWriter&) = delete;
+
+    void setOpenHook(OpenHook hook) { openHook_ = std::move(hook); }
+    // Parts kept open at once; the least recently written one is closed to make room. Size it to
+    // the number of streams writing side by side, or every block evicts a part.
+    void setMaxOpenParts(size_t count) {
+        maxOpenParts_ = std::max<size_t>(count, 1);
+        open_.reserve(maxOpenParts_);
+    }
+    // Extend each part to its final length (from totalSize/partSize) when first opened, so the
+    // filesystem allocates clusters once instead of on every fwrite. 0 disables.
+    void setPreallocate(uint64_t totalSize, PreallocHook hook = {}) {
+        preallocTotal_ = totalSize;
+        preallocHook_ = std::move(hook);
+    }
+
+    // Hash each part's committed bytes in write order (see PartHasher). `seeds` continue parts
+    // hashed by an earlier transfer; a part without a seed starts hashing at its offset 0.
+    void enableHashing(PartHashes seeds = {}) {
+        hashing_ = true;
+        hashes_ = std::move(seeds);
+    }
+    const PartHashes& partHashes() const { return hashes_; }
+    // Track the whole-file CRC-32 of the committed bytes (see FileCrc), continuing `seed`.
+    void enableFileCrc(FileCrc seed = {}) {
+        crcing_ = true;
+        fileCrc_ = std::move(seed);
+    }
+    const FileCrc& fileCrc() const { return fileCrc_; }
+
+    bool write(uint64_t globalOffset, const char* data, size_t len, std::string& err);
+    // Push buffered bytes of all open parts to the files (Raw: writes the partial tail block).
+    bool flush(std::string& err);
+    // flush() plus fsync of every open part written since its last fsync: bytes written so far
+    // survive a power loss. Parts closed to make room for another are fsynced as they close.
+    bool sync(std::string& err);
+    // Close all open parts (flushes).
+    void close();
+
+    uint64_t partSize() const { return partSize_; }
+    WriteBackend backend() const { return backend_; }
+    const std::string& dir() const { return dir_; }
+    // fsync calls issued so far (by sync() and when a written part is closed to make room).
+    uint64_t fsyncCount() const { return fsyncs_; }
+
+private:
+    struct OpenPart {
+        uint64_t index{0};
+        FILE* file{nullptr};   // Stdio backend
+        int fd{-1};            // Raw backend
+        uint64_t pos{0};       // current file position within the part
+        uint64_t lastUse{0};
+        std::vector<char> buf; // stdio buffer (must outlive the FILE*) or Raw staging block
+        uint64_t stageStart{0}; // Raw: part offset of buf[0]
+        size_t stageLen{0};
+        bool dirty{false};      // written since its last fsync
+    };
+
+    OpenPart* openPart(uint64_t index, uint64_t globalOffset, std::string& err);
+    bool closePart(OpenPart& p);
+    bool writeRaw(OpenPart& p, uint64_t partOff, const char* data, size_t len, std::string& err);
+    bool writeAt(OpenPart& p, uint64_t partOff, const char* data, size_t len, std::string& err);
+    bool flushStage(OpenPart& p, std::string& err);
+    bool syncPart(OpenPart& p, std::string& err);
+    void hashWritten(uint64_t partIndex, uint64_t partOff, const char* data, size_t len);
+
+    std::string dir_;
+    uint64_t partSize_{0};
+    size_t ioBufferBytes_{0};
+    WriteBackend backend_{WriteBackend::Stdio};
+    size_t maxOpenParts_{kDefaultOpenParts};
+    uint64_t useCounter_{0};
+    uint64_t fsyncs_{0};
+    uint64_t preallocTotal_{0};
+    OpenHook openHook_;
+    PreallocHook preallocHook_;
+    bool hashing_{false};
+    PartHashes hashes_;
+    bool crcing_{false};
+    FileCrc fileCrc_;
+    std::vector<OpenPart> open_;
+};
+
+// Reserve length bytes for an open file (posix_fallocate where available, else ftruncate).
+bool preallocateFile(int fd, uint64_t length);
+
+// Trim part files so only bytes below durableEnd remain (later parts are removed).
+// Used when a contiguous (legacy) resume point is all that can be trusted.
+bool truncatePartsTo(const std::string& dir, uint64_t partSize, uint64_t durableEnd, std::string& err);
+// Cut each part file back to the end of the last kept range inside it (whole-file offsets);
+// parts with no kept byte are removed. Holes inside a part stay and are refetched later.
+bool truncatePartsToRanges(const std::string& dir, uint64_t partSize, const RangeSet& keep, std::string& err);
+
+} // namespace romm
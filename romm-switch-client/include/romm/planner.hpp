@@ -13,6 +13,7 @@ struct DownloadFileSpec {
     uint64_t sizeBytes{0};
     std::string relativePath; // optional subpath within bundle output
     std::string category;      // e.g., game/dlc/update
+    FileChecksums checksums;   // verified before finalize when present
 };
 
 struct DownloadBundle {
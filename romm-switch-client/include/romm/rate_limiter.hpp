@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace romm {
+
+// Local time-of-day window with its own cap. end <= start wraps past midnight.
+struct RateWindow {
+    int startMinute{0};     // minutes since local midnight, 0..1439
+    int endMinute{0};
+    uint64_t bytesPerSec{0}; // 0 = unlimited inside the window
+};
+
+struct RateLimitConfig {
+    uint64_t bytesPerSec{0};       // sustained cap outside any window; 0 = unlimited
+    uint64_t burstBytes{0};        // bucket size; 0 = one second at the current cap
+    std::vector<RateWindow> schedule;
+};
+
+// "HH:MM-HH:MM=KB[,...]" (KB/s per window, 0 = unlimited). Empty text is an empty schedule.
+bool parseRateSchedule(const std::string& text, std::vector<RateWindow>& out, std::string& err);
+
+// Token bucket shared by every connection the download worker opens. Callers report bytes after
+// receiving them; acquire() sleeps off any debt, which backs pressure up into the socket.
+class RateLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Time hooks; the defaults use steady_clock, sleep_for and the local wall clock.
+    // Tests plug in a simulated clock whose sleep() just advances now().
+    struct TimeSource {
+        std::function<Clock::time_point()> now;
+        std::function<void(std::chrono::microseconds)> sleep;
+        std::function<int()> minuteOfDay;
+    };
+
+    RateLimiter();
+    explicit RateLimiter(TimeSource time);
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    // Replace the caps; the bucket starts full.
+    void configure(const RateLimitConfig& cfg);
+    bool enabled() const;
+
+    // Take bytes from the bucket, sleeping while it is in debt. Returns false if cancel was set
+    // while waiting (the bytes stay charged).
+    bool acquire(uint64_t bytes, const std::atomic<bool>* cancel = nullptr);
+
+    // Cap in effect right now (after the schedule); 0 = unlimited.
+    uint64_t currentBytesPerSec() const;
+    // Total time callers spent sleeping in acquire().
+    uint64_t throttledMs() const { return throttledUs_.load(std::memory_order_relaxed) / 1000; }
+
+private:
+    uint64_t rateForMinuteLocked(int minute) const;
+    void refillLocked(Clock::time_point now);
+
+    TimeSource time_;
+    mutable std::mutex mutex_;
+    RateLimitConfig cfg_;
+    uint64_t rate_{0};   // current cap (schedule applied)
+    double burst_{0.0};
+    double tokens_{0.0}; // negative = debt callers are sleeping off
+    Clock::time_point last_{};
+    Clock::time_point lastScheduleCheck_{};
+    std::atomic<uint64_t> throttledUs_{0};
+};
+
+} // namespace romm
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+
+#include "romm/errors.hpp"
+
+namespace romm {
+
+// Limits for in-session retries of one queue item (shared by every file of a bundle).
+struct RetryPolicy {
+    int maxRetries{10};               // retries per item, whatever file they belong to
+    uint32_t baseDelayMs{500};        // first backoff
+    uint32_t maxDelayMs{8000};        // cap for a single backoff
+    uint64_t maxTotalDelayMs{120000}; // backoff time the item may spend waiting in total
+};
+
+struct RetryDecision {
+    bool retry{false};
+    uint32_t delayMs{0};
+    std::string reason; // why the item gives up (empty when retrying)
+};
+
+// Backoff for the n-th consecutive failure (n >= 1): base * 2^(n-1), capped at maxDelayMs, with
+// "equal jitter" (uniform in [d/2, d]) so parallel connections do not reconnect in lockstep.
+// `random` is any 32-bit value; the same value always gives the same delay.
+uint32_t backoffDelayMs(const RetryPolicy& policy, int failure, uint32_t random);
+
+// Retry bookkeeping for one queue item. Failures are classified through classifyError's
+// retryable flag; an attempt that moved the durable offset forward restarts the backoff from
+// the base delay (the link recovered for a while) but still spends one retry of the budget.
+// Thread-safe: bundle files stream in parallel and share one budget.
+class RetryBudget {
+public:
+    // Jitter is seeded from the clock; tests pass a fixed seed.
+    explicit RetryBudget(const RetryPolicy& policy = RetryPolicy{});
+    RetryBudget(const RetryPolicy& policy, uint32_t seed);
+
+    RetryDecision onFailure(const ErrorInfo& info, bool madeProgress);
+
+    int retriesUsed() const;
+    uint64_t delayedMs() const;
+    const RetryPolicy& policy() const { return policy_; }
+
+private:
+    RetryPolicy policy_;
+    mutable std::mutex mutex_;
+    std::minstd_rand rng_;
+    int retries_{0};
+    int streak_{0}; // consecutive failures without progress
+    uint64_t delayedMs_{0};
+};
+
+} // namespace romm
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace romm {
+
+// Incremental SHA-256. Compresses with the ARMv8 SHA2 instructions when the target has them
+// (Switch build: -march=armv8-a+crypto) and with portable C++ otherwise.
+class Sha256 {
+public:
+    using Digest = std::array<uint8_t, 32>;
+
+    // Everything needed to continue hashing later: chaining value, byte count and the
+    // not-yet-compressed tail (bytes % 64 valid entries).
+    struct State {
+        std::array<uint32_t, 8> h{};
+        uint64_t bytes{0};
+        std::array<uint8_t, 64> tail{};
+
+        bool operator==(const State& o) const;
+        bool operator!=(const State& o) const { return !(*this == o); }
+    };
+
+    Sha256();
+    explicit Sha256(const State& s) : s_(s) {}
+
+    void update(const void* data, size_t len);
+    // Digest of everything fed so far; pads a copy, so hashing can continue afterwards.
+    Digest digest() const;
+
+    const State& state() const { return s_; }
+    uint64_t bytes() const { return s_.bytes; }
+
+    static Digest hash(const void* data, size_t len);
+    static std::string toHex(const Digest& d);
+    // True when compiled with the hardware compression path.
+    static bool accelerated();
+
+private:
+    State s_;
+};
+
+} // namespace romm
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace romm {
+
+struct StallPolicy {
+    uint64_t windowMs{5000};                      // a connection's rate is measured over this window
+    uint64_t warmupMs{8000};                      // never judge a connection younger than this
+    double lagRatio{0.2};                         // flagged below this share of the baseline
+    double minBaselineBytesPerSec{256.0 * 1024};  // whole link this slow: nothing to gain from hedging
+    double baselineAlpha{0.3};                    // EWMA weight of each new baseline sample
+};
+
+// Spots "zombie" connections that still trickle data (so libcurl's low-speed timeout never fires)
+// but fell far behind what the link has been delivering. The baseline is an EWMA of the median
+// windowed rate of the healthy connections, so it works with one connection (its own history) as
+// well as with several (its peers). Not thread-safe: owned by the thread that monitors the streams.
+class StallDetector {
+public:
+    explicit StallDetector(const StallPolicy& policy = StallPolicy{});
+
+    // Start watching a connection; returns its id.
+    int track(uint64_t nowMs);
+    void untrack(int id);
+    // Cumulative bytes the connection has received so far.
+    void sample(int id, uint64_t bytes, uint64_t nowMs);
+    // Forget the rate history (e.g. the SD card, not the link, held the connections back).
+    void restartWindows(uint64_t nowMs);
+
+    // Refresh the baseline and return connections that just fell behind (each is reported once).
+    std::vector<int> poll(uint64_t nowMs);
+
+    double baseline() const { return baseline_; }
+    // Rate over the last full window; 0 while the window is not full yet.
+    double rate(int id) const;
+
+private:
+    struct Conn {
+        int id{0};
+        uint64_t startMs{0};
+        std::deque<std::pair<uint64_t, uint64_t>> samples; // (ms, cumulative bytes)
+        bool flagged{false};
+    };
+
+    Conn* find(int id);
+    const Conn* find(int id) const;
+    double windowRate(const Conn& c) const;
+
+    StallPolicy policy_;
+    std::vector<Conn> conns_;
+    int nextId_{0};
+    double baseline_{0.0};
+};
+
+// Byte range shared by a connection and its hedge. Both read the same bytes; whichever is ahead
+// writes them, the other drops what was already written, so the range is always committed as
+// one contiguous run from `start` and there is never a second writer for the same byte.
+// Thread-safe: each connection delivers from its own thread.
+class RaceCursor {
+public:
+    using WriteFn = std::function<bool(uint64_t offset, const char* data, size_t len, std::string& err)>;
+
+    RaceCursor(uint64_t start, uint64_t end, WriteFn write);
+
+    // `len` bytes a connection received at absolute offset `pos`. Returns the bytes that were new
+    // in `wrote`. A connection must start at or below the cursor; a gap above it is an error.
+    bool deliver(uint64_t pos, const char* data, size_t len, size_t& wrote, std::string& err);
+
+    uint64_t cursor() const;
+    uint64_t end() const { return end_; }
+    bool complete() const { return cursor() >= end_; }
+
+private:
+    const uint64_t end_;
+    WriteFn write_;
+    mutable std::mutex mutex_;
+    uint64_t cursor_;
+};
+
+} // namespace romm
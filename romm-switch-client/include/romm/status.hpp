@@ -4,7 +4,11 @@
 #include "romm/errors.hpp"
 #include "romm/platform_prefs.hpp"
 #include "romm/planner.hpp"
+#include "romm/write_pipeline.hpp"
+#include "romm/connection_pool.hpp"
+#include "romm/throughput.hpp"
 #include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
 #include <mutex>
@@ -28,6 +32,15 @@ struct QueueItem {
         : game(g), state(s), error(errStr) {}
 };
 
+// Progress of one file in the active bundle. Counters are atomic so the UI can read them
+// through a shared_ptr copy without holding the status lock.
+struct FileProgress {
+    std::string name;
+    std::atomic<uint64_t> size{0};
+    std::atomic<uint64_t> downloaded{0};
+    std::atomic<bool> finished{false};
+};
+
 struct WorkerEvent {
     WorkerEventType type{WorkerEventType::DownloadFailureState};
     bool failed{false};
@@ -82,7 +95,13 @@ struct Status {
     std::atomic<uint64_t> totalDownloadBytes{0};
     std::atomic<uint64_t> totalDownloadedBytes{0};
     std::string currentDownloadTitle;
-    double lastSpeedMBps{0.0}; // last measured throughput in MB/s, updated by worker
+    std::vector<std::shared_ptr<FileProgress>> activeFiles; // files of the bundle in flight (vector guarded by mutex)
+    ThroughputMeter throughput; // bytes received by every stream; rate/ETA read lock-free by the UI
+    WriteQueueStats writeQueueStats; // writer-thread ring depth/stalls (lock-free; diagnostics)
+    ConnectionStats connectionStats; // downloader keep-alive reuse (lock-free; diagnostics)
+    // Finalize stage: progress of a copy fallback in flight (both 0 while finalize is a plain rename).
+    std::atomic<uint64_t> finalizeCopyDone{0};
+    std::atomic<uint64_t> finalizeCopyTotal{0};
     std::atomic<bool> downloadWorkerRunning{false};
     std::atomic<bool> lastDownloadFailed{false};
     std::string lastDownloadError;
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace romm {
+
+struct ThroughputSnapshot {
+    double bytesPerSec{0.0};     // EWMA over the completed seconds of the window
+    double lastSecondBytes{0.0}; // the most recent completed second
+    double averageBytesPerSec{0.0}; // mean since the first active second in the window
+    uint64_t peakBytesPerSec{0}; // busiest completed second in the window
+    uint64_t minBytesPerSec{0};  // slowest completed second since the first active one
+    uint64_t totalBytes{0};      // every byte counted since reset()
+    bool active{false};          // bytes arrived within the window
+};
+
+// Download rate meter. Producers (every receive callback, on any thread) call add(), which is one
+// lock-free CAS on the bucket of the current second in a ring of kWindowSeconds buckets. Readers
+// (the UI, heartbeats) derive everything in snapshot() from the ring without locks or writes, so
+// the hot path never contends with the render loop and nobody has to drive a sampling timer.
+class ThroughputMeter {
+public:
+    static constexpr size_t kWindowSeconds = 60;
+    static constexpr double kEwmaAlpha = 0.2; // weight of each new second (~5s time constant)
+
+    // Milliseconds on a monotonic clock; the default is steady_clock. Tests pass a fake clock.
+    using NowFn = std::function<uint64_t()>;
+
+    ThroughputMeter();
+    explicit ThroughputMeter(NowFn now);
+
+    ThroughputMeter(const ThroughputMeter&) = delete;
+    ThroughputMeter& operator=(const ThroughputMeter&) = delete;
+
+    void add(uint64_t bytes);
+    ThroughputSnapshot snapshot() const;
+
+    // Empty the window. Not safe against concurrent add(); call while no transfer runs.
+    void reset();
+
+    // Seconds until `remainingBytes` arrive at `bytesPerSec`; -1 when unknown (no rate yet).
+    static int64_t etaSeconds(uint64_t remainingBytes, double bytesPerSec);
+
+private:
+    // Bucket word: high 24 bits tag the second (second index + 1, wrapped; 0 = never used),
+    // low 40 bits count its bytes (1TB per second is plenty).
+    static constexpr int kTagShift = 40;
+    static constexpr uint64_t kCountMask = (1ULL << kTagShift) - 1;
+    static constexpr uint64_t kTagMask = (1ULL << 24) - 1;
+
+    static uint64_t tagOf(uint64_t second) { return ((second + 1) & kTagMask) << kTagShift; }
+    uint64_t secondNow() const;
+    uint64_t bytesIn(uint64_t second) const;
+
+    NowFn now_;
+    std::atomic<uint64_t> originMs_{0};
+    std::atomic<uint64_t> total_{0};
+    std::array<std::atomic<uint64_t>, kWindowSeconds> ring_{};
+};
+
+} // namespace romm
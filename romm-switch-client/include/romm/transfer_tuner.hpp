@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace romm {
+
+// Knobs the tuner moves. writeBatchBytes applies to a running stream; the others are picked up
+// when the next stream starts (next file, retry, or bundle file).
+struct TuningParams {
+    size_t recvBufferBytes{256 * 1024};  // libcurl receive buffer + SO_RCVBUF
+    size_t ioBufferBytes{256 * 1024};    // stdio buffer of each part file
+    size_t writeBatchBytes{1024 * 1024}; // bytes staged per block handed to the writer thread
+    int connections{1};                  // Range connections per file (segmented mode)
+};
+
+struct TuningBounds {
+    TuningParams min;
+    TuningParams max;
+};
+
+// One measurement window of a running stream.
+struct TuningSample {
+    uint64_t bytes{0};       // received in the window
+    uint64_t elapsedMs{0};
+    uint64_t stallMs{0};     // network side waiting for a free ring block (SD slower than link)
+    uint64_t throttledMs{0}; // time spent in the bandwidth limiter
+};
+
+// Closed-loop hill climber over the receive/write knobs, shared by every stream of the worker.
+// Each window is classified as SD-bound (writer stalls) or network-bound (no stalls); one knob is
+// stepped in the direction that regime suggests, then kept if the next window is measurably faster
+// (or, for dropping a connection, not measurably slower) and reverted and left alone for a while
+// otherwise. Every decision comes back as a log line.
+class TransferTuner {
+public:
+    static constexpr uint64_t kMinWindowMs = 4000;
+    static constexpr uint64_t kMinWindowBytes = 8ULL * 1024ULL * 1024ULL;
+    static constexpr double kMinGain = 0.05;        // keep a step only if it is >= 5% faster
+    static constexpr double kSdBoundStall = 0.15;   // stall share of the window that means "SD-bound"
+    static constexpr double kNetBoundStall = 0.02;
+    static constexpr int kHoldWindows = 8;          // windows a reverted knob is left alone
+
+    TransferTuner() = default;
+
+    // Start over from `start` (clamped to bounds); called when the worker starts.
+    void reset(const TuningBounds& bounds, const TuningParams& start);
+    // Parameters for a stream that is about to start; activates steps waiting for a new stream.
+    TuningParams beginStream();
+    TuningParams current() const;
+
+    // Feed one window. Returns a human-readable decision when a knob moved, otherwise "".
+    // Windows shorter than kMinWindowMs / kMinWindowBytes, or mostly throttled, are ignored.
+    std::string observe(const TuningSample& sample);
+
+private:
+    enum Knob { kRecvBuffer = 0, kIoBuffer, kWriteBatch, kConnections, kKnobCount };
+
+    struct Trial {
+        Knob knob{kKnobCount};
+        TuningParams before;
+        double baseline{0.0};     // bytes/s before the step
+        bool down{false};         // shrinking step: kept unless it costs throughput
+        bool awaitingStream{false};
+    };
+
+    bool stepLocked(Knob knob, bool down, TuningParams& p) const;
+    static bool liveKnob(Knob knob) { return knob == kWriteBatch; }
+    static const char* knobName(Knob knob);
+    static std::string knobValue(Knob knob, const TuningParams& p);
+
+    mutable std::mutex mutex_;
+    TuningBounds bounds_;
+    TuningParams params_;
+    Trial trial_;
+    int hold_[kKnobCount][2]{}; // [knob][down]
+};
+
+// Feeds a TransferTuner one series of windows for all streams running at once (bundle files side by
+// side): each window holds the bytes every stream received, measured against the shared writer-stall
+// and limiter clocks, so a trial step is judged on the same aggregate its baseline came from. The
+// window is dropped whenever a stream starts or ends, since the rate then moves for reasons other
+// than the knobs, and while no stream runs. Thread-safe.
+class TuningSampler {
+public:
+    // Running totals of the shared clocks at `nowMs` (any monotonic millisecond clock).
+    struct Clocks {
+        uint64_t nowMs{0};
+        uint64_t stallMs{0};
+        uint64_t throttledMs{0};
+    };
+
+    static constexpr uint64_t kMaxWindowMs = 60000; // slow links: give up on a window after a minute
+
+    explicit TuningSampler(TransferTuner& tuner) : tuner_(tuner) {}
+
+    void streamStarted(const Clocks& clocks);
+    void streamEnded(const Clocks& clocks);
+    // A stream received `bytes` more.
+    void add(uint64_t bytes);
+    // Close the window once it is long enough and feed it to the tuner. Returns the decision, if any.
+    std::string poll(const Clocks& clocks);
+    int activeStreams() const;
+
+private:
+    void restartLocked(const Clocks& clocks);
+
+    TransferTuner& tuner_;
+    mutable std::mutex mutex_;
+    int active_{0};
+    uint64_t bytes_{0};
+    Clocks start_;
+};
+
+} // namespace romm
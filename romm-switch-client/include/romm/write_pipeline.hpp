@@ -0,0 +1,179 @@
+#pragma once
+
+#include "romm/part_writer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace romm {
+
+// Shared counters for the download write path; read lock-free by the UI/diagnostics.
+struct WriteQueueStats {
+    std::atomic<uint32_t> depth{0};        // filled blocks waiting for the writer thread
+    std::atomic<uint32_t> peakDepth{0};
+    std::atomic<uint64_t> stallCount{0};   // producer waits for a free block (SD slower than network)
+    std::atomic<uint64_t> stallMs{0};
+    std::atomic<uint64_t> bytesWritten{0};
+
+    void reset() {
+        depth.store(0);
+        peakDepth.store(0);
+        stallCount.store(0);
+        stallMs.store(0);
+        bytesWritten.store(0);
+    }
+};
+
+// Bounded ring of preallocated blocks: producers acquire/fill/submit, one consumer pops/recycles.
+// No allocation after construction; acquire() blocks while every block is in flight.
+class BlockRing {
+public:
+    struct Block {
+        uint64_t offset{0};
+        size_t len{0};
+        std::atomic<uint64_t>* written{nullptr}; // bumped by the consumer once len bytes are committed
+        std::vector<char> data;
+    };
+
+    BlockRing(size_t blockBytes, size_t blockCount, WriteQueueStats* stats = nullptr);
+
+    BlockRing(const BlockRing&) = delete;
+    BlockRing& operator=(const BlockRing&) = delete;
+
+    // Producer side. acquire() returns nullptr once the ring is aborted.
+    Block* acquire();
+    void submit(Block* b);
+    // Hand back a block without queueing it (e.g. producer gave up).
+    void recycle(Block* b);
+
+    // Consumer side: next filled block in FIFO order; nullptr when closed and drained, or aborted.
+    Block* pop();
+
+    void close();
+    void abort();
+    bool aborted() const;
+
+    size_t blockBytes() const { return blockBytes_; }
+    size_t blockCount() const { return blocks_.size(); }
+
+private:
+    size_t blockBytes_{0};
+    std::vector<Block> blocks_;
+    std::vector<Block*> free_;
+    std::deque<Block*> filled_;
+    bool closed_{false};
+    bool aborted_{false};
+    WriteQueueStats* stats_{nullptr};
+    mutable std::mutex mutex_;
+    std::condition_variable freeCv_;
+    std::condition_variable filledCv_;
+};
+
+// Decouples network receive from SD writes: producers copy into the ring and return immediately,
+// a dedicated writer thread drains blocks into a PartWriter (part rotation, open hook, fwrite).
+class AsyncPartWriter {
+public:
+    AsyncPartWriter(const std::string& dir,
+                    uint64_t partSize,
+                    size_t blockBytes,
+                    size_t blockCount,
+                    WriteQueueStats* stats = nullptr,
+                    size_t ioBufferBytes = 256 * 1024,
+                    WriteBackend backend = WriteBackend::Stdio);
+    ~AsyncPartWriter();
+
+    AsyncPartWriter(const AsyncPartWriter&) = delete;
+    AsyncPartWriter& operator=(const AsyncPartWriter&) = delete;
+
+    // Set before start(); the hook runs on the writer thread.
+    void setOpenHook(PartWriter::OpenHook hook) { sink_.setOpenHook(std::move(hook)); }
+    void setMaxOpenParts(size_t count) { sink_.setMaxOpenParts(count); }
+    void setPreallocate(uint64_t totalSize, PartWriter::PreallocHook hook = {}) {
+        sink_.setPreallocate(totalSize, std::move(hook));
+    }
+    void enableHashing(PartHashes seeds = {}) { sink_.enableHashing(std::move(seeds)); }
+    void enableFileCrc(FileCrc seed = {}) { sink_.enableFileCrc(std::move(seed)); }
+    // Runs on the writer thread right after the open parts were flushed and fsynced, so every
+    // byte counted by Stream::written() is durable. Receives the current hashed prefixes.
+    using CheckpointHook = std::function<void(const PartHashes& hashes)>;
+    // Checkpoint every `everyBytes` committed bytes or `everyMs` (whichever comes first, checked
+    // per block), and once more in finish(). Set before start().
+    void setCheckpoint(uint64_t everyBytes, uint32_t everyMs, CheckpointHook hook) {
+        checkpointBytes_ = everyBytes;
+        checkpointMs_ = everyMs;
+        checkpointHook_ = std::move(hook);
+    }
+    void start();
+    // Bytes a Stream stages before handing a block to the writer (clamped to 1..blockBytes).
+    // May change while streaming; blocks already being filled keep going up to the new size.
+    void setBatchBytes(size_t bytes) {
+        batchBytes_.store(std::clamp<size_t>(bytes, 1, ring_.blockBytes()), std::memory_order_relaxed);
+    }
+    size_t batchBytes() const { return batchBytes_.load(std::memory_order_relaxed); }
+    // Hashed prefixes per part; read only after finish()/abort().
+    const PartHashes& partHashes() const { return sink_.partHashes(); }
+    // Whole-file CRC runs of the committed bytes; read in the checkpoint hook or after finish()/abort().
+    const FileCrc& fileCrc() const { return sink_.fileCrc(); }
+
+    // Per-producer staging: coalesces contiguous writes into full blocks before queueing them.
+    // One Stream per producing thread; call flush() before the owner's finish().
+    class Stream {
+    public:
+        explicit Stream(AsyncPartWriter& owner) : owner_(owner) {}
+        ~Stream();
+
+        Stream(const Stream&) = delete;
+        Stream& operator=(const Stream&) = delete;
+
+        bool write(uint64_t offset, const char* data, size_t len, std::string& err);
+        // Queue the partially filled block (if any).
+        bool flush(std::string& err);
+        // Bytes of this stream the writer thread has committed to the part files.
+        uint64_t written() const { return written_.load(std::memory_order_acquire); }
+
+    private:
+        bool submitCurrent(std::string& err);
+
+        AsyncPartWriter& owner_;
+        BlockRing::Block* cur_{nullptr};
+        std::atomic<uint64_t> written_{0};
+    };
+
+    // Close the ring, wait for the writer to drain it, then flush/close the part files.
+    bool finish(std::string& err);
+    // Drop queued blocks and stop the writer thread.
+    void abort();
+
+    bool failed() const { return failed_.load(std::memory_order_acquire); }
+    std::string error() const;
+
+private:
+    void run();
+    void fail(const std::string& err);
+    bool checkpoint(std::string& err);
+
+    PartWriter sink_;
+    BlockRing ring_;
+    std::atomic<size_t> batchBytes_{0};
+    WriteQueueStats* stats_{nullptr};
+    CheckpointHook checkpointHook_;
+    uint64_t checkpointBytes_{0};
+    uint32_t checkpointMs_{0};
+    uint64_t sinceCheckpoint_{0};
+    std::chrono::steady_clock::time_point lastCheckpoint_{};
+    std::thread thread_;
+    std::atomic<bool> failed_{false};
+    mutable std::mutex errMutex_;
+    std::string err_;
+};
+
+} // namespace romm
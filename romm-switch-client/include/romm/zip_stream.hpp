@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace romm {
+
+struct ZipEntry {
+    std::string name;            // path inside the archive ('/' separated)
+    uint16_t method{0};          // 0 = stored, 8 = deflate
+    uint16_t flags{0};
+    uint32_t crc32{0};           // from the local header, or the data descriptor once it was read
+    uint64_t compressedSize{0};
+    uint64_t uncompressedSize{0};
+    bool sizesInDescriptor{false}; // general-purpose bit 3: crc/sizes follow the data
+    bool zip64{false};
+};
+
+// Push parser for a ZIP archive read front to back, as it comes off the network: local file
+// headers, then each entry's data (stored, or deflate through zlib) handed out decompressed, CRC
+// checked at the end of the entry. The central directory is never needed; reaching it ends the
+// archive. Entries whose size is only in a trailing data descriptor work for deflate (the stream
+// ends itself); a stored one needs the size supplied by onEntry.
+class ZipStreamReader {
+public:
+    struct Handler {
+        // New entry. Return false to abort. Set skip to drop its data; for a stored entry with
+        // sizesInDescriptor, set sizeHint to its expected size (0 fails the archive).
+        std::function<bool(const ZipEntry& entry, bool& skip, uint64_t& sizeHint)> onEntry;
+        // Decompressed bytes of the current entry, in order.
+        std::function<bool(const char* data, size_t len)> onData;
+        // The entry's data ended and matched its CRC and size.
+        std::function<bool(const ZipEntry& entry)> onEntryEnd;
+    };
+
+    explicit ZipStreamReader(Handler handler);
+    ~ZipStreamReader();
+
+    ZipStreamReader(const ZipStreamReader&) = delete;
+    ZipStreamReader& operator=(const ZipStreamReader&) = delete;
+
+    // Feed the next bytes of the archive. After an error, the reader stays failed.
+    bool feed(const char* data, size_t len, std::string& err);
+    // The central directory (or end record) was reached: every entry has been seen.
+    bool finished() const { return state_ == State::Done; }
+    uint64_t entriesSeen() const { return entries_; }
+
+private:
+    enum class State { Signature, Header, Names, Data, Descriptor, Done, Failed };
+    struct Inflater;
+
+    bool fail(const std::string& msg, std::string& err);
+    bool take(const char*& p, size_t& n, size_t want);
+    void parseHeader();
+    void parseNames();
+    bool startData(std::string& err);
+    bool dataStored(const char*& p, size_t& n, std::string& err);
+    bool dataDeflate(const char*& p, size_t& n, std::string& err);
+    bool endData(std::string& err);
+    bool endEntry(std::string& err);
+    bool emit(const char* data, size_t len, std::string& err);
+
+    Handler handler_;
+    State state_{State::Signature};
+    std::string buf_;            // bytes of a header/descriptor split across feed() calls
+    bool descriptorSigChecked_{false};
+    ZipEntry entry_;
+    uint16_t nameLen_{0};
+    uint16_t extraLen_{0};
+    bool skip_{false};
+    uint64_t remaining_{0};      // stored: bytes left in the entry
+    uint64_t compressedRead_{0};
+    uint64_t produced_{0};       // decompressed bytes of the entry so far
+    uint32_t crc_{0};
+    uint64_t entries_{0};
+    std::unique_ptr<Inflater> inflater_;
+    std::vector<char> out_;
+};
+
+} // namespace romm
@@ -3,6 +3,8 @@
 #include "romm/util.hpp"
 #include "romm/raii.hpp"
 #include "romm/http_common.hpp"
+#include "romm/http_cache.hpp"
+#include "romm/http_single_flight.hpp"
 #include "mini/json.hpp"
 // TODO(http): centralize HTTP client with structured errors/timeouts and optional token auth.
 
@@ -272,10 +274,12 @@ bool decodeChunkedBody(const std::string& body, std::string& decoded) {
 // Low-level HTTP request: no JSON assumptions.
 // Returns true if we got *any* HTTP response (even 4xx/5xx).
 // resp.statusCode will be 0 on protocol/parse failure.
+// acceptCompressed: let the server gzip/deflate the body (text such as JSON); resp.body is decoded.
 bool httpRequest(const std::string& method,
                  const std::string& url,
                  const std::vector<std::pair<std::string, std::string>>& extraHeaders,
                  int timeoutSec,
+                 bool acceptCompressed,
                  HttpResponse& resp,
                  std::string& err)
 {
@@ -283,6 +287,9 @@ bool httpRequest(const std::string& method,
     options.timeoutSec = timeoutSec;
     options.keepAlive = true;
     options.decodeChunked = true;
+    options.acceptCompressed = acceptCompressed;
+    options.cache = &httpResponseCache();
+    options.singleFlight = &httpSingleFlight();
 
     HttpTransaction tx;
     if (!romm::httpRequestBuffered(method, url, extraHeaders, options, tx, err)) {
@@ -327,6 +334,7 @@ bool httpRequest(const std::string&,
                  const std::string&,
                  const std::vector<std::pair<std::string, std::string>>&,
                  int,
+                 bool,
                  HttpResponse&,
                  std::string& err) {
     err = "httpRequest not available in UNIT_TEST build";
@@ -468,7 +476,8 @@ static bool httpGetJsonWithRetry(const std::string& url,
     for (int attempt = 1; attempt <= maxAttempts; ++attempt) {
         HttpResponse r;
         std::string e;
-        if (httpRequest("GET", url, headers, timeoutSec, r, e)) {
+        // Catalog pages are large, repetitive JSON that shrinks several-fold gzipped.
+        if (httpRequest("GET", url, headers, timeoutSec, true, r, e)) {
             hadHttpResponse = true;
             resp = std::move(r);
             if (resp.statusCode >= 200 && resp.statusCode < 300) {
@@ -520,6 +529,22 @@ static std::string valToString(const mini::Value& v) {
     return {};
 }
 
+// Lowercase hex digest of `digits` characters from a RomM file object ("crc_hash", ...). Missing
+// or malformed values come back empty, so they are never verified against.
+static std::string hexDigestField(const mini::Object& o, const char* key, size_t digits) {
+    auto it = o.find(key);
+    if (it == o.end() || it->second.type != mini::Value::Type::String) return {};
+    std::string hex = it->second.str;
+    // crc_hash may arrive without leading zeros.
+    if (digits == 8 && !hex.empty() && hex.size() < digits) hex.insert(0, digits - hex.size(), '0');
+    if (hex.size() != digits) return {};
+    for (auto& c : hex) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        if (!std::isxdigit(static_cast<unsigned char>(c))) return {};
+    }
+    return hex;
+}
+
 static std::string previewText(const std::string& s, size_t maxlen = 64) {
     if (s.size() <= maxlen) return s;
     return s.substr(0, maxlen) + "...";
@@ -1124,6 +1149,9 @@ bool enrichGameWithFiles(const Config& cfg, Game& g, std::string& outError, Erro
         rf.url = finalUrl;
         rf.sizeBytes = fsize;
         rf.category = category;
+        rf.checksums.crc32 = hexDigestField(fo, "crc_hash", 8);
+        rf.checksums.md5 = hexDigestField(fo, "md5_hash", 32);
+        rf.checksums.sha1 = hexDigestField(fo, "sha1_hash", 40);
         g.files.push_back(rf);
 
         std::string lower = fname;
@@ -1181,7 +1209,7 @@ bool fetchBinary(const Config& cfg, const std::string& url, std::string& outData
     std::vector<std::pair<std::string,std::string>> headers;
     headers.emplace_back("Accept", "*/*");
     if (!auth.empty()) headers.emplace_back("Authorization", "Basic " + auth);
-    if (!httpRequest("GET", url, headers, cfg.httpTimeoutSeconds, resp, err)) {
+    if (!httpRequest("GET", url, headers, cfg.httpTimeoutSeconds, false, resp, err)) {
         setApiError(outError, outInfo, err, ErrorCategory::Network);
         return false;
     }
@@ -124,6 +124,30 @@ static bool parseEnvStream(std::istream& in, Config& outCfg) {
             outCfg.fat32Safe = (v == "1" || v == "true" || v == "yes");
         } else if (key == "log_level") outCfg.logLevel = toLower(val);
         else if (key == "speed_test_url") outCfg.speedTestUrl = val;
+        else if (key == "download_connections") outCfg.downloadConnections = std::atoi(val.c_str());
+        else if (key == "bundle_concurrency") outCfg.bundleConcurrency = std::atoi(val.c_str());
+        else if (key == "lookahead_depth") outCfg.lookaheadDepth = std::atoi(val.c_str());
+        else if (key == "write_backend") outCfg.writeBackend = toLower(val);
+        else if (key == "hash_parts") {
+            std::string v = toLower(val);
+            outCfg.hashParts = (v == "1" || v == "true" || v == "yes");
+        }
+        else if (key == "archive_bundles") {
+            std::string v = toLower(val);
+            outCfg.archiveBundles = (v == "1" || v == "true" || v == "yes");
+        }
+        else if (key == "http2") {
+            std::string v = toLower(val);
+            outCfg.http2 = (v == "1" || v == "true" || v == "yes");
+        }
+        else if (key == "http_cache_mb") outCfg.httpCacheMb = std::atoi(val.c_str());
+        else if (key == "rate_limit_kbps") outCfg.rateLimitKBps = std::atoi(val.c_str());
+        else if (key == "rate_limit_burst_kb") outCfg.rateLimitBurstKB = std::atoi(val.c_str());
+        else if (key == "rate_limit_schedule") outCfg.rateLimitSchedule = val;
+        else if (key == "preallocate_parts") {
+            std::string v = toLower(val);
+            outCfg.preallocateParts = (v == "1" || v == "true" || v == "yes");
+        }
         else if (key == "platform_prefs_mode") outCfg.platformPrefsMode = val;
         else if (key == "platform_prefs_sd") outCfg.platformPrefsPathSd = val;
         else if (key == "platform_prefs_romfs") outCfg.platformPrefsPathRomfs = val;
@@ -159,6 +183,18 @@ static void migrateSchema0To1(mini::Object& obj) {
     aliasKeyIfMissing(obj, "FAT32_SAFE", "fat32_safe");
     aliasKeyIfMissing(obj, "LOG_LEVEL", "log_level");
     aliasKeyIfMissing(obj, "SPEED_TEST_URL", "speed_test_url");
+    aliasKeyIfMissing(obj, "DOWNLOAD_CONNECTIONS", "download_connections");
+    aliasKeyIfMissing(obj, "BUNDLE_CONCURRENCY", "bundle_concurrency");
+    aliasKeyIfMissing(obj, "LOOKAHEAD_DEPTH", "lookahead_depth");
+    aliasKeyIfMissing(obj, "PREALLOCATE_PARTS", "preallocate_parts");
+    aliasKeyIfMissing(obj, "WRITE_BACKEND", "write_backend");
+    aliasKeyIfMissing(obj, "HASH_PARTS", "hash_parts");
+    aliasKeyIfMissing(obj, "ARCHIVE_BUNDLES", "archive_bundles");
+    aliasKeyIfMissing(obj, "HTTP2", "http2");
+    aliasKeyIfMissing(obj, "HTTP_CACHE_MB", "http_cache_mb");
+    aliasKeyIfMissing(obj, "RATE_LIMIT_KBPS", "rate_limit_kbps");
+    aliasKeyIfMissing(obj, "RATE_LIMIT_BURST_KB", "rate_limit_burst_kb");
+    aliasKeyIfMissing(obj, "RATE_LIMIT_SCHEDULE", "rate_limit_schedule");
     aliasKeyIfMissing(obj, "PLATFORM_PREFS_MODE", "platform_prefs_mode");
     aliasKeyIfMissing(obj, "PLATFORM_PREFS_SD", "platform_prefs_sd");
     aliasKeyIfMissing(obj, "PLATFORM_PREFS_ROMFS", "platform_prefs_romfs");
@@ -170,6 +206,17 @@ static void migrateSchema0To1(mini::Object& obj) {
     aliasKeyIfMissing(obj, "fat32Safe", "fat32_safe");
     aliasKeyIfMissing(obj, "logLevel", "log_level");
     aliasKeyIfMissing(obj, "speedTestUrl", "speed_test_url");
+    aliasKeyIfMissing(obj, "downloadConnections", "download_connections");
+    aliasKeyIfMissing(obj, "bundleConcurrency", "bundle_concurrency");
+    aliasKeyIfMissing(obj, "lookaheadDepth", "lookahead_depth");
+    aliasKeyIfMissing(obj, "preallocateParts", "preallocate_parts");
+    aliasKeyIfMissing(obj, "writeBackend", "write_backend");
+    aliasKeyIfMissing(obj, "hashParts", "hash_parts");
+    aliasKeyIfMissing(obj, "archiveBundles", "archive_bundles");
+    aliasKeyIfMissing(obj, "httpCacheMb", "http_cache_mb");
+    aliasKeyIfMissing(obj, "rateLimitKBps", "rate_limit_kbps");
+    aliasKeyIfMissing(obj, "rateLimitBurstKB", "rate_limit_burst_kb");
+    aliasKeyIfMissing(obj, "rateLimitSchedule", "rate_limit_schedule");
     aliasKeyIfMissing(obj, "platformPrefsMode", "platform_prefs_mode");
     aliasKeyIfMissing(obj, "platformPrefsSd", "platform_prefs_sd");
     aliasKeyIfMissing(obj, "platformPrefsRomfs", "platform_prefs_romfs");
@@ -258,6 +305,22 @@ static bool parseJsonObject(mini::Object& obj, Config& outCfg, std::string& outE
         if (!lvl.empty()) outCfg.logLevel = toLower(lvl);
     }
     getStr("speed_test_url", outCfg.speedTestUrl);
+    getInt("download_connections", outCfg.downloadConnections);
+    getInt("bundle_concurrency", outCfg.bundleConcurrency);
+    getInt("lookahead_depth", outCfg.lookaheadDepth);
+    getBool("preallocate_parts", outCfg.preallocateParts);
+    getBool("hash_parts", outCfg.hashParts);
+    getBool("archive_bundles", outCfg.archiveBundles);
+    getBool("http2", outCfg.http2);
+    getInt("http_cache_mb", outCfg.httpCacheMb);
+    getInt("rate_limit_kbps", outCfg.rateLimitKBps);
+    getInt("rate_limit_burst_kb", outCfg.rateLimitBurstKB);
+    getStr("rate_limit_schedule", outCfg.rateLimitSchedule);
+    {
+        std::string backend;
+        getStr("write_backend", backend);
+        if (!backend.empty()) outCfg.writeBackend = toLower(backend);
+    }
     getStr("platform_prefs_mode", outCfg.platformPrefsMode);
     getStr("platform_prefs_sd", outCfg.platformPrefsPathSd);
     getStr("platform_prefs_romfs", outCfg.platformPrefsPathRomfs);
@@ -0,0 +1,66 @@
+#include "romm/connection_pool.hpp"
+
+#include <vector>
+
+namespace romm {
+
+ConnectionPool::ConnectionPool(size_t maxIdle, Destroy destroy) : maxIdle_(maxIdle), destroy_(destroy) {}
+
+ConnectionPool::~ConnectionPool() { clear(); }
+
+void ConnectionPool::destroyHandle(void* handle) const {
+    if (handle && destroy_) destroy_(handle);
+}
+
+void* ConnectionPool::acquire(const std::string& origin) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = idle_.begin(); it != idle_.end(); ++it) {
+        if (it->origin != origin) continue;
+        void* handle = it->handle;
+        idle_.erase(it);
+        return handle;
+    }
+    return nullptr;
+}
+
+void ConnectionPool::release(const std::string& origin, void* handle) {
+    if (!handle) return;
+    std::vector<void*> closing;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_.push_front(Idle{origin, handle});
+        while (idle_.size() > maxIdle_) {
+            closing.push_back(idle_.back().handle);
+            idle_.pop_back();
+        }
+    }
+    // Closing a TLS connection may block on the socket; never while holding the lock.
+    for (void* h : closing) {
+        destroyHandle(h);
+        if (stats_) stats_->evicted.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ConnectionPool::noteRequest(uint64_t newConnections, uint64_t connectMs) {
+    if (!stats_) return;
+    stats_->requests.fetch_add(1, std::memory_order_relaxed);
+    if (newConnections == 0) stats_->reused.fetch_add(1, std::memory_order_relaxed);
+    stats_->opened.fetch_add(newConnections, std::memory_order_relaxed);
+    stats_->connectMs.fetch_add(connectMs, std::memory_order_relaxed);
+}
+
+void ConnectionPool::clear() {
+    std::list<Idle> closing;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closing.swap(idle_);
+    }
+    for (const auto& c : closing) destroyHandle(c.handle);
+}
+
+size_t ConnectionPool::idleCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idle_.size();
+}
+
+} // namespace romm
@@ -0,0 +1,247 @@
+#include "romm/crc32.hpp"
+#include "romm/part_writer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define ROMM_CRC32_ARMV8 1
+#include <arm_acle.h>
+#else
+#include <zlib.h>
+#endif
+
+namespace romm {
+
+namespace {
+
+constexpr uint32_t kPoly = 0xEDB88320u; // reflected 0x04C11DB7
+constexpr size_t kReadBackBytes = 1024 * 1024;
+
+// a * b modulo the CRC polynomial, in the reflected bit order (x^0 is the top bit).
+constexpr uint32_t multModP(uint32_t a, uint32_t b) {
+    uint32_t m = 1u << 31;
+    uint32_t p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ kPoly : b >> 1;
+    }
+    return p;
+}
+
+// x^(2^n) mod P for n = 0..31; entry n shifts a CRC by 2^n bits.
+constexpr std::array<uint32_t, 32> makeX2nTable() {
+    std::array<uint32_t, 32> t{};
+    uint32_t p = 1u << 30; // x^1
+    t[0] = p;
+    for (size_t n = 1; n < t.size(); ++n) {
+        p = multModP(p, p);
+        t[n] = p;
+    }
+    return t;
+}
+
+constexpr std::array<uint32_t, 32> kX2n = makeX2nTable();
+
+// x^(n * 2^k) mod P.
+uint32_t x2nModP(uint64_t n, unsigned k) {
+    uint32_t p = 1u << 31; // x^0
+    while (n) {
+        if (n & 1) p = multModP(kX2n[k & 31], p);
+        n >>= 1;
+        k++;
+    }
+    return p;
+}
+
+} // namespace
+
+uint32_t crc32Update(uint32_t crc, const void* data, size_t len) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+#if defined(ROMM_CRC32_ARMV8)
+    uint32_t c = ~crc;
+    while (len > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+        c = __crc32b(c, *p++);
+        --len;
+    }
+    while (len >= 32) {
+        uint64_t v[4];
+        std::memcpy(v, p, sizeof(v));
+        c = __crc32d(c, v[0]);
+        c = __crc32d(c, v[1]);
+        c = __crc32d(c, v[2]);
+        c = __crc32d(c, v[3]);
+        p += 32;
+        len -= 32;
+    }
+    while (len >= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        c = __crc32d(c, v);
+        p += 8;
+        len -= 8;
+    }
+    while (len > 0) {
+        c = __crc32b(c, *p++);
+        --len;
+    }
+    return ~c;
+#else
+    uLong c = crc;
+    while (len > 0) {
+        const uInt n = static_cast<uInt>(std::min<size_t>(len, 1u << 30)); // zlib takes uInt lengths
+        c = ::crc32(c, p, n);
+        p += n;
+        len -= n;
+    }
+    return static_cast<uint32_t>(c);
+#endif
+}
+
+uint32_t crc32Combine(uint32_t crcA, uint32_t crcB, uint64_t lenB) {
+    return multModP(x2nModP(lenB, 3), crcA) ^ crcB;
+}
+
+bool crc32Accelerated() {
+#if defined(ROMM_CRC32_ARMV8)
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::string crc32ToHex(uint32_t crc) {
+    char buf[9];
+    std::snprintf(buf, sizeof(buf), "%08x", static_cast<unsigned>(crc));
+    return std::string(buf);
+}
+
+bool crc32FromHex(const std::string& hex, uint32_t& out) {
+    if (hex.size() != 8) return false;
+    uint32_t v = 0;
+    for (char c : hex) {
+        int d = -1;
+        if (c >= '0' && c <= '9') d = c - '0';
+        else if (c >= 'a' && c <= 'f') d = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') d = c - 'A' + 10;
+        if (d < 0) return false;
+        v = (v << 4) | static_cast<uint32_t>(d);
+    }
+    out = v;
+    return true;
+}
+
+void FileCrc::seed(uint64_t end, uint32_t crc) {
+    runs_.clear();
+    if (end > 0) runs_.emplace(0, Run{end, crc});
+}
+
+void FileCrc::update(uint64_t offset, const char* data, size_t len) {
+    if (len == 0) return;
+    const uint64_t end = offset + len;
+    // Bytes written twice: whatever run held them no longer provably matches the file.
+    auto it = runs_.lower_bound(offset);
+    if (it != runs_.begin() && std::prev(it)->second.end > offset) --it;
+    while (it != runs_.end() && it->first < end) it = runs_.erase(it);
+
+    // `it` is now the first run after the write; the one before it ends at or before `offset`.
+    std::map<uint64_t, Run>::iterator cur;
+    if (it != runs_.begin() && std::prev(it)->second.end == offset) {
+        cur = std::prev(it);
+        cur->second.crc = crc32Update(cur->second.crc, data, len);
+        cur->second.end = end;
+    } else {
+        cur = runs_.emplace_hint(it, offset, Run{end, crc32Update(0, data, len)});
+    }
+    if (it != runs_.end() && it->first == end) {
+        cur->second.crc = crc32Combine(cur->second.crc, it->second.crc, it->second.end - it->first);
+        cur->second.end = it->second.end;
+        runs_.erase(it);
+    }
+}
+
+void FileCrc::keepInside(const RangeSet& keep) {
+    for (auto it = runs_.begin(); it != runs_.end();) {
+        if (keep.contains(it->first, it->second.end)) {
+            ++it;
+        } else {
+            it = runs_.erase(it);
+        }
+    }
+}
+
+uint64_t FileCrc::prefixEnd() const {
+    return (!runs_.empty() && runs_.begin()->first == 0) ? runs_.begin()->second.end : 0;
+}
+
+uint32_t FileCrc::prefixCrc() const {
+    return (!runs_.empty() && runs_.begin()->first == 0) ? runs_.begin()->second.crc : 0;
+}
+
+bool FileCrc::whole(uint64_t size, uint32_t& crc) const {
+    if (size == 0) {
+        crc = 0;
+        return runs_.empty();
+    }
+    if (runs_.size() != 1 || prefixEnd() != size) return false;
+    crc = prefixCrc();
+    return true;
+}
+
+std::vector<ByteRange> FileCrc::missing(uint64_t size) const {
+    RangeSet covered;
+    for (const auto& r : runs_) covered.add(r.first, r.second.end);
+    return covered.missing(0, size);
+}
+
+bool completeFileCrc(const std::string& dir, uint64_t partSize, uint64_t totalSize, FileCrc& crc,
+                     std::string& err, uint64_t* readBytes) {
+    if (readBytes) *readBytes = 0;
+    if (partSize == 0) partSize = totalSize;
+    const std::vector<ByteRange> gaps = crc.missing(totalSize);
+    std::vector<char> buf;
+    if (!gaps.empty()) buf.resize(kReadBackBytes);
+    for (const auto& gap : gaps) {
+        uint64_t off = gap.start;
+        while (off < gap.end) {
+            const uint64_t partIndex = off / partSize;
+            const uint64_t partOff = off % partSize;
+            const uint64_t partEnd = off + std::min(gap.end - off, partSize - partOff);
+            const std::string path = partFilePath(dir, partIndex);
+            FILE* f = std::fopen(path.c_str(), "rb");
+            if (!f) {
+                err = "Cannot open " + path + " for checksum";
+                return false;
+            }
+            bool ok = std::fseek(f, static_cast<long>(partOff), SEEK_SET) == 0;
+            while (ok && off < partEnd) {
+                const size_t want = static_cast<size_t>(std::min<uint64_t>(partEnd - off, buf.size()));
+                const size_t got = std::fread(buf.data(), 1, want, f);
+                if (got != want) ok = false;
+                crc.update(off, buf.data(), got);
+                off += got;
+                if (readBytes) *readBytes += got;
+            }
+            std::fclose(f);
+            if (!ok) {
+                err = "Short read in " + path + " at " + std::to_string(off - partIndex * partSize);
+                return false;
+            }
+        }
+    }
+    uint32_t value = 0;
+    if (!crc.whole(totalSize, value)) {
+        err = "Checksum runs do not cover the file";
+        return false;
+    }
+    return true;
+}
+
+} // namespace romm
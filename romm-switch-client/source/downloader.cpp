@@ -6,8 +6,20 @@
 #include "romm/raii.hpp"
 #include "romm/http_common.hpp"
 #include "romm/manifest.hpp"
+#include "romm/part_hash.hpp"
+#include "romm/crc32.hpp"
 #include "romm/queue_store.hpp"
-#include "romm/speed_test.hpp"
+#include "romm/write_pipeline.hpp"
+#include "romm/download_segments.hpp"
+#include "romm/bundle_executor.hpp"
+#include "romm/job_manager.hpp"
+#include "romm/lookahead.hpp"
+#include "romm/rate_limiter.hpp"
+#include "romm/transfer_tuner.hpp"
+#include "romm/retry_policy.hpp"
+#include "romm/stall_detector.hpp"
+#include "romm/zip_stream.hpp"
+#include "romm/connection_pool.hpp"
 #include <switch.h>
 #include <sys/socket.h>
 #include <netdb.h>
@@ -27,6 +39,7 @@
 #include <chrono>
 #include <thread>
 #include <fstream>
+#include <memory>
 #include <sys/iosupport.h>
 #include <switch/runtime/devices/fs_dev.h> // fsdevSetConcatenationFileAttribute
 
@@ -37,7 +50,120 @@ namespace {
 constexpr uint64_t kDbiPartSizeBytes = 0xFFFF0000ULL; // DBI/Tinfoil split size
 constexpr uint64_t kFreeSpaceMarginBytes = 200ULL * 1024ULL * 1024ULL; // ~200MB margin
 constexpr size_t kStreamBufferBytes = 256 * 1024;
-constexpr int kMaxRetryBackoffMs = 2000;
+constexpr size_t kRawWriteBlockBytes = 2 * 1024 * 1024; // raw backend: one aligned write() per 2MB
+constexpr size_t kWriteBlockBytes = 2 * 1024 * 1024; // ring block size = largest tuned write batch
+constexpr size_t kWriteBlockCount = 8;               // 8-16MB of buffering between network and SD
+// Auto-tuning bounds (see TransferTuner); starting values match the former fixed settings.
+constexpr size_t kMinRecvBufferBytes = 64 * 1024;
+constexpr size_t kMaxRecvBufferBytes = 512 * 1024;
+constexpr size_t kMinIoBufferBytes = 64 * 1024;
+constexpr size_t kMaxIoBufferBytes = 1024 * 1024;
+constexpr size_t kMinWriteBatchBytes = 256 * 1024;
+constexpr size_t kStartWriteBatchBytes = 1024 * 1024;
+constexpr uint64_t kCheckpointBytes = 64ULL * 1024ULL * 1024ULL; // fsync parts + manifest every 64MB...
+constexpr uint32_t kCheckpointMs = 5000;                         // ...or every 5s, whichever first
+constexpr auto kRetrySleepSlice = std::chrono::milliseconds(100); // stop latency during a backoff
+constexpr int kMaxDownloadConnections = 8;
+constexpr int kMaxBundleConcurrency = 4;
+constexpr uint64_t kMinSegmentBytes = 16ULL * 1024ULL * 1024ULL; // don't split below 16MB per connection
+constexpr int kStallCheckMs = 200;       // zombie-connection check interval
+constexpr int kHedgeRaceMs = 4000;       // a hedge and its lagging rival race this long, then one is cancelled
+constexpr int kMaxHedgesPerStream = 2;   // hedges running at once for one file
+constexpr int kMaxHedgesPerSegment = 2;  // hedges opened over one segment's lifetime
+
+constexpr int kMaxLookaheadDepth = 10;
+constexpr size_t kMaxIdleConnections = kMaxDownloadConnections + kMaxHedgesPerStream; // one full segmented file
+
+// write_backend=raw swaps the stdio buffer for an aligned fd staging block; unknown names use stdio.
+WriteBackend writeBackendFor(const Config& cfg) {
+    WriteBackend backend = WriteBackend::Stdio;
+    parseWriteBackend(cfg.writeBackend, backend);
+    return backend;
+}
+
+size_t ioBufferBytesFor(WriteBackend backend, const TuningParams& tune) {
+    return backend == WriteBackend::Raw ? kRawWriteBlockBytes : tune.ioBufferBytes;
+}
+
+// download_connections is the ceiling; the tuner starts there and may shed connections the SD
+// card cannot keep up with. The raw backend keeps its fixed 2MB staging block.
+TuningBounds tuningBoundsFor(const Config& cfg) {
+    TuningBounds b;
+    const int maxConnections = std::clamp(cfg.downloadConnections, 1, kMaxDownloadConnections);
+    const bool raw = writeBackendFor(cfg) == WriteBackend::Raw;
+    b.min.recvBufferBytes = kMinRecvBufferBytes;
+    b.max.recvBufferBytes = kMaxRecvBufferBytes;
+    b.min.ioBufferBytes = raw ? kRawWriteBlockBytes : kMinIoBufferBytes;
+    b.max.ioBufferBytes = raw ? kRawWriteBlockBytes : kMaxIoBufferBytes;
+    b.min.writeBatchBytes = kMinWriteBatchBytes;
+    b.max.writeBatchBytes = kWriteBlockBytes;
+    b.min.connections = 1;
+    b.max.connections = maxConnections;
+    return b;
+}
+
+TuningParams tuningStartFor(const Config& cfg) {
+    TuningParams p;
+    p.recvBufferBytes = 256 * 1024;
+    p.ioBufferBytes = writeBackendFor(cfg) == WriteBackend::Raw ? kRawWriteBlockBytes : kStreamBufferBytes;
+    p.writeBatchBytes = kStartWriteBatchBytes;
+    p.connections = std::clamp(cfg.downloadConnections, 1, kMaxDownloadConnections);
+    return p;
+}
+
+// rate_limit_* keys -> bucket config; a malformed schedule is logged and ignored.
+RateLimitConfig rateLimitFor(const Config& cfg) {
+    RateLimitConfig out;
+    out.bytesPerSec = static_cast<uint64_t>(std::max(cfg.rateLimitKBps, 0)) * 1024ULL;
+    out.burstBytes = static_cast<uint64_t>(std::max(cfg.rateLimitBurstKB, 0)) * 1024ULL;
+    std::string err;
+    if (!parseRateSchedule(cfg.rateLimitSchedule, out.schedule, err)) {
+        logLine("Warning: ignoring rate_limit_schedule: " + err);
+        out.schedule.clear();
+    }
+    if (out.bytesPerSec > 0 || !out.schedule.empty()) {
+        logLine("Rate limit: " + std::to_string(cfg.rateLimitKBps) + " KB/s burst=" +
+                std::to_string(out.burstBytes / 1024) + " KB windows=" + std::to_string(out.schedule.size()));
+    }
+    return out;
+}
+
+// Per-file extras for the part writer, owned by downloadOneFile.
+struct PartFileOptions {
+    PartWriter::PreallocHook onPrealloc; // empty: parts grow through writes
+    PartHashes* hashes{nullptr};         // in: resume seeds, out: hashed prefixes; null = no hashing
+    FileCrc* crc{nullptr};               // in: resume seed, out: CRC runs of the file; null = not tracked
+    // Writer thread, after an fsync: every byte in `written` (what this stream committed so far,
+    // whole-file offsets) is on the card.
+    std::function<void(const RangeSet& written, const PartHashes& hashes, const FileCrc& crc)> onCheckpoint;
+};
+
+// Snapshot of upcoming queue entries handed to the look-ahead stage.
+struct LookaheadJob {
+    std::vector<QueueItem> items;
+};
+
+// A file whose parts are complete and only need moving into the library.
+struct FinalizeStep {
+    std::string tmpDir;    // holds the .part files
+    std::string finalPath;
+    std::string tempRoot;  // per-file temp root, removed once the move succeeded
+    std::string name;
+    // Checked before the move when RomM reported a CRC: `crc` holds what the streams already
+    // covered, the rest is read back from the parts.
+    FileChecksums checksums;
+    FileCrc crc;
+    uint64_t totalSize{0};
+    uint64_t partSize{0};
+};
+
+// Finalize-stage work for one queue item. Runs on the finalizer thread while the worker streams
+// the next item; jobs finish in submission order.
+struct FinalizeJob {
+    std::string title;
+    std::vector<FinalizeStep> steps;
+    bool trackQueueItem{false}; // the item waits in the queue as Finalizing and is resolved here
+};
 
 struct DownloadContext {
     std::thread worker;
@@ -45,13 +171,66 @@ struct DownloadContext {
     Status* status{nullptr};
     Config cfg;
     std::atomic<int> activeSocketFd{-1};
+    LatestJobWorker<LookaheadJob, size_t> lookahead; // resolves/preflights the next items in background
+    PreflightCache preflightCache;
+    RateLimiter rateLimiter; // shared by every connection this worker opens
+    TransferTuner tuner;     // buffer/batch/connection tuning, shared by every stream of this worker
+    TuningSampler tuningSampler{tuner}; // one window series over all of those streams
+    SerialJobWorker<FinalizeJob> finalizer; // moves finished files into place behind the worker
+    // Keep-alive handles for preflights, streams and hedges of every item this worker runs.
+    ConnectionPool connections{kMaxIdleConnections, destroyHttpHandle};
 };
 
 DownloadContext gCtx; // global download context shared with worker
 
+// Reports a running stream's progress to the worker's TuningSampler and applies live decisions
+// (write batch) to its writer.
+class TuningWindow {
+public:
+    TuningWindow(AsyncPartWriter& writer, const WriteQueueStats& stats) : writer_(writer), stats_(stats) {
+        gCtx.tuningSampler.streamStarted(clocks());
+    }
+    ~TuningWindow() { gCtx.tuningSampler.streamEnded(clocks()); }
+
+    TuningWindow(const TuningWindow&) = delete;
+    TuningWindow& operator=(const TuningWindow&) = delete;
+
+    // received: bytes this stream has taken from the network so far.
+    void poll(uint64_t received) {
+        if (received > lastReceived_) gCtx.tuningSampler.add(received - lastReceived_);
+        lastReceived_ = received;
+        const std::string decision = gCtx.tuningSampler.poll(clocks());
+        if (!decision.empty()) logLine("Tuner: " + decision);
+        // Any stream's poll may close the shared window; follow the shared batch size.
+        const size_t batch = gCtx.tuner.current().writeBatchBytes;
+        if (batch != batchBytes_) {
+            writer_.setBatchBytes(batch);
+            batchBytes_ = batch;
+        }
+    }
+
+private:
+    TuningSampler::Clocks clocks() const {
+        TuningSampler::Clocks c;
+        c.nowMs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                            std::chrono::steady_clock::now().time_since_epoch())
+                                            .count());
+        // Both clocks are shared by every stream, like the sampler's byte count.
+        c.stallMs = stats_.stallMs.load();
+        c.throttledMs = gCtx.rateLimiter.throttledMs();
+        return c;
+    }
+
+    AsyncPartWriter& writer_;
+    const WriteQueueStats& stats_;
+    uint64_t lastReceived_{0};
+    size_t batchBytes_{0};
+};
+
 static void recomputeTotals(Status& st) {
     uint64_t remaining = 0;
     for (auto& q : st.downloadQueue) {
+        if (q.state == QueueState::Finalizing) continue; // bytes already counted as downloaded
         uint64_t sz = q.bundle.totalSize();
         if (sz == 0) sz = q.game.sizeBytes;
         remaining += sz;
@@ -132,6 +311,17 @@ struct PreflightInfo {
     uint64_t contentLength{0};
 };
 
+// Single-request mode: the data GET stands in for the preflight. streamDownload's header check
+// records what the response says about the file and vetoes the stream before any byte is written
+// when it contradicts the plan; the caller then falls back to preflight().
+struct ResponseProbe {
+    uint64_t minTotal{0};      // anything smaller is an error page, not a ROM
+    bool answered{false};      // a 200/206 response arrived
+    bool supportsRanges{false};
+    uint64_t total{0};         // full size per the response (0 = not stated)
+    bool mismatch{false};      // size differs/unknown/tiny, or the Range was ignored
+};
+
 #ifdef UNIT_TEST
 static void parseLengthAndRanges(const std::string& headers, PreflightInfo& info) {
     std::istringstream hs(headers);
@@ -167,9 +357,11 @@ static uint64_t partSizeFor(const Config& cfg, uint64_t totalSize) {
     return cfg.fat32Safe ? kDbiPartSizeBytes : totalSize;
 }
 
-static Manifest buildManifestFor(const Game& g, uint64_t totalSize, uint64_t partSize) {
+static Manifest buildManifestFor(const Game& g, uint64_t totalSize, uint64_t partSize,
+                                 const FileChecksums& checksums = {}) {
     Manifest m;
     m.rommId = g.id;
+    m.checksums = checksums;
     m.fileId = g.fileId;
     m.fsName = g.fsName.empty() ? safeName(g.title) : g.fsName;
     m.url = g.downloadUrl;
@@ -180,24 +372,86 @@ static Manifest buildManifestFor(const Game& g, uint64_t totalSize, uint64_t par
     int idx = 0;
     while (remaining > 0) {
         uint64_t sz = (remaining > partSize) ? partSize : remaining;
-        m.parts.push_back(ManifestPart{idx, sz, ""});
+        ManifestPart part;
+        part.index = idx;
+        part.size = sz;
+        m.parts.push_back(part);
         remaining -= sz;
         idx++;
     }
     return m;
 }
 
+// Seed hashers where the next writes of each part will start. Complete parts keep their records;
+// a partial part keeps its record only if it ends exactly where the part's leading run of kept
+// bytes ends (the writer extends that run first); all other records are cleared.
+static PartHashes seedPartHashes(Manifest& m, uint64_t partSize, const RangeSet& have) {
+    PartHashes seeds;
+    for (auto& part : m.parts) {
+        const uint64_t partStart = static_cast<uint64_t>(part.index) * partSize;
+        if (have.contains(partStart, partStart + part.size)) continue;
+        const uint64_t leading = have.runEnd(partStart) - partStart;
+        PartHasher hasher;
+        if (leading > 0 && PartHasher::fromRecord(part, leading, hasher)) {
+            seeds.emplace(static_cast<uint64_t>(part.index), hasher);
+        } else {
+            clearPartHash(part);
+        }
+    }
+    return seeds;
+}
+
+static void recordPartHashes(Manifest& m, const PartHashes& hashes) {
+    for (auto& part : m.parts) {
+        auto it = hashes.find(static_cast<uint64_t>(part.index));
+        if (it != hashes.end()) it->second.record(part);
+    }
+}
+
+// Continue the whole-file CRC from the manifest when its prefix is still durable; otherwise the
+// record is dropped and the finalize stage reads back whatever the streams do not cover.
+static FileCrc seedFileCrc(Manifest& m, const RangeSet& have) {
+    FileCrc crc;
+    uint32_t value = 0;
+    if (m.crcOffset > 0 && m.crcOffset <= have.runEnd(0) && crc32FromHex(m.crcState, value)) {
+        crc.seed(m.crcOffset, value);
+    } else {
+        m.crcOffset = 0;
+        m.crcState.clear();
+    }
+    return crc;
+}
+
+static void recordFileCrc(Manifest& m, const FileCrc& crc) {
+    m.crcOffset = crc.prefixEnd();
+    m.crcState = m.crcOffset > 0 ? crc32ToHex(crc.prefixCrc()) : std::string();
+}
+
+// Returns true if any part was flagged (i.e. the manifest changed).
+static bool clearPreallocated(Manifest& m) {
+    bool changed = false;
+    for (auto& part : m.parts) {
+        if (!part.preallocated) continue;
+        part.preallocated = false;
+        part.written = 0;
+        changed = true;
+    }
+    return changed;
+}
+
+// Atomic replace (temp + fsync + rename): a crash mid-checkpoint keeps the previous manifest.
 static bool writeManifestFile(const std::string& path, const Manifest& m) {
-    std::ofstream out(path, std::ios::binary | std::ios::trunc);
-    if (!out) return false;
-    out << manifestToJson(m);
+    std::string err;
+    if (!writeFileAtomic(path, manifestToJson(m), err)) {
+        logLine("Warning: manifest write failed: " + err);
+        return false;
+    }
     return true;
 }
 
 static bool readManifestFile(const std::string& path, Manifest& m) {
-    std::ifstream in(path, std::ios::binary);
-    if (!in) return false;
-    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::string content;
+    if (!readFileAtomic(path, content)) return false;
     std::string err;
     return manifestFromJson(content, m, err);
 }
@@ -228,8 +482,9 @@ static bool preflight(const std::string& url, const std::string& authBasic, int
 
         HttpRequestOptions opts;
         opts.timeoutSec = timeoutSec;
-        opts.keepAlive = false;
+        opts.pool = &gCtx.connections;
         opts.decodeChunked = true;
+        opts.cancelRequested = &gCtx.stopRequested;
         opts.activeSocketFd = &gCtx.activeSocketFd;
 
         HttpTransaction tx;
@@ -285,17 +540,107 @@ bool parseLengthAndRangesForTest(const std::string& headers, bool& supportsRange
 }
 #endif
 
+static bool validateSegmentHeaders(const ParsedHttpResponse& h, const ByteRange& seg, std::string& err) {
+    if (h.statusCode >= 300 && h.statusCode < 400) {
+        err = "Redirect not supported (HTTP " + std::to_string(h.statusCode) +
+              (h.location.empty() ? "" : " to " + h.location) + ")";
+        return false;
+    }
+    if (h.statusCode != 206) {
+        err = "Range not honored (status " + std::to_string(h.statusCode) + ")";
+        return false;
+    }
+    if (h.chunked) {
+        err = "Chunked transfer not supported for streaming downloads";
+        return false;
+    }
+    if (!h.hasContentRange || h.contentRangeStart != seg.start) {
+        err = "Content-Range start mismatch";
+        return false;
+    }
+    if (h.contentRangeEnd + 1 < seg.end) {
+        err = "Short segment (Content-Range end " + std::to_string(h.contentRangeEnd) +
+              " < expected " + std::to_string(seg.end - 1) + ")";
+        return false;
+    }
+    return true;
+}
+
+// One connection of a race (see RaceCursor): a Range GET over [from, race.end()). A segment's
+// first connection and any hedge opened for it run the same way; cancel makes it yield.
+struct RaceConn {
+    std::atomic<bool> cancel{false};
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> pos{0}; // absolute offset this connection has read up to
+    uint64_t from{0};
+    std::string err;              // failure, if any; read once running is false
+};
+
+static void runRaceConnection(const std::string& url, const std::string& authBasic, RaceCursor& race,
+                              int timeoutSec, const TuningParams& tune, const std::atomic<bool>& abortAll,
+                              RaceConn& conn, Status& status, FileProgress& progress) {
+    const ByteRange range{conn.from, race.end()};
+    std::vector<std::pair<std::string, std::string>> headers;
+    if (!authBasic.empty()) headers.emplace_back("Authorization", "Basic " + authBasic);
+    headers.emplace_back("Range", rangeHeaderValue(range));
+
+    HttpRequestOptions opts;
+    opts.timeoutSec = timeoutSec;
+    opts.pool = &gCtx.connections;
+    opts.decodeChunked = false;
+    opts.recvBufferBytes = tune.recvBufferBytes;
+    opts.cancelRequested = &conn.cancel;
+
+    ParsedHttpResponse parsed{};
+    bool headersOk = false;
+    std::string connErr;
+    std::string streamErr;
+    bool ok = httpRequestStreamed(
+        "GET", url, headers, opts, parsed,
+        [&](const char* data, size_t len) -> bool {
+            if (!headersOk) {
+                if (!validateSegmentHeaders(parsed, range, connErr)) return false;
+                headersOk = true;
+            }
+            if (abortAll.load(std::memory_order_acquire) || conn.cancel.load(std::memory_order_acquire)) return false;
+            const uint64_t pos = conn.pos.load(std::memory_order_relaxed);
+            if (pos >= range.end) return true;
+            const size_t toUse = static_cast<size_t>(std::min<uint64_t>(len, range.end - pos));
+            size_t wrote = 0;
+            if (!race.deliver(pos, data, toUse, wrote, connErr)) return false;
+            conn.pos.store(pos + toUse, std::memory_order_release);
+            progress.downloaded.fetch_add(wrote);
+            status.totalDownloadedBytes.fetch_add(wrote);
+            status.throughput.add(wrote);
+            if (!gCtx.rateLimiter.acquire(toUse, &conn.cancel)) return false;
+            return !race.complete(); // the rival finished the range: stop reading
+        },
+        streamErr);
+    if (ok && !headersOk) ok = validateSegmentHeaders(parsed, range, connErr);
+    if (!race.complete() && !conn.cancel.load()) {
+        if (connErr.empty()) connErr = ok ? "Short read" : (!streamErr.empty() && streamErr != "Sink aborted" ? streamErr : "Stream failed");
+        conn.err = connErr;
+    }
+    conn.running.store(false, std::memory_order_release);
+}
+
 // Stream a continuous HTTP GET (optionally with Range) and split into FAT32-friendly parts.
-// TODO(manifest/hashes): track expected parts/sizes/hashes to validate resume beyond size-only.
+// With rangesSupported, a connection that falls far behind its own rolling rate gets a hedged
+// Range connection over the rest of the file; the two race and the one that gets further stays.
 static bool streamDownload(const std::string& url,
                            const std::string& authBasic,
                            bool useRange,
+                           bool rangesSupported,
                            uint64_t startOffset,
                            uint64_t totalSize,
                            uint64_t partSize,
                            const std::string& tmpDir,
                            Status& status,
+                           FileProgress& progress,
                            const Config& cfg,
+                           const TuningParams& tune,
+                           const PartFileOptions& partOpts,
+                           ResponseProbe* probe,
                            std::string& err) {
     int timeoutSec = cfg.httpTimeoutSeconds > 0 ? cfg.httpTimeoutSeconds : 10;
     if (timeoutSec > 30) timeoutSec = 30;
@@ -306,62 +651,51 @@ static bool streamDownload(const std::string& url,
     logLine("Stream start: url=" + url + " range=" + (useRange ? "true" : "false") +
             " start=" + std::to_string(startOffset) + " expect=" + std::to_string(expectedBody));
 
-    // Buffered writer that keeps one part file open at a time.
-    FILE* partFile = nullptr;
-    int currentPart = -1;
-    auto closePart = [&]() {
-        if (partFile) {
-            fclose(partFile);
-            partFile = nullptr;
-            currentPart = -1;
+    // Network callbacks only copy into the ring; the writer thread does part rotation and fwrite.
+    // The open hook (free-space recheck on each new part) runs on the writer thread.
+    const WriteBackend backend = writeBackendFor(cfg);
+    AsyncPartWriter writer(tmpDir, partSize, kWriteBlockBytes, kWriteBlockCount, &status.writeQueueStats,
+                           ioBufferBytesFor(backend, tune), backend);
+    writer.setBatchBytes(tune.writeBatchBytes);
+    TuningWindow tuning(writer, status.writeQueueStats);
+    writer.setOpenHook([&](uint64_t /*partIdx*/, uint64_t offset, std::string& hookErr) -> bool {
+        uint64_t received = (offset >= startOffset) ? (offset - startOffset) : 0;
+        uint64_t remainingBytes = (expectedBody > received) ? (expectedBody - received) : 0;
+        uint64_t freeBytes = 0;
+        if (!ensureFreeSpace(tmpDir, remainingBytes, &freeBytes)) {
+            hookErr = "Not enough free space (need " + std::to_string(remainingBytes) +
+                      " bytes + margin, have " + std::to_string(freeBytes) + ")";
+            logLine("Free-space recheck failed in stream: " + hookErr);
+            return false;
         }
-    };
-    auto writeSpan = [&](uint64_t& globalOffset, const char* data, size_t len) -> bool {
-        size_t remaining = len;
-        size_t idx = 0;
-        while (remaining > 0) {
-            uint64_t partIdx = globalOffset / partSize;
-            uint64_t partOff = globalOffset % partSize;
-            uint64_t space = partSize - partOff;
-            size_t toWrite = static_cast<size_t>(std::min<uint64_t>(space, remaining));
-            if (currentPart != static_cast<int>(partIdx)) {
-                uint64_t received = (globalOffset >= startOffset) ? (globalOffset - startOffset) : 0;
-                uint64_t remainingBytes = (expectedBody > received) ? (expectedBody - received) : 0;
-                uint64_t freeBytes = 0;
-                if (!ensureFreeSpace(tmpDir, remainingBytes, &freeBytes)) {
-                    err = "Not enough free space (need " + std::to_string(remainingBytes) +
-                          " bytes + margin, have " + std::to_string(freeBytes) + ")";
-                    logLine("Free-space recheck failed in stream: " + err);
-                    closePart();
-                    return false;
-                }
-                closePart();
-                std::string partName = (partIdx < 10 ? "0" : "") + std::to_string(partIdx);
-                std::string partPath = tmpDir + "/" + partName + ".part";
-                partFile = fopen(partPath.c_str(), "r+b");
-                if (!partFile) partFile = fopen(partPath.c_str(), "w+b");
-                if (!partFile) { err = "Open part failed"; logLine("Open part failed: " + partPath); return false; }
-                // Large stdio buffer to reduce syscalls.
-                static thread_local char ioBuf[kStreamBufferBytes];
-                setvbuf(partFile, ioBuf, _IOFBF, sizeof(ioBuf));
-                if (fseek(partFile, static_cast<long>(partOff), SEEK_SET) != 0) {
-                    err = "Seek failed";
-                    logLine("Seek failed in part " + partPath + " offset=" + std::to_string(partOff));
-                    closePart();
-                    return false;
-                }
-                currentPart = static_cast<int>(partIdx);
-            }
-            size_t wn = fwrite(data + idx, 1, toWrite, partFile);
-            if (wn != toWrite) { err = "Write failed"; closePart(); return false; }
-            globalOffset += toWrite;
-            idx += toWrite;
-            remaining -= toWrite;
+        return true;
+    });
+    if (partOpts.onPrealloc) writer.setPreallocate(totalSize, partOpts.onPrealloc);
+    if (partOpts.hashes) writer.enableHashing(*partOpts.hashes);
+    if (partOpts.crc) writer.enableFileCrc(*partOpts.crc);
+    AsyncPartWriter::Stream sink(writer);
+    if (partOpts.onCheckpoint) {
+        writer.setCheckpoint(kCheckpointBytes, kCheckpointMs, [&](const PartHashes& hashes) {
+            RangeSet written;
+            written.add(startOffset, startOffset + sink.written());
+            partOpts.onCheckpoint(written, hashes, writer.fileCrc());
+        });
+    }
+    writer.start();
+    // Drain queued blocks and close the parts; a writer failure (e.g. free space) wins over stream errors.
+    auto closePart = [&]() -> bool {
+        std::string writeErr;
+        bool flushed = sink.flush(writeErr);
+        if (!writer.finish(writeErr) || !flushed) {
+            err = writeErr;
+            return false;
         }
         return true;
     };
+    // Created once the headers fixed the body length; the primary connection and a hedge write through it.
+    std::unique_ptr<RaceCursor> race;
 
-    uint64_t globalOffset = startOffset;
+    uint64_t globalOffset = startOffset; // what this (primary) connection has read up to
     auto lastBeat = std::chrono::steady_clock::now();
     uint64_t bytesSinceBeat = 0;
     const uint64_t kLogEvery = 100ULL * 1024ULL * 1024ULL; // ~100MB
@@ -375,6 +709,37 @@ static bool streamDownload(const std::string& url,
                   (parsedHeaders.location.empty() ? "" : " to " + parsedHeaders.location) + ")";
             return false;
         }
+        if (probe && (statusCode == 200 || statusCode == 206)) {
+            probe->answered = true;
+            probe->supportsRanges = statusCode == 206 || parsedHeaders.acceptRanges;
+            if (parsedHeaders.hasContentRangeTotal) {
+                probe->total = parsedHeaders.contentRangeTotal;
+            } else if (statusCode == 200 && parsedHeaders.hasContentLength) {
+                probe->total = parsedHeaders.contentLength;
+            }
+            std::string why;
+            if (useRange && statusCode != 206) {
+                why = "Range not honored";
+            } else if (probe->total == 0) {
+                why = "no size in response";
+            } else if (probe->total < probe->minTotal) {
+                why = "tiny response (" + std::to_string(probe->total) + " bytes)";
+            } else if (probe->total != totalSize) {
+                why = "server size " + std::to_string(probe->total) + " != expected " + std::to_string(totalSize);
+            }
+            if (!why.empty()) {
+                probe->mismatch = true;
+                err = "Single request: " + why;
+                return false;
+            }
+            // The free-space decision the preflight path makes up front.
+            uint64_t freeBytes = 0;
+            if (!ensureFreeSpace(tmpDir, expectedBody, &freeBytes)) {
+                err = "Not enough free space (need " + std::to_string(expectedBody) +
+                      " bytes + margin, have " + std::to_string(freeBytes) + ")";
+                return false;
+            }
+        }
         if (useRange && statusCode != 206) {
             err = "Range not honored (status " + std::to_string(statusCode) + ")";
             return false;
@@ -405,10 +770,86 @@ static bool streamDownload(const std::string& url,
                 " clen=" + std::to_string(parsedHeaders.contentLength) +
                 " expected=" + std::to_string(expectedBody) +
                 (useRange ? " (range)" : ""));
+        race = std::make_unique<RaceCursor>(
+            startOffset, startOffset + expectedBody,
+            [&](uint64_t offset, const char* data, size_t len, std::string& writeErr) {
+                return sink.write(offset, data, len, writeErr);
+            });
         headersValidated = true;
         return true;
     };
 
+    // Zombie detection (see StallDetector) runs from the receive callback, every kStallCheckMs.
+    StallDetector stalls;
+    const int primaryId = stalls.track(0);
+    RaceConn hedge;
+    std::thread hedgeThread;
+    int hedgeId = -1;
+    int hedges = 0;
+    bool primaryYielded = false; // lost the race to a hedge, or the hedge finished first
+    auto hedgeStart = transferStart;
+    auto lastStallCheck = transferStart;
+    uint64_t writerStallAtCheck = status.writeQueueStats.stallMs.load();
+    // Returns false when the primary connection should stop reading.
+    auto monitorStalls = [&](std::chrono::steady_clock::time_point now) -> bool {
+        if (now - lastStallCheck < std::chrono::milliseconds(kStallCheckMs)) return true;
+        lastStallCheck = now;
+        const uint64_t nowMs = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(now - transferStart).count());
+        stalls.sample(primaryId, globalOffset - startOffset, nowMs);
+        const bool hedging = hedge.running.load(std::memory_order_acquire);
+        if (hedgeId >= 0) {
+            if (!hedging) {
+                stalls.untrack(hedgeId);
+                hedgeId = -1;
+            } else {
+                stalls.sample(hedgeId, hedge.pos.load() - hedge.from, nowMs);
+                if (now - hedgeStart >= std::chrono::milliseconds(kHedgeRaceMs)) {
+                    if (hedge.pos.load() > globalOffset) {
+                        logLine("Hedge won at " + std::to_string(race->cursor()) + "/" + std::to_string(race->end()));
+                        primaryYielded = true;
+                        return false;
+                    }
+                    logLine("Hedge lost at " + std::to_string(race->cursor()) + "/" + std::to_string(race->end()));
+                    hedge.cancel.store(true, std::memory_order_release);
+                    stalls.untrack(hedgeId);
+                    hedgeId = -1;
+                }
+            }
+        }
+        // Writer stalls and the bandwidth cap slow the connection without it being a zombie.
+        const uint64_t writerStall = status.writeQueueStats.stallMs.load();
+        const bool sdBound = writerStall - writerStallAtCheck > kStallCheckMs / 4;
+        writerStallAtCheck = writerStall;
+        if (sdBound) {
+            stalls.restartWindows(nowMs);
+            return true;
+        }
+        if (gCtx.rateLimiter.currentBytesPerSec() > 0) return true;
+        const std::vector<int> flagged = stalls.poll(nowMs);
+        if (!rangesSupported || hedging || !race || race->complete() || hedges >= kMaxHedgesPerSegment ||
+            std::find(flagged.begin(), flagged.end(), primaryId) == flagged.end()) {
+            return true;
+        }
+        if (hedgeThread.joinable()) hedgeThread.join(); // an earlier hedge that already lost
+        const uint64_t from = race->cursor();
+        hedge.cancel.store(false);
+        hedge.from = from;
+        hedge.pos.store(from);
+        hedge.err.clear();
+        hedge.running.store(true, std::memory_order_release);
+        hedges++;
+        hedgeStart = now;
+        hedgeId = stalls.track(nowMs);
+        logLine("Hedging stream from " + std::to_string(from) + "/" + std::to_string(race->end()) + ": " +
+                std::to_string(static_cast<uint64_t>(stalls.rate(primaryId) / 1024)) + " KB/s vs baseline " +
+                std::to_string(static_cast<uint64_t>(stalls.baseline() / 1024)) + " KB/s");
+        hedgeThread = std::thread([&]() {
+            runRaceConnection(url, authBasic, *race, timeoutSec, tune, gCtx.stopRequested, hedge, status, progress);
+        });
+        return true;
+    };
+
     std::vector<std::pair<std::string, std::string>> headers;
     if (!authBasic.empty()) headers.emplace_back("Authorization", "Basic " + authBasic);
     if (useRange && startOffset > 0) {
@@ -417,8 +858,9 @@ static bool streamDownload(const std::string& url,
 
     HttpRequestOptions opts;
     opts.timeoutSec = timeoutSec;
-    opts.keepAlive = false;
+    opts.pool = &gCtx.connections;
     opts.decodeChunked = false;
+    opts.recvBufferBytes = tune.recvBufferBytes;
     opts.cancelRequested = &gCtx.stopRequested;
     opts.activeSocketFd = &gCtx.activeSocketFd;
 
@@ -433,44 +875,47 @@ static bool streamDownload(const std::string& url,
             size_t toUse = static_cast<size_t>(
                 std::min<uint64_t>(static_cast<uint64_t>(len), expectedBody - receivedBefore));
             if (toUse == 0) return true;
-            if (!writeSpan(globalOffset, data, toUse)) return false;
-            status.currentDownloadedBytes.fetch_add(toUse);
-            status.totalDownloadedBytes.fetch_add(toUse);
-            bytesSinceBeat += toUse;
+            size_t wrote = 0;
+            if (!race->deliver(globalOffset, data, toUse, wrote, err)) return false;
+            globalOffset += toUse;
+            progress.downloaded.fetch_add(wrote);
+            status.totalDownloadedBytes.fetch_add(wrote);
+            status.throughput.add(wrote);
+            bytesSinceBeat += wrote;
+            // Sleeping here stops reading the socket, so the server sees TCP backpressure.
+            if (!gCtx.rateLimiter.acquire(toUse, &gCtx.stopRequested)) return false;
+            uint64_t received = race->cursor() - startOffset;
+            tuning.poll(received);
+            if (race->complete() && globalOffset < race->end()) {
+                primaryYielded = true; // the hedge finished the file
+                return false;
+            }
+            if (!monitorStalls(std::chrono::steady_clock::now())) return false;
 
-            uint64_t received = globalOffset - startOffset;
             if (!probeLogged && received >= kProbeBytes) {
                 double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - transferStart).count();
                 if (secs <= 0.0) secs = 1e-6;
                 double mbps = (received / (1024.0 * 1024.0)) / secs; // MB/s
                 logLine("Throughput estimate ~" + std::to_string(mbps) + " MB/s (first 10MB)");
-                {
-                    std::lock_guard<std::mutex> lock(status.mutex);
-                    status.lastSpeedMBps = mbps;
-                }
                 probeLogged = true;
             }
 
             auto now = std::chrono::steady_clock::now();
             if (bytesSinceBeat >= kLogEvery || now - lastBeat > std::chrono::seconds(10)) {
-                double beatSecs = std::chrono::duration<double>(now - lastBeat).count();
-                if (beatSecs > 0.0) {
-                    double mbps = (bytesSinceBeat / (1024.0 * 1024.0)) / beatSecs; // MB/s
-                    {
-                        std::lock_guard<std::mutex> lock(status.mutex);
-                        status.lastSpeedMBps = mbps;
-                    }
-                }
                 std::string titleCopy;
                 {
                     std::lock_guard<std::mutex> lock(status.mutex);
                     titleCopy = status.currentDownloadTitle;
                 }
-                logDebug("Heartbeat: " + titleCopy +
-                         " cur=" + std::to_string(status.currentDownloadedBytes.load()) + "/" +
-                         std::to_string(status.currentDownloadSize.load()) +
+                logDebug("Heartbeat: " + titleCopy + " [" + progress.name + "]" +
+                         " cur=" + std::to_string(progress.downloaded.load()) + "/" +
+                         std::to_string(progress.size.load()) +
                          " total=" + std::to_string(status.totalDownloadedBytes.load()) + "/" +
-                         std::to_string(status.totalDownloadBytes.load()),
+                         std::to_string(status.totalDownloadBytes.load()) +
+                         " wq=" + std::to_string(status.writeQueueStats.depth.load()) +
+                         " stallMs=" + std::to_string(status.writeQueueStats.stallMs.load()) +
+                         " throttledMs=" + std::to_string(gCtx.rateLimiter.throttledMs()) +
+                         " rateKBps=" + std::to_string(static_cast<uint64_t>(status.throughput.snapshot().bytesPerSec / 1024)),
                          "DL");
                 lastBeat = now;
                 bytesSinceBeat = 0;
@@ -479,36 +924,399 @@ static bool streamDownload(const std::string& url,
         },
         streamErr);
 
-    if (!headersValidated && !validateHeaders()) {
-        closePart();
+    // A hedge still running either finishes the file (the primary yielded or broke off) or is no
+    // longer needed.
+    if (hedgeThread.joinable()) {
+        if (race->complete()) hedge.cancel.store(true, std::memory_order_release);
+        while (hedge.running.load(std::memory_order_acquire)) {
+            if (gCtx.stopRequested.load()) hedge.cancel.store(true, std::memory_order_release);
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        hedgeThread.join();
+    }
+    const bool wroteOk = closePart();
+    if (partOpts.hashes) *partOpts.hashes = writer.partHashes();
+    if (partOpts.crc) *partOpts.crc = writer.fileCrc();
+    // Preallocated parts are full length on disk; on failure cut them back to the committed bytes
+    // so the size-based retry/resume logic never counts the unwritten extent.
+    const uint64_t durableEnd = startOffset + sink.written();
+    auto failStream = [&]() -> bool {
+        if (partOpts.onPrealloc && durableEnd < totalSize) {
+            std::string trimErr;
+            if (!truncatePartsTo(tmpDir, partSize, durableEnd, trimErr)) {
+                logLine("Warning: failed to trim preallocated parts: " + trimErr);
+            }
+        }
         return false;
+    };
+    if (!headersValidated && !validateHeaders()) {
+        return failStream();
+    }
+    if (!wroteOk) {
+        logLine("Stream write error: " + err);
+        return failStream();
+    }
+    if (race->complete()) {
+        if (hedges > 0) logLine("Stream complete after " + std::to_string(hedges) + " hedge(s)");
+        return true;
+    }
+    if (primaryYielded && !gCtx.stopRequested.load()) {
+        err = hedge.err.empty() ? "Stream failed" : hedge.err;
+        logLine("Stream recv error (hedge): " + err);
+        return failStream();
     }
-    closePart();
 
     if (!ok) {
         if (streamErr == "Cancelled" || gCtx.stopRequested.load()) {
             err = "Stopped";
-            return false;
+            return failStream();
         }
         if (err.empty()) {
             err = !streamErr.empty() && streamErr != "Sink aborted" ? streamErr : "Stream failed";
         }
         logLine("Stream recv error: " + err);
-        return false;
+        return failStream();
     }
 
-    const uint64_t received = globalOffset - startOffset;
-    if (gCtx.stopRequested.load()) { err = "Stopped"; return false; }
-    if (received < expectedBody) { err = "Short read"; return false; }
-    if (received > expectedBody) { err = "Overflow"; return false; }
+    const uint64_t received = race->cursor() - startOffset;
+    if (gCtx.stopRequested.load()) { err = "Stopped"; return failStream(); }
+    if (received < expectedBody) { err = "Short read"; return failStream(); }
+    if (received > expectedBody) { err = "Overflow"; return failStream(); }
     return true;
 }
 
+// Pull the missing ranges of a file over several Range GETs at once; each segment writes its own
+// slice of the part files, and up to tune.connections segments run at a time. The calling
+// (worker) thread supervises: it relays stop requests, logs heartbeats and hedges connections the
+// stall detector flags. Whatever a segment
+// committed is reported through the checkpoint hook, so a failed run keeps its completed slices
+// (holes included) for the next attempt instead of trimming back to a contiguous prefix.
+static bool streamSegmented(const std::string& url,
+                            const std::string& authBasic,
+                            const std::vector<ByteRange>& gaps,
+                            uint64_t totalSize,
+                            uint64_t partSize,
+                            const std::string& tmpDir,
+                            Status& status,
+                            FileProgress& progress,
+                            const Config& cfg,
+                            const TuningParams& tune,
+                            const PartFileOptions& partOpts,
+                            std::string& err) {
+    int timeoutSec = cfg.httpTimeoutSeconds > 0 ? cfg.httpTimeoutSeconds : 10;
+    if (timeoutSec > 30) timeoutSec = 30;
+    const std::vector<ByteRange> segs = planSegmentsOver(gaps, tune.connections, kMinSegmentBytes);
+    if (segs.empty()) {
+        err = "Nothing to download";
+        return false;
+    }
+    uint64_t needBytes = 0;
+    for (const auto& seg : segs) needBytes += seg.size();
+    uint64_t freeBytes = 0;
+    if (!ensureFreeSpace(tmpDir, needBytes, &freeBytes)) {
+        err = "Not enough free space (need " + std::to_string(needBytes) +
+              " bytes + margin, have " + std::to_string(freeBytes) + ")";
+        logLine("Free-space check failed before segmented stream: " + err);
+        return false;
+    }
+    const size_t connections = std::min<size_t>(segs.size(), static_cast<size_t>(std::max(1, tune.connections)));
+    logLine("Segmented stream start: url=" + url + " need=" + std::to_string(needBytes) +
+            " total=" + std::to_string(totalSize) + " gaps=" + std::to_string(gaps.size()) +
+            " segments=" + std::to_string(segs.size()) + " connections=" + std::to_string(connections));
+
+    // conns[0] is the connection that took the segment, conns[1] a hedge; a later hedge may
+    // reuse whichever slot has finished.
+    struct SegmentState {
+        std::unique_ptr<RaceCursor> race;
+        RaceConn conns[2];
+        std::atomic<bool> started{false};
+        std::mutex mutex; // guards live, busy, ok, err and the closing flush
+        int live{0};
+        bool busy[2]{false, false}; // slot still owned by its thread (running may already be false)
+        bool ok{false};
+        std::string err;
+        // Monitor thread only.
+        int detectorId[2]{-1, -1};
+        int hedges{0};
+        int hedgeSlot{1}; // slot of the newest hedge
+        std::chrono::steady_clock::time_point hedgeStart{};
+    };
+    std::vector<SegmentState> states(segs.size());
+    std::atomic<bool> abortAll{false};
+
+    // One writer thread for all segments; each connection stages into its own ring stream.
+    const WriteBackend backend = writeBackendFor(cfg);
+    AsyncPartWriter writer(tmpDir, partSize, kWriteBlockBytes, std::max(kWriteBlockCount, connections * 2),
+                           &status.writeQueueStats, ioBufferBytesFor(backend, tune), backend);
+    writer.setBatchBytes(tune.writeBatchBytes);
+    // Every running segment writes its own part (hedges share their segment's), so keep one open
+    // per connection instead of closing and reopening parts round-robin on each block.
+    writer.setMaxOpenParts(std::max(PartWriter::kDefaultOpenParts, static_cast<size_t>(connections)));
+    if (partOpts.onPrealloc) writer.setPreallocate(totalSize, partOpts.onPrealloc);
+    if (partOpts.hashes) writer.enableHashing(*partOpts.hashes);
+    if (partOpts.crc) writer.enableFileCrc(*partOpts.crc);
+    std::vector<std::unique_ptr<AsyncPartWriter::Stream>> streams;
+    streams.reserve(segs.size());
+    for (size_t i = 0; i < segs.size(); ++i) {
+        streams.push_back(std::make_unique<AsyncPartWriter::Stream>(writer));
+        AsyncPartWriter::Stream* sink = streams.back().get();
+        states[i].race = std::make_unique<RaceCursor>(
+            segs[i].start, segs[i].end,
+            [sink](uint64_t offset, const char* data, size_t len, std::string& writeErr) {
+                return sink->write(offset, data, len, writeErr);
+            });
+    }
+    // The committed head of every segment is durable, wherever it sits in the file.
+    auto writtenRanges = [&]() -> RangeSet {
+        RangeSet written;
+        for (size_t i = 0; i < segs.size(); ++i) written.add(segs[i].start, segs[i].start + streams[i]->written());
+        return written;
+    };
+    if (partOpts.onCheckpoint) {
+        writer.setCheckpoint(kCheckpointBytes, kCheckpointMs, [&](const PartHashes& hashes) {
+            partOpts.onCheckpoint(writtenRanges(), hashes, writer.fileCrc());
+        });
+    }
+    writer.start();
+
+    // Connection `slot` of segment i: run it, and close the segment when it is the last one out.
+    auto runConnection = [&](size_t i, int slot) {
+        SegmentState& ss = states[i];
+        runRaceConnection(url, authBasic, *ss.race, timeoutSec, tune, abortAll, ss.conns[slot], status, progress);
+        std::lock_guard<std::mutex> lock(ss.mutex);
+        ss.busy[slot] = false;
+        if (--ss.live > 0) return; // the rival connection carries on
+        std::string flushErr;
+        const bool flushed = streams[i]->flush(flushErr);
+        ss.ok = flushed && ss.race->complete();
+        if (ss.ok) return;
+        ss.err = !flushed ? flushErr : !ss.conns[slot].err.empty() ? ss.conns[slot].err : ss.conns[1 - slot].err;
+        abortAll.store(true, std::memory_order_release);
+    };
+    // Call with the segment's mutex held.
+    auto startConnection = [&](size_t i, int slot, uint64_t from) {
+        RaceConn& conn = states[i].conns[slot];
+        conn.cancel.store(false);
+        conn.from = from;
+        conn.pos.store(from);
+        conn.err.clear();
+        conn.running.store(true, std::memory_order_release);
+        states[i].busy[slot] = true;
+        states[i].live++;
+    };
+
+    // Each connection takes the next unstarted segment until none are left (or one failed).
+    std::atomic<size_t> nextSeg{0};
+    std::atomic<size_t> connectionsDone{0};
+    std::vector<std::thread> threads;
+    threads.reserve(connections);
+    for (size_t c = 0; c < connections; ++c) {
+        threads.emplace_back([&]() {
+            for (size_t i = nextSeg.fetch_add(1); i < segs.size(); i = nextSeg.fetch_add(1)) {
+                if (abortAll.load(std::memory_order_acquire)) break;
+                {
+                    std::lock_guard<std::mutex> lock(states[i].mutex);
+                    startConnection(i, 0, segs[i].start);
+                }
+                states[i].started.store(true, std::memory_order_release);
+                runConnection(i, 0);
+            }
+            connectionsDone.fetch_add(1, std::memory_order_release);
+        });
+    }
+
+    const uint64_t kProbeBytes = 10ULL * 1024ULL * 1024ULL;
+    bool probeLogged = false;
+    auto transferStart = std::chrono::steady_clock::now();
+    auto lastBeat = transferStart;
+    TuningWindow tuning(writer, status.writeQueueStats);
+    auto sumDone = [&]() {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < segs.size(); ++i) sum += states[i].race->cursor() - segs[i].start;
+        return sum;
+    };
+    // Zombie connections: a lagging connection gets a hedge over the rest of its segment; after
+    // kHedgeRaceMs the one that got further keeps the segment and the other is cancelled.
+    StallDetector stalls;
+    std::vector<std::thread> hedgeThreads;
+    int hedgesLive = 0;
+    uint64_t writerStallAtCheck = status.writeQueueStats.stallMs.load();
+    auto msSinceStart = [&](std::chrono::steady_clock::time_point t) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(t - transferStart).count());
+    };
+    auto monitorStalls = [&](std::chrono::steady_clock::time_point now) {
+        const uint64_t nowMs = msSinceStart(now);
+        hedgesLive = 0;
+        for (size_t i = 0; i < segs.size(); ++i) {
+            SegmentState& ss = states[i];
+            if (!ss.started.load(std::memory_order_acquire)) continue;
+            for (int slot = 0; slot < 2; ++slot) {
+                RaceConn& conn = ss.conns[slot];
+                const bool running = conn.running.load(std::memory_order_acquire);
+                if (running && ss.detectorId[slot] < 0) {
+                    ss.detectorId[slot] = stalls.track(nowMs);
+                } else if (!running && ss.detectorId[slot] >= 0) {
+                    stalls.untrack(ss.detectorId[slot]);
+                    ss.detectorId[slot] = -1;
+                }
+                if (running) stalls.sample(ss.detectorId[slot], conn.pos.load() - conn.from, nowMs);
+            }
+            const bool both = ss.conns[0].running.load() && ss.conns[1].running.load();
+            if (!both) continue;
+            hedgesLive++;
+            if (now - ss.hedgeStart < std::chrono::milliseconds(kHedgeRaceMs)) continue;
+            // The race is over: keep whichever connection got further (the older one on a tie).
+            const int hedgeSlot = ss.hedgeSlot;
+            const int loser = ss.conns[hedgeSlot].pos.load() > ss.conns[1 - hedgeSlot].pos.load() ? 1 - hedgeSlot
+                                                                                                 : hedgeSlot;
+            ss.conns[loser].cancel.store(true, std::memory_order_release);
+            stalls.untrack(ss.detectorId[loser]);
+            ss.detectorId[loser] = -1;
+            // A winner that was flagged gets judged afresh from here on.
+            if (loser == hedgeSlot) {
+                stalls.untrack(ss.detectorId[1 - loser]);
+                ss.detectorId[1 - loser] = stalls.track(nowMs);
+            }
+            hedgesLive--;
+            logLine(std::string("Hedge ") + (loser == hedgeSlot ? "lost" : "won") + " on segment " +
+                    std::to_string(i) + " at " + std::to_string(ss.race->cursor()) + "/" +
+                    std::to_string(segs[i].end));
+        }
+        // Writer stalls and the bandwidth cap slow every connection alike; neither is a zombie.
+        const uint64_t writerStall = status.writeQueueStats.stallMs.load();
+        const bool sdBound = writerStall - writerStallAtCheck > kStallCheckMs / 4;
+        writerStallAtCheck = writerStall;
+        if (sdBound) {
+            stalls.restartWindows(nowMs);
+            return;
+        }
+        if (gCtx.rateLimiter.currentBytesPerSec() > 0) return;
+        for (int id : stalls.poll(nowMs)) {
+            for (size_t i = 0; i < segs.size(); ++i) {
+                SegmentState& ss = states[i];
+                const int slot = ss.detectorId[0] == id ? 0 : ss.detectorId[1] == id ? 1 : -1;
+                if (slot < 0) continue;
+                const double rate = stalls.rate(id);
+                if (hedgesLive >= kMaxHedgesPerStream || ss.hedges >= kMaxHedgesPerSegment ||
+                    abortAll.load(std::memory_order_acquire)) {
+                    break;
+                }
+                const int hedgeSlot = 1 - slot;
+                uint64_t from = 0;
+                {
+                    std::lock_guard<std::mutex> lock(ss.mutex);
+                    if (ss.live == 0 || ss.busy[hedgeSlot] || ss.race->complete()) break;
+                    from = ss.race->cursor();
+                    startConnection(i, hedgeSlot, from);
+                }
+                ss.hedges++;
+                ss.hedgeSlot = hedgeSlot;
+                ss.hedgeStart = now;
+                ss.detectorId[hedgeSlot] = stalls.track(nowMs);
+                hedgesLive++;
+                logLine("Hedging segment " + std::to_string(i) + " from " + std::to_string(from) + "/" +
+                        std::to_string(segs[i].end) + ": " + std::to_string(static_cast<uint64_t>(rate / 1024)) +
+                        " KB/s vs baseline " + std::to_string(static_cast<uint64_t>(stalls.baseline() / 1024)) +
+                        " KB/s");
+                hedgeThreads.emplace_back([&, i, hedgeSlot]() { runConnection(i, hedgeSlot); });
+                break;
+            }
+        }
+    };
+    while (true) {
+        if (connectionsDone.load(std::memory_order_acquire) == threads.size()) {
+            bool anyLive = false;
+            for (auto& ss : states) {
+                std::lock_guard<std::mutex> lock(ss.mutex);
+                if (ss.live > 0) anyLive = true;
+            }
+            if (!anyLive) break;
+        }
+        if (gCtx.stopRequested.load()) abortAll.store(true, std::memory_order_release);
+        if (abortAll.load(std::memory_order_acquire)) {
+            for (auto& ss : states) {
+                ss.conns[0].cancel.store(true, std::memory_order_release);
+                ss.conns[1].cancel.store(true, std::memory_order_release);
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(kStallCheckMs));
+
+        const uint64_t received = sumDone();
+        tuning.poll(received);
+        auto now = std::chrono::steady_clock::now();
+        monitorStalls(now);
+        if (!probeLogged && received >= kProbeBytes) {
+            double secs = std::chrono::duration<double>(now - transferStart).count();
+            if (secs <= 0.0) secs = 1e-6;
+            double mbps = (received / (1024.0 * 1024.0)) / secs; // MB/s
+            logLine("Throughput estimate ~" + std::to_string(mbps) + " MB/s (first 10MB, " +
+                    std::to_string(connections) + " connections)");
+            probeLogged = true;
+        }
+        if (now - lastBeat > std::chrono::seconds(10)) {
+            std::string titleCopy;
+            {
+                std::lock_guard<std::mutex> lock(status.mutex);
+                titleCopy = status.currentDownloadTitle;
+            }
+            logDebug("Heartbeat: " + titleCopy + " [" + progress.name + "]" +
+                     " segments=" + std::to_string(segs.size()) +
+                     " cur=" + std::to_string(progress.downloaded.load()) + "/" +
+                     std::to_string(progress.size.load()) +
+                     " total=" + std::to_string(status.totalDownloadedBytes.load()) + "/" +
+                     std::to_string(status.totalDownloadBytes.load()) +
+                     " wq=" + std::to_string(status.writeQueueStats.depth.load()) +
+                     " stallMs=" + std::to_string(status.writeQueueStats.stallMs.load()) +
+                     " throttledMs=" + std::to_string(gCtx.rateLimiter.throttledMs()) +
+                     " rateKBps=" + std::to_string(static_cast<uint64_t>(status.throughput.snapshot().bytesPerSec / 1024)),
+                     "DL");
+            lastBeat = now;
+        }
+    }
+    for (auto& t : threads) t.join();
+    for (auto& t : hedgeThreads) t.join();
+
+    std::string writeErr;
+    const bool wroteOk = writer.finish(writeErr);
+    if (partOpts.hashes) *partOpts.hashes = writer.partHashes();
+    if (partOpts.crc) *partOpts.crc = writer.fileCrc();
+    bool allOk = wroteOk;
+    for (auto& ss : states) {
+        std::lock_guard<std::mutex> lock(ss.mutex);
+        if (!ss.ok) allOk = false;
+    }
+    if (allOk) {
+        logLine("Segmented stream complete: segments=" + std::to_string(segs.size()));
+        return true;
+    }
+
+    // The final checkpoint in finish() already recorded the committed slices; nothing is trimmed.
+    const RangeSet kept = writtenRanges();
+    if (gCtx.stopRequested.load()) {
+        err = "Stopped";
+    } else if (!wroteOk) {
+        err = writeErr;
+    } else {
+        for (auto& ss : states) {
+            std::lock_guard<std::mutex> lock(ss.mutex);
+            if (!ss.err.empty() && ss.err != "Cancelled") {
+                err = ss.err;
+                break;
+            }
+        }
+        if (err.empty()) err = "Stream failed";
+    }
+    logLine("Segmented stream failed: " + err + "; kept " + std::to_string(kept.covered()) + " bytes in " +
+            std::to_string(kept.ranges().size()) + " range(s)");
+    return false;
+}
+
 // Rename *.part -> 00/01... then move tmpDir to finalDir (archive bit set for multi-part).
-static bool finalizeParts(const std::string& tmpDir, const std::string& finalDir) {
+static bool finalizeParts(const std::string& tmpDir, const std::string& finalDir, const CopyProgressFn& onCopy) {
     // Drop manifest (avoid carrying metadata into the final folder).
     std::error_code rmManifestEc;
     std::filesystem::remove(tmpDir + "/manifest.json", rmManifestEc);
+    std::filesystem::remove(tmpDir + "/manifest.json.tmp", rmManifestEc);
     // rename *.part -> 00/01... and move dir + set archive bit
     DIR* d = opendir(tmpDir.c_str());
     if (!d) return false;
@@ -555,11 +1363,9 @@ static bool finalizeParts(const std::string& tmpDir, const std::string& finalDir
                     " err=" + renEc.message() + " errno=" + std::to_string(errno) +
                     " strerror=" + std::string(strerror(errno)));
             // fallback: copy then remove source
-            std::error_code cpEc;
-            std::filesystem::copy_file(src, finalDir,
-                                       std::filesystem::copy_options::overwrite_existing, cpEc);
-            if (cpEc) {
-                logLine("Copy fallback failed " + src + " -> " + finalDir + " err=" + cpEc.message());
+            std::string cpErr;
+            if (!copyFileStreaming(src, finalDir, onCopy, cpErr)) {
+                logLine("Copy fallback failed " + src + " -> " + finalDir + " err=" + cpErr);
                 return false;
             }
             std::error_code delEc;
@@ -630,23 +1436,51 @@ static std::string sanitizeRelativePath(const std::string& rel) {
     return out;
 }
 
-// Download a single file (Game-compatible) into FAT32-safe parts. Resumes completed parts; deletes partial fragments.
-static bool downloadOneFile(Game g, const DownloadFileSpec* spec, Status& status, const Config& cfg) {
-    std::string auth;
-    if (!cfg.username.empty() || !cfg.password.empty()) {
-        auth = romm::util::base64Encode(cfg.username + ":" + cfg.password);
-    }
+struct TempLayout {
+    std::string baseDir;  // final outputs: <downloadDir>/<platform>/<title_id>
+    std::string tempRoot; // <downloadDir>/temp/<platform>/<romId>/<fileId>
+    std::string tmpDir;   // <tempRoot>/<title(12)>_<id(8)>.tmp: parts + manifest
+    std::string idSuffix;
+};
+
+// Where a file's parts and its final output live; the archive stage fills the same temp dirs.
+static TempLayout tempLayoutFor(const Config& cfg, const Game& g) {
+    TempLayout out;
     std::string platformSlug = g.platformSlug.empty() ? "unknown" : g.platformSlug;
     std::string platSafe = safeName(platformSlug);
     std::string romSafe = safeName(!g.id.empty() ? g.id : g.fileId);
     std::string fileSafe = safeName(g.fileId);
     if (romSafe.empty()) romSafe = "rom";
     if (fileSafe.empty()) fileSafe = "file";
-    // Final outputs live under <downloadDir>/<platform>/<title__id.ext>
-    std::string baseDir = cfg.downloadDir + "/" + platSafe + "/" + romFolderName(g);
+    out.baseDir = cfg.downloadDir + "/" + platSafe + "/" + romFolderName(g);
+    out.tempRoot = cfg.downloadDir + "/temp/" + platSafe + "/" + romSafe + "/" + fileSafe;
+    std::string tmpName = safeName(g.title);
+    if (tmpName.empty() && !g.fsName.empty()) tmpName = safeName(g.fsName);
+    if (tmpName.size() > 12) tmpName = tmpName.substr(0, 12);
+    out.idSuffix = safeName(!g.id.empty() ? g.id : g.fileId);
+    if (out.idSuffix.size() > 8) out.idSuffix = out.idSuffix.substr(0, 8);
+    if (tmpName.empty()) tmpName = out.idSuffix.empty() ? "rom" : out.idSuffix;
+    out.tmpDir = out.tempRoot + "/" + tmpName;
+    if (!out.idSuffix.empty()) out.tmpDir += "_" + out.idSuffix;
+    out.tmpDir += ".tmp";
+    return out;
+}
+
+// Download a single file (Game-compatible) into FAT32-safe parts. Resumes completed parts; deletes partial fragments.
+// Failed streams are retried in place from the last checkpoint while `retries` (the item's budget) allows.
+static bool downloadOneFile(Game g, const DownloadFileSpec* spec, Status& status, FileProgress& progress,
+                            const Config& cfg, RetryBudget& retries, FinalizeStep& finalize) {
+    std::string auth;
+    if (!cfg.username.empty() || !cfg.password.empty()) {
+        auth = romm::util::base64Encode(cfg.username + ":" + cfg.password);
+    }
+    const TempLayout layout = tempLayoutFor(cfg, g);
+    const FileChecksums expected = spec ? spec->checksums : FileChecksums{};
+    const std::string& baseDir = layout.baseDir;
+    const std::string& tempRoot = layout.tempRoot;
+    const std::string& tmpDir = layout.tmpDir;
+    const std::string& idSuffix = layout.idSuffix;
     ensureDirectory(baseDir);
-    // Temps live under <downloadDir>/temp/<platform>/<romId>/<fileId>/...
-    std::string tempRoot = cfg.downloadDir + "/temp/" + platSafe + "/" + romSafe + "/" + fileSafe;
     ensureDirectory(tempRoot);
 
     // free space check for full ROM upfront (best effort)
@@ -665,25 +1499,32 @@ static bool downloadOneFile(Game g, const DownloadFileSpec* spec, Status& status
         return false;
     }
 
-    std::string tmpName = safeName(g.title);
-    if (tmpName.empty() && !g.fsName.empty()) tmpName = safeName(g.fsName);
-    if (tmpName.size() > 12) tmpName = tmpName.substr(0, 12);
-    std::string idSuffix = safeName(!g.id.empty() ? g.id : g.fileId);
-    if (idSuffix.size() > 8) idSuffix = idSuffix.substr(0, 8);
-    if (tmpName.empty()) tmpName = idSuffix.empty() ? "rom" : idSuffix;
-    std::string tmpDir = tempRoot + "/" + tmpName;
-    if (!idSuffix.empty()) tmpDir += "_" + idSuffix;
-    tmpDir += ".tmp";
     ensureDirectory(tmpDir);
     logLine("Using temp dir: " + tmpDir);
     logLine("Download URL: " + g.downloadUrl);
     PreflightInfo pf;
     uint64_t originalSize = g.sizeBytes;
-    if (!preflight(g.downloadUrl, auth, cfg.httpTimeoutSeconds, pf)) {
+    bool prepared = false;
+    if (auto cached = gCtx.preflightCache.take(g.downloadUrl)) {
+        pf.contentLength = cached->contentLength;
+        pf.supportsRanges = cached->supportsRanges;
+        prepared = pf.contentLength > 0;
+    }
+    // Single-request mode: with nothing cached, the first data GET doubles as the preflight (see
+    // ResponseProbe) and the plan below starts from the metadata size. preflight() only runs when
+    // that GET cannot answer for it: a segmented transfer, or a response contradicting the plan.
+    bool deferred = !prepared && g.sizeBytes > 0;
+    if (prepared) {
+        logLine("Preflight (look-ahead) for " + g.title + " len=" + std::to_string(pf.contentLength) +
+                " ranges=" + (pf.supportsRanges ? "true" : "false"));
+    } else if (deferred) {
+        pf.supportsRanges = true; // assumed; a resumed GET that gets a 200 instead of 206 falls back
+        logLine("Preflight deferred to the data request for " + g.title);
+    } else if (!preflight(g.downloadUrl, auth, cfg.httpTimeoutSeconds, pf)) {
         logLine("Preflight failed for " + g.title + " (HEAD/Range probe). Aborting download.");
         setDownloadFailureState(status, true, "Preflight failed");
         // Persist a manifest with failure reason so restart shows the failure.
-        Manifest failManifest = buildManifestFor(g, g.sizeBytes, partSizeFor(cfg, g.sizeBytes));
+        Manifest failManifest = buildManifestFor(g, g.sizeBytes, partSizeFor(cfg, g.sizeBytes), expected);
         failManifest.failureReason = "Preflight failed (HEAD/Range)";
         writeManifestFile(tmpDir + "/manifest.json", failManifest);
         return false;
@@ -698,23 +1539,26 @@ static bool downloadOneFile(Game g, const DownloadFileSpec* spec, Status& status
     if (effectiveSize == 0) {
         effectiveSize = g.sizeBytes;
     }
-    {
+    auto applySize = [&](uint64_t oldSize, uint64_t newSize) {
         std::lock_guard<std::mutex> lock(status.mutex);
-        status.currentDownloadSize.store(effectiveSize);
-        g.sizeBytes = effectiveSize;
-        if (!status.downloadQueue.empty()) {
-            // Replace the queued size so recomputeTotals uses the effective size.
-            status.downloadQueue.front().game.sizeBytes = effectiveSize;
+        progress.size.store(newSize);
+        g.sizeBytes = newSize;
+        // Replace the queued size so recomputeTotals uses the effective size.
+        for (auto& q : status.downloadQueue) {
+            if (q.state != QueueState::Downloading) continue;
+            q.game.sizeBytes = newSize;
+            break;
         }
         uint64_t curTotal = status.totalDownloadBytes.load();
-        if (curTotal >= originalSize) {
-            status.totalDownloadBytes.store(curTotal - originalSize + effectiveSize);
+        if (curTotal >= oldSize) {
+            status.totalDownloadBytes.store(curTotal - oldSize + newSize);
         } else {
-            status.totalDownloadBytes.store(effectiveSize);
+            status.totalDownloadBytes.store(newSize);
         }
-    }
+    };
+    applySize(originalSize, effectiveSize);
 
-    uint64_t totalSize = status.currentDownloadSize.load();
+    uint64_t totalSize = progress.size.load();
     uint64_t partSize = partSizeFor(cfg, totalSize);
     bool refreshedMetadata = false;
     const uint64_t kTinyContentThreshold = 1024ULL * 1024ULL; // 1 MB
@@ -726,13 +1570,16 @@ static bool downloadOneFile(Game g, const DownloadFileSpec* spec, Status& status
     bool needRewrite = true;
     if (haveManifest) {
         // Reuse only if consistent with current download parameters.
+        // Different digests from the server mean a different file behind the same id.
         if (manifestCompatible(manifest, g, totalSize, partSize) &&
-            manifest.failureReason.empty()) {
+            manifest.failureReason.empty() &&
+            (expected.empty() || manifest.checksums.empty() || manifest.checksums == expected)) {
             needRewrite = false;
+            if (!expected.empty()) manifest.checksums = expected;
         }
     }
     if (needRewrite) {
-        manifest = buildManifestFor(g, totalSize, partSize);
+        manifest = buildManifestFor(g, totalSize, partSize, expected);
         writeManifestFile(manifestPath, manifest);
     }
 
@@ -746,9 +1593,23 @@ static bool downloadOneFile(Game g, const DownloadFileSpec* spec, Status& status
             if (!parsePartIndex(ent->d_name, idx)) continue;
             std::string p = tmpDir + "/" + ent->d_name;
             struct stat st{};
-            if (stat(p.c_str(), &st) == 0) {
-                observedParts.push_back({idx, static_cast<uint64_t>(st.st_size)});
+            if (stat(p.c_str(), &st) != 0) continue;
+            uint64_t size = static_cast<uint64_t>(st.st_size);
+            // Spot-check against the in-flight hash record before trusting the size.
+            auto mp = std::find_if(manifest.parts.begin(), manifest.parts.end(),
+                                   [&](const ManifestPart& part) { return part.index == idx; });
+            if (mp != manifest.parts.end()) {
+                std::string hashErr;
+                if (!verifyPartHash(p, *mp, size, hashErr)) {
+                    logLine("Part " + std::to_string(idx) + " failed hash check (" + hashErr + "); discarding");
+                    size = 0; // planResume treats an empty part as invalid
+                    clearPartHash(*mp);
+                } else if (mp->preallocated && !mp->hashState.empty() && mp->hashOffset <= size) {
+                    // The verified hashed prefix is real data even if the preallocation marker lags.
+                    mp->written = std::max(mp->written, mp->hashOffset);
+                }
             }
+            observedParts.push_back({idx, size});
         }
         closedir(d);
     }
@@ -756,7 +1617,9 @@ static bool downloadOneFile(Game g, const DownloadFileSpec* spec, Status& status
     logLine("Resume plan: valid=" + std::to_string(resumePlan.validParts.size()) +
             " partial=" + std::to_string(resumePlan.partialIndex) +
             " bytesHave=" + std::to_string(resumePlan.bytesHave) +
-            " bytesNeed=" + std::to_string(resumePlan.bytesNeed));
+            " bytesNeed=" + std::to_string(resumePlan.bytesNeed) +
+            " gaps=" + std::to_string(resumePlan.missing.size()) +
+            (manifest.hasRangeMap ? " (range map)" : ""));
     // Drop any invalid parts so we never append onto bad data.
     for (int idx : resumePlan.invalidParts) {
         std::string p = tmpDir + "/";
@@ -782,11 +1645,27 @@ static bool downloadOneFile(Game g, const DownloadFileSpec* spec, Status& status
         writeManifestFile(manifestPath, manifest);
     }
 
-    uint64_t haveBytes = std::min<uint64_t>(resumePlan.bytesHave, totalSize);
+    // Bytes already on the card (whole-file ranges); checkpoints extend it as streams commit.
+    RangeSet have = resumePlan.have.clipped(0, totalSize);
+    uint64_t haveBytes = have.covered();
+    // A crash can leave part bytes past the last checkpoint (never fsynced, possibly garbage) or
+    // preallocated parts at full length; cut each part back to the last byte the manifest vouches
+    // for so later size-based accounting stays honest. Unvouched bytes inside holes are refetched.
+    {
+        std::string trimErr;
+        if (!truncatePartsToRanges(tmpDir, partSize, have, trimErr)) {
+            logLine("Warning: failed to trim parts to resume point: " + trimErr);
+        }
+        clearPreallocated(manifest);
+    }
+    recordDurableRanges(manifest, have);
+    PartHashes partHashes = seedPartHashes(manifest, partSize, have);
+    FileCrc fileCrc = seedFileCrc(manifest, have);
+    writeManifestFile(manifestPath, manifest);
     {
         std::lock_guard<std::mutex> lock(status.mutex);
-        status.currentDownloadSize.store(totalSize);
-        status.currentDownloadedBytes.store(haveBytes);
+        progress.size.store(totalSize);
+        progress.downloaded.store(haveBytes);
         status.currentDownloadTitle = g.title;
     }
     logLine("Resume state: haveBytes=" + std::to_string(haveBytes) +
@@ -799,14 +1678,45 @@ static bool downloadOneFile(Game g, const DownloadFileSpec* spec, Status& status
         creditedExisting = haveBytes;
     }
 
-    if (haveBytes >= totalSize) {
-        logLine("Already have full size for " + g.title);
-    }
-
-    const int maxAttempts = 3;
     int attempt = 0;
+    bool refreshedAfter404 = false;
     std::string err;
     bool okStream = false;
+    // Runs on the writer thread just before a part is extended; records the real data extent first
+    // so a crash between the two never lets resume trust the zero-filled tail.
+    PartFileOptions partOpts;
+    if (cfg.hashParts) partOpts.hashes = &partHashes;
+    // The CRC runs along on the writer thread only when there is a CRC to check it against.
+    if (!expected.crc32.empty()) partOpts.crc = &fileCrc;
+    // Writer thread, right after an fsync: persist the durable ranges (and the hashes covering them).
+    // The worker thread only reads `have` again once the stream returned.
+    partOpts.onCheckpoint = [&](const RangeSet& written, const PartHashes& hashes, const FileCrc& crc) {
+        have.add(written);
+        recordDurableRanges(manifest, have);
+        if (partOpts.hashes) {
+            PartHashes durable = hashes;
+            dropHashesOutside(durable, partSize, have);
+            recordPartHashes(manifest, durable);
+        }
+        if (partOpts.crc) {
+            FileCrc durable = crc;
+            durable.keepInside(have);
+            recordFileCrc(manifest, durable);
+        }
+        writeManifestFile(manifestPath, manifest);
+    };
+    if (cfg.preallocateParts) {
+        partOpts.onPrealloc = [&](uint64_t partIndex) {
+            for (auto& part : manifest.parts) {
+                if (part.index != static_cast<int>(partIndex)) continue;
+                const uint64_t partStart = partIndex * partSize;
+                part.preallocated = true;
+                part.written = std::min<uint64_t>(have.runEnd(partStart) - partStart, part.size);
+                writeManifestFile(manifestPath, manifest);
+                break;
+            }
+        };
+    }
     auto refreshMetadata = [&]() mutable -> bool {
         if (refreshedMetadata) return false;
         refreshedMetadata = true;
@@ -819,13 +1729,17 @@ static bool downloadOneFile(Game g, const DownloadFileSpec* spec, Status& status
         }
         removeDirRecursive(tmpDir);
         ensureDirectory(tmpDir);
-        manifest = buildManifestFor(g, g.sizeBytes, partSizeFor(cfg, g.sizeBytes));
+        manifest = buildManifestFor(g, g.sizeBytes, partSizeFor(cfg, g.sizeBytes), expected);
+        have.clear();
+        recordDurableRanges(manifest, have);
         writeManifestFile(manifestPath, manifest);
+        partHashes.clear();
+        fileCrc.clear();
+        // Drop only this file's credited bytes; sibling bundle files may be counting concurrently.
+        rollbackFileCredit(progress.downloaded, status.totalDownloadedBytes, 0);
         haveBytes = 0;
         creditedExisting = 0;
-        status.currentDownloadedBytes.store(0);
-        status.totalDownloadedBytes.store(0);
-        status.currentDownloadSize.store(g.sizeBytes);
+        progress.size.store(g.sizeBytes);
         {
             std::lock_guard<std::mutex> lock(status.mutex);
             status.currentDownloadTitle = g.title;
@@ -837,26 +1751,78 @@ static bool downloadOneFile(Game g, const DownloadFileSpec* spec, Status& status
         }
         logLine("Refresh succeeded; new URL=" + g.downloadUrl + " len=" + std::to_string(pf.contentLength));
         totalSize = pf.contentLength ? pf.contentLength : g.sizeBytes;
-        status.currentDownloadSize.store(totalSize);
+        progress.size.store(totalSize);
+        deferred = false;
+        return true;
+    };
+    // The server's size differs from the metadata size the plan was built on: start the file over.
+    auto restartAtSize = [&](uint64_t newSize) {
+        logLine("Server size " + std::to_string(newSize) + " differs from planned " + std::to_string(totalSize) +
+                "; restarting " + g.title);
+        removeDirRecursive(tmpDir);
+        ensureDirectory(tmpDir);
+        partSize = partSizeFor(cfg, newSize);
+        manifest = buildManifestFor(g, newSize, partSize, expected);
+        have.clear();
+        recordDurableRanges(manifest, have);
+        writeManifestFile(manifestPath, manifest);
+        partHashes.clear();
+        fileCrc.clear();
+        rollbackFileCredit(progress.downloaded, status.totalDownloadedBytes, 0);
+        haveBytes = 0;
+        creditedExisting = 0;
+        applySize(totalSize, newSize);
+        totalSize = newSize;
+    };
+    // Fallback from single-request mode: the classic HEAD / Range 0-0 preflight, then re-plan if
+    // the server disagrees with the metadata.
+    auto resolvePreflight = [&]() -> bool {
+        deferred = false;
+        if (!preflight(g.downloadUrl, auth, cfg.httpTimeoutSeconds, pf)) {
+            logLine("Preflight failed for " + g.title + " (HEAD/Range probe)");
+            err = "Preflight failed";
+            return false;
+        }
+        logLine("Preflight for " + g.title + " len=" + std::to_string(pf.contentLength) +
+                " ranges=" + (pf.supportsRanges ? "true" : "false"));
+        if (pf.contentLength > 0 && pf.contentLength < kTinyContentThreshold) {
+            logLine("Tiny Content-Length (" + std::to_string(pf.contentLength) + " bytes) for " + g.title +
+                    "; attempting metadata refresh");
+            if (refreshMetadata()) return true;
+            err = "Server returned tiny Content-Length (" + std::to_string(pf.contentLength) + " bytes)";
+            return false;
+        }
+        if (pf.contentLength > 0 && pf.contentLength != totalSize) restartAtSize(pf.contentLength);
         return true;
     };
     // If preflight returned an implausibly tiny length (e.g., HTML error page), try one refresh up front.
     if (pf.contentLength > 0 && pf.contentLength < kTinyContentThreshold) {
         logLine("Tiny Content-Length (" + std::to_string(pf.contentLength) + " bytes) for " + g.title + "; attempting metadata refresh");
         if (refreshMetadata()) {
-            totalSize = status.currentDownloadSize.load();
+            totalSize = progress.size.load();
         } else {
             err = "Server returned tiny Content-Length (" + std::to_string(pf.contentLength) + " bytes)";
             return false;
         }
     }
 
-    while (attempt < maxAttempts && !okStream && !gCtx.stopRequested.load()) {
+    // Every byte is already durable (an earlier run or the bundle archive stage): nothing to stream,
+    // and a Range request at EOF would only earn a 416.
+    if (totalSize > 0 && haveBytes >= totalSize) {
+        logLine("Already have full size for " + g.title);
+        okStream = true;
+    }
+
+    while (!okStream && !gCtx.stopRequested.load()) {
         bool useRange = pf.supportsRanges && haveBytes > 0;
         if (!pf.supportsRanges && haveBytes > 0) {
             logLine("Server does not support Range; restarting download for " + g.title);
             removeDirRecursive(tmpDir);
             ensureDirectory(tmpDir);
+            have.clear();
+            partHashes = seedPartHashes(manifest, partSize, have); // drops every hash record
+            fileCrc = seedFileCrc(manifest, have);
+            recordDurableRanges(manifest, have);
             if (creditedExisting > 0) {
                 uint64_t curTotal = status.totalDownloadedBytes.load();
                 if (curTotal >= creditedExisting) {
@@ -866,67 +1832,113 @@ static bool downloadOneFile(Game g, const DownloadFileSpec* spec, Status& status
                 }
                 creditedExisting = 0;
             }
-            status.currentDownloadedBytes.store(0);
+            progress.downloaded.store(0);
             haveBytes = 0;
             useRange = false;
         }
         err.clear();
-        uint64_t totalBefore = status.totalDownloadedBytes.load();
+        const TuningParams tune = gCtx.tuner.beginStream();
+        // One trailing gap streams sequentially unless it is worth splitting; holes before the end
+        // (out-of-order or retried segments left behind) always go through Range segments.
+        const std::vector<ByteRange> gaps = have.missing(0, totalSize);
+        const bool trailingOnly = gaps.empty() || (gaps.size() == 1 && gaps.front().end == totalSize);
+        const bool segmented = pf.supportsRanges && !gaps.empty() &&
+                               (!trailingOnly ||
+                                (tune.connections > 1 && (totalSize - haveBytes) >= 2 * kMinSegmentBytes));
+        if (deferred && segmented) {
+            // Several Range connections at once: confirm size and range support before splitting.
+            if (!resolvePreflight()) break;
+            continue;
+        }
+        const uint64_t haveBefore = haveBytes;
         logLine("Begin stream attempt " + std::to_string(attempt + 1) +
                 " range=" + (useRange ? "true" : "false") +
                 " haveBytes=" + std::to_string(haveBytes) +
-                " totalSize=" + std::to_string(totalSize));
-        okStream = streamDownload(g.downloadUrl, auth, useRange, haveBytes, totalSize, partSize, tmpDir, status, cfg, err);
+                " totalSize=" + std::to_string(totalSize) +
+                " io=" + writeBackendName(writeBackendFor(cfg)) +
+                (deferred ? " (single request)" : ""));
+        logLine("Stream tuning: recv=" + std::to_string(tune.recvBufferBytes / 1024) +
+                "KB io=" + std::to_string(tune.ioBufferBytes / 1024) +
+                "KB batch=" + std::to_string(tune.writeBatchBytes / 1024) +
+                "KB connections=" + std::to_string(tune.connections));
+        ResponseProbe probe;
+        probe.minTotal = kTinyContentThreshold;
+        if (segmented) {
+            okStream = streamSegmented(g.downloadUrl, auth, gaps, totalSize, partSize, tmpDir, status, progress,
+                                       cfg, tune, partOpts, err);
+        } else {
+            okStream = streamDownload(g.downloadUrl, auth, useRange, pf.supportsRanges, haveBytes, totalSize, partSize,
+                                      tmpDir, status, progress, cfg, tune, partOpts, deferred ? &probe : nullptr,
+                                      err);
+        }
+        if (deferred && probe.answered && !probe.mismatch) {
+            // The data GET answered everything the preflight would have.
+            deferred = false;
+            pf.contentLength = probe.total;
+            pf.supportsRanges = probe.supportsRanges;
+        }
+        // Streams trim preallocated parts to the committed bytes on failure, so the markers can go;
+        // hashed prefixes are persisted so a later resume keeps hashing where this attempt stopped.
+        bool manifestDirty = clearPreallocated(manifest);
+        if (partOpts.hashes) {
+            dropHashesOutside(partHashes, partSize, have);
+            recordPartHashes(manifest, partHashes);
+            manifestDirty = true;
+        }
+        if (partOpts.crc) {
+            fileCrc.keepInside(have);
+            recordFileCrc(manifest, fileCrc);
+            manifestDirty = true;
+        }
+        if (manifestDirty) writeManifestFile(manifestPath, manifest);
         if (!okStream) {
             logLine("Download attempt " + std::to_string(attempt + 1) + " failed: " + err);
-            // Roll back bytes credited during this failed attempt so overall doesn't exceed 100%.
-            uint64_t totalAfter = status.totalDownloadedBytes.load();
-            if (totalAfter > totalBefore) {
-                uint64_t delta = totalAfter - totalBefore;
-                if (delta > totalAfter) delta = totalAfter; // safety
-                status.totalDownloadedBytes.fetch_sub(delta);
-            }
-            status.currentDownloadedBytes.store(haveBytes);
+            // Roll back what this file credited during the failed attempt so overall doesn't exceed
+            // 100%; sibling bundle files may be counting concurrently.
+            rollbackFileCredit(progress.downloaded, status.totalDownloadedBytes, haveBefore);
             attempt++;
             if (gCtx.stopRequested.load()) break;
-            // Backoff between attempts (capped) to be friendlier on slow/unstable links.
-            int backoffMs = 500 * attempt;
-            if (backoffMs > kMaxRetryBackoffMs) backoffMs = kMaxRetryBackoffMs;
-            std::this_thread::sleep_for(std::chrono::milliseconds(backoffMs));
-            if (!err.empty() && err.find("HTTP status 404") != std::string::npos) {
+            if (deferred && probe.mismatch) {
+                // Nothing was written; ask the preflight and re-plan without spending a retry.
+                logLine(err + "; falling back to preflight");
+                if (!resolvePreflight()) break;
+                continue;
+            }
+            if (!refreshedAfter404 && err.find("HTTP status 404") != std::string::npos) {
                 // Stale URL (manifest pointing to old file_id). Try to refresh once.
-                if (refreshMetadata()) {
-                    attempt = 0; // fresh attempts after refresh
-                    continue;
-                }
+                refreshedAfter404 = true;
+                if (refreshMetadata()) continue;
+            }
+            // Everything up to the last checkpoint is kept; the next attempt asks for the rest
+            // (Range: bytes=<durable>-, or the missing segments) after a jittered backoff.
+            const uint64_t haveNow = pf.supportsRanges ? have.covered() : 0;
+            const RetryDecision retry = retries.onFailure(classifyError(err, ErrorCategory::Network), haveNow > haveBefore);
+            if (!retry.retry) {
+                logLine("Giving up on " + g.title + ": " + retry.reason);
+                break;
+            }
+            logLine("Retry " + std::to_string(retries.retriesUsed()) + "/" +
+                    std::to_string(retries.policy().maxRetries) + " for " + g.title + " in " +
+                    std::to_string(retry.delayMs) + "ms from " + std::to_string(haveNow) + "/" +
+                    std::to_string(totalSize) + " bytes");
+            const auto wakeAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(retry.delayMs);
+            while (!gCtx.stopRequested.load() && std::chrono::steady_clock::now() < wakeAt) {
+                std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+                    kRetrySleepSlice, wakeAt - std::chrono::steady_clock::now()));
             }
+            if (gCtx.stopRequested.load()) break;
             // If ranges unsupported, reset counters so UI reflects restart
             if (!pf.supportsRanges) {
-                status.currentDownloadedBytes.store(0);
+                rollbackFileCredit(progress.downloaded, status.totalDownloadedBytes, 0);
+                creditedExisting = 0;
                 haveBytes = 0;
+                have.clear();
+                fileCrc.clear();
             } else {
-                // Recompute haveBytes from disk for resume
-                uint64_t newHave = 0;
-                DIR* d = opendir(tmpDir.c_str());
-                if (d) {
-                    struct dirent* ent;
-                    while ((ent = readdir(d)) != nullptr) {
-                        std::string n = ent->d_name;
-                        if (n.size() > 5 && n.substr(n.size() - 5) == ".part") {
-                            std::string p = tmpDir + "/" + n;
-                            struct stat st{};
-                            if (stat(p.c_str(), &st) == 0) newHave += (uint64_t)st.st_size;
-                        }
-                    }
-                    closedir(d);
-                }
-                haveBytes = std::min<uint64_t>(newHave, totalSize);
-                status.currentDownloadedBytes.store(haveBytes);
-                // Keep overall in sync with on-disk bytes after a retry: do not let overall drop below haveBytes.
-                uint64_t curTotal = status.totalDownloadedBytes.load();
-                if (curTotal < haveBytes) {
-                    status.totalDownloadedBytes.store(haveBytes);
-                }
+                // Resume from the ranges the checkpoints recorded, including this attempt's slices,
+                // which count toward overall again.
+                haveBytes = have.covered();
+                creditFileBytes(progress.downloaded, status.totalDownloadedBytes, haveBytes);
             }
         }
     }
@@ -962,7 +1974,7 @@ static bool downloadOneFile(Game g, const DownloadFileSpec* spec, Status& status
             if (!sizeEc && existing == spec->sizeBytes) {
                 logLine("Skipping existing complete file " + finalPath.string());
                 status.totalDownloadedBytes.fetch_add(existing);
-                status.currentDownloadedBytes.store(existing);
+                progress.downloaded.store(existing);
                 return true;
             }
         }
@@ -973,27 +1985,24 @@ static bool downloadOneFile(Game g, const DownloadFileSpec* spec, Status& status
         std::string suffix = idSuffix.empty() ? "dup" : idSuffix;
         finalPath += ("." + suffix);
     }
-    logLine("Finalize: moving temp to " + finalPath.string());
-    bool okFinal = finalizeParts(tmpDir, finalPath.string());
-    if (!okFinal) {
-        setDownloadFailureState(status, true, "Finalize failed");
-        return false;
-    }
-    // Clean up temp root for this fileId now that finalize succeeded.
-    removeDirRecursive(tempRoot);
-    // Remove any empty parent directories under <downloadDir>/temp/<platform>/<romId>/...
-    std::filesystem::path stop = std::filesystem::path(cfg.downloadDir) / "temp";
-    removeEmptyParents(std::filesystem::path(tempRoot).parent_path(), stop);
-    removeEmptyParents(std::filesystem::path(tempRoot).parent_path().parent_path(), stop);
+    // The move itself runs on the finalize stage so the worker can start the next transfer.
+    finalize.tmpDir = tmpDir;
+    finalize.finalPath = finalPath.string();
+    finalize.tempRoot = tempRoot;
+    finalize.name = g.fsName.empty() ? g.title : g.fsName;
+    finalize.checksums = expected;
+    finalize.crc = fileCrc;
+    finalize.totalSize = totalSize;
+    finalize.partSize = partSize;
     {
         std::lock_guard<std::mutex> lock(status.mutex);
         // Keep UI counters aligned with the completed file.
-        status.currentDownloadedBytes.store(totalSize);
+        progress.downloaded.store(totalSize);
         status.totalDownloadedBytes.store(status.totalDownloadedBytes.load()); // unchanged, already includes current
         status.lastDownloadError.clear();
         status.lastDownloadFailed.store(false);
     }
-    logLine("Download complete: " + g.title);
+    logLine("Stream complete: " + g.title + " (finalize queued)");
     return true;
 }
 
@@ -1011,35 +2020,526 @@ static DownloadBundle bundleFromGame(const Game& g) {
     return b;
 }
 
-// Download a bundle (supports multiple files iteratively).
-static bool downloadBundle(const DownloadBundle& bundle, Status& status, const Config& cfg) {
+// Look-ahead stage: resolve metadata (bundle files/URLs) and preflight the next queue items while
+// the current one downloads, so the next transfer starts as soon as the previous file finalizes.
+// Failures are only logged; the worker redoes anything missing when the item reaches the front.
+static size_t prepareLookahead(const LookaheadJob& job) {
+    Status* st = gCtx.status;
+    if (!st) return 0;
+    const Config& cfg = gCtx.cfg;
+    std::string auth;
+    if (!cfg.username.empty() || !cfg.password.empty()) {
+        auth = romm::util::base64Encode(cfg.username + ":" + cfg.password);
+    }
+    size_t prepared = 0;
+    for (const auto& item : job.items) {
+        if (gCtx.stopRequested.load()) break;
+        DownloadBundle bundle = item.bundle;
+        if (bundleNeedsResolve(item)) {
+            Game g = item.game;
+            std::string err;
+            if (!enrichGameWithFiles(cfg, g, err)) {
+                logDebug("Look-ahead enrich failed for " + g.title + ": " + err, "DL");
+                continue;
+            }
+            PlatformPrefs prefs;
+            {
+                std::lock_guard<std::mutex> lock(st->mutex);
+                prefs = st->platformPrefs;
+            }
+            bundle = buildBundleFromGame(g, prefs);
+            if (bundle.files.empty()) continue;
+            if (bundle.totalSize() > 0) g.sizeBytes = bundle.totalSize();
+            std::lock_guard<std::mutex> lock(st->mutex);
+            for (auto& q : st->downloadQueue) {
+                if (q.game.id != g.id || q.state != QueueState::Pending || !bundleNeedsResolve(q)) continue;
+                q.game = g;
+                q.bundle = bundle;
+                st->downloadQueueRevision++;
+                recomputeTotals(*st);
+                break;
+            }
+        }
+        if (bundle.files.empty()) bundle = bundleFromGame(item.game);
+        for (const auto& f : bundle.files) {
+            if (gCtx.stopRequested.load()) break;
+            if (f.url.empty() || gCtx.preflightCache.contains(f.url)) continue;
+            PreflightInfo pf;
+            if (!preflight(f.url, auth, cfg.httpTimeoutSeconds, pf)) {
+                logDebug("Look-ahead preflight failed for " + f.name, "DL");
+                continue;
+            }
+            gCtx.preflightCache.put(f.url, PreparedPreflight{pf.contentLength, pf.supportsRanges});
+            prepared++;
+        }
+    }
+    if (prepared > 0) {
+        logDebug("Look-ahead prepared " + std::to_string(prepared) + " file(s) across " +
+                 std::to_string(job.items.size()) + " item(s)", "DL");
+    }
+    return prepared;
+}
+
+static Game gameForBundleFile(const DownloadBundle& b, const DownloadFileSpec& f) {
+    Game g;
+    g.id = b.romId;
+    g.title = b.title;
+    g.platformSlug = b.platformSlug;
+    g.fsName = f.name;
+    g.fileId = f.fileId;
+    g.downloadUrl = f.url;
+    g.sizeBytes = f.sizeBytes;
+    return g;
+}
+
+// The bundle archive is worth trying only for a fresh multi-file bundle: one interrupted archive
+// cannot resume, so any file with partial data (a manifest in its temp dir) goes the per-file way.
+static bool bundleArchiveEligible(const DownloadBundle& b, const Config& cfg) {
+    if (!cfg.archiveBundles || b.files.size() < 2 || b.romId.empty()) return false;
+    for (const auto& f : b.files) {
+        if (f.fileId.empty() || f.url.empty() || f.sizeBytes == 0) return false;
+        std::error_code ec;
+        if (std::filesystem::exists(tempLayoutFor(cfg, gameForBundleFile(b, f)).tmpDir + "/manifest.json", ec)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Bundle file an archive entry holds: matched on the relative path, then the file name, then the
+// entry's base name. npos for entries that are not (or no longer) wanted.
+static size_t matchArchiveEntry(const DownloadBundle& b, const std::string& entryName, const std::vector<bool>& taken) {
+    auto baseName = [](const std::string& p) {
+        const size_t slash = p.find_last_of('/');
+        return slash == std::string::npos ? p : p.substr(slash + 1);
+    };
+    const std::string entryPath = sanitizeRelativePath(entryName);
+    for (int pass = 0; pass < 3; ++pass) {
+        for (size_t i = 0; i < b.files.size(); ++i) {
+            if (taken[i]) continue;
+            const auto& f = b.files[i];
+            const bool match =
+                pass == 0 ? !f.relativePath.empty() && sanitizeRelativePath(f.relativePath) == entryPath
+                : pass == 1 ? sanitizeRelativePath(f.name) == entryPath
+                            : baseName(entryPath) == baseName(sanitizeRelativePath(f.name));
+            if (match) return i;
+        }
+    }
+    return std::string::npos;
+}
+
+// Archive stage for a fresh multi-file bundle: one GET for a ZIP of the bundle's files that the server
+// builds on the fly, parsed as it streams (see ZipStreamReader) and written entry by entry into
+// each file's regular temp dir and manifest, exactly as downloadOneFile would have left them.
+// Returns how many files were extracted completely. Nothing here fails the item: the per-file path
+// that runs next finalizes complete files and downloads the rest, resuming the interrupted entry
+// from its last checkpoint.
+static size_t extractBundleArchive(const DownloadBundle& b, Status& status, const Config& cfg,
+                                   const std::vector<std::shared_ptr<FileProgress>>& progress,
+                                   const std::function<void()>& onProgress) {
+    std::string auth;
+    if (!cfg.username.empty() || !cfg.password.empty()) {
+        auth = romm::util::base64Encode(cfg.username + ":" + cfg.password);
+    }
+    uint64_t freeBytes = 0;
+    if (!ensureFreeSpace(cfg.downloadDir, b.totalSize(), &freeBytes)) {
+        logLine("Bundle archive skipped: not enough free space for " + b.title);
+        return 0;
+    }
+    // Without file_ids RomM zips every file of the ROM. A bundle can be a subset (bundle_best keeps
+    // only the best-scoring folder), and every ZIP entry must map onto one of b.files, so the
+    // request names them. RomM takes file_ids as one comma-separated list.
+    std::string fileIds;
+    for (const auto& f : b.files) {
+        if (!fileIds.empty()) fileIds += ",";
+        fileIds += romm::util::urlEncode(f.fileId);
+    }
+    const std::string archiveName = (b.title.empty() ? b.romId : b.title) + ".zip";
+    const std::string url = cfg.serverUrl + "/api/roms/" + romm::util::urlEncode(b.romId) + "/content/" +
+                            romm::util::urlEncode(archiveName) + "?file_ids=" + fileIds;
+    logLine("Bundle archive start: " + b.title + " files=" + std::to_string(b.files.size()) + " url=" + url);
+
+    struct EntryOut {
+        size_t index{0};
+        std::string manifestPath;
+        uint64_t partSize{0};
+        Manifest manifest;
+        RangeSet have;
+        uint64_t offset{0};
+        uint32_t crc{0}; // the entry's CRC-32, checked by the reader against its data
+        std::unique_ptr<AsyncPartWriter> writer;
+        std::unique_ptr<AsyncPartWriter::Stream> sink;
+    };
+    const WriteBackend backend = writeBackendFor(cfg);
+    const TuningParams tune = gCtx.tuner.beginStream();
+    std::unique_ptr<EntryOut> cur;
+    std::vector<bool> taken(b.files.size(), false);
+    size_t extracted = 0;
+    uint64_t credited = 0;
+    std::string err;
+
+    // Drain the entry's writer (its last checkpoint records what is durable). A complete entry
+    // also records its full range and leaves a preflight result for the per-file path.
+    auto closeEntry = [&](bool complete) -> bool {
+        if (!cur) return true;
+        std::unique_ptr<EntryOut> e = std::move(cur);
+        std::string writeErr;
+        const bool flushed = e->sink->flush(writeErr);
+        const bool ok = e->writer->finish(writeErr) && flushed;
+        if (!ok) err = writeErr;
+        const DownloadFileSpec& f = b.files[e->index];
+        if (ok && complete) {
+            e->have.add(0, f.sizeBytes);
+            recordDurableRanges(e->manifest, e->have);
+            if (cfg.hashParts) recordPartHashes(e->manifest, e->writer->partHashes());
+            // ZIP stores the CRC-32 of the uncompressed data: the per-file path verifies it without a read-back.
+            FileCrc crc;
+            crc.seed(f.sizeBytes, e->crc);
+            recordFileCrc(e->manifest, crc);
+            writeManifestFile(e->manifestPath, e->manifest);
+            gCtx.preflightCache.put(f.url, PreparedPreflight{f.sizeBytes, true});
+            extracted++;
+        }
+        e->sink.reset();
+        e->writer.reset();
+        return ok;
+    };
+
+    ZipStreamReader::Handler handler;
+    handler.onEntry = [&](const ZipEntry& entry, bool& skip, uint64_t& sizeHint) -> bool {
+        const size_t idx = matchArchiveEntry(b, entry.name, taken);
+        if (idx == std::string::npos) {
+            logDebug("Bundle archive: skipping entry " + entry.name, "DL");
+            skip = true;
+            return true;
+        }
+        const DownloadFileSpec& f = b.files[idx];
+        if (!entry.sizesInDescriptor && entry.uncompressedSize != f.sizeBytes) {
+            logLine("Bundle archive: entry " + entry.name + " is " + std::to_string(entry.uncompressedSize) +
+                    " bytes, expected " + std::to_string(f.sizeBytes) + "; left for a direct download");
+            skip = true;
+            return true;
+        }
+        taken[idx] = true;
+        sizeHint = f.sizeBytes;
+        const Game g = gameForBundleFile(b, f);
+        const TempLayout layout = tempLayoutFor(cfg, g);
+        ensureDirectory(layout.tempRoot);
+        removeDirRecursive(layout.tmpDir); // stray parts without a manifest
+        ensureDirectory(layout.tmpDir);
+        auto e = std::make_unique<EntryOut>();
+        e->index = idx;
+        e->manifestPath = layout.tmpDir + "/manifest.json";
+        e->partSize = partSizeFor(cfg, f.sizeBytes);
+        e->manifest = buildManifestFor(g, f.sizeBytes, e->partSize, f.checksums);
+        recordDurableRanges(e->manifest, e->have);
+        writeManifestFile(e->manifestPath, e->manifest);
+        e->writer = std::make_unique<AsyncPartWriter>(layout.tmpDir, e->partSize, kWriteBlockBytes, kWriteBlockCount,
+                                                      &status.writeQueueStats, ioBufferBytesFor(backend, tune),
+                                                      backend);
+        e->writer->setBatchBytes(tune.writeBatchBytes);
+        if (cfg.hashParts) e->writer->enableHashing();
+        EntryOut* out = e.get();
+        const bool hashing = cfg.hashParts;
+        e->writer->setCheckpoint(kCheckpointBytes, kCheckpointMs, [out, hashing](const PartHashes& hashes) {
+            out->have.add(0, out->sink->written());
+            recordDurableRanges(out->manifest, out->have);
+            if (hashing) {
+                PartHashes durable = hashes;
+                dropHashesOutside(durable, out->partSize, out->have);
+                recordPartHashes(out->manifest, durable);
+            }
+            writeManifestFile(out->manifestPath, out->manifest);
+        });
+        e->sink = std::make_unique<AsyncPartWriter::Stream>(*e->writer);
+        e->writer->start();
+        logLine("Bundle archive: " + entry.name + " -> " + layout.tmpDir +
+                (entry.method == 8 ? " (deflate)" : " (stored)"));
+        cur = std::move(e);
+        return true;
+    };
+    handler.onData = [&](const char* data, size_t len) -> bool {
+        if (!cur) return true;
+        const DownloadFileSpec& f = b.files[cur->index];
+        if (cur->offset + len > f.sizeBytes) {
+            err = "Archive entry larger than expected: " + f.name;
+            return false;
+        }
+        if (!cur->sink->write(cur->offset, data, len, err)) return false;
+        cur->offset += len;
+        progress[cur->index]->downloaded.fetch_add(len);
+        status.totalDownloadedBytes.fetch_add(len);
+        status.throughput.add(len);
+        credited += len;
+        return true;
+    };
+    handler.onEntryEnd = [&](const ZipEntry& entry) -> bool {
+        if (!cur) return true;
+        const DownloadFileSpec& f = b.files[cur->index];
+        const bool complete = cur->offset == f.sizeBytes;
+        cur->crc = entry.crc32;
+        if (!complete) {
+            logLine("Bundle archive: entry " + entry.name + " ended at " + std::to_string(cur->offset) + "/" +
+                    std::to_string(f.sizeBytes) + " bytes; left for a direct download");
+        }
+        return closeEntry(complete);
+    };
+    ZipStreamReader reader(std::move(handler));
+
+    std::vector<std::pair<std::string, std::string>> headers;
+    if (!auth.empty()) headers.emplace_back("Authorization", "Basic " + auth);
+    HttpRequestOptions opts;
+    opts.timeoutSec = std::clamp(cfg.httpTimeoutSeconds > 0 ? cfg.httpTimeoutSeconds : 10, 1, 30);
+    opts.pool = &gCtx.connections;
+    opts.decodeChunked = false;
+    opts.recvBufferBytes = tune.recvBufferBytes;
+    opts.cancelRequested = &gCtx.stopRequested;
+    opts.activeSocketFd = &gCtx.activeSocketFd;
+    ParsedHttpResponse parsed{};
+    auto lastPublish = std::chrono::steady_clock::now();
+    std::string streamErr;
+    const bool ok = httpRequestStreamed(
+        "GET", url, headers, opts, parsed,
+        [&](const char* data, size_t len) -> bool {
+            if (parsed.statusCode != 200) {
+                err = "HTTP status " + std::to_string(parsed.statusCode);
+                return false;
+            }
+            if (reader.finished() || len == 0) return true;
+            if (!reader.feed(data, len, err)) return false;
+            if (!gCtx.rateLimiter.acquire(len, &gCtx.stopRequested)) return false;
+            const auto now = std::chrono::steady_clock::now();
+            if (now - lastPublish >= std::chrono::milliseconds(200)) {
+                lastPublish = now;
+                onProgress();
+            }
+            return true;
+        },
+        streamErr);
+    if (!ok && err.empty()) err = streamErr.empty() ? "Archive request failed" : streamErr;
+    if (ok && !reader.finished() && err.empty()) err = "Archive ended before its central directory";
+    closeEntry(false);
+
+    // The per-file path re-credits every durable byte it finds, so hand back this stage's credit.
+    status.totalDownloadedBytes.fetch_sub(std::min<uint64_t>(credited, status.totalDownloadedBytes.load()));
+    onProgress();
+    if (!err.empty()) {
+        logLine("Bundle archive stopped after " + std::to_string(extracted) + "/" + std::to_string(b.files.size()) +
+                " file(s): " + err);
+    } else {
+        logLine("Bundle archive done: " + std::to_string(extracted) + "/" + std::to_string(b.files.size()) +
+                " file(s) from " + std::to_string(reader.entriesSeen()) + " entr" +
+                (reader.entriesSeen() == 1 ? "y" : "ies"));
+    }
+    return extracted;
+}
+
+// Download a bundle: up to bundle_concurrency files at once, each with its own FileProgress.
+// The worker thread aggregates per-file progress into the Current counters (combined bundle total).
+// Files that streamed completely are appended to finalizeOut (in bundle order), even when a
+// sibling failed, so their bytes are not stranded in temp.
+static bool downloadBundle(const DownloadBundle& bundle, Status& status, const Config& cfg,
+                           std::vector<FinalizeStep>& finalizeOut) {
     DownloadBundle b = bundle;
     if (b.files.empty()) {
         logLine("Bundle has no files; falling back to single file from game metadata");
         return false;
     }
-    status.currentDownloadFileCount.store(b.files.size());
-    bool ok = true;
-    for (size_t i = 0; i < b.files.size(); ++i) {
-        const auto& f = b.files[i];
-        Game g;
-        g.id = b.romId;
-        g.title = b.title;
-        g.platformSlug = b.platformSlug;
-        g.fsName = f.name;
-        g.fileId = f.fileId;
-        g.downloadUrl = f.url;
-        g.sizeBytes = f.sizeBytes;
-        status.currentDownloadIndex.store(static_cast<size_t>(i));
-        if (!downloadOneFile(g, &f, status, cfg)) {
-            ok = false;
-            break;
+    const size_t fileCount = b.files.size();
+    std::vector<std::shared_ptr<FileProgress>> progress;
+    progress.reserve(fileCount);
+    for (const auto& f : b.files) {
+        auto fp = std::make_shared<FileProgress>();
+        fp->name = f.name;
+        fp->size.store(f.sizeBytes);
+        progress.push_back(std::move(fp));
+    }
+    {
+        std::lock_guard<std::mutex> lock(status.mutex);
+        status.activeFiles = progress;
+    }
+    status.currentDownloadFileCount.store(fileCount);
+    status.currentDownloadIndex.store(0);
+
+    auto publishProgress = [&]() {
+        uint64_t done = 0;
+        uint64_t size = 0;
+        size_t finished = 0;
+        for (const auto& fp : progress) {
+            done += fp->downloaded.load();
+            size += fp->size.load();
+            if (fp->finished.load()) finished++;
         }
+        status.currentDownloadedBytes.store(done);
+        status.currentDownloadSize.store(size);
+        status.currentDownloadIndex.store(std::min(finished, fileCount - 1));
+    };
+
+    std::vector<FinalizeStep> finalizeSteps(fileCount);
+    std::mutex firstErrMutex;
+    std::string firstErr; // siblings finishing later may clear lastDownloadError; keep the first failure
+    RetryBudget retries;  // one budget per queue item, shared by its files
+    const int concurrency = std::clamp(cfg.bundleConcurrency, 1, kMaxBundleConcurrency);
+    if (fileCount > 1) {
+        logLine("Bundle start: " + b.title + " files=" + std::to_string(fileCount) +
+                " concurrency=" + std::to_string(std::min<size_t>(fileCount, concurrency)));
+    }
+    // Extracted files reach the per-file path below fully durable and only get finalized there.
+    if (bundleArchiveEligible(b, cfg)) {
+        extractBundleArchive(b, status, cfg, progress, publishProgress);
+    }
+    bool ok = runBoundedTasks(
+        fileCount, concurrency,
+        [&](size_t i) -> bool {
+            const auto& f = b.files[i];
+            bool fileOk = downloadOneFile(gameForBundleFile(b, f), &f, status, *progress[i], cfg, retries, finalizeSteps[i]);
+            progress[i]->finished.store(fileOk);
+            if (!fileOk) {
+                std::string errCopy;
+                {
+                    std::lock_guard<std::mutex> lock(status.mutex);
+                    errCopy = status.lastDownloadError;
+                }
+                std::lock_guard<std::mutex> lock(firstErrMutex);
+                if (firstErr.empty()) firstErr = errCopy.empty() ? "Download failed: " + f.name : errCopy;
+            }
+            return fileOk;
+        },
+        []() { return gCtx.stopRequested.load(); },
+        publishProgress);
+
+    {
+        std::lock_guard<std::mutex> lock(status.mutex);
+        status.activeFiles.clear();
+    }
+    for (auto& step : finalizeSteps) {
+        if (!step.tmpDir.empty()) finalizeOut.push_back(std::move(step));
+    }
+    if (!ok && !firstErr.empty() && !gCtx.stopRequested.load()) {
+        setDownloadFailureState(status, true, firstErr);
     }
     return ok;
 }
 
-// Background worker: processes the downloadQueue sequentially, updating Status.
+// Index of the entry the worker is streaming (the Downloading one); npos if it is gone.
+// Call with the status lock held.
+static size_t activeQueueIndex(const Status& st) {
+    for (size_t i = 0; i < st.downloadQueue.size(); ++i) {
+        if (st.downloadQueue[i].state == QueueState::Downloading) return i;
+    }
+    return std::string::npos;
+}
+
+// Check a streamed file against the CRC-32 RomM reported before it is moved into the library.
+// Bytes the streams already covered are not read again; only the rest (segments that never met,
+// resumed gaps) is read back from the parts. `corrupt` is set when the data itself is wrong.
+static bool verifyFinalizeStep(const FinalizeStep& step, bool& corrupt, std::string& err) {
+    corrupt = false;
+    uint32_t expected = 0;
+    if (!crc32FromHex(step.checksums.crc32, expected)) {
+        if (!step.checksums.empty()) {
+            logLine("Verify: no CRC32 from the server for " + step.name + "; MD5/SHA-1 are not checked");
+        }
+        return true;
+    }
+    FileCrc crc = step.crc;
+    uint64_t readBack = 0;
+    std::string readErr;
+    if (!completeFileCrc(step.tmpDir, step.partSize, step.totalSize, crc, readErr, &readBack)) {
+        err = "Checksum read failed for " + step.name + ": " + readErr;
+        return false;
+    }
+    uint32_t actual = 0;
+    crc.whole(step.totalSize, actual);
+    if (actual != expected) {
+        corrupt = true;
+        err = "CRC32 mismatch for " + step.name + ": expected " + step.checksums.crc32 + ", got " +
+              crc32ToHex(actual) + " (" + std::to_string(step.totalSize) + " bytes)";
+        return false;
+    }
+    logLine("Verify: CRC32 " + step.checksums.crc32 + " ok for " + step.name + " (read back " +
+            std::to_string(readBack) + "/" + std::to_string(step.totalSize) + " bytes" +
+            (crc32Accelerated() ? ", hw" : "") + ")");
+    return true;
+}
+
+// Finalize stage: move every streamed file of an item into place (rename, or a large-buffer copy
+// where the rename is refused), clean its temp folders, then resolve the item's Finalizing queue
+// entry. Jobs run in submission order, so the first Finalizing entry is always this job's item.
+static void runFinalize(const FinalizeJob& job) {
+    Status* st = gCtx.status;
+    if (!st) return;
+    const std::filesystem::path tempTop = std::filesystem::path(gCtx.cfg.downloadDir) / "temp";
+    std::string err;
+    for (const auto& step : job.steps) {
+        bool corrupt = false;
+        std::string verifyErr;
+        if (!verifyFinalizeStep(step, corrupt, verifyErr)) {
+            logLine("Finalize: " + verifyErr);
+            if (err.empty()) err = verifyErr;
+            // Wrong bytes must not be resumed from: drop the temp so a retry fetches the file afresh.
+            if (corrupt) removeDirRecursive(step.tempRoot);
+            continue;
+        }
+        logLine("Finalize: moving temp to " + step.finalPath);
+        int loggedTenth = -1;
+        auto onCopy = [&](uint64_t copied, uint64_t total) {
+            st->finalizeCopyDone.store(copied);
+            st->finalizeCopyTotal.store(total);
+            const int tenth = total > 0 ? static_cast<int>(copied * 10 / total) : 0;
+            if (tenth != loggedTenth) {
+                loggedTenth = tenth;
+                logLine("Finalize copy " + step.name + ": " + std::to_string(tenth * 10) + "% (" +
+                        std::to_string(copied) + "/" + std::to_string(total) + ")");
+            }
+        };
+        bool ok = finalizeParts(step.tmpDir, step.finalPath, onCopy);
+        st->finalizeCopyDone.store(0);
+        st->finalizeCopyTotal.store(0);
+        if (!ok) {
+            if (err.empty()) err = "Finalize failed: " + step.name;
+            continue; // siblings are independent; keep this file's temp folder for a retry
+        }
+        // Clean up temp root for this fileId now that finalize succeeded.
+        removeDirRecursive(step.tempRoot);
+        // Remove any empty parent directories under <downloadDir>/temp/<platform>/<romId>/...
+        removeEmptyParents(std::filesystem::path(step.tempRoot).parent_path(), tempTop);
+        removeEmptyParents(std::filesystem::path(step.tempRoot).parent_path().parent_path(), tempTop);
+    }
+    if (!err.empty()) {
+        logLine(err + " (" + job.title + ")");
+        setDownloadFailureState(*st, true, err);
+    } else if (job.trackQueueItem) {
+        logLine("Download complete: " + job.title);
+    }
+    if (!job.trackQueueItem) return;
+    bool queueChanged = false;
+    {
+        std::lock_guard<std::mutex> lock(st->mutex);
+        for (size_t i = 0; i < st->downloadQueue.size(); ++i) {
+            if (st->downloadQueue[i].state != QueueState::Finalizing) continue;
+            QueueItem done = st->downloadQueue[i];
+            done.state = err.empty() ? QueueState::Completed : QueueState::Failed;
+            done.error = err;
+            st->downloadHistory.push_back(std::move(done));
+            st->downloadQueue.erase(st->downloadQueue.begin() + static_cast<std::ptrdiff_t>(i));
+            st->downloadQueueRevision++;
+            st->downloadHistoryRevision++;
+            queueChanged = true;
+            break;
+        }
+        recomputeTotals(*st);
+    }
+    if (queueChanged) {
+        std::string qerr;
+        if (!saveQueueState(*st, qerr) && !qerr.empty()) {
+            logLine("Queue state save warning: " + qerr);
+        }
+    }
+}
+
+// Background worker: processes the downloadQueue sequentially, updating Status. Finished items
+// wait at the head of the queue as Finalizing while the finalize stage moves them into place.
 static void workerLoop() {
     Status* st = gCtx.status;
     Config cfg = gCtx.cfg;
@@ -1061,17 +2561,31 @@ static void workerLoop() {
     }
     setDownloadFailureState(*st, false, "");
     st->currentDownloadFileCount.store(0);
+    const size_t lookaheadDepth = static_cast<size_t>(std::clamp(cfg.lookaheadDepth, 0, kMaxLookaheadDepth));
+    gCtx.preflightCache.clear();
+    gCtx.rateLimiter.configure(rateLimitFor(cfg));
+    gCtx.tuner.reset(tuningBoundsFor(cfg), tuningStartFor(cfg));
+    gCtx.connections.setStats(&st->connectionStats);
+    st->throughput.reset();
+    if (lookaheadDepth > 0) gCtx.lookahead.start(prepareLookahead);
+    gCtx.finalizer.start(runFinalize);
     logLine("Worker start, total bytes=" + std::to_string(st->totalDownloadBytes.load()));
     while (true) {
         QueueItem next;
             {
                 std::lock_guard<std::mutex> lock(st->mutex);
-                if (st->downloadQueue.empty() || gCtx.stopRequested.load()) break;
+                if (gCtx.stopRequested.load()) break;
+                // Skip the prefix of items still being finalized behind us.
+                size_t idx = 0;
+                while (idx < st->downloadQueue.size() && st->downloadQueue[idx].state == QueueState::Finalizing) {
+                    idx++;
+                }
+                if (idx >= st->downloadQueue.size()) break;
                 st->currentDownloadIndex.store(0);
-                next = st->downloadQueue.front(); // copy
+                next = st->downloadQueue[idx]; // copy
                 if (next.bundle.files.empty()) {
                     next.bundle = bundleFromGame(next.game);
-                    st->downloadQueue.front().bundle = next.bundle;
+                    st->downloadQueue[idx].bundle = next.bundle;
                 }
                 // Prime UI fields for the next item.
                 uint64_t bundleSize = next.bundle.totalSize();
@@ -1080,11 +2594,21 @@ static void workerLoop() {
                 st->currentDownloadSize.store(bundleSize);
                 st->currentDownloadedBytes.store(0);
                 st->currentDownloadFileCount.store(next.bundle.files.empty() ? 1 : next.bundle.files.size());
-                st->downloadQueue.front().state = QueueState::Downloading;
+                st->downloadQueue[idx].state = QueueState::Downloading;
                 st->downloadQueueRevision++;
+                if (lookaheadDepth > 0) {
+                    LookaheadJob job{lookaheadWindow(st->downloadQueue, lookaheadDepth)};
+                    if (!job.items.empty()) gCtx.lookahead.submit(job);
+                }
             }
         setDownloadFailureState(*st, false, "");
-        if (!downloadBundle(next.bundle, *st, cfg)) {
+        std::vector<FinalizeStep> finalizeSteps;
+        if (!downloadBundle(next.bundle, *st, cfg, finalizeSteps)) {
+            if (!finalizeSteps.empty()) {
+                // Files of the bundle that did finish still get moved into place.
+                FinalizeJob partial{next.bundle.title, std::move(finalizeSteps), false};
+                if (!gCtx.finalizer.submit(partial)) runFinalize(partial);
+            }
             bool wasStopped = gCtx.stopRequested.load();
             logLine(std::string("Download failed or stopped for ") + next.game.title +
                     (wasStopped ? " (stop requested)" : ""));
@@ -1101,18 +2625,20 @@ static void workerLoop() {
             bool queueChanged = false;
             {
                 std::lock_guard<std::mutex> lock(st->mutex);
-                if (!st->downloadQueue.empty()) {
+                const size_t active = activeQueueIndex(*st);
+                if (active != std::string::npos) {
+                    QueueItem& item = st->downloadQueue[active];
                     if (wasStopped) {
                         // Preserve interrupted item in active queue so restart/next run can resume.
-                        st->downloadQueue.front().state = QueueState::Resumable;
-                        st->downloadQueue.front().error = "Interrupted";
+                        item.state = QueueState::Resumable;
+                        item.error = "Interrupted";
                         st->downloadQueueRevision++;
                         queueChanged = true;
                     } else {
-                        st->downloadQueue.front().state = QueueState::Failed;
-                        st->downloadQueue.front().error = st->lastDownloadError;
-                        st->downloadHistory.push_back(st->downloadQueue.front());
-                        st->downloadQueue.erase(st->downloadQueue.begin());
+                        item.state = QueueState::Failed;
+                        item.error = st->lastDownloadError;
+                        st->downloadHistory.push_back(item);
+                        st->downloadQueue.erase(st->downloadQueue.begin() + static_cast<std::ptrdiff_t>(active));
                         st->downloadQueueRevision++;
                         st->downloadHistoryRevision++;
                         queueChanged = true;
@@ -1128,15 +2654,14 @@ static void workerLoop() {
             }
             continue;
         }
+        // Streamed: park the item as Finalizing and move on; the finalize stage completes it.
         bool queueChanged = false;
         {
             std::lock_guard<std::mutex> lock(st->mutex);
-            if (!st->downloadQueue.empty()) {
-                st->downloadQueue.front().state = QueueState::Completed;
-                st->downloadHistory.push_back(st->downloadQueue.front());
-                st->downloadQueue.erase(st->downloadQueue.begin());
+            const size_t active = activeQueueIndex(*st);
+            if (active != std::string::npos) {
+                st->downloadQueue[active].state = QueueState::Finalizing;
                 st->downloadQueueRevision++;
-                st->downloadHistoryRevision++;
                 queueChanged = true;
             }
             recomputeTotals(*st);
@@ -1147,7 +2672,20 @@ static void workerLoop() {
                 logLine("Queue state save warning: " + qerr);
             }
         }
+        FinalizeJob job{next.bundle.title.empty() ? next.game.title : next.bundle.title, std::move(finalizeSteps),
+                        queueChanged};
+        if (!gCtx.finalizer.submit(job)) runFinalize(job);
     }
+    if (lookaheadDepth > 0) gCtx.lookahead.stop();
+    // Let queued finalizes complete (also on stop: a half-moved file is worse than a short wait).
+    gCtx.finalizer.finish();
+    gCtx.preflightCache.clear();
+    // Idle connections would only time out server-side before the next run.
+    gCtx.connections.clear();
+    logLine("Connections: requests=" + std::to_string(st->connectionStats.requests.load()) +
+            " reused=" + std::to_string(st->connectionStats.reused.load()) +
+            " opened=" + std::to_string(st->connectionStats.opened.load()) +
+            " connectMs=" + std::to_string(st->connectionStats.connectMs.load()));
     st->downloadWorkerRunning.store(false);
     st->currentDownloadFileCount.store(0);
     bool postCompletion = false;
@@ -1180,10 +2718,18 @@ bool loadLocalManifests(Status& status, const Config& cfg, std::string& outError
     std::vector<Found> manifests;
     for (const auto& entry : fs::recursive_directory_iterator(tempRoot)) {
         if (!entry.is_regular_file()) continue;
-        if (entry.path().filename() != "manifest.json") continue;
+        fs::path manifestPath = entry.path();
+        if (manifestPath.filename() == "manifest.json.tmp") {
+            // Crash between unlink and rename of a checkpoint: only the temp copy survived.
+            manifestPath.replace_filename("manifest.json");
+            std::error_code existsEc;
+            if (fs::exists(manifestPath, existsEc)) continue;
+        } else if (manifestPath.filename() != "manifest.json") {
+            continue;
+        }
         Manifest m;
-        if (!readManifestFile(entry.path().string(), m)) continue;
-        fs::path parent = entry.path().parent_path();
+        if (!readManifestFile(manifestPath.string(), m)) continue;
+        fs::path parent = manifestPath.parent_path();
         // temp/<platform>/<rom>/<file>/... -> extract platform slug as first element after tempRoot
         std::string platSlug = "unknown";
         fs::path rel;
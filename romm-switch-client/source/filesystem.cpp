@@ -1,8 +1,16 @@
 #include "romm/filesystem.hpp"
 #include "romm/logger.hpp"
 #include "romm/util.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
 #include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <sys/stat.h>
 #include <sys/statvfs.h>
+#include <unistd.h>
 
 namespace romm {
 
@@ -39,6 +47,108 @@ uint64_t getFreeSpace(const std::string& path) {
     return static_cast<uint64_t>(s.f_bavail) * static_cast<uint64_t>(s.f_frsize);
 }
 
+bool writeFileAtomic(const std::string& path, const std::string& data, std::string& err) {
+    const std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        err = "Open failed: " + tmp + " (" + std::strerror(errno) + ")";
+        return false;
+    }
+    const char* p = data.data();
+    size_t left = data.size();
+    bool ok = true;
+    while (left > 0) {
+        ssize_t n = ::write(fd, p, left);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            ok = false;
+            break;
+        }
+        p += n;
+        left -= static_cast<size_t>(n);
+    }
+    if (ok && ::fsync(fd) != 0) ok = false;
+    if (!ok) err = "Write failed: " + tmp + " (" + std::strerror(errno) + ")";
+    ::close(fd);
+    if (!ok) return false;
+    if (::rename(tmp.c_str(), path.c_str()) != 0) {
+        // FAT on the Switch refuses to rename onto an existing file; readFileAtomic covers the gap.
+        ::remove(path.c_str());
+        if (::rename(tmp.c_str(), path.c_str()) != 0) {
+            err = "Rename failed: " + tmp + " (" + std::strerror(errno) + ")";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool readFileAtomic(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        // Only trust the temp copy when the target is gone: it was complete before the remove.
+        in.open(path + ".tmp", std::ios::binary);
+        if (!in) return false;
+    }
+    out.assign((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return true;
+}
+
+bool copyFileStreaming(const std::string& src, const std::string& dst, const CopyProgressFn& progress,
+                       std::string& err, size_t bufferBytes) {
+    int in = ::open(src.c_str(), O_RDONLY);
+    if (in < 0) {
+        err = "Open failed: " + src + " (" + std::strerror(errno) + ")";
+        return false;
+    }
+    struct stat st{};
+    const uint64_t total = ::fstat(in, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+    int out = ::open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (out < 0) {
+        err = "Open failed: " + dst + " (" + std::strerror(errno) + ")";
+        ::close(in);
+        return false;
+    }
+    std::vector<char> buf(bufferBytes > 0 ? bufferBytes : kCopyBufferBytes);
+    uint64_t copied = 0;
+    bool ok = true;
+    while (ok) {
+        ssize_t n = ::read(in, buf.data(), buf.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            err = "Read failed: " + src + " (" + std::strerror(errno) + ")";
+            ok = false;
+            break;
+        }
+        if (n == 0) break;
+        const char* p = buf.data();
+        size_t left = static_cast<size_t>(n);
+        while (left > 0) {
+            ssize_t w = ::write(out, p, left);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) {
+                err = "Write failed: " + dst + " (" + std::strerror(errno) + ")";
+                ok = false;
+                break;
+            }
+            p += w;
+            left -= static_cast<size_t>(w);
+        }
+        copied += static_cast<uint64_t>(n);
+        if (ok && progress) progress(copied, total);
+    }
+    if (ok && ::fsync(out) != 0) {
+        err = "Sync failed: " + dst + " (" + std::strerror(errno) + ")";
+        ok = false;
+    }
+    ::close(in);
+    if (::close(out) != 0 && ok) {
+        err = "Close failed: " + dst + " (" + std::strerror(errno) + ")";
+        ok = false;
+    }
+    if (!ok) ::remove(dst.c_str());
+    return ok;
+}
+
 bool isGameCompletedOnDisk(const Game& g, const Config& cfg) {
     std::string idSafe = safeName(!g.id.empty() ? g.id : g.fileId);
     std::string romSafe = idSafe.empty() ? safeName(g.title) : idSafe;
@@ -0,0 +1,292 @@
+#include "romm/http_cache.hpp"
+#include "romm/sha256.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace romm {
+
+namespace {
+
+// Entry file: five header lines, then the response headers and the body back to back.
+//   romm-http-cache 1 / url / etag / last-modified / "<headersLen> <bodyLen>"
+constexpr const char* kMagic = "romm-http-cache 1";
+constexpr const char* kEntrySuffix = ".entry";
+// One response may take at most this share of the budget, so a large cover cannot flush the rest.
+constexpr uint64_t kMaxEntryShare = 8;
+
+std::string toLowerCopy(std::string s) {
+    for (auto& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return s;
+}
+
+struct EntryHead {
+    std::string url;
+    std::string etag;
+    std::string lastModified;
+    uint64_t headersLen{0};
+    uint64_t bodyLen{0};
+    uint64_t dataOffset{0};
+};
+
+bool readHead(std::istream& in, EntryHead& head) {
+    std::string magic;
+    std::string lengths;
+    if (!std::getline(in, magic) || magic != kMagic) return false;
+    if (!std::getline(in, head.url) || !std::getline(in, head.etag) || !std::getline(in, head.lastModified) ||
+        !std::getline(in, lengths)) {
+        return false;
+    }
+    std::istringstream ls(lengths);
+    if (!(ls >> head.headersLen >> head.bodyLen)) return false;
+    const std::streamoff pos = in.tellg();
+    if (pos < 0) return false;
+    head.dataOffset = static_cast<uint64_t>(pos);
+    return true;
+}
+
+// The headers of a stored response, made to describe the stored body: it was decoded on receipt,
+// so Content-Encoding and Transfer-Encoding go and Content-Length becomes its decoded size.
+std::string storedHeaders(const std::string& headersRaw, size_t bodyBytes) {
+    std::string out;
+    size_t pos = 0;
+    while (pos < headersRaw.size()) {
+        size_t end = headersRaw.find("\r\n", pos);
+        if (end == std::string::npos) end = headersRaw.size();
+        std::string line = headersRaw.substr(pos, end - pos);
+        pos = end + 2;
+        const std::string name = toLowerCopy(line.substr(0, line.find(':')));
+        if (name == "content-encoding" || name == "transfer-encoding") continue;
+        if (name == "content-length") line = "Content-Length: " + std::to_string(bodyBytes);
+        if (!out.empty()) out += "\r\n";
+        out += line;
+    }
+    return out;
+}
+
+} // namespace
+
+bool HttpResponseCache::open(const std::string& dir, uint64_t budgetBytes, std::string& err) {
+    namespace fs = std::filesystem;
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    lru_.clear();
+    bytes_ = 0;
+    dir_ = dir;
+    budget_ = budgetBytes;
+    if (budget_ == 0) return true;
+
+    std::error_code ec;
+    fs::create_directories(dir_, ec);
+    if (!fs::is_directory(dir_, ec)) {
+        err = "Cannot create HTTP cache directory " + dir_;
+        budget_ = 0;
+        return false;
+    }
+    struct Found {
+        std::string key;
+        Entry entry;
+        fs::file_time_type written;
+    };
+    std::vector<Found> found;
+    for (fs::directory_iterator it(dir_, ec), end; !ec && it != end; it.increment(ec)) {
+        const fs::path& path = it->path();
+        const std::string ext = path.extension().string();
+        if (ext != kEntrySuffix) {
+            // Leftover temp file of a store that never finished.
+            if (ext == ".tmp") fs::remove(path, ec);
+            continue;
+        }
+        std::ifstream in(path, std::ios::binary);
+        EntryHead head;
+        const uint64_t size = fs::file_size(path, ec);
+        if (!in || ec || !readHead(in, head) || head.dataOffset + head.headersLen + head.bodyLen != size) {
+            in.close();
+            fs::remove(path, ec);
+            continue;
+        }
+        Found f;
+        f.key = path.stem().string();
+        f.entry.etag = head.etag;
+        f.entry.lastModified = head.lastModified;
+        f.entry.size = size;
+        f.written = fs::last_write_time(path, ec);
+        found.push_back(std::move(f));
+    }
+    std::sort(found.begin(), found.end(), [](const Found& a, const Found& b) { return a.written > b.written; });
+    for (auto& f : found) {
+        lru_.push_back(f.key);
+        f.entry.lru = std::prev(lru_.end());
+        bytes_ += f.entry.size;
+        entries_.emplace(f.key, std::move(f.entry));
+    }
+    evictLocked();
+    return true;
+}
+
+bool HttpResponseCache::enabled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return budget_ > 0;
+}
+
+std::string HttpResponseCache::keyFor(const std::string& method,
+                                      const std::string& url,
+                                      const std::vector<std::pair<std::string, std::string>>& headers) {
+    Sha256 sha;
+    sha.update(method.data(), method.size());
+    sha.update(" ", 1);
+    sha.update(url.data(), url.size());
+    for (const auto& kv : headers) {
+        if (toLowerCopy(kv.first) != "authorization") continue;
+        sha.update("\n", 1);
+        sha.update(kv.second.data(), kv.second.size());
+    }
+    // 128 bits is plenty for a file name.
+    return Sha256::toHex(sha.digest()).substr(0, 32);
+}
+
+std::string HttpResponseCache::pathFor(const std::string& key) const {
+    return dir_ + "/" + key + kEntrySuffix;
+}
+
+bool HttpResponseCache::validators(const std::string& key, Validators& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) return false;
+    out.etag = it->second.etag;
+    out.lastModified = it->second.lastModified;
+    return true;
+}
+
+bool HttpResponseCache::load(const std::string& key, ParsedHttpResponse& parsed, std::string& body) {
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it == entries_.end()) return false;
+        lru_.splice(lru_.begin(), lru_, it->second.lru);
+        path = pathFor(key);
+    }
+    // The read runs unlocked; a store or eviction racing with it shows up as a failed read.
+    std::ifstream in(path, std::ios::binary);
+    EntryHead head;
+    bool ok = in && readHead(in, head);
+    std::string headers;
+    if (ok) {
+        headers.resize(static_cast<size_t>(head.headersLen));
+        body.resize(static_cast<size_t>(head.bodyLen));
+        ok = (head.headersLen == 0 || in.read(&headers[0], static_cast<std::streamsize>(headers.size()))) &&
+             (head.bodyLen == 0 || in.read(&body[0], static_cast<std::streamsize>(body.size())));
+    }
+    std::string err;
+    if (ok) {
+        const std::string block = "HTTP/1.1 200 OK" + (headers.empty() ? std::string() : "\r\n" + headers);
+        ok = parseHttpResponseHeaders(block, parsed, err);
+    }
+    if (!ok) {
+        body.clear();
+        remove(key);
+        return false;
+    }
+    stats_.hits.fetch_add(1, std::memory_order_relaxed);
+    stats_.hitBytes.fetch_add(body.size(), std::memory_order_relaxed);
+    return true;
+}
+
+bool HttpResponseCache::store(const std::string& key, const std::string& url, const ParsedHttpResponse& parsed,
+                              const std::string& body) {
+    if (parsed.statusCode != 200 || (parsed.etag.empty() && parsed.lastModified.empty())) return false;
+    if (parsed.cacheControl.find("no-store") != std::string::npos) return false;
+    if (url.find('\n') != std::string::npos || parsed.etag.find('\n') != std::string::npos ||
+        parsed.lastModified.find('\n') != std::string::npos) {
+        return false;
+    }
+    const std::string headers = storedHeaders(parsed.headersRaw, body.size());
+    std::string tmp;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (budget_ == 0 || body.size() + headers.size() > budget_ / kMaxEntryShare) return false;
+        tmp = dir_ + "/" + key + "." + std::to_string(++tmpSeq_) + ".tmp";
+    }
+
+    // No fsync: a torn entry fails its length check and is dropped, like any other miss.
+    std::string headLines = std::string(kMagic) + "\n" + url + "\n" + parsed.etag + "\n" + parsed.lastModified +
+                            "\n" + std::to_string(headers.size()) + " " + std::to_string(body.size()) +
+                            "\n";
+    FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(headLines.data(), 1, headLines.size(), f) == headLines.size() &&
+              std::fwrite(headers.data(), 1, headers.size(), f) == headers.size() &&
+              std::fwrite(body.data(), 1, body.size(), f) == body.size();
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    const uint64_t size = headLines.size() + headers.size() + body.size();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::string path = pathFor(key);
+    dropLocked(key);
+    // FAT refuses to rename onto an existing file; dropLocked removed it.
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    lru_.push_front(key);
+    Entry e;
+    e.etag = parsed.etag;
+    e.lastModified = parsed.lastModified;
+    e.size = size;
+    e.lru = lru_.begin();
+    entries_[key] = std::move(e);
+    bytes_ += size;
+    stats_.stores.fetch_add(1, std::memory_order_relaxed);
+    evictLocked();
+    return true;
+}
+
+void HttpResponseCache::remove(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    dropLocked(key);
+}
+
+void HttpResponseCache::dropLocked(const std::string& key) {
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        bytes_ -= it->second.size;
+        lru_.erase(it->second.lru);
+        entries_.erase(it);
+    }
+    std::remove(pathFor(key).c_str());
+}
+
+void HttpResponseCache::evictLocked() {
+    while (bytes_ > budget_ && !lru_.empty()) {
+        const std::string key = lru_.back(); // dropLocked erases the node
+        dropLocked(key);
+        stats_.evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+uint64_t HttpResponseCache::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+size_t HttpResponseCache::entries() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+HttpResponseCache& httpResponseCache() {
+    static HttpResponseCache cache;
+    return cache;
+}
+
+} // namespace romm
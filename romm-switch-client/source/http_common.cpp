@@ -3,16 +3,20 @@
 #endif
 
 #include "romm/http_common.hpp"
+#include "romm/http_cache.hpp"
+#include "romm/http_engine.hpp"
+#include "romm/http_single_flight.hpp"
+#include <algorithm>
 #include <cerrno>
 #include <cctype>
+#include <climits>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
-#include <mutex>
+#include <memory>
 #include <sstream>
 
-#ifndef UNIT_TEST
-#include <curl/curl.h>
-#endif
+#include <zlib.h>
 
 #if defined(_WIN32)
 #include <winsock2.h>
@@ -28,7 +32,8 @@ namespace romm {
 
 namespace {
 constexpr size_t kHttpRecvBuf = 8192;
-constexpr long kCurlBufferSize = 256L * 1024L;
+// Body bytes a streamed call lets the I/O thread run ahead of its sink before the transfer pauses.
+constexpr size_t kStreamQueueBytes = 512 * 1024;
 
 struct ParsedUrl {
     std::string scheme;
@@ -82,7 +87,7 @@ static bool isCancelled(const HttpRequestOptions& options) {
     return options.cancelRequested && options.cancelRequested->load(std::memory_order_acquire);
 }
 
-[[maybe_unused]] static bool parseHttpUrlInternal(const std::string& url, ParsedUrl& out, std::string& err) {
+static bool parseHttpUrlInternal(const std::string& url, ParsedUrl& out, std::string& err) {
     out = ParsedUrl{};
     size_t schemeLen = 0;
     if (url.rfind("http://", 0) == 0) {
@@ -343,263 +348,6 @@ static bool recvWithCancel(int fd, char* buf, size_t len, const HttpRequestOptio
     return parseHttpResponseHeaders(headerBlock, parsed, err);
 }
 
-#ifndef UNIT_TEST
-struct CurlEasyHandle {
-    CURL* handle{nullptr};
-    bool owned{false};
-    ~CurlEasyHandle() {
-        if (owned && handle) curl_easy_cleanup(handle);
-    }
-};
-
-// Use a wrapper so thread exit cleans up keep-alive handles (important for worker threads).
-struct ThreadCurlKeepAliveEasy {
-    CURL* handle{nullptr};
-    ~ThreadCurlKeepAliveEasy() {
-        if (handle) {
-            curl_easy_cleanup(handle);
-            handle = nullptr;
-        }
-    }
-};
-thread_local ThreadCurlKeepAliveEasy gCurlKeepAliveEasy;
-
-static bool gCurlGlobalInitOk = false;
-static bool gCurlGlobalCleaned = false;
-static std::mutex gCurlGlobalMutex;
-
-struct CurlHeaderState {
-    std::string raw;
-};
-
-struct CurlProgressState {
-    const HttpRequestOptions* options{nullptr};
-    bool cancelled{false};
-};
-
-struct CurlBufferedWriteState {
-    const HttpRequestOptions* options{nullptr};
-    std::string* body{nullptr};
-    bool sizeExceeded{false};
-};
-
-struct CurlStreamWriteState {
-    const HttpRequestOptions* options{nullptr};
-    const std::function<bool(const char*, size_t)>* onData{nullptr};
-    CurlHeaderState* headers{nullptr};
-    ParsedHttpResponse* parsed{nullptr};
-    bool headersParsed{false};
-    bool parseFailed{false};
-    bool chunkedRejected{false};
-    bool sinkAborted{false};
-    bool sizeExceeded{false};
-    uint64_t streamed{0};
-    std::string parseErr;
-};
-
-struct CurlSlist {
-    curl_slist* head{nullptr};
-    ~CurlSlist() { if (head) curl_slist_free_all(head); }
-};
-
-static bool ensureCurlGlobalInit(std::string& err) {
-    static bool initAttempted = false;
-    static bool initOk = false;
-    if (!initAttempted) {
-        initAttempted = true;
-        initOk = (curl_global_init(CURL_GLOBAL_DEFAULT) == CURLE_OK);
-        gCurlGlobalInitOk = initOk;
-    }
-    if (!initOk) err = "curl_global_init failed";
-    return initOk;
-}
-
-static bool acquireCurlHandle(bool keepAlive, CurlEasyHandle& out, std::string& err) {
-    if (keepAlive) {
-        if (!gCurlKeepAliveEasy.handle) gCurlKeepAliveEasy.handle = curl_easy_init();
-        if (!gCurlKeepAliveEasy.handle) {
-            err = "curl_easy_init failed";
-            return false;
-        }
-        out.handle = gCurlKeepAliveEasy.handle;
-        out.owned = false;
-        curl_easy_reset(out.handle);
-        return true;
-    }
-    out.handle = curl_easy_init();
-    if (!out.handle) {
-        err = "curl_easy_init failed";
-        return false;
-    }
-    out.owned = true;
-    return true;
-}
-
-static bool extractFinalHeaderBlock(const std::string& raw, std::string& out) {
-    out.clear();
-    size_t pos = 0;
-    bool found = false;
-    while (pos < raw.size()) {
-        size_t end = raw.find("\r\n\r\n", pos);
-        if (end == std::string::npos) break;
-        std::string block = raw.substr(pos, end - pos);
-        if (!block.empty() && block.rfind("HTTP/", 0) == 0) {
-            out = std::move(block);
-            found = true;
-        }
-        pos = end + 4;
-    }
-    if (found) return true;
-    if (!raw.empty() && raw.rfind("HTTP/", 0) == 0) {
-        out = raw;
-        while (!out.empty() && (out.back() == '\r' || out.back() == '\n')) out.pop_back();
-        return true;
-    }
-    return false;
-}
-
-static bool parseCurlResponseHeaders(const CurlHeaderState& headerState,
-                                     ParsedHttpResponse& out,
-                                     std::string& err) {
-    std::string block;
-    if (!extractFinalHeaderBlock(headerState.raw, block)) {
-        err = "Missing HTTP response headers";
-        return false;
-    }
-    return parseAndFillResponse(block, out, err);
-}
-
-static size_t curlHeaderCallback(char* ptr, size_t size, size_t nmemb, void* userdata) {
-    auto* state = static_cast<CurlHeaderState*>(userdata);
-    if (!state || !ptr) return 0;
-    size_t n = size * nmemb;
-    state->raw.append(ptr, n);
-    return n;
-}
-
-static int curlProgressCallback(void* clientp,
-                                curl_off_t /*dltotal*/,
-                                curl_off_t /*dlnow*/,
-                                curl_off_t /*ultotal*/,
-                                curl_off_t /*ulnow*/) {
-    auto* state = static_cast<CurlProgressState*>(clientp);
-    if (!state || !state->options) return 0;
-    if (isCancelled(*state->options)) {
-        state->cancelled = true;
-        return 1;
-    }
-    return 0;
-}
-
-static size_t curlBufferedWriteCallback(char* ptr, size_t size, size_t nmemb, void* userdata) {
-    auto* state = static_cast<CurlBufferedWriteState*>(userdata);
-    if (!state || !state->body || !ptr) return 0;
-    size_t n = size * nmemb;
-    if (state->options && state->options->maxBodyBytes > 0 &&
-        state->body->size() + n > state->options->maxBodyBytes) {
-        state->sizeExceeded = true;
-        return 0;
-    }
-    state->body->append(ptr, n);
-    return n;
-}
-
-static size_t curlStreamWriteCallback(char* ptr, size_t size, size_t nmemb, void* userdata) {
-    auto* state = static_cast<CurlStreamWriteState*>(userdata);
-    if (!state || !ptr) return 0;
-    size_t n = size * nmemb;
-    if (n == 0) return 0;
-
-    if (!state->headersParsed) {
-        std::string err;
-        if (!parseCurlResponseHeaders(*state->headers, *state->parsed, err)) {
-            state->parseFailed = true;
-            state->parseErr = err;
-            return 0;
-        }
-        state->headersParsed = true;
-        if (state->parsed->chunked) {
-            state->chunkedRejected = true;
-            return 0;
-        }
-    }
-
-    if (state->options && state->options->maxBodyBytes > 0 &&
-        state->streamed + n > state->options->maxBodyBytes) {
-        state->sizeExceeded = true;
-        return 0;
-    }
-
-    if (state->onData && !(*state->onData)(ptr, n)) {
-        state->sinkAborted = true;
-        return 0;
-    }
-
-    state->streamed += static_cast<uint64_t>(n);
-    return n;
-}
-
-static bool setupCurlRequest(CURL* easy,
-                             const std::string& method,
-                             const std::string& url,
-                             const std::vector<std::pair<std::string, std::string>>& headers,
-                             const HttpRequestOptions& options,
-                             CurlHeaderState& headerState,
-                             CurlProgressState& progressState,
-                             CurlSlist& reqHeaders,
-                             std::string& err) {
-    if (curl_easy_setopt(easy, CURLOPT_URL, url.c_str()) != CURLE_OK) {
-        err = "Failed to set request URL";
-        return false;
-    }
-    curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, options.followRedirects ? 1L : 0L);
-    if (options.followRedirects) {
-        curl_easy_setopt(easy, CURLOPT_MAXREDIRS, 5L);
-        // Allow redirecting only to HTTP(S).
-        curl_easy_setopt(easy, CURLOPT_REDIR_PROTOCOLS, CURLPROTO_HTTP | CURLPROTO_HTTPS);
-    }
-    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
-    curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
-    curl_easy_setopt(easy, CURLOPT_FAILONERROR, 0L);
-    // Raise libcurl's transfer buffer to reduce callback churn on large downloads.
-    curl_easy_setopt(easy, CURLOPT_BUFFERSIZE, kCurlBufferSize);
-    curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT, options.timeoutSec > 0 ? options.timeoutSec : 0);
-    // Match prior behavior: timeout means connect/idle timeout, not full-transfer cap.
-    curl_easy_setopt(easy, CURLOPT_TIMEOUT, 0L);
-    curl_easy_setopt(easy, CURLOPT_LOW_SPEED_LIMIT, 1L);
-    curl_easy_setopt(easy, CURLOPT_LOW_SPEED_TIME, options.timeoutSec > 0 ? options.timeoutSec : 0);
-    curl_easy_setopt(easy, CURLOPT_FORBID_REUSE, options.keepAlive ? 0L : 1L);
-    curl_easy_setopt(easy, CURLOPT_FRESH_CONNECT, options.keepAlive ? 0L : 1L);
-
-    curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, curlHeaderCallback);
-    curl_easy_setopt(easy, CURLOPT_HEADERDATA, &headerState);
-
-    progressState.options = &options;
-    progressState.cancelled = false;
-    curl_easy_setopt(easy, CURLOPT_NOPROGRESS, 0L);
-    curl_easy_setopt(easy, CURLOPT_XFERINFOFUNCTION, curlProgressCallback);
-    curl_easy_setopt(easy, CURLOPT_XFERINFODATA, &progressState);
-
-    for (const auto& kv : headers) {
-        reqHeaders.head = curl_slist_append(reqHeaders.head, (kv.first + ": " + kv.second).c_str());
-    }
-    if (reqHeaders.head) curl_easy_setopt(easy, CURLOPT_HTTPHEADER, reqHeaders.head);
-
-    curl_easy_setopt(easy, CURLOPT_NOBODY, 0L);
-    curl_easy_setopt(easy, CURLOPT_HTTPGET, 0L);
-    curl_easy_setopt(easy, CURLOPT_CUSTOMREQUEST, nullptr);
-    if (isHeadMethod(method)) {
-        curl_easy_setopt(easy, CURLOPT_NOBODY, 1L);
-        curl_easy_setopt(easy, CURLOPT_CUSTOMREQUEST, "HEAD");
-    } else if (method == "GET") {
-        curl_easy_setopt(easy, CURLOPT_HTTPGET, 1L);
-    } else {
-        curl_easy_setopt(easy, CURLOPT_CUSTOMREQUEST, method.c_str());
-    }
-    return true;
-}
-#endif
-
 } // namespace
 
 bool sendAll(int fd, const char* data, size_t len) {
@@ -682,6 +430,14 @@ bool parseHttpResponseHeaders(const std::string& headerBlock, ParsedHttpResponse
             parsedContentLength = cl;
             out.hasContentLength = true;
             out.contentLength = cl;
+        } else if (keyLower == "content-encoding") {
+            out.contentEncoding = valLower;
+        } else if (keyLower == "etag") {
+            out.etag = val;
+        } else if (keyLower == "last-modified") {
+            out.lastModified = val;
+        } else if (keyLower == "cache-control") {
+            out.cacheControl = valLower;
         } else if (keyLower == "content-range") {
             std::string rangeVal = val;
             auto bytesPos = rangeVal.find("bytes");
@@ -746,180 +502,275 @@ bool parseHttpResponseHeaders(const std::string& headerBlock, ParsedHttpResponse
     return true;
 }
 
-bool httpRequestBuffered(const std::string& method,
-                         const std::string& url,
-                         const std::vector<std::pair<std::string, std::string>>& headers,
-                         const HttpRequestOptions& options,
-                         HttpTransaction& out,
-                         std::string& err) {
-    out = HttpTransaction{};
-    err.clear();
-#ifndef UNIT_TEST
-    ParsedUrl parsedUrl;
-    if (!parseHttpUrlInternal(url, parsedUrl, err)) return false;
-
-    if (!ensureCurlGlobalInit(err)) return false;
-    CurlEasyHandle easy;
-    if (!acquireCurlHandle(options.keepAlive, easy, err)) return false;
-
-    CurlHeaderState headerState;
-    CurlProgressState progressState;
-    CurlSlist reqHeaders;
-    if (!setupCurlRequest(easy.handle, method, url, headers, options, headerState, progressState, reqHeaders, err)) {
-        return false;
+namespace {
+constexpr size_t kInflateChunk = 64 * 1024;
+} // namespace
+
+struct HttpBodyDecoder::Inflater {
+    z_stream z{};
+    bool ready{false};
+    std::vector<char> out;
+    ~Inflater() {
+        if (ready) inflateEnd(&z);
+    }
+};
+
+bool HttpBodyDecoder::codingOf(const std::string& contentEncoding, Coding& out) {
+    if (contentEncoding == "gzip" || contentEncoding == "x-gzip") {
+        out = Coding::Gzip;
+        return true;
     }
+    if (contentEncoding == "deflate") {
+        out = Coding::Deflate;
+        return true;
+    }
+    return false;
+}
 
-    if (options.activeSocketFd) options.activeSocketFd->store(-1, std::memory_order_release);
+HttpBodyDecoder::HttpBodyDecoder(Coding coding, size_t maxOutBytes) : coding_(coding), maxOutBytes_(maxOutBytes) {}
 
-    CurlBufferedWriteState writeState;
-    writeState.options = &options;
-    writeState.body = &out.body;
-    curl_easy_setopt(easy.handle, CURLOPT_WRITEFUNCTION, curlBufferedWriteCallback);
-    curl_easy_setopt(easy.handle, CURLOPT_WRITEDATA, &writeState);
+HttpBodyDecoder::~HttpBodyDecoder() = default;
 
-    CURLcode rc = curl_easy_perform(easy.handle);
-    if (rc != CURLE_OK) {
-        if (progressState.cancelled || isCancelled(options)) {
-            err = "Cancelled";
-        } else if (writeState.sizeExceeded) {
-            err = "HTTP body exceeds configured max size";
-        } else if (rc == CURLE_OPERATION_TIMEDOUT) {
-            err = "Recv timed out";
-        } else {
-            err = std::string("CURL failed: ") + curl_easy_strerror(rc);
-        }
+bool HttpBodyDecoder::start(const char* data, std::string& err) {
+    int windowBits = 15 + 16; // gzip wrapper
+    if (coding_ == Coding::Deflate) {
+        // RFC 9110 says zlib-wrapped, but raw deflate is common; a zlib header is 2 bytes whose
+        // big-endian value is a multiple of 31, with method 8.
+        const auto b0 = static_cast<unsigned char>(data[0]);
+        const auto b1 = static_cast<unsigned char>(data[1]);
+        const bool zlibHeader = (b0 & 0x0F) == 8 && ((b0 << 8) | b1) % 31 == 0;
+        windowBits = zlibHeader ? 15 : -15;
+    }
+    inflater_ = std::make_unique<Inflater>();
+    if (inflateInit2(&inflater_->z, windowBits) != Z_OK) {
+        err = "inflateInit failed";
         return false;
     }
+    inflater_->ready = true;
+    inflater_->out.resize(kInflateChunk);
+    return true;
+}
 
-    if (!parseCurlResponseHeaders(headerState, out.parsed, err)) return false;
-    if (!options.decodeChunked && out.parsed.chunked) {
-        err = "Chunked transfer not supported";
-        return false;
+bool HttpBodyDecoder::write(const char* data, size_t len, std::string& out, std::string& err) {
+    if (len == 0) return true;
+    if (!inflater_) {
+        // Deflate needs two bytes to tell its wrappers apart.
+        if (coding_ == Coding::Deflate && head_.size() + len < 2) {
+            head_.append(data, len);
+            return true;
+        }
+        if (!head_.empty()) {
+            head_.append(data, len);
+            std::string head = std::move(head_);
+            head_.clear();
+            return start(head.data(), err) && write(head.data(), head.size(), out, err);
+        }
+        if (!start(data, err)) return false;
     }
-    if (options.maxBodyBytes > 0 && out.body.size() > options.maxBodyBytes) {
-        err = "HTTP body exceeds configured max size";
+    if (ended_) {
+        err = "Data after the end of the compressed body";
         return false;
     }
-    if (isHeadMethod(method) || isNoBodyStatus(out.parsed.statusCode)) out.body.clear();
+    z_stream& z = inflater_->z;
+    while (len > 0) {
+        const size_t avail = std::min<size_t>(len, UINT_MAX);
+        z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        z.avail_in = static_cast<uInt>(avail);
+        int ret = Z_OK;
+        do {
+            z.next_out = reinterpret_cast<Bytef*>(inflater_->out.data());
+            z.avail_out = static_cast<uInt>(inflater_->out.size());
+            ret = inflate(&z, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+                err = std::string("Corrupt compressed body") + (z.msg ? std::string(": ") + z.msg : "");
+                return false;
+            }
+            const size_t produced = inflater_->out.size() - z.avail_out;
+            if (maxOutBytes_ > 0 && outBytes_ + produced > maxOutBytes_) {
+                exceeded_ = true;
+                err = "HTTP body exceeds configured max size";
+                return false;
+            }
+            out.append(inflater_->out.data(), produced);
+            outBytes_ += produced;
+        } while (ret != Z_STREAM_END && (z.avail_in > 0 || z.avail_out == 0) && ret != Z_BUF_ERROR);
+        const size_t used = avail - z.avail_in;
+        if (used == 0 && ret != Z_STREAM_END) {
+            err = "Corrupt compressed body";
+            return false;
+        }
+        data += used;
+        len -= used;
+        if (ret == Z_STREAM_END) {
+            ended_ = true;
+            if (len > 0) {
+                err = "Data after the end of the compressed body";
+                return false;
+            }
+        }
+    }
     return true;
-#else
-    (void)method;
-    (void)url;
-    (void)headers;
-    (void)options;
-    err = "httpRequestBuffered unavailable in UNIT_TEST";
-    return false;
-#endif
 }
 
-bool httpRequestStreamed(const std::string& method,
-                         const std::string& url,
-                         const std::vector<std::pair<std::string, std::string>>& headers,
-                         const HttpRequestOptions& options,
-                         ParsedHttpResponse& outHeaders,
-                         const std::function<bool(const char*, size_t)>& onData,
-                         std::string& err) {
-    outHeaders = ParsedHttpResponse{};
-    err.clear();
-#ifndef UNIT_TEST
-    ParsedUrl parsedUrl;
-    if (!parseHttpUrlInternal(url, parsedUrl, err)) return false;
-
-    if (!ensureCurlGlobalInit(err)) return false;
-    CurlEasyHandle easy;
-    if (!acquireCurlHandle(options.keepAlive, easy, err)) return false;
-
-    CurlHeaderState headerState;
-    CurlProgressState progressState;
-    CurlSlist reqHeaders;
-    if (!setupCurlRequest(easy.handle, method, url, headers, options, headerState, progressState, reqHeaders, err)) {
+bool HttpBodyDecoder::finish(std::string& err) {
+    if (!inflater_ && head_.empty()) return true; // empty body
+    if (!ended_) {
+        err = "Truncated compressed body";
         return false;
     }
+    return true;
+}
 
-    if (options.activeSocketFd) options.activeSocketFd->store(-1, std::memory_order_release);
+bool httpOriginOf(const std::string& url, std::string& origin, std::string& err) {
+    ParsedUrl parsed;
+    if (!parseHttpUrlInternal(url, parsed, err)) return false;
+    origin = parsed.scheme + "://" + parsed.host + ":" + parsed.port;
+    return true;
+}
 
-    CurlStreamWriteState writeState;
-    writeState.options = &options;
-    writeState.onData = &onData;
-    writeState.headers = &headerState;
-    writeState.parsed = &outHeaders;
-    curl_easy_setopt(easy.handle, CURLOPT_WRITEFUNCTION, curlStreamWriteCallback);
-    curl_easy_setopt(easy.handle, CURLOPT_WRITEDATA, &writeState);
+namespace {
+// `nameLower` must be lowercase.
+bool hasHeader(const std::vector<std::pair<std::string, std::string>>& headers, const char* nameLower) {
+    for (const auto& kv : headers) {
+        std::string name = kv.first;
+        for (auto& c : name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        if (name == nameLower) return true;
+    }
+    return false;
+}
 
-    CURLcode rc = curl_easy_perform(easy.handle);
+// A GET whose response only depends on the URL and credentials: not conditional, not a range.
+bool isPlainGet(const std::string& method, const std::vector<std::pair<std::string, std::string>>& headers) {
+    return method == "GET" && !hasHeader(headers, "if-none-match") && !hasHeader(headers, "if-modified-since") &&
+           !hasHeader(headers, "range");
+}
 
-    if (!writeState.headersParsed) {
-        if (!parseCurlResponseHeaders(headerState, outHeaders, err)) {
-            if (rc != CURLE_OK) {
-                if (progressState.cancelled || isCancelled(options)) err = "Cancelled";
-                else err = std::string("CURL failed: ") + curl_easy_strerror(rc);
-            }
+bool requestThroughCache(HttpEngine& engine,
+                         const std::string& method,
+                         const std::string& url,
+                         const std::vector<std::pair<std::string, std::string>>& headers,
+                         const HttpRequestOptions& options,
+                         HttpTransaction& out,
+                         std::string& err) {
+    // Plain GETs go through the response cache; a caller-made conditional or range request is
+    // passed through untouched.
+    HttpResponseCache* cache = options.cache;
+    if (cache && (!cache->enabled() || !isPlainGet(method, headers))) cache = nullptr;
+    const std::string key = cache ? HttpResponseCache::keyFor(method, url, headers) : std::string();
+    HttpResponseCache::Validators validators;
+    bool conditional = cache && cache->validators(key, validators);
+
+    for (;;) {
+        HttpRequest req;
+        req.method = method;
+        req.url = url;
+        req.headers = headers;
+        req.options = options;
+        if (conditional) {
+            if (!validators.etag.empty()) req.headers.push_back({"If-None-Match", validators.etag});
+            if (!validators.lastModified.empty()) req.headers.push_back({"If-Modified-Since", validators.lastModified});
+            cache->stats().revalidations.fetch_add(1, std::memory_order_relaxed);
+        }
+        HttpCallPtr call = engine.submit(std::move(req));
+        HttpResult& res = call->wait();
+        if (!res.ok) {
+            err = res.err;
             return false;
         }
-        writeState.headersParsed = true;
+        if (conditional && res.parsed.statusCode == 304) {
+            if (cache->load(key, out.parsed, out.body)) {
+                out.fromCache = true;
+                return true;
+            }
+            // The stored copy is gone (evicted, damaged): ask again for the full response.
+            conditional = false;
+            continue;
+        }
+        // Only bodies in their plain form are stored; one the engine left encoded is not.
+        HttpBodyDecoder::Coding coding;
+        const bool plain = res.parsed.contentEncoding.empty() ||
+                           (options.acceptCompressed && HttpBodyDecoder::codingOf(res.parsed.contentEncoding, coding));
+        if (cache && res.parsed.statusCode == 200 && plain) cache->store(key, url, res.parsed, res.body);
+        out.parsed = std::move(res.parsed);
+        out.body = std::move(res.body);
+        return true;
     }
+}
+} // namespace
 
-    if (rc != CURLE_OK) {
-        if (progressState.cancelled || isCancelled(options)) {
-            err = "Cancelled";
-        } else if (writeState.sinkAborted) {
-            err = "Sink aborted";
-        } else if (writeState.sizeExceeded) {
-            err = "HTTP body exceeds configured max size";
-        } else if (writeState.chunkedRejected) {
-            err = "Chunked encoding not supported for streaming downloads";
-        } else if (writeState.parseFailed) {
-            err = writeState.parseErr;
-        } else if (rc == CURLE_OPERATION_TIMEDOUT) {
-            err = "Recv timed out";
-        } else {
-            err = std::string("CURL failed: ") + curl_easy_strerror(rc);
-        }
+bool httpRequestBuffered(const std::string& method,
+                         const std::string& url,
+                         const std::vector<std::pair<std::string, std::string>>& headers,
+                         const HttpRequestOptions& options,
+                         HttpTransaction& out,
+                         std::string& err) {
+    out = HttpTransaction{};
+    err.clear();
+    HttpEngine& engine = httpEngine();
+    if (engine.onIoThread()) {
+        err = "Blocking HTTP request on the HTTP I/O thread";
         return false;
     }
+    // A request its caller can cancel keeps its own transfer: cancelling it must not fail the
+    // callers that joined it.
+    if (!options.singleFlight || options.cancelRequested || options.activeSocketFd || !isPlainGet(method, headers)) {
+        return requestThroughCache(engine, method, url, headers, options, out, err);
+    }
+    return options.singleFlight->run(
+        HttpSingleFlight::keyFor(method, url, headers, options.maxBodyBytes),
+        [&](HttpTransaction& tx, std::string& fetchErr) {
+            return requestThroughCache(engine, method, url, headers, options, tx, fetchErr);
+        },
+        out, err);
+}
 
-    if (writeState.chunkedRejected || outHeaders.chunked) {
-        err = "Chunked encoding not supported for streaming downloads";
+bool httpRequestStreamed(const std::string& method,
+                         const std::string& url,
+                         const std::vector<std::pair<std::string, std::string>>& headers,
+                         const HttpRequestOptions& options,
+                         ParsedHttpResponse& outHeaders,
+                         const std::function<bool(const char*, size_t)>& onData,
+                         std::string& err) {
+    outHeaders = ParsedHttpResponse{};
+    err.clear();
+    HttpEngine& engine = httpEngine();
+    if (engine.onIoThread()) {
+        err = "Blocking HTTP request on the HTTP I/O thread";
         return false;
     }
-    if (options.maxBodyBytes > 0 && writeState.streamed > options.maxBodyBytes) {
-        err = "HTTP body exceeds configured max size";
+    // The sink runs here, on the caller's thread: it may block (disk, rate limiter) without
+    // stalling the other transfers, and a full queue pauses this transfer's socket instead.
+    auto queue = std::make_shared<HttpBodyQueue>(kStreamQueueBytes);
+    HttpRequest req;
+    req.method = method;
+    req.url = url;
+    req.headers = headers;
+    req.options = options;
+    req.options.decodeChunked = false; // streamed bodies must be Content-Length delimited
+    req.bodyQueue = queue;
+    HttpCallPtr call = engine.submit(std::move(req));
+
+    bool sinkAborted = false;
+    std::string chunk;
+    while (queue->take(chunk, outHeaders)) {
+        if (!onData(chunk.data(), chunk.size())) {
+            sinkAborted = true;
+            queue->close();
+            break;
+        }
+        queue->recycle(std::move(chunk));
+    }
+    HttpResult& res = call->wait();
+    outHeaders = res.parsed;
+    if (sinkAborted) {
+        err = isCancelled(options) ? "Cancelled" : "Sink aborted";
         return false;
     }
-    if (!(isHeadMethod(method) || isNoBodyStatus(outHeaders.statusCode)) &&
-        outHeaders.hasContentLength &&
-        writeState.streamed < outHeaders.contentLength) {
-        err = "Short read";
+    if (!res.ok) {
+        err = res.err;
         return false;
     }
     return true;
-#else
-    (void)method;
-    (void)url;
-    (void)headers;
-    (void)options;
-    (void)onData;
-    err = "httpRequestStreamed unavailable in UNIT_TEST";
-    return false;
-#endif
-}
-
-void httpShutdown() {
-#ifndef UNIT_TEST
-    // Note: thread-local keep-alive handles on worker threads are cleaned up by their TLS destructor.
-    // Here we only do best-effort cleanup for the current thread + libcurl global cleanup.
-    if (gCurlKeepAliveEasy.handle) {
-        curl_easy_cleanup(gCurlKeepAliveEasy.handle);
-        gCurlKeepAliveEasy.handle = nullptr;
-    }
-    std::lock_guard<std::mutex> lock(gCurlGlobalMutex);
-    if (gCurlGlobalCleaned) return;
-    if (gCurlGlobalInitOk) {
-        curl_global_cleanup();
-    }
-    gCurlGlobalCleaned = true;
-    gCurlGlobalInitOk = false;
-#endif
 }
 
 } // namespace romm
@@ -0,0 +1,940 @@
+#include "romm/http_engine.hpp"
+#include "romm/connection_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+#ifndef UNIT_TEST
+#include <curl/curl.h>
+#include <sys/socket.h>
+#endif
+
+namespace romm {
+
+namespace {
+constexpr size_t kMaxSpareChunks = 4;
+#ifndef UNIT_TEST
+constexpr long kCurlBufferSize = 256L * 1024L;
+constexpr long kCurlMaxBufferSize = 512L * 1024L; // CURL_MAX_READ_SIZE on older libcurl
+constexpr long kMaxCachedConnections = 16;        // the multi handle's connection cache
+constexpr size_t kMaxIdleEasy = 4;                // keep-alive handles kept for requests without a pool
+constexpr int kPollMs = 100;                      // cancellation is noticed within this
+constexpr long kDnsCacheSec = 300;                // RomM servers rarely move; libcurl's default is 60
+constexpr curl_off_t kDnsCachedUs = 1000;         // a lookup faster than this came from the cache
+
+bool gCurlGlobalInitOk = false;
+bool gCurlGlobalCleaned = false;
+std::mutex gCurlGlobalMutex;
+
+bool ensureCurlGlobalInit(std::string& err) {
+    std::lock_guard<std::mutex> lock(gCurlGlobalMutex);
+    static bool initAttempted = false;
+    if (!initAttempted) {
+        initAttempted = true;
+        gCurlGlobalInitOk = (curl_global_init(CURL_GLOBAL_DEFAULT) == CURLE_OK);
+    }
+    if (!gCurlGlobalInitOk) err = "curl_global_init failed";
+    return gCurlGlobalInitOk;
+}
+
+bool isNoBodyStatus(int statusCode) {
+    return (statusCode >= 100 && statusCode < 200) || statusCode == 204 || statusCode == 304;
+}
+
+bool isHeadMethod(const std::string& method) {
+    return method == "HEAD" || method == "head" || method == "Head";
+}
+
+bool isCancelled(const HttpRequestOptions& options) {
+    return options.cancelRequested && options.cancelRequested->load(std::memory_order_acquire);
+}
+#endif
+
+} // namespace
+
+// ---- HttpBodyQueue ----
+
+HttpBodyQueue::HttpBodyQueue(size_t capacityBytes) : capacity_(capacityBytes > 0 ? capacityBytes : 1) {}
+
+void HttpBodyQueue::setHeaders(const ParsedHttpResponse& parsed) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        headers_ = parsed;
+        headersSet_ = true;
+    }
+    cv_.notify_all();
+}
+
+HttpBodyQueue::Push HttpBodyQueue::push(const char* data, size_t len) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_) return Push::Closed;
+        if (bytes_ > 0 && bytes_ + len > capacity_) {
+            producerPaused_ = true;
+            return Push::Full;
+        }
+        std::string buf;
+        if (!spare_.empty()) {
+            buf = std::move(spare_.back());
+            spare_.pop_back();
+        }
+        buf.assign(data, len);
+        chunks_.push_back(std::move(buf));
+        bytes_ += len;
+    }
+    cv_.notify_all();
+    return Push::Accepted;
+}
+
+void HttpBodyQueue::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_ = true;
+    }
+    cv_.notify_all();
+}
+
+void HttpBodyQueue::setOnResume(std::function<void()> onResume) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    onResume_ = std::move(onResume);
+}
+
+bool HttpBodyQueue::take(std::string& chunk, ParsedHttpResponse& headers) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&]() { return !chunks_.empty() || finished_ || closed_; });
+    if (headersSet_ && !headersTaken_) {
+        headers = headers_;
+        headersTaken_ = true;
+    }
+    if (chunks_.empty()) return false;
+    chunk = std::move(chunks_.front());
+    chunks_.pop_front();
+    bytes_ -= chunk.size();
+    resumeIfDrained(lock);
+    return true;
+}
+
+void HttpBodyQueue::recycle(std::string&& chunk) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (spare_.size() >= kMaxSpareChunks) return;
+    chunk.clear();
+    spare_.push_back(std::move(chunk));
+}
+
+void HttpBodyQueue::close() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    closed_ = true;
+    chunks_.clear();
+    bytes_ = 0;
+    cv_.notify_all();
+    // A paused transfer has to run once more to see Closed and abort.
+    resumeIfDrained(lock);
+}
+
+size_t HttpBodyQueue::bufferedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+void HttpBodyQueue::resumeIfDrained(std::unique_lock<std::mutex>& lock) {
+    if (!producerPaused_ || bytes_ > capacity_ / 2) return;
+    producerPaused_ = false;
+    std::function<void()> onResume = onResume_;
+    lock.unlock();
+    if (onResume) onResume();
+}
+
+// ---- HttpCall ----
+
+void HttpCall::cancel() {
+    cancel_.store(true, std::memory_order_release);
+    if (engine_) engine_->wake();
+}
+
+bool HttpCall::done() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return done_;
+}
+
+HttpResult& HttpCall::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&]() { return done_; });
+    return result_;
+}
+
+bool HttpCall::waitFor(int timeoutMs) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, std::chrono::milliseconds(timeoutMs > 0 ? timeoutMs : 0), [&]() { return done_; });
+}
+
+void HttpCall::complete(HttpResult&& result) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        result_ = std::move(result);
+        done_ = true;
+    }
+    cv_.notify_all();
+}
+
+// ---- HttpEngine ----
+
+struct HttpEngine::Transfer {
+    enum class Version { Http1, Http2Tls, Http2Prior };
+
+    uint64_t id{0};
+    HttpRequest req;
+    HttpCallPtr call;
+    HttpEngineStats* stats{nullptr};
+    std::string origin;
+    bool streaming{false};
+    Version version{Version::Http1};
+    bool h2Retried{false}; // h2c failed; this request runs on HTTP/1.1
+    bool pipeWait{false};  // queue behind a connection that multiplexes
+#ifndef UNIT_TEST
+    CURL* easy{nullptr};
+    curl_slist* reqHeaders{nullptr};
+#endif
+    std::string rawHeaders;
+    HttpResult result;
+    bool headersParsed{false};
+    bool parseFailed{false};
+    bool chunkedRejected{false};
+    bool sinkAborted{false};
+    bool sizeExceeded{false};
+    bool cancelled{false};
+    std::string parseErr;
+    // Buffered body with a Content-Encoding the request asked for (acceptCompressed).
+    bool encodingChecked{false};
+    std::unique_ptr<HttpBodyDecoder> decoder;
+    std::string decodeErr;
+
+    // Back to the state before the first byte, for a retry.
+    void resetResponse() {
+        rawHeaders.clear();
+        result = HttpResult{};
+        headersParsed = parseFailed = chunkedRejected = sinkAborted = sizeExceeded = false;
+        parseErr.clear();
+        encodingChecked = false;
+        decoder.reset();
+        decodeErr.clear();
+    }
+};
+
+// Process-wide CURLSH for the DNS cache and TLS sessions. The connection cache stays in the multi
+// handle, where CURLMOPT_MAXCONNECTS bounds it. libcurl takes the locks from whichever thread
+// touches shared data, so each data type gets its own mutex.
+struct HttpEngine::Share {
+#ifndef UNIT_TEST
+    CURLSH* handle{nullptr};
+    std::mutex locks[CURL_LOCK_DATA_LAST];
+#endif
+    HttpEngineStats* stats{nullptr};
+};
+
+HttpEngine::HttpEngine() = default;
+
+HttpEngine::~HttpEngine() { shutdown(); }
+
+bool HttpEngine::onIoThread() const {
+    return ioThreadId_.load(std::memory_order_acquire) == std::this_thread::get_id();
+}
+
+HttpCallPtr HttpEngine::submit(HttpRequest request) {
+    auto call = std::make_shared<HttpCall>(this);
+    auto transfer = std::make_unique<Transfer>();
+    transfer->id = nextId_.fetch_add(1, std::memory_order_relaxed);
+    transfer->req = std::move(request);
+    transfer->call = call;
+    transfer->stats = &stats_;
+    transfer->streaming = transfer->req.onData || transfer->req.bodyQueue;
+    stats_.submitted.fetch_add(1, std::memory_order_relaxed);
+    if (transfer->req.options.activeSocketFd) {
+        transfer->req.options.activeSocketFd->store(-1, std::memory_order_release);
+    }
+
+    std::string err;
+    if (!httpOriginOf(transfer->req.url, transfer->origin, err)) {
+        failTransfer(std::move(transfer), err);
+        return call;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (ensureStarted(err)) {
+            commands_.push_back(Command{Command::Kind::Start, transfer->id, std::move(transfer)});
+        }
+    }
+    if (transfer) {
+        failTransfer(std::move(transfer), err);
+        return call;
+    }
+    wake();
+    return call;
+}
+
+void HttpEngine::post(Command&& cmd) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!started_ || stopped_) return;
+        commands_.push_back(std::move(cmd));
+    }
+    wake();
+}
+
+void HttpEngine::wake() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!started_ || stopped_) return;
+#ifndef UNIT_TEST
+    curl_multi_wakeup(static_cast<CURLM*>(multi_));
+#endif
+    cv_.notify_all();
+}
+
+void HttpEngine::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return;
+        stopping_ = true;
+        if (!started_) {
+            stopped_ = true;
+            return;
+        }
+    }
+    wake();
+    if (thread_.joinable()) thread_.join();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true; // wake() no longer touches the multi handle
+    }
+#ifndef UNIT_TEST
+    for (void* easy : idleEasy_) curl_easy_cleanup(static_cast<CURL*>(easy));
+    idleEasy_.clear();
+    curl_multi_cleanup(static_cast<CURLM*>(multi_));
+    multi_ = nullptr;
+    // Every handle is detached by now (parked ones were detached on release).
+    if (share_ && share_->handle) curl_share_cleanup(share_->handle);
+    share_.reset();
+#endif
+}
+
+void HttpEngine::failTransfer(std::unique_ptr<Transfer> transfer, const std::string& err) {
+    HttpResult result;
+    result.err = err;
+    complete(*transfer, result);
+}
+
+void HttpEngine::complete(Transfer& transfer, HttpResult& result) {
+    if (result.ok) {
+        stats_.completed.fetch_add(1, std::memory_order_relaxed);
+    } else if (transfer.cancelled) {
+        stats_.cancelled.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        stats_.failed.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (transfer.req.onDone) transfer.req.onDone(result);
+    // Waiters see the result before a body reader sees the end of the stream.
+    transfer.call->complete(std::move(result));
+    if (transfer.req.bodyQueue) transfer.req.bodyQueue->finish();
+}
+
+#ifndef UNIT_TEST
+
+namespace {
+
+bool extractFinalHeaderBlock(const std::string& raw, std::string& out) {
+    out.clear();
+    size_t pos = 0;
+    bool found = false;
+    while (pos < raw.size()) {
+        size_t end = raw.find("\r\n\r\n", pos);
+        if (end == std::string::npos) break;
+        std::string block = raw.substr(pos, end - pos);
+        if (!block.empty() && block.rfind("HTTP/", 0) == 0) {
+            out = std::move(block);
+            found = true;
+        }
+        pos = end + 4;
+    }
+    if (found) return true;
+    if (!raw.empty() && raw.rfind("HTTP/", 0) == 0) {
+        out = raw;
+        while (!out.empty() && (out.back() == '\r' || out.back() == '\n')) out.pop_back();
+        return true;
+    }
+    return false;
+}
+
+bool parseTransferHeaders(const HttpEngine::Transfer& t, ParsedHttpResponse& out, std::string& err) {
+    std::string block;
+    if (!extractFinalHeaderBlock(t.rawHeaders, block)) {
+        err = "Missing HTTP response headers";
+        return false;
+    }
+    return parseHttpResponseHeaders(block, out, err);
+}
+
+size_t curlHeaderCallback(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    auto* t = static_cast<HttpEngine::Transfer*>(userdata);
+    if (!t || !ptr) return 0;
+    size_t n = size * nmemb;
+    t->rawHeaders.append(ptr, n);
+    return n;
+}
+
+size_t curlWriteCallback(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    auto* t = static_cast<HttpEngine::Transfer*>(userdata);
+    if (!t || !ptr) return 0;
+    size_t n = size * nmemb;
+    if (n == 0) return 0;
+    const HttpRequestOptions& options = t->req.options;
+
+    if (!t->streaming) {
+        t->result.wireBytes += n;
+        if (options.acceptCompressed && !t->encodingChecked) {
+            t->encodingChecked = true;
+            std::string err;
+            HttpBodyDecoder::Coding coding;
+            // A parse failure here is reported (again) when the request ends.
+            if (parseTransferHeaders(*t, t->result.parsed, err) &&
+                HttpBodyDecoder::codingOf(t->result.parsed.contentEncoding, coding)) {
+                t->decoder = std::make_unique<HttpBodyDecoder>(coding, options.maxBodyBytes);
+            }
+        }
+        if (t->decoder) {
+            if (!t->decoder->write(ptr, n, t->result.body, t->decodeErr)) {
+                if (t->decoder->exceeded()) t->sizeExceeded = true;
+                return 0;
+            }
+            t->result.bodyBytes = t->result.body.size();
+            return n;
+        }
+        if (options.maxBodyBytes > 0 && t->result.body.size() + n > options.maxBodyBytes) {
+            t->sizeExceeded = true;
+            return 0;
+        }
+        t->result.body.append(ptr, n);
+        t->result.bodyBytes += n;
+        return n;
+    }
+
+    if (!t->headersParsed) {
+        std::string err;
+        if (!parseTransferHeaders(*t, t->result.parsed, err)) {
+            t->parseFailed = true;
+            t->parseErr = err;
+            return 0;
+        }
+        t->headersParsed = true;
+        if (t->result.parsed.chunked && !options.decodeChunked) {
+            t->chunkedRejected = true;
+            return 0;
+        }
+        if (t->req.bodyQueue) t->req.bodyQueue->setHeaders(t->result.parsed);
+    }
+
+    if (options.maxBodyBytes > 0 && t->result.bodyBytes + n > options.maxBodyBytes) {
+        t->sizeExceeded = true;
+        return 0;
+    }
+    if (t->req.bodyQueue) {
+        switch (t->req.bodyQueue->push(ptr, n)) {
+        case HttpBodyQueue::Push::Accepted:
+            break;
+        case HttpBodyQueue::Push::Full:
+            // libcurl hands the same bytes over again once the reader resumes us.
+            t->stats->pauses.fetch_add(1, std::memory_order_relaxed);
+            return CURL_WRITEFUNC_PAUSE;
+        case HttpBodyQueue::Push::Closed:
+            t->sinkAborted = true;
+            return 0;
+        }
+    } else if (!t->req.onData(t->result.parsed, ptr, n)) {
+        t->sinkAborted = true;
+        return 0;
+    }
+    t->result.bodyBytes += n;
+    return n;
+}
+
+// CURLOPT_SOCKOPTFUNCTION: size the kernel receive buffer to match the tuned curl buffer.
+int curlSockoptCallback(void* clientp, curl_socket_t fd, curlsocktype purpose) {
+    if (purpose != CURLSOCKTYPE_IPCXN) return CURL_SOCKOPT_OK;
+    const int bytes = static_cast<int>(reinterpret_cast<uintptr_t>(clientp));
+    // Best effort: the stack clamps to its own maximum (256KB with the libnx defaults).
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+    return CURL_SOCKOPT_OK;
+}
+
+void shareLock(CURL* /*easy*/, curl_lock_data data, curl_lock_access /*access*/, void* userptr) {
+    auto* share = static_cast<HttpEngine::Share*>(userptr);
+    std::mutex& m = share->locks[data];
+    if (m.try_lock()) return;
+    share->stats->shareLockWaits.fetch_add(1, std::memory_order_relaxed);
+    m.lock();
+}
+
+void shareUnlock(CURL* /*easy*/, curl_lock_data data, void* userptr) {
+    static_cast<HttpEngine::Share*>(userptr)->locks[data].unlock();
+}
+
+bool setupCurlRequest(HttpEngine::Transfer& t, CURLSH* share, std::string& err) {
+    CURL* easy = t.easy;
+    const HttpRequestOptions& options = t.req.options;
+    if (curl_easy_setopt(easy, CURLOPT_URL, t.req.url.c_str()) != CURLE_OK) {
+        err = "Failed to set request URL";
+        return false;
+    }
+    curl_easy_setopt(easy, CURLOPT_PRIVATE, reinterpret_cast<char*>(&t));
+    curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, options.followRedirects ? 1L : 0L);
+    if (options.followRedirects) {
+        curl_easy_setopt(easy, CURLOPT_MAXREDIRS, 5L);
+        // Allow redirecting only to HTTP(S).
+        curl_easy_setopt(easy, CURLOPT_REDIR_PROTOCOLS, CURLPROTO_HTTP | CURLPROTO_HTTPS);
+    }
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    if (share) curl_easy_setopt(easy, CURLOPT_SHARE, share);
+    curl_easy_setopt(easy, CURLOPT_DNS_CACHE_TIMEOUT, kDnsCacheSec);
+    switch (t.version) {
+    case HttpEngine::Transfer::Version::Http1:
+        curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+        break;
+    case HttpEngine::Transfer::Version::Http2Tls:
+        curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        break;
+    case HttpEngine::Transfer::Version::Http2Prior:
+        curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE);
+        break;
+    }
+    // Wait for a connection that may multiplex instead of opening one per concurrent request.
+    curl_easy_setopt(easy, CURLOPT_PIPEWAIT, t.pipeWait ? 1L : 0L);
+    curl_easy_setopt(easy, CURLOPT_FAILONERROR, 0L);
+    // Raise libcurl's transfer buffer to reduce callback churn on large downloads.
+    long bufferSize = kCurlBufferSize;
+    if (options.recvBufferBytes > 0) {
+        bufferSize = std::min<long>(std::max<long>(static_cast<long>(options.recvBufferBytes), 16L * 1024L),
+                                    kCurlMaxBufferSize);
+        curl_easy_setopt(easy, CURLOPT_SOCKOPTFUNCTION, curlSockoptCallback);
+        curl_easy_setopt(easy, CURLOPT_SOCKOPTDATA, reinterpret_cast<void*>(static_cast<uintptr_t>(bufferSize)));
+    }
+    curl_easy_setopt(easy, CURLOPT_BUFFERSIZE, bufferSize);
+    curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT, options.timeoutSec > 0 ? options.timeoutSec : 0);
+    // Match prior behavior: timeout means connect/idle timeout, not full-transfer cap.
+    curl_easy_setopt(easy, CURLOPT_TIMEOUT, 0L);
+    curl_easy_setopt(easy, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    curl_easy_setopt(easy, CURLOPT_LOW_SPEED_TIME, options.timeoutSec > 0 ? options.timeoutSec : 0);
+    const bool keepAlive = options.keepAlive || options.pool;
+    curl_easy_setopt(easy, CURLOPT_FORBID_REUSE, keepAlive ? 0L : 1L);
+    // A retry after failed h2c must not land on the connection that just failed it.
+    curl_easy_setopt(easy, CURLOPT_FRESH_CONNECT, (!keepAlive || t.h2Retried) ? 1L : 0L);
+
+    curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, curlHeaderCallback);
+    curl_easy_setopt(easy, CURLOPT_HEADERDATA, &t);
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, curlWriteCallback);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, &t);
+    // Cancellation is polled by the I/O loop, so no progress callback is needed.
+    curl_easy_setopt(easy, CURLOPT_NOPROGRESS, 1L);
+
+    for (const auto& kv : t.req.headers) {
+        t.reqHeaders = curl_slist_append(t.reqHeaders, (kv.first + ": " + kv.second).c_str());
+    }
+    // Decoded by us, not libcurl, so that maxBodyBytes and the byte counters see both sizes.
+    if (options.acceptCompressed && !t.streaming) {
+        t.reqHeaders = curl_slist_append(t.reqHeaders, "Accept-Encoding: gzip, deflate");
+    }
+    if (t.reqHeaders) curl_easy_setopt(easy, CURLOPT_HTTPHEADER, t.reqHeaders);
+
+    if (isHeadMethod(t.req.method)) {
+        curl_easy_setopt(easy, CURLOPT_NOBODY, 1L);
+        curl_easy_setopt(easy, CURLOPT_CUSTOMREQUEST, "HEAD");
+    } else if (t.req.method == "GET") {
+        curl_easy_setopt(easy, CURLOPT_HTTPGET, 1L);
+    } else {
+        curl_easy_setopt(easy, CURLOPT_CUSTOMREQUEST, t.req.method.c_str());
+    }
+    return true;
+}
+
+// Reuse accounting for pooled requests that reached the server (a response arrived).
+void notePooledRequest(CURL* easy, const HttpRequestOptions& options) {
+    if (!options.pool) return;
+    long code = 0;
+    if (curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &code) != CURLE_OK || code <= 0) return;
+    long connects = 0;
+    curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS, &connects);
+    // APPCONNECT covers the TLS handshake too; it stays 0 on plain HTTP.
+    curl_off_t connectUs = 0;
+    curl_easy_getinfo(easy, CURLINFO_APPCONNECT_TIME_T, &connectUs);
+    if (connectUs <= 0) curl_easy_getinfo(easy, CURLINFO_CONNECT_TIME_T, &connectUs);
+    options.pool->noteRequest(connects > 0 ? static_cast<uint64_t>(connects) : 0,
+                              connects > 0 && connectUs > 0 ? static_cast<uint64_t>(connectUs / 1000) : 0);
+}
+
+// Shared-cache accounting for every request that reached the server.
+void noteCacheUse(CURL* easy, HttpEngineStats& stats) {
+    long code = 0;
+    if (curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &code) != CURLE_OK || code <= 0) return;
+    long connects = 0;
+    curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS, &connects);
+    if (connects <= 0) {
+        stats.connReused.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    stats.connOpened.fetch_add(static_cast<uint64_t>(connects), std::memory_order_relaxed);
+    curl_off_t lookupUs = 0;
+    curl_easy_getinfo(easy, CURLINFO_NAMELOOKUP_TIME_T, &lookupUs);
+    (lookupUs < kDnsCachedUs ? stats.dnsCached : stats.dnsResolved).fetch_add(1, std::memory_order_relaxed);
+    curl_off_t connectUs = 0;
+    curl_off_t appConnectUs = 0;
+    curl_easy_getinfo(easy, CURLINFO_CONNECT_TIME_T, &connectUs);
+    curl_easy_getinfo(easy, CURLINFO_APPCONNECT_TIME_T, &appConnectUs);
+    if (appConnectUs > 0) {
+        stats.tlsHandshakes.fetch_add(1, std::memory_order_relaxed);
+        if (appConnectUs > connectUs) {
+            stats.tlsHandshakeMs.fetch_add(static_cast<uint64_t>((appConnectUs - connectUs) / 1000),
+                                           std::memory_order_relaxed);
+        }
+    }
+}
+
+std::string curlFailure(CURLcode rc) {
+    if (rc == CURLE_OPERATION_TIMEDOUT) return "Recv timed out";
+    return std::string("CURL failed: ") + curl_easy_strerror(rc);
+}
+
+// The error text the blocking calls have always reported, from the transfer's flags and rc.
+void buildResult(HttpEngine::Transfer& t, CURLcode rc) {
+    HttpResult& r = t.result;
+    const HttpRequestOptions& options = t.req.options;
+    if (t.cancelled || (rc != CURLE_OK && isCancelled(options))) {
+        t.cancelled = true;
+        r.err = "Cancelled";
+        return;
+    }
+    if (!t.streaming) {
+        if (rc != CURLE_OK) {
+            if (t.sizeExceeded) {
+                r.err = "HTTP body exceeds configured max size";
+            } else if (!t.decodeErr.empty()) {
+                r.err = t.decodeErr;
+            } else {
+                r.err = curlFailure(rc);
+            }
+            return;
+        }
+        if (!parseTransferHeaders(t, r.parsed, r.err)) return;
+        if (t.decoder) {
+            if (!t.decoder->finish(r.err)) return;
+            t.stats->decodedResponses.fetch_add(1, std::memory_order_relaxed);
+            t.stats->decodedWireBytes.fetch_add(r.wireBytes, std::memory_order_relaxed);
+            t.stats->decodedBodyBytes.fetch_add(r.body.size(), std::memory_order_relaxed);
+        }
+        if (!options.decodeChunked && r.parsed.chunked) {
+            r.err = "Chunked transfer not supported";
+            return;
+        }
+        if (options.maxBodyBytes > 0 && r.body.size() > options.maxBodyBytes) {
+            r.err = "HTTP body exceeds configured max size";
+            return;
+        }
+        if (isHeadMethod(t.req.method) || isNoBodyStatus(r.parsed.statusCode)) r.body.clear();
+        r.ok = true;
+        return;
+    }
+
+    if (!t.headersParsed) {
+        if (!parseTransferHeaders(t, r.parsed, r.err)) {
+            if (rc != CURLE_OK) r.err = std::string("CURL failed: ") + curl_easy_strerror(rc);
+            return;
+        }
+        t.headersParsed = true;
+        if (t.req.bodyQueue) t.req.bodyQueue->setHeaders(r.parsed);
+    }
+    if (rc != CURLE_OK) {
+        if (t.sinkAborted) {
+            r.err = "Sink aborted";
+        } else if (t.sizeExceeded) {
+            r.err = "HTTP body exceeds configured max size";
+        } else if (t.chunkedRejected) {
+            r.err = "Chunked encoding not supported for streaming downloads";
+        } else if (t.parseFailed) {
+            r.err = t.parseErr;
+        } else {
+            r.err = curlFailure(rc);
+        }
+        return;
+    }
+    if (t.chunkedRejected || (r.parsed.chunked && !options.decodeChunked)) {
+        r.err = "Chunked encoding not supported for streaming downloads";
+        return;
+    }
+    if (options.maxBodyBytes > 0 && r.bodyBytes > options.maxBodyBytes) {
+        r.err = "HTTP body exceeds configured max size";
+        return;
+    }
+    if (!(isHeadMethod(t.req.method) || isNoBodyStatus(r.parsed.statusCode)) && r.parsed.hasContentLength &&
+        r.bodyBytes < r.parsed.contentLength) {
+        r.err = "Short read";
+        return;
+    }
+    r.ok = true;
+}
+
+} // namespace
+
+bool HttpEngine::ensureStarted(std::string& err) {
+    if (stopping_ || stopped_) {
+        err = "HTTP engine stopped";
+        return false;
+    }
+    if (started_) return true;
+    if (!ensureCurlGlobalInit(err)) return false;
+    CURLM* multi = curl_multi_init();
+    if (!multi) {
+        err = "curl_multi_init failed";
+        return false;
+    }
+    curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, kMaxCachedConnections);
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    multi_ = multi;
+    // Without the share every handle keeps its own DNS cache and TLS sessions; still usable.
+    share_ = std::make_unique<Share>();
+    share_->stats = &stats_;
+    share_->handle = curl_share_init();
+    if (share_->handle) {
+        curl_share_setopt(share_->handle, CURLSHOPT_LOCKFUNC, shareLock);
+        curl_share_setopt(share_->handle, CURLSHOPT_UNLOCKFUNC, shareUnlock);
+        curl_share_setopt(share_->handle, CURLSHOPT_USERDATA, share_.get());
+        curl_share_setopt(share_->handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share_->handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+    started_ = true;
+    thread_ = std::thread([this]() { run(); });
+    return true;
+}
+
+void* HttpEngine::takeEasyHandle(Transfer& t, std::string& err) {
+    const HttpRequestOptions& options = t.req.options;
+    CURL* easy = nullptr;
+    if (options.pool) {
+        easy = static_cast<CURL*>(options.pool->acquire(t.origin));
+    } else if (options.keepAlive && !idleEasy_.empty()) {
+        easy = static_cast<CURL*>(idleEasy_.back());
+        idleEasy_.pop_back();
+    }
+    if (easy) {
+        curl_easy_reset(easy);
+    } else {
+        easy = curl_easy_init();
+    }
+    if (!easy) err = "curl_easy_init failed";
+    return easy;
+}
+
+void HttpEngine::releaseEasyHandle(Transfer& t) {
+    if (t.reqHeaders) {
+        curl_slist_free_all(t.reqHeaders);
+        t.reqHeaders = nullptr;
+    }
+    if (!t.easy) return;
+    // Parked handles must not pin the share (curl_share_cleanup refuses while one is attached).
+    curl_easy_setopt(t.easy, CURLOPT_SHARE, static_cast<CURLSH*>(nullptr));
+    const HttpRequestOptions& options = t.req.options;
+    if (options.pool) {
+        options.pool->release(t.origin, t.easy);
+    } else if (options.keepAlive && idleEasy_.size() < kMaxIdleEasy) {
+        idleEasy_.push_back(t.easy);
+    } else {
+        curl_easy_cleanup(t.easy);
+    }
+    t.easy = nullptr;
+}
+
+void HttpEngine::startTransfer(std::unique_ptr<Transfer> transfer) {
+    Transfer& t = *transfer;
+    t.version = Transfer::Version::Http1;
+    t.pipeWait = false;
+    if (http2_.load(std::memory_order_relaxed) && !t.streaming) {
+        if (t.origin.rfind("https://", 0) == 0) {
+            t.version = Transfer::Version::Http2Tls;
+            t.pipeWait = true;
+        } else if (!t.h2Retried && h1Origins_.find(t.origin) == h1Origins_.end()) {
+            // Until the server has answered over h2c, a burst opens a connection each: requests
+            // parked behind a connection whose preface fails do not survive the retry.
+            t.version = Transfer::Version::Http2Prior;
+            t.pipeWait = h2Origins_.find(t.origin) != h2Origins_.end();
+        }
+    }
+    std::string err;
+    t.easy = static_cast<CURL*>(takeEasyHandle(t, err));
+    if (!t.easy || !setupCurlRequest(t, share_ ? share_->handle : nullptr, err)) {
+        releaseEasyHandle(t);
+        failTransfer(std::move(transfer), err);
+        return;
+    }
+    if (curl_multi_add_handle(static_cast<CURLM*>(multi_), t.easy) != CURLM_OK) {
+        releaseEasyHandle(t);
+        failTransfer(std::move(transfer), "curl_multi_add_handle failed");
+        return;
+    }
+    if (t.req.bodyQueue) {
+        const uint64_t id = t.id;
+        t.req.bodyQueue->setOnResume([this, id]() { post(Command{Command::Kind::Resume, id, nullptr}); });
+    }
+    transfers_.emplace(t.id, std::move(transfer));
+    const uint64_t active = stats_.active.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (active > stats_.peakActive.load(std::memory_order_relaxed)) {
+        stats_.peakActive.store(active, std::memory_order_relaxed);
+    }
+}
+
+void HttpEngine::finishTransfer(uint64_t id, int curlCode) {
+    auto it = transfers_.find(id);
+    if (it == transfers_.end()) return;
+    std::unique_ptr<Transfer> transfer = std::move(it->second);
+    transfers_.erase(it);
+    stats_.active.fetch_sub(1, std::memory_order_relaxed);
+    Transfer& t = *transfer;
+    if (t.req.bodyQueue) t.req.bodyQueue->setOnResume(nullptr);
+    curl_multi_remove_handle(static_cast<CURLM*>(multi_), t.easy);
+    notePooledRequest(t.easy, t.req.options);
+    noteCacheUse(t.easy, stats_);
+    if (t.version != Transfer::Version::Http1) {
+        long code = 0;
+        long version = 0;
+        curl_easy_getinfo(t.easy, CURLINFO_RESPONSE_CODE, &code);
+        curl_easy_getinfo(t.easy, CURLINFO_HTTP_VERSION, &version);
+        if (code > 0) {
+            if (version == CURL_HTTP_VERSION_2_0) {
+                stats_.http2Requests.fetch_add(1, std::memory_order_relaxed);
+                if (t.version == Transfer::Version::Http2Prior) h2Origins_.insert(t.origin);
+            } else {
+                stats_.http2Fallbacks.fetch_add(1, std::memory_order_relaxed);
+            }
+        } else if (t.version == Transfer::Version::Http2Prior && curlCode != CURLE_OK && !t.cancelled &&
+                   !t.call->cancelled() && !isCancelled(t.req.options)) {
+            // No response over h2c. Retry this request once on HTTP/1.1 (buffered requests have
+            // handed nothing to the caller yet); stop offering h2c to a server that never spoke it.
+            if (h2Origins_.find(t.origin) == h2Origins_.end()) h1Origins_.insert(t.origin);
+            stats_.http2Fallbacks.fetch_add(1, std::memory_order_relaxed);
+            // The handle keeps HTTP/2 stream state through curl_easy_reset; retry on a new one.
+            curl_easy_cleanup(t.easy);
+            t.easy = nullptr;
+            releaseEasyHandle(t);
+            t.resetResponse();
+            t.h2Retried = true;
+            startTransfer(std::move(transfer));
+            return;
+        }
+    }
+    buildResult(t, static_cast<CURLcode>(curlCode));
+    releaseEasyHandle(t);
+    complete(t, t.result);
+}
+
+void HttpEngine::run() {
+    ioThreadId_.store(std::this_thread::get_id(), std::memory_order_release);
+    CURLM* multi = static_cast<CURLM*>(multi_);
+    std::vector<Command> batch;
+    std::vector<uint64_t> ending;
+    for (;;) {
+        bool stopping = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (transfers_.empty()) cv_.wait(lock, [&]() { return !commands_.empty() || stopping_; });
+            batch.assign(std::make_move_iterator(commands_.begin()), std::make_move_iterator(commands_.end()));
+            commands_.clear();
+            stopping = stopping_;
+        }
+        for (Command& cmd : batch) {
+            if (cmd.kind == Command::Kind::Start) {
+                if (stopping) {
+                    cmd.transfer->cancelled = true;
+                    failTransfer(std::move(cmd.transfer), "Cancelled");
+                } else {
+                    startTransfer(std::move(cmd.transfer));
+                }
+            } else {
+                auto it = transfers_.find(cmd.id);
+                // Resuming may run the write callback right here, which may pause again.
+                if (it != transfers_.end()) curl_easy_pause(it->second->easy, CURLPAUSE_CONT);
+            }
+        }
+        batch.clear();
+
+        ending.clear();
+        for (const auto& kv : transfers_) {
+            Transfer& t = *kv.second;
+            if (stopping || t.call->cancelled() || isCancelled(t.req.options)) {
+                t.cancelled = true;
+                ending.push_back(kv.first);
+            }
+        }
+        for (uint64_t id : ending) finishTransfer(id, CURLE_ABORTED_BY_CALLBACK);
+        if (stopping) break;
+        if (transfers_.empty()) continue;
+
+        int running = 0;
+        curl_multi_perform(multi, &running);
+        int left = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi, &left)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            char* priv = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &priv);
+            if (priv) finishTransfer(reinterpret_cast<Transfer*>(priv)->id, msg->data.result);
+        }
+        if (!transfers_.empty()) curl_multi_poll(multi, nullptr, 0, kPollMs, nullptr);
+    }
+    ioThreadId_.store(std::thread::id(), std::memory_order_release);
+}
+
+bool HttpEngine::http2Supported() {
+    const curl_version_info_data* info = curl_version_info(CURLVERSION_NOW);
+    return info && (info->features & CURL_VERSION_HTTP2) != 0;
+}
+
+#else
+
+bool HttpEngine::ensureStarted(std::string& err) {
+    err = "HTTP engine unavailable in UNIT_TEST";
+    return false;
+}
+
+bool HttpEngine::http2Supported() { return false; }
+
+#endif
+
+bool HttpEngine::setHttp2(bool enabled) {
+    const bool on = enabled && http2Supported();
+    http2_.store(on, std::memory_order_relaxed);
+    return on == enabled;
+}
+
+HttpEngine& httpEngine() {
+    static HttpEngine engine;
+    return engine;
+}
+
+void destroyHttpHandle(void* handle) {
+#ifndef UNIT_TEST
+    if (handle) curl_easy_cleanup(static_cast<CURL*>(handle));
+#else
+    (void)handle;
+#endif
+}
+
+void httpShutdown() {
+#ifndef UNIT_TEST
+    // Ends whatever is still in flight and frees the engine's handles; parked pool handles are
+    // closed by their pools.
+    httpEngine().shutdown();
+    std::lock_guard<std::mutex> lock(gCurlGlobalMutex);
+    if (gCurlGlobalCleaned) return;
+    if (gCurlGlobalInitOk) {
+        curl_global_cleanup();
+    }
+    gCurlGlobalCleaned = true;
+    gCurlGlobalInitOk = false;
+#endif
+}
+
+} // namespace romm
@@ -0,0 +1,97 @@
+#include "romm/http_single_flight.hpp"
+
+#include <cctype>
+#include <condition_variable>
+
+namespace romm {
+
+struct HttpSingleFlight::Flight {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done{false};
+    bool ok{false};
+    HttpTransaction tx;
+    std::string err;
+    uint64_t waiters{0}; // guarded by HttpSingleFlight::mutex_
+};
+
+std::string HttpSingleFlight::keyFor(const std::string& method,
+                                     const std::string& url,
+                                     const std::vector<std::pair<std::string, std::string>>& headers,
+                                     size_t maxBodyBytes) {
+    std::string key = method + " " + url + "\n" + std::to_string(maxBodyBytes);
+    for (const auto& kv : headers) {
+        std::string name = kv.first;
+        for (auto& c : name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        if (name != "authorization") continue;
+        key += "\n";
+        key += kv.second;
+    }
+    return key;
+}
+
+bool HttpSingleFlight::run(const std::string& key, const Fetch& fetch, HttpTransaction& out, std::string& err) {
+    std::shared_ptr<Flight> flight;
+    bool leader = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = flights_.find(key);
+        if (it == flights_.end()) {
+            flight = std::make_shared<Flight>();
+            flights_.emplace(key, flight);
+            leader = true;
+        } else {
+            flight = it->second;
+            const uint64_t waiters = ++flight->waiters;
+            if (waiters > stats_.peakWaiters.load(std::memory_order_relaxed)) {
+                stats_.peakWaiters.store(waiters, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    if (!leader) {
+        stats_.joined.fetch_add(1, std::memory_order_relaxed);
+        std::unique_lock<std::mutex> lock(flight->mutex);
+        flight->cv.wait(lock, [&] { return flight->done; });
+        out = flight->tx;
+        err = flight->err;
+        return flight->ok;
+    }
+
+    stats_.leaders.fetch_add(1, std::memory_order_relaxed);
+    HttpTransaction tx;
+    std::string fetchErr;
+    const bool ok = fetch(tx, fetchErr);
+    uint64_t waiters = 0;
+    {
+        // Leave the map first: from here on, a new caller starts a new request.
+        std::lock_guard<std::mutex> lock(mutex_);
+        flights_.erase(key);
+        waiters = flight->waiters;
+    }
+    if (waiters > 0) {
+        {
+            std::lock_guard<std::mutex> lock(flight->mutex);
+            flight->ok = ok;
+            flight->tx = tx;
+            flight->err = fetchErr;
+            flight->done = true;
+        }
+        flight->cv.notify_all();
+    }
+    out = std::move(tx);
+    err = std::move(fetchErr);
+    return ok;
+}
+
+size_t HttpSingleFlight::inFlight() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return flights_.size();
+}
+
+HttpSingleFlight& httpSingleFlight() {
+    static HttpSingleFlight flights;
+    return flights;
+}
+
+} // namespace romm
@@ -39,6 +39,9 @@ extern "C" void stbi_image_free(void *retval_from_stbi_load);
 #include "romm/job_manager.hpp"
 #include "romm/logger.hpp"
 #include "romm/http_common.hpp"
+#include "romm/http_cache.hpp"
+#include "romm/http_engine.hpp"
+#include "romm/http_single_flight.hpp"
 #include "romm/update.hpp"
 #include "romm/self_update.hpp"
 #include "romm/version.hpp"
@@ -50,7 +53,6 @@ extern "C" void stbi_image_free(void *retval_from_stbi_load);
 #include "romm/platform_prefs.hpp"
 #include "romm/queue_policy.hpp"
 #include "romm/queue_store.hpp"
-#include "romm/speed_test.hpp"
 
 using romm::Status;
 using romm::Config;
@@ -385,6 +387,20 @@ static std::string humanSize(uint64_t bytes) {
     return std::string(buf);
 }
 
+// "1h02m", "4m05s", "12s"; "--" while the rate is unknown.
+static std::string formatEta(int64_t secs) {
+    if (secs < 0) return "--";
+    char buf[32];
+    if (secs >= 3600) {
+        std::snprintf(buf, sizeof(buf), "%lldh%02lldm", (long long)(secs / 3600), (long long)((secs / 60) % 60));
+    } else if (secs >= 60) {
+        std::snprintf(buf, sizeof(buf), "%lldm%02llds", (long long)(secs / 60), (long long)(secs % 60));
+    } else {
+        std::snprintf(buf, sizeof(buf), "%llds", (long long)secs);
+    }
+    return std::string(buf);
+}
+
 static std::string normalizeSearchText(const std::string& in) {
     std::string out;
     out.reserve(in.size());
@@ -594,6 +610,9 @@ static void renderStatus(SDL_Renderer* renderer, const Status& status, const Con
         uint64_t totalDownloadedBytes{0};
         uint64_t currentDownloadSize{0};
         uint64_t currentDownloadedBytes{0};
+        uint64_t finalizeCopyDone{0};
+        uint64_t finalizeCopyTotal{0};
+        std::vector<std::shared_ptr<romm::FileProgress>> activeFiles;
         uint64_t failedHistoryCount{0};
         std::vector<romm::QueueItem> recentFailed;
         bool netBusy{false};
@@ -601,7 +620,21 @@ static void renderStatus(SDL_Renderer* renderer, const Status& status, const Con
         std::string netBusyWhat;
         std::string lastError;
         romm::ErrorInfo lastErrorInfo{};
-        double lastSpeedMBps{0.0};
+        romm::ThroughputSnapshot speed;
+        uint32_t writeQueueDepth{0};
+        uint32_t writeQueuePeak{0};
+        uint64_t writeStallCount{0};
+        uint64_t writeStallMs{0};
+        uint64_t connRequests{0};
+        uint64_t connReused{0};
+        uint64_t connOpened{0};
+        uint64_t connConnectMs{0};
+        uint64_t httpConnReused{0};
+        uint64_t httpConnOpened{0};
+        uint64_t httpDnsCached{0};
+        uint64_t httpDnsResolved{0};
+        uint64_t httpTlsHandshakes{0};
+        uint64_t httpTlsHandshakeMs{0};
         bool queueReorderActive{false};
         bool burnInMode{false};
         bool diagnosticsServerReachableKnown{false};
@@ -664,14 +697,33 @@ static void renderStatus(SDL_Renderer* renderer, const Status& status, const Con
         snap.currentDownloadFileCount = static_cast<int>(status.currentDownloadFileCount.load());
         snap.totalDownloadBytes = status.totalDownloadBytes.load();
         snap.totalDownloadedBytes = status.totalDownloadedBytes.load();
+        snap.finalizeCopyDone = status.finalizeCopyDone.load();
+        snap.finalizeCopyTotal = status.finalizeCopyTotal.load();
         snap.currentDownloadSize = status.currentDownloadSize.load();
         snap.currentDownloadedBytes = status.currentDownloadedBytes.load();
+        snap.activeFiles = status.activeFiles;
         snap.netBusy = status.netBusy.load();
         snap.netBusySinceMs = status.netBusySinceMs.load();
         snap.netBusyWhat = status.netBusyWhat;
         snap.lastError = status.lastError;
         snap.lastErrorInfo = status.lastErrorInfo;
-        snap.lastSpeedMBps = status.lastSpeedMBps;
+        snap.writeQueueDepth = status.writeQueueStats.depth.load();
+        snap.writeQueuePeak = status.writeQueueStats.peakDepth.load();
+        snap.writeStallCount = status.writeQueueStats.stallCount.load();
+        snap.writeStallMs = status.writeQueueStats.stallMs.load();
+        snap.connRequests = status.connectionStats.requests.load();
+        snap.connReused = status.connectionStats.reused.load();
+        snap.connOpened = status.connectionStats.opened.load();
+        snap.connConnectMs = status.connectionStats.connectMs.load();
+        {
+            const romm::HttpEngineStats& http = romm::httpEngine().stats();
+            snap.httpConnReused = http.connReused.load();
+            snap.httpConnOpened = http.connOpened.load();
+            snap.httpDnsCached = http.dnsCached.load();
+            snap.httpDnsResolved = http.dnsResolved.load();
+            snap.httpTlsHandshakes = http.tlsHandshakes.load();
+            snap.httpTlsHandshakeMs = http.tlsHandshakeMs.load();
+        }
         snap.queueReorderActive = status.queueReorderActive;
         snap.burnInMode = status.burnInMode;
         snap.diagnosticsServerReachableKnown = status.diagnosticsServerReachableKnown;
@@ -767,6 +819,8 @@ static void renderStatus(SDL_Renderer* renderer, const Status& status, const Con
         }
         std::reverse(snap.recentFailed.begin(), snap.recentFailed.end());
     }
+    // The meter is lock-free; read it outside the status lock.
+    snap.speed = status.throughput.snapshot();
     if (needRebuildQueueState) {
         std::unordered_map<std::string, romm::QueueState> tmp;
         tmp.reserve(rebuildQueueCopy.size() + rebuildHistCopy.size());
@@ -955,12 +1009,16 @@ static void renderStatus(SDL_Renderer* renderer, const Status& status, const Con
 
     // If we have a speed reading, prepend it to the right-hand status.
     std::vector<std::string> rightParts;
-    if (snap.lastSpeedMBps > 0.05) {
+    const double speedMBps = snap.speed.bytesPerSec / (1024.0 * 1024.0);
+    // Remaining time at the smoothed rate; empty when idle or nothing is left.
+    auto etaSuffix = [&](uint64_t remaining) -> std::string {
+        if (!snap.speed.active || remaining == 0) return std::string();
+        return "  ETA " + formatEta(romm::ThroughputMeter::etaSeconds(remaining, snap.speed.bytesPerSec));
+    };
+    if (speedMBps > 0.05) {
         std::ostringstream oss;
-        oss << "SPD:" << std::fixed << std::setprecision(1) << snap.lastSpeedMBps << " MB/s";
+        oss << "SPD:" << std::fixed << std::setprecision(1) << speedMBps << " MB/s";
         rightParts.push_back(oss.str());
-    } else if (snap.lastSpeedMBps < 0.0) {
-        rightParts.push_back(snap.lastSpeedMBps == -2.0 ? "SPD:err" : "SPD:...");
     }
     rightParts.push_back(sysInfo);
     std::string rightInfo;
@@ -1122,17 +1180,19 @@ static void renderStatus(SDL_Renderer* renderer, const Status& status, const Con
                 drawText(renderer, outline.x, outline.y + 50,
                          "Current  " + std::to_string(pctCurInt) + "% (" +
                          humanSize(curDone) + " / " +
-                         humanSize(curBytes) + ")", fg, 2);
+                         humanSize(curBytes) + ")" +
+                         etaSuffix(curBytes > curDone ? curBytes - curDone : 0), fg, 2);
             }
             drawText(renderer, outline.x, outline.y + 80,
                      "Overall  " + std::to_string(pctInt) + "% (" +
                      humanSize(totalDone) + " / " +
                      humanSize(totalBytes) + ")" +
-                     (snap.lastSpeedMBps > 0.1 ? ("  @" + [] (double mbps) {
+                     (speedMBps > 0.1 ? ("  @" + [] (double mbps) {
                         std::ostringstream oss;
                         oss << std::fixed << std::setprecision(1) << " " << mbps << " MB/s";
                         return oss.str();
-                     }(snap.lastSpeedMBps)) : std::string()),
+                     }(speedMBps)) : std::string()) +
+                     etaSuffix(totalBytes > totalDone ? totalBytes - totalDone : 0),
                      fg, 2);
             if (totalDone == 0) {
                 static const char* dots[] = {"", ".", "..", "..."};
@@ -1144,6 +1204,27 @@ static void renderStatus(SDL_Renderer* renderer, const Status& status, const Con
             if (snap.lastDownloadFailed) {
                 drawText(renderer, outline.x, outline.y + 110, "Failed: " + snap.lastDownloadError, {255,80,80,255}, 2);
             }
+            // Per-file lines for multi-file bundles (files may download concurrently).
+            if (snap.activeFiles.size() > 1) {
+                int fy = outline.y + 146;
+                size_t shown = 0;
+                for (const auto& fp : snap.activeFiles) {
+                    if (shown >= 5) break;
+                    const uint64_t fsize = fp->size.load();
+                    const uint64_t fdone = fp->downloaded.load();
+                    const bool fin = fp->finished.load();
+                    if (fin || fdone == 0) continue; // show in-flight files only
+                    int fpct = fsize > 0 ? static_cast<int>(std::min<uint64_t>(fdone * 100 / fsize, 100)) : 0;
+                    std::string fname = foldUtf8ToAscii(fp->name, true);
+                    if (fname.size() > 30) fname = fname.substr(0, 30) + "...";
+                    drawText(renderer, outline.x, fy,
+                             fname + "  " + std::to_string(fpct) + "% (" +
+                             humanSize(fdone) + " / " + humanSize(fsize) + ")",
+                             {200,220,255,255}, 2);
+                    fy += 26;
+                    shown++;
+                }
+            }
         }
     } else if (snap.view == Status::View::DOWNLOADING) {
         SDL_Color fg{255,255,255,255};
@@ -1436,6 +1517,7 @@ static void renderStatus(SDL_Renderer* renderer, const Status& status, const Con
                 }
             }
         }
+        bool finalizeShown = start > 0; // copy progress belongs to the head of the queue
         for (size_t i = 0; i < visible; ++i) {
             size_t idx = start + i;
             SDL_Rect r{ 64, 120 + static_cast<int>(i)*26, 1008, 22 };
@@ -1460,6 +1542,11 @@ static void renderStatus(SDL_Renderer* renderer, const Status& status, const Con
                     case romm::QueueState::Failed: stateStr = "failed"; break;
                     case romm::QueueState::Cancelled: stateStr = "cancelled"; break;
                 }
+                if (q.state == romm::QueueState::Finalizing && !finalizeShown && snap.finalizeCopyTotal > 0) {
+                    // Only the oldest finalizing entry can be copying (finalize runs in queue order).
+                    stateStr += " " + std::to_string(snap.finalizeCopyDone * 100 / snap.finalizeCopyTotal) + "%";
+                }
+                if (q.state == romm::QueueState::Finalizing) finalizeShown = true;
                 drawText(renderer, r.x + 680, r.y + 4, sz + " " + stateStr, fg, 2);
                 if ((q.state == romm::QueueState::Failed || q.state == romm::QueueState::Resumable || q.state == romm::QueueState::Cancelled) && !q.error.empty()) {
                     drawText(renderer, r.x + 10, r.y + 22, ellipsize(q.error, 58), SDL_Color{255,160,160,255}, 2);
@@ -1510,6 +1597,24 @@ static void renderStatus(SDL_Renderer* renderer, const Status& status, const Con
                  "Active: " + std::to_string(snap.queueCount) +
                  "  History: " + std::to_string(snap.historyCount) +
                  "  Downloading: " + std::string(snap.downloadWorkerRunning ? "yes" : "no"),
+                 sub, 2); y += 24;
+        drawText(renderer, box.x + 16, y,
+                 "SD writer: depth " + std::to_string(snap.writeQueueDepth) +
+                 " (peak " + std::to_string(snap.writeQueuePeak) + ")" +
+                 "  stalls " + std::to_string(snap.writeStallCount) +
+                 " / " + std::to_string(snap.writeStallMs) + "ms",
+                 sub, 2); y += 24;
+        drawText(renderer, box.x + 16, y,
+                 "Connections: " + std::to_string(snap.connReused) + "/" + std::to_string(snap.connRequests) +
+                 " reused  " + std::to_string(snap.connOpened) + " opened (" +
+                 std::to_string(snap.connConnectMs) + "ms connecting)",
+                 sub, 2); y += 24;
+        drawText(renderer, box.x + 16, y,
+                 "Shared cache: conn " + std::to_string(snap.httpConnReused) + "/" +
+                 std::to_string(snap.httpConnReused + snap.httpConnOpened) + " reused  DNS " +
+                 std::to_string(snap.httpDnsCached) + "/" +
+                 std::to_string(snap.httpDnsCached + snap.httpDnsResolved) + " cached  TLS " +
+                 std::to_string(snap.httpTlsHandshakes) + " (" + std::to_string(snap.httpTlsHandshakeMs) + "ms)",
                  sub, 2); y += 30;
 
         drawText(renderer, box.x + 16, y, "Last Error", fg, 2); y += 26;
@@ -1774,7 +1879,6 @@ int main(int argc, char** argv) {
     setvbuf(stdout, nullptr, _IONBF, 0);
     setvbuf(stderr, nullptr, _IONBF, 0);
     socketInitializeDefault();
-    std::thread speedTestThread;
 #if HAS_NXLINK
     int nxfd = nxlinkStdio();
     if (nxfd >= 0) {
@@ -2250,6 +2354,59 @@ int main(int argc, char** argv) {
             lines.push_back("Queue=" + std::to_string(status.downloadQueue.size()) +
                             " History=" + std::to_string(status.downloadHistory.size()) +
                             " WorkerRunning=" + std::string(status.downloadWorkerRunning.load() ? "yes" : "no"));
+            lines.push_back("WriteQueueDepth=" + std::to_string(status.writeQueueStats.depth.load()) +
+                            " Peak=" + std::to_string(status.writeQueueStats.peakDepth.load()) +
+                            " Stalls=" + std::to_string(status.writeQueueStats.stallCount.load()) +
+                            " StallMs=" + std::to_string(status.writeQueueStats.stallMs.load()) +
+                            " BytesWritten=" + std::to_string(status.writeQueueStats.bytesWritten.load()));
+            lines.push_back("ConnRequests=" + std::to_string(status.connectionStats.requests.load()) +
+                            " Reused=" + std::to_string(status.connectionStats.reused.load()) +
+                            " Opened=" + std::to_string(status.connectionStats.opened.load()) +
+                            " ConnectMs=" + std::to_string(status.connectionStats.connectMs.load()) +
+                            " Evicted=" + std::to_string(status.connectionStats.evicted.load()));
+            {
+                const romm::HttpEngineStats& http = romm::httpEngine().stats();
+                lines.push_back("HttpActive=" + std::to_string(http.active.load()) +
+                                " Peak=" + std::to_string(http.peakActive.load()) +
+                                " Submitted=" + std::to_string(http.submitted.load()) +
+                                " Failed=" + std::to_string(http.failed.load()) +
+                                " Cancelled=" + std::to_string(http.cancelled.load()) +
+                                " Pauses=" + std::to_string(http.pauses.load()));
+                lines.push_back("HttpConnReused=" + std::to_string(http.connReused.load()) +
+                                " Opened=" + std::to_string(http.connOpened.load()) +
+                                " DnsCached=" + std::to_string(http.dnsCached.load()) +
+                                " DnsResolved=" + std::to_string(http.dnsResolved.load()) +
+                                " TlsHandshakes=" + std::to_string(http.tlsHandshakes.load()) +
+                                " TlsMs=" + std::to_string(http.tlsHandshakeMs.load()) +
+                                " ShareLockWaits=" + std::to_string(http.shareLockWaits.load()));
+                lines.push_back(std::string("Http2=") + (romm::httpEngine().http2() ? "on" : "off") +
+                                " Http2Requests=" + std::to_string(http.http2Requests.load()) +
+                                " Http2Fallbacks=" + std::to_string(http.http2Fallbacks.load()));
+                lines.push_back("HttpDecoded=" + std::to_string(http.decodedResponses.load()) +
+                                " WireBytes=" + std::to_string(http.decodedWireBytes.load()) +
+                                " BodyBytes=" + std::to_string(http.decodedBodyBytes.load()));
+                const romm::HttpResponseCache& cache = romm::httpResponseCache();
+                const romm::HttpCacheStats& cs = cache.stats();
+                lines.push_back("HttpCacheEntries=" + std::to_string(cache.entries()) +
+                                " Bytes=" + std::to_string(cache.bytes()) +
+                                " Revalidations=" + std::to_string(cs.revalidations.load()) +
+                                " Hits=" + std::to_string(cs.hits.load()) +
+                                " HitBytes=" + std::to_string(cs.hitBytes.load()) +
+                                " Stores=" + std::to_string(cs.stores.load()) +
+                                " Evictions=" + std::to_string(cs.evictions.load()));
+                const romm::HttpSingleFlightStats& sf = romm::httpSingleFlight().stats();
+                lines.push_back("HttpCoalesced=" + std::to_string(sf.joined.load()) +
+                                " Leaders=" + std::to_string(sf.leaders.load()) +
+                                " PeakWaiters=" + std::to_string(sf.peakWaiters.load()));
+            }
+            {
+                const romm::ThroughputSnapshot speed = status.throughput.snapshot();
+                lines.push_back("RateBps=" + std::to_string((uint64_t)speed.bytesPerSec) +
+                                " AvgBps=" + std::to_string((uint64_t)speed.averageBytesPerSec) +
+                                " PeakBps=" + std::to_string(speed.peakBytesPerSec) +
+                                " MinBps=" + std::to_string(speed.minBytesPerSec) +
+                                " ReceivedBytes=" + std::to_string(speed.totalBytes));
+            }
             lines.push_back("ServerReachableKnown=" + std::string(status.diagnosticsServerReachableKnown ? "yes" : "no") +
                             " Reachable=" + std::string(status.diagnosticsServerReachable ? "yes" : "no") +
                             " ProbeInFlight=" + std::string(status.diagnosticsProbeInFlight ? "yes" : "no"));
@@ -2390,6 +2547,10 @@ int main(int argc, char** argv) {
         opt.keepAlive = true;
         opt.decodeChunked = true;
         opt.maxBodyBytes = 2 * 1024 * 1024;
+        opt.acceptCompressed = true;
+        // GitHub does not count a 304 against the unauthenticated rate limit.
+        opt.cache = &romm::httpResponseCache();
+        opt.singleFlight = &romm::httpSingleFlight();
 
         std::vector<std::pair<std::string, std::string>> headers;
         headers.emplace_back("User-Agent", "romm-switch-client");
@@ -2645,6 +2806,22 @@ int main(int argc, char** argv) {
         romm::logLine(" server_url=" + config.serverUrl);
         romm::logLine(" download_dir=" + config.downloadDir);
         romm::logLine(std::string(" fat32_safe=") + (config.fat32Safe ? "true" : "false"));
+        if (config.http2) {
+            romm::logLine(romm::httpEngine().setHttp2(true)
+                              ? " http2=true"
+                              : " http2=true ignored: libcurl was built without HTTP/2");
+        }
+        {
+            const int cacheMb = std::max(0, config.httpCacheMb);
+            std::string cacheErr;
+            if (!romm::httpResponseCache().open(romm::kHttpCacheDir, static_cast<uint64_t>(cacheMb) * 1024 * 1024,
+                                                cacheErr)) {
+                romm::logLine(" http_cache disabled: " + cacheErr);
+            } else {
+                romm::logLine(" http_cache_mb=" + std::to_string(cacheMb) + " entries=" +
+                              std::to_string(romm::httpResponseCache().entries()));
+            }
+        }
 
         // Updater storage lives under the download cache root to keep /switch tidy.
         // We also keep a fixed pending pointer file under /switch/romm_switch_client/.
@@ -2687,24 +2864,7 @@ int main(int argc, char** argv) {
         }
         romm::ensureDirectory(config.downloadDir);
         if (!config.speedTestUrl.empty()) {
-            // Kick off a background speed test (20MB range) without blocking UI; join on exit.
-            const Config cfgCopy = config;
-            {
-                std::lock_guard<std::mutex> lock(status.mutex);
-                status.lastSpeedMBps = -1.0; // pending
-            }
-            speedTestThread = std::thread([cfgCopy, &status]() {
-                std::string err;
-                constexpr uint64_t kProbeBytes = 40ULL * 1024ULL * 1024ULL;
-                if (romm::runSpeedTest(cfgCopy, status, kProbeBytes, err)) {
-                    std::lock_guard<std::mutex> lock(status.mutex);
-                    romm::logLine("Startup speed test: " + std::to_string(status.lastSpeedMBps) + " MB/s");
-                } else {
-                    std::lock_guard<std::mutex> lock(status.mutex);
-                    status.lastSpeedMBps = -2.0; // failed
-                    romm::logLine("Startup speed test failed: " + err);
-                }
-            });
+            romm::logLine("speed_test_url is ignored; downloads tune themselves from live throughput");
         }
         std::string histErr;
         if (!romm::loadLocalManifests(status, config, histErr) && !histErr.empty()) {
@@ -3083,6 +3243,7 @@ int main(int argc, char** argv) {
                 }
             }
             for (const auto& q : status.downloadQueue) {
+                if (q.state == romm::QueueState::Finalizing) continue; // already downloaded
                 remaining += q.bundle.totalSize();
             }
             uint64_t already = status.totalDownloadedBytes.load();
@@ -3785,9 +3946,6 @@ exit_app:
     romm::logLine("Exiting main loop. running=" + std::to_string(running));
     romm::stopDownloadWorker();
     persistQueueState();
-    if (speedTestThread.joinable()) {
-        speedTestThread.join();
-    }
     romFetchJobs.stop();
     remoteSearchJobs.stop();
     diagProbeJobs.stop();
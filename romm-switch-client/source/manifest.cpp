@@ -43,12 +43,43 @@ std::string manifestToJson(const Manifest& m) {
         if (p.completed) {
             oss << ",\"done\":true";
         }
+        if (p.preallocated) {
+            oss << ",\"preallocated\":true,\"written\":" << static_cast<unsigned long long>(p.written);
+        }
+        if (!p.hashState.empty()) {
+            oss << ",\"hash_offset\":" << static_cast<unsigned long long>(p.hashOffset)
+                << ",\"hash_state\":\"" << escapeJson(p.hashState) << "\"";
+        }
+        if (!p.checkState.empty()) {
+            oss << ",\"check_offset\":" << static_cast<unsigned long long>(p.checkOffset)
+                << ",\"check_state\":\"" << escapeJson(p.checkState) << "\"";
+        }
+        if (m.hasRangeMap) {
+            oss << ",\"ranges\":[";
+            const auto& ranges = p.ranges.ranges();
+            for (size_t r = 0; r < ranges.size(); ++r) {
+                if (r > 0) oss << ",";
+                oss << "[" << static_cast<unsigned long long>(ranges[r].start) << ","
+                    << static_cast<unsigned long long>(ranges[r].end) << "]";
+            }
+            oss << "]";
+        }
         oss << "}";
     }
     oss << "]";
+    if (m.hasDurableOffset) {
+        oss << ",\"durable_offset\":" << static_cast<unsigned long long>(m.durableOffset);
+    }
     if (!m.failureReason.empty()) {
         oss << ",\"failure_reason\":\"" << escapeJson(m.failureReason) << "\"";
     }
+    if (!m.checksums.crc32.empty()) oss << ",\"crc_hash\":\"" << escapeJson(m.checksums.crc32) << "\"";
+    if (!m.checksums.md5.empty()) oss << ",\"md5_hash\":\"" << escapeJson(m.checksums.md5) << "\"";
+    if (!m.checksums.sha1.empty()) oss << ",\"sha1_hash\":\"" << escapeJson(m.checksums.sha1) << "\"";
+    if (!m.crcState.empty()) {
+        oss << ",\"crc_offset\":" << static_cast<unsigned long long>(m.crcOffset)
+            << ",\"crc_state\":\"" << escapeJson(m.crcState) << "\"";
+    }
     oss << "}";
     return oss.str();
 }
@@ -79,6 +110,15 @@ bool manifestFromJson(const std::string& json, Manifest& out, std::string& err)
     getNum("total_size", out.totalSize);
     getNum("part_size", out.partSize);
     getStr("failure_reason", out.failureReason);
+    getStr("crc_hash", out.checksums.crc32);
+    getStr("md5_hash", out.checksums.md5);
+    getStr("sha1_hash", out.checksums.sha1);
+    getNum("crc_offset", out.crcOffset);
+    getStr("crc_state", out.crcState);
+    if (auto it = obj.find("durable_offset"); it != obj.end() && it->second.type == mini::Value::Type::Number) {
+        out.hasDurableOffset = true;
+        out.durableOffset = static_cast<uint64_t>(it->second.number);
+    }
 
     auto pit = obj.find("parts");
     if (pit != obj.end() && pit->second.type == mini::Value::Type::Array) {
@@ -94,6 +134,30 @@ bool manifestFromJson(const std::string& json, Manifest& out, std::string& err)
                 p.sha256 = it->second.str;
             if (auto it = o.find("done"); it != o.end() && it->second.type == mini::Value::Type::Bool)
                 p.completed = it->second.boolean;
+            if (auto it = o.find("preallocated"); it != o.end() && it->second.type == mini::Value::Type::Bool)
+                p.preallocated = it->second.boolean;
+            if (auto it = o.find("written"); it != o.end() && it->second.type == mini::Value::Type::Number)
+                p.written = static_cast<uint64_t>(it->second.number);
+            if (auto it = o.find("hash_offset"); it != o.end() && it->second.type == mini::Value::Type::Number)
+                p.hashOffset = static_cast<uint64_t>(it->second.number);
+            if (auto it = o.find("hash_state"); it != o.end() && it->second.type == mini::Value::Type::String)
+                p.hashState = it->second.str;
+            if (auto it = o.find("check_offset"); it != o.end() && it->second.type == mini::Value::Type::Number)
+                p.checkOffset = static_cast<uint64_t>(it->second.number);
+            if (auto it = o.find("check_state"); it != o.end() && it->second.type == mini::Value::Type::String)
+                p.checkState = it->second.str;
+            if (auto it = o.find("ranges"); it != o.end() && it->second.type == mini::Value::Type::Array) {
+                out.hasRangeMap = true;
+                for (const auto& r : it->second.array) {
+                    if (r.type != mini::Value::Type::Array || r.array.size() != 2 ||
+                        r.array[0].type != mini::Value::Type::Number || r.array[1].type != mini::Value::Type::Number) {
+                        continue;
+                    }
+                    const uint64_t start = static_cast<uint64_t>(r.array[0].number);
+                    const uint64_t end = std::min<uint64_t>(static_cast<uint64_t>(r.array[1].number), p.size);
+                    p.ranges.add(start, end);
+                }
+            }
             out.parts.push_back(p);
         }
     }
@@ -106,15 +170,80 @@ bool manifestFromJson(const std::string& json, Manifest& out, std::string& err)
     return true;
 }
 
+void recordDurableRanges(Manifest& m, const RangeSet& have) {
+    m.hasRangeMap = true;
+    for (auto& part : m.parts) {
+        const uint64_t partStart = static_cast<uint64_t>(part.index) * m.partSize;
+        part.ranges.clear();
+        const RangeSet inPart = have.clipped(partStart, partStart + part.size);
+        for (const auto& r : inPart.ranges()) {
+            part.ranges.add(r.start - partStart, r.end - partStart);
+        }
+    }
+    m.hasDurableOffset = true;
+    m.durableOffset = have.runEnd(0);
+}
+
+namespace {
+
+// Range-map resume: a part keeps the recorded ranges that its file still holds.
+ResumePlan planSparseResume(const Manifest& m, const std::vector<std::pair<int, uint64_t>>& observedParts) {
+    ResumePlan plan;
+    std::unordered_map<int, uint64_t> observed;
+    observed.reserve(observedParts.size());
+    for (const auto& pr : observedParts) observed[pr.first] = pr.second;
+
+    std::vector<ManifestPart> parts = m.parts;
+    std::sort(parts.begin(), parts.end(),
+              [](const ManifestPart& a, const ManifestPart& b) { return a.index < b.index; });
+    for (const auto& p : parts) {
+        auto obsIt = observed.find(p.index);
+        if (obsIt == observed.end()) continue;
+        const uint64_t onDisk = std::min(obsIt->second, p.size);
+        const RangeSet kept = p.ranges.clipped(0, onDisk);
+        observed.erase(obsIt);
+        if (kept.empty()) {
+            // Nothing recorded as durable survives in this file; don't build on it.
+            plan.invalidParts.push_back(p.index);
+            continue;
+        }
+        const uint64_t partStart = static_cast<uint64_t>(p.index) * m.partSize;
+        for (const auto& r : kept.ranges()) plan.have.add(partStart + r.start, partStart + r.end);
+        if (kept.contains(0, p.size)) {
+            plan.validParts.push_back(p.index);
+        } else if (plan.partialIndex < 0) {
+            plan.partialIndex = p.index;
+            plan.partialBytes = kept.covered();
+        }
+    }
+    // Files the manifest doesn't expect.
+    for (const auto& kv : observed) plan.invalidParts.push_back(kv.first);
+
+    plan.bytesHave = plan.have.covered();
+    plan.bytesNeed = (m.totalSize > plan.bytesHave) ? (m.totalSize - plan.bytesHave) : 0;
+    plan.missing = plan.have.missing(0, m.totalSize);
+    return plan;
+}
+
+} // namespace
+
 ResumePlan planResume(const Manifest& m,
                       const std::vector<std::pair<int, uint64_t>>& observedParts) {
+    if (m.hasRangeMap) return planSparseResume(m, observedParts);
     ResumePlan plan;
 
     // Build quick lookups for expected and observed sizes.
     std::unordered_map<int, uint64_t> expected;
+    std::unordered_map<int, uint64_t> writtenCap; // preallocated parts: only `written` bytes are data
+    std::unordered_map<int, uint64_t> durableCap; // bytes of each part below the durable offset
     expected.reserve(m.parts.size());
     for (const auto& p : m.parts) {
         expected[p.index] = p.size;
+        if (p.preallocated) writtenCap[p.index] = p.written;
+        if (m.hasDurableOffset) {
+            const uint64_t partStart = static_cast<uint64_t>(p.index) * m.partSize;
+            durableCap[p.index] = m.durableOffset > partStart ? m.durableOffset - partStart : 0;
+        }
     }
     std::unordered_map<int, uint64_t> observed;
     observed.reserve(observedParts.size());
@@ -133,6 +262,12 @@ ResumePlan planResume(const Manifest& m,
 
         uint64_t expectedSize = expIt->second;
         uint64_t haveSize = obsIt->second;
+        if (auto capIt = writtenCap.find(idx); capIt != writtenCap.end()) {
+            haveSize = std::min(haveSize, capIt->second);
+        }
+        if (auto capIt = durableCap.find(idx); capIt != durableCap.end()) {
+            haveSize = std::min(haveSize, capIt->second);
+        }
 
         if (haveSize == expectedSize) {
             plan.validParts.push_back(idx);
@@ -162,6 +297,8 @@ ResumePlan planResume(const Manifest& m,
     }
 
     plan.bytesNeed = (m.totalSize > plan.bytesHave) ? (m.totalSize - plan.bytesHave) : 0;
+    plan.have.add(0, std::min(plan.bytesHave, m.totalSize));
+    plan.missing = plan.have.missing(0, m.totalSize);
     return plan;
 }
 
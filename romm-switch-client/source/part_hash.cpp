@@ -0,0 +1,188 @@
+#include "romm/part_hash.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace romm {
+
+namespace {
+constexpr size_t kVerifyReadBytes = 64 * 1024;
+
+int hexNibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+} // namespace
+
+PartHasher::PartHasher() {
+    anchors_[0] = sha_.state();
+    anchors_[1] = sha_.state();
+}
+
+PartHasher::PartHasher(const Sha256::State& seed) : sha_(seed) {
+    anchors_[0] = seed;
+    anchors_[1] = seed;
+}
+
+void PartHasher::update(const char* data, size_t len) {
+    while (len > 0) {
+        const uint64_t toBoundary = kHashCheckWindowBytes - offset() % kHashCheckWindowBytes;
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(len, toBoundary));
+        sha_.update(data, n);
+        data += n;
+        len -= n;
+        if (offset() % kHashCheckWindowBytes == 0) {
+            anchors_[0] = anchors_[1];
+            anchors_[1] = sha_.state();
+        }
+    }
+}
+
+const Sha256::State& PartHasher::checkAnchor() const {
+    // Keep the window non-empty when the prefix ends exactly on a boundary.
+    return anchors_[1].bytes < offset() ? anchors_[1] : anchors_[0];
+}
+
+void PartHasher::record(ManifestPart& part) const {
+    if (part.size > 0 && offset() == part.size) {
+        part.sha256 = Sha256::toHex(sha_.digest());
+        part.hashOffset = 0;
+        part.hashState.clear();
+    } else {
+        part.sha256.clear();
+        part.hashOffset = offset();
+        part.hashState = encodeHashState(sha_.state());
+    }
+    const Sha256::State& anchor = checkAnchor();
+    part.checkOffset = anchor.bytes;
+    part.checkState = encodeHashState(anchor);
+}
+
+bool PartHasher::fromRecord(const ManifestPart& part, uint64_t partOffset, PartHasher& out) {
+    if (partOffset == 0) {
+        out = PartHasher();
+        return true;
+    }
+    if (part.hashState.empty() || part.hashOffset != partOffset) return false;
+    Sha256::State seed;
+    if (!decodeHashState(part.hashState, part.hashOffset, seed)) return false;
+    out = PartHasher(seed);
+    return true;
+}
+
+std::string encodeHashState(const Sha256::State& s) {
+    static const char* kHex = "0123456789abcdef";
+    std::string out;
+    out.reserve(64 + 2 * 64);
+    for (uint32_t w : s.h) {
+        for (int shift = 28; shift >= 0; shift -= 4) out.push_back(kHex[(w >> shift) & 0x0F]);
+    }
+    const size_t tail = static_cast<size_t>(s.bytes % 64);
+    for (size_t i = 0; i < tail; ++i) {
+        out.push_back(kHex[s.tail[i] >> 4]);
+        out.push_back(kHex[s.tail[i] & 0x0F]);
+    }
+    return out;
+}
+
+bool decodeHashState(const std::string& hex, uint64_t bytes, Sha256::State& out) {
+    const size_t tail = static_cast<size_t>(bytes % 64);
+    if (hex.size() != 64 + 2 * tail) return false;
+    Sha256::State s;
+    s.bytes = bytes;
+    for (size_t i = 0; i < hex.size(); ++i) {
+        if (hexNibble(hex[i]) < 0) return false;
+    }
+    for (size_t w = 0; w < 8; ++w) {
+        uint32_t v = 0;
+        for (size_t i = 0; i < 8; ++i) v = (v << 4) | static_cast<uint32_t>(hexNibble(hex[w * 8 + i]));
+        s.h[w] = v;
+    }
+    for (size_t i = 0; i < tail; ++i) {
+        s.tail[i] = static_cast<uint8_t>((hexNibble(hex[64 + 2 * i]) << 4) | hexNibble(hex[64 + 2 * i + 1]));
+    }
+    out = s;
+    return true;
+}
+
+void clearPartHash(ManifestPart& part) {
+    part.sha256.clear();
+    part.hashOffset = 0;
+    part.hashState.clear();
+    part.checkOffset = 0;
+    part.checkState.clear();
+}
+
+void dropHashesBeyond(PartHashes& hashes, uint64_t partSize, uint64_t durableEnd) {
+    RangeSet durable;
+    durable.add(0, durableEnd);
+    dropHashesOutside(hashes, partSize, durable);
+}
+
+void dropHashesOutside(PartHashes& hashes, uint64_t partSize, const RangeSet& durable) {
+    for (auto it = hashes.begin(); it != hashes.end();) {
+        const uint64_t partStart = it->first * partSize;
+        if (!durable.contains(partStart, partStart + it->second.offset())) {
+            it = hashes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool verifyPartHash(const std::string& path, const ManifestPart& part, uint64_t observedSize, std::string& err) {
+    if (part.checkState.empty()) return true;
+    const bool complete = !part.sha256.empty();
+    uint64_t end = 0;
+    if (complete) {
+        if (observedSize != part.size) return true;
+        end = part.size;
+    } else {
+        if (part.hashState.empty() || observedSize < part.hashOffset) return true;
+        end = part.hashOffset;
+    }
+    Sha256::State anchor;
+    if (part.checkOffset > end || !decodeHashState(part.checkState, part.checkOffset, anchor)) return true;
+
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        err = "Open part failed";
+        return false;
+    }
+    bool readOk = std::fseek(f, static_cast<long>(part.checkOffset), SEEK_SET) == 0;
+    Sha256 sha(anchor);
+    std::vector<char> buf(kVerifyReadBytes);
+    uint64_t remaining = end - part.checkOffset;
+    while (readOk && remaining > 0) {
+        const size_t want = static_cast<size_t>(std::min<uint64_t>(remaining, buf.size()));
+        const size_t got = std::fread(buf.data(), 1, want, f);
+        if (got != want) readOk = false;
+        sha.update(buf.data(), got);
+        remaining -= got;
+    }
+    std::fclose(f);
+    if (!readOk) {
+        err = "Read failed";
+        return false;
+    }
+
+    if (complete) {
+        if (Sha256::toHex(sha.digest()) != part.sha256) {
+            err = "SHA-256 mismatch";
+            return false;
+        }
+        return true;
+    }
+    Sha256::State expected;
+    if (!decodeHashState(part.hashState, part.hashOffset, expected)) return true;
+    if (sha.state() != expected) {
+        err = "SHA-256 state mismatch";
+        return false;
+    }
+    return true;
+}
+
+} // namespace romm
@@ -0,0 +1,347 @@
+#include "romm/part_writer.hpp"
+#include "romm/logger.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace romm {
+
+namespace {
+bool parsePartFileIndex(const std::string& name, uint64_t& outIdx) {
+    if (name.size() <= 5 || name.compare(name.size() - 5, 5, ".part") != 0) return false;
+    std::string stem = name.substr(0, name.size() - 5);
+    if (stem.empty()) return false;
+    for (char c : stem) {
+        if (c < '0' || c > '9') return false;
+    }
+    outIdx = std::strtoull(stem.c_str(), nullptr, 10);
+    return true;
+}
+} // namespace
+
+std::string partFileName(uint64_t index) {
+    return (index < 10 ? "0" : "") + std::to_string(index) + ".part";
+}
+
+std::string partFilePath(const std::string& dir, uint64_t index) {
+    return dir + "/" + partFileName(index);
+}
+
+bool parseWriteBackend(const std::string& name, WriteBackend& out) {
+    if (name == "raw") {
+        out = WriteBackend::Raw;
+        return true;
+    }
+    out = WriteBackend::Stdio;
+    return name == "stdio";
+}
+
+const char* writeBackendName(WriteBackend backend) {
+    return backend == WriteBackend::Raw ? "raw" : "stdio";
+}
+
+PartWriter::PartWriter(std::string dir, uint64_t partSize, size_t ioBufferBytes, WriteBackend backend)
+    : dir_(std::move(dir)), partSize_(partSize), ioBufferBytes_(ioBufferBytes), backend_(backend) {
+    open_.reserve(maxOpenParts_);
+}
+
+PartWriter::~PartWriter() { close(); }
+
+bool PartWriter::closePart(OpenPart& p) {
+    bool ok = true;
+    if (p.file) {
+        ok = fclose(p.file) == 0;
+        p.file = nullptr;
+    }
+    if (p.fd >= 0) {
+        std::string err;
+        if (!flushStage(p, err)) {
+            ok = false;
+            logLine("Tail flush failed for part " + partFilePath(dir_, p.index));
+        }
+        ok = (::close(p.fd) == 0) && ok;
+        p.fd = -1;
+    }
+    return ok;
+}
+
+void PartWriter::close() {
+    for (auto& p : open_) closePart(p);
+    open_.clear();
+}
+
+PartWriter::OpenPart* PartWriter::openPart(uint64_t index, uint64_t globalOffset, std::string& err) {
+    for (auto& p : open_) {
+        if (p.index == index) {
+            p.lastUse = ++useCounter_;
+            return &p;
+        }
+    }
+    if (openHook_ && !openHook_(index, globalOffset, err)) {
+        return nullptr;
+    }
+    if (open_.size() >= maxOpenParts_) {
+        auto lru = std::min_element(open_.begin(), open_.end(),
+                                    [](const OpenPart& a, const OpenPart& b) { return a.lastUse < b.lastUse; });
+        // sync() only reaches open parts, yet the next checkpoint counts this part's bytes as
+        // durable: fsync it on the way out.
+        std::string syncErr;
+        const bool synced = !lru->dirty || syncPart(*lru, syncErr);
+        const bool closed = closePart(*lru);
+        open_.erase(lru);
+        if (!synced || !closed) {
+            // Buffered bytes of the evicted part may be lost; fail rather than leave a silent hole.
+            err = "Write failed";
+            return nullptr;
+        }
+    }
+    std::string path = partFilePath(dir_, index);
+    // O_CREAT without O_TRUNC: concurrent writers may race to create the same part file.
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0666);
+    FILE* f = (fd >= 0 && backend_ == WriteBackend::Stdio) ? fdopen(fd, "r+b") : nullptr;
+    if (fd < 0 || (backend_ == WriteBackend::Stdio && !f)) {
+        if (fd >= 0) ::close(fd);
+        err = "Open part failed";
+        logLine("Open part failed: " + path);
+        return nullptr;
+    }
+    if (preallocTotal_ > 0) {
+        const uint64_t partStart = index * partSize_;
+        const uint64_t want = preallocTotal_ > partStart ? std::min(partSize_, preallocTotal_ - partStart) : 0;
+        struct stat st{};
+        if (want > 0 && fstat(fd, &st) == 0 && static_cast<uint64_t>(st.st_size) < want) {
+            if (preallocHook_) preallocHook_(index);
+            if (!preallocateFile(fd, want)) {
+                // Not fatal: the part just grows through fwrite as before.
+                logLine("Preallocate failed for " + path + ": " + std::strerror(errno));
+            }
+        }
+    }
+    OpenPart p;
+    p.index = index;
+    p.file = f;
+    p.fd = f ? -1 : fd;
+    p.pos = 0;
+    p.lastUse = ++useCounter_;
+    if (ioBufferBytes_ > 0) {
+        p.buf.resize(ioBufferBytes_);
+        // Large stdio buffer to reduce syscalls.
+        if (f) setvbuf(f, p.buf.data(), _IOFBF, p.buf.size());
+    }
+    open_.push_back(std::move(p));
+    return &open_.back();
+}
+
+bool PartWriter::write(uint64_t globalOffset, const char* data, size_t len, std::string& err) {
+    if (partSize_ == 0) {
+        err = "Write failed";
+        return false;
+    }
+    size_t idx = 0;
+    while (idx < len) {
+        uint64_t partIdx = globalOffset / partSize_;
+        uint64_t partOff = globalOffset % partSize_;
+        uint64_t space = partSize_ - partOff;
+        size_t toWrite = static_cast<size_t>(std::min<uint64_t>(space, len - idx));
+        OpenPart* p = openPart(partIdx, globalOffset, err);
+        if (!p) return false;
+        p->dirty = true;
+        if (p->fd >= 0) {
+            if (!writeRaw(*p, partOff, data + idx, toWrite, err)) return false;
+            if (hashing_) hashWritten(partIdx, partOff, data + idx, toWrite);
+            if (crcing_) fileCrc_.update(globalOffset, data + idx, toWrite);
+            globalOffset += toWrite;
+            idx += toWrite;
+            continue;
+        }
+        if (p->pos != partOff) {
+            if (fseek(p->file, static_cast<long>(partOff), SEEK_SET) != 0) {
+                err = "Seek failed";
+                logLine("Seek failed in part " + partFilePath(dir_, partIdx) + " offset=" + std::to_string(partOff));
+                return false;
+            }
+            p->pos = partOff;
+        }
+        size_t wn = fwrite(data + idx, 1, toWrite, p->file);
+        if (wn != toWrite) {
+            err = "Write failed";
+            return false;
+        }
+        p->pos += toWrite;
+        if (hashing_) hashWritten(partIdx, partOff, data + idx, toWrite);
+        if (crcing_) fileCrc_.update(globalOffset, data + idx, toWrite);
+        globalOffset += toWrite;
+        idx += toWrite;
+    }
+    return true;
+}
+
+void PartWriter::hashWritten(uint64_t partIndex, uint64_t partOff, const char* data, size_t len) {
+    auto it = hashes_.find(partIndex);
+    if (it == hashes_.end()) {
+        if (partOff != 0) return; // no leading run for this part yet (e.g. a later segment)
+        it = hashes_.emplace(partIndex, PartHasher()).first;
+    }
+    if (partOff == it->second.offset()) {
+        it->second.update(data, len);
+    } else if (partOff < it->second.offset()) {
+        // Already-hashed bytes were rewritten; the digest no longer describes the file.
+        hashes_.erase(it);
+    }
+    // partOff beyond the hashed prefix: another stream's slice, left unhashed.
+}
+
+bool PartWriter::writeRaw(OpenPart& p, uint64_t partOff, const char* data, size_t len, std::string& err) {
+    const size_t block = p.buf.size();
+    if (block == 0) return writeAt(p, partOff, data, len, err);
+    while (len > 0) {
+        if (p.stageLen > 0 && p.stageStart + p.stageLen != partOff) {
+            if (!flushStage(p, err)) return false;
+        }
+        if (p.stageLen == 0 && partOff % block == 0 && len >= block) {
+            // Aligned whole blocks go straight from the caller's buffer.
+            size_t direct = len - len % block;
+            if (!writeAt(p, partOff, data, direct, err)) return false;
+            partOff += direct;
+            data += direct;
+            len -= direct;
+            continue;
+        }
+        if (p.stageLen == 0) p.stageStart = partOff;
+        // Stage up to the next block boundary so every later write() starts aligned.
+        const size_t cap = block - static_cast<size_t>(p.stageStart % block);
+        const size_t n = std::min(len, cap - p.stageLen);
+        std::memcpy(p.buf.data() + p.stageLen, data, n);
+        p.stageLen += n;
+        partOff += n;
+        data += n;
+        len -= n;
+        if (p.stageLen == cap && !flushStage(p, err)) return false;
+    }
+    return true;
+}
+
+bool PartWriter::flushStage(OpenPart& p, std::string& err) {
+    if (p.stageLen == 0) return true;
+    const size_t n = p.stageLen;
+    p.stageLen = 0;
+    return writeAt(p, p.stageStart, p.buf.data(), n, err);
+}
+
+bool PartWriter::writeAt(OpenPart& p, uint64_t partOff, const char* data, size_t len, std::string& err) {
+    if (p.pos != partOff) {
+        if (::lseek(p.fd, static_cast<off_t>(partOff), SEEK_SET) < 0) {
+            err = "Seek failed";
+            logLine("Seek failed in part " + partFilePath(dir_, p.index) + " offset=" + std::to_string(partOff));
+            return false;
+        }
+        p.pos = partOff;
+    }
+    while (len > 0) {
+        ssize_t wn = ::write(p.fd, data, len);
+        if (wn < 0 && errno == EINTR) continue;
+        if (wn <= 0) {
+            err = "Write failed";
+            logLine("Write failed in part " + partFilePath(dir_, p.index) + ": " + std::strerror(errno));
+            return false;
+        }
+        p.pos += static_cast<uint64_t>(wn);
+        data += wn;
+        len -= static_cast<size_t>(wn);
+    }
+    return true;
+}
+
+bool PartWriter::flush(std::string& err) {
+    for (auto& p : open_) {
+        if (p.file && fflush(p.file) != 0) {
+            err = "Write failed";
+            return false;
+        }
+        if (p.fd >= 0 && !flushStage(p, err)) return false;
+    }
+    return true;
+}
+
+bool PartWriter::syncPart(OpenPart& p, std::string& err) {
+    if (p.file && fflush(p.file) != 0) {
+        err = "Write failed";
+        return false;
+    }
+    if (p.fd >= 0 && !flushStage(p, err)) return false;
+    const int fd = p.file ? fileno(p.file) : p.fd;
+    if (fd >= 0 && ::fsync(fd) != 0) {
+        err = "Write failed";
+        logLine("fsync failed for part " + partFilePath(dir_, p.index) + ": " + std::strerror(errno));
+        return false;
+    }
+    p.dirty = false;
+    ++fsyncs_;
+    return true;
+}
+
+bool PartWriter::sync(std::string& err) {
+    if (!flush(err)) return false;
+    for (auto& p : open_) {
+        if (p.dirty && !syncPart(p, err)) return false;
+    }
+    return true;
+}
+
+bool preallocateFile(int fd, uint64_t length) {
+#if defined(__linux__)
+    if (posix_fallocate(fd, 0, static_cast<off_t>(length)) == 0) return true;
+#endif
+    return ftruncate(fd, static_cast<off_t>(length)) == 0;
+}
+
+bool truncatePartsTo(const std::string& dir, uint64_t partSize, uint64_t durableEnd, std::string& err) {
+    RangeSet keep;
+    keep.add(0, durableEnd);
+    return truncatePartsToRanges(dir, partSize, keep, err);
+}
+
+bool truncatePartsToRanges(const std::string& dir, uint64_t partSize, const RangeSet& keep, std::string& err) {
+    if (partSize == 0) return true;
+    DIR* d = opendir(dir.c_str());
+    if (!d) return true;
+    std::vector<uint64_t> indices;
+    struct dirent* ent;
+    while ((ent = readdir(d)) != nullptr) {
+        uint64_t idx = 0;
+        if (parsePartFileIndex(ent->d_name, idx)) indices.push_back(idx);
+    }
+    closedir(d);
+
+    bool ok = true;
+    for (uint64_t idx : indices) {
+        const std::string path = partFilePath(dir, idx);
+        const uint64_t partStart = idx * partSize;
+        const RangeSet inPart = keep.clipped(partStart, partStart + partSize);
+        const uint64_t keepBytes = inPart.empty() ? 0 : inPart.ranges().back().end - partStart;
+        if (keepBytes == 0) {
+            if (::remove(path.c_str()) != 0 && errno != ENOENT) {
+                err = "Failed to remove part " + path;
+                ok = false;
+            }
+            continue;
+        }
+        struct stat st{};
+        if (stat(path.c_str(), &st) != 0) continue;
+        if (static_cast<uint64_t>(st.st_size) <= keepBytes) continue;
+        int fd = ::open(path.c_str(), O_RDWR);
+        if (fd < 0 || ftruncate(fd, static_cast<off_t>(keepBytes)) != 0) {
+            err = "Failed to truncate part " + path + ": " + std::strerror(errno);
+            ok = false;
+        }
+        if (fd >= 0) ::close(fd);
+    }
+    return ok;
+}
+
+} // namespace romm
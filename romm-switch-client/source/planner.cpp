@@ -78,6 +78,7 @@ DownloadBundle buildBundleFromGame(const Game& g, const PlatformPrefs& prefs) {
             spec.url = rf.url;
             spec.sizeBytes = rf.sizeBytes;
             spec.category = rf.category;
+            spec.checksums = rf.checksums;
             bundle.files.push_back(std::move(spec));
         }
     } else if (bundle.mode == "bundle_best") {
@@ -130,6 +131,7 @@ DownloadBundle buildBundleFromGame(const Game& g, const PlatformPrefs& prefs) {
                 spec.url = rf.url;
                 spec.sizeBytes = rf.sizeBytes;
                 spec.category = rf.category;
+                spec.checksums = rf.checksums;
                 bundle.files.push_back(std::move(spec));
             }
         }
@@ -164,6 +166,7 @@ DownloadBundle buildBundleFromGame(const Game& g, const PlatformPrefs& prefs) {
             spec.url = best->url;
             spec.sizeBytes = best->sizeBytes;
             spec.category = best->category;
+            spec.checksums = best->checksums;
             bundle.files.push_back(std::move(spec));
         }
     }
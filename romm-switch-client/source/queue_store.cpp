@@ -66,6 +66,9 @@ std::string queueToJson(const std::vector<QueueItem>& items) {
             oss << "\"size_bytes\":" << static_cast<unsigned long long>(f.sizeBytes) << ",";
             oss << "\"relative_path\":\"" << escapeJson(f.relativePath) << "\",";
             oss << "\"category\":\"" << escapeJson(f.category) << "\"";
+            if (!f.checksums.crc32.empty()) oss << ",\"crc_hash\":\"" << escapeJson(f.checksums.crc32) << "\"";
+            if (!f.checksums.md5.empty()) oss << ",\"md5_hash\":\"" << escapeJson(f.checksums.md5) << "\"";
+            if (!f.checksums.sha1.empty()) oss << ",\"sha1_hash\":\"" << escapeJson(f.checksums.sha1) << "\"";
             oss << "}";
         }
         oss << "]";
@@ -105,6 +108,9 @@ void parseFileSpec(const mini::Object& o, DownloadFileSpec& f) {
     if (auto it = o.find("size_bytes"); it != o.end()) f.sizeBytes = valToU64(it->second);
     if (auto it = o.find("relative_path"); it != o.end()) f.relativePath = valToString(it->second);
     if (auto it = o.find("category"); it != o.end()) f.category = valToString(it->second);
+    if (auto it = o.find("crc_hash"); it != o.end()) f.checksums.crc32 = valToString(it->second);
+    if (auto it = o.find("md5_hash"); it != o.end()) f.checksums.md5 = valToString(it->second);
+    if (auto it = o.find("sha1_hash"); it != o.end()) f.checksums.sha1 = valToString(it->second);
 }
 
 void parseBundle(const mini::Object& o, DownloadBundle& b) {
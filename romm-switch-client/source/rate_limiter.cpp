@@ -0,0 +1,166 @@
+#include "romm/rate_limiter.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <ctime>
+#include <thread>
+
+namespace romm {
+
+namespace {
+
+constexpr auto kScheduleRecheck = std::chrono::seconds(1);
+constexpr auto kMaxSleepSlice = std::chrono::milliseconds(100); // cancel latency while throttled
+
+int localMinuteOfDay() {
+    std::time_t t = std::time(nullptr);
+    std::tm tm{};
+    if (!localtime_r(&t, &tm)) return 0;
+    return tm.tm_hour * 60 + tm.tm_min;
+}
+
+std::string trimmed(const std::string& s) {
+    size_t b = 0;
+    size_t e = s.size();
+    while (b < e && std::isspace(static_cast<unsigned char>(s[b]))) ++b;
+    while (e > b && std::isspace(static_cast<unsigned char>(s[e - 1]))) --e;
+    return s.substr(b, e - b);
+}
+
+// "HH:MM" -> minutes since midnight; 24:00 is accepted as the end of the day.
+bool parseClock(const std::string& s, int& out) {
+    const std::string t = trimmed(s);
+    const size_t colon = t.find(':');
+    if (colon == std::string::npos || colon == 0 || colon > 2 || t.size() - colon != 3) return false;
+    for (size_t i = 0; i < t.size(); ++i) {
+        if (i != colon && !std::isdigit(static_cast<unsigned char>(t[i]))) return false;
+    }
+    const int h = std::stoi(t.substr(0, colon));
+    const int m = std::stoi(t.substr(colon + 1));
+    if (m > 59 || h > 24 || (h == 24 && m != 0)) return false;
+    out = (h * 60 + m) % (24 * 60);
+    return true;
+}
+
+bool parseKb(const std::string& s, uint64_t& out) {
+    const std::string t = trimmed(s);
+    if (t.empty() || t.size() > 9) return false;
+    for (char c : t) {
+        if (!std::isdigit(static_cast<unsigned char>(c))) return false;
+    }
+    out = std::stoull(t) * 1024ULL;
+    return true;
+}
+
+} // namespace
+
+bool parseRateSchedule(const std::string& text, std::vector<RateWindow>& out, std::string& err) {
+    std::vector<RateWindow> windows;
+    size_t pos = 0;
+    while (pos <= text.size()) {
+        size_t comma = text.find(',', pos);
+        if (comma == std::string::npos) comma = text.size();
+        const std::string item = trimmed(text.substr(pos, comma - pos));
+        pos = comma + 1;
+        if (item.empty()) continue;
+        const size_t dash = item.find('-');
+        const size_t eq = item.find('=');
+        RateWindow w;
+        if (dash == std::string::npos || eq == std::string::npos || eq < dash ||
+            !parseClock(item.substr(0, dash), w.startMinute) ||
+            !parseClock(item.substr(dash + 1, eq - dash - 1), w.endMinute) ||
+            !parseKb(item.substr(eq + 1), w.bytesPerSec)) {
+            err = "Invalid rate window '" + item + "' (expected HH:MM-HH:MM=KB)";
+            return false;
+        }
+        windows.push_back(w);
+    }
+    out = std::move(windows);
+    return true;
+}
+
+RateLimiter::RateLimiter()
+    : RateLimiter(TimeSource{[] { return Clock::now(); },
+                             [](std::chrono::microseconds d) { std::this_thread::sleep_for(d); },
+                             localMinuteOfDay}) {}
+
+RateLimiter::RateLimiter(TimeSource time) : time_(std::move(time)) {
+    last_ = time_.now();
+    lastScheduleCheck_ = last_;
+}
+
+void RateLimiter::configure(const RateLimitConfig& cfg) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cfg_ = cfg;
+    rate_ = rateForMinuteLocked(time_.minuteOfDay());
+    burst_ = static_cast<double>(cfg_.burstBytes > 0 ? cfg_.burstBytes : rate_);
+    tokens_ = burst_;
+    last_ = time_.now();
+    lastScheduleCheck_ = last_;
+}
+
+bool RateLimiter::enabled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cfg_.bytesPerSec > 0) return true;
+    return std::any_of(cfg_.schedule.begin(), cfg_.schedule.end(),
+                       [](const RateWindow& w) { return w.bytesPerSec > 0; });
+}
+
+uint64_t RateLimiter::currentBytesPerSec() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rate_;
+}
+
+uint64_t RateLimiter::rateForMinuteLocked(int minute) const {
+    for (const auto& w : cfg_.schedule) {
+        const bool inside = w.startMinute < w.endMinute
+                                ? (minute >= w.startMinute && minute < w.endMinute)
+                                : (minute >= w.startMinute || minute < w.endMinute);
+        if (inside) return w.bytesPerSec;
+    }
+    return cfg_.bytesPerSec;
+}
+
+void RateLimiter::refillLocked(Clock::time_point now) {
+    if (!cfg_.schedule.empty() && now - lastScheduleCheck_ >= kScheduleRecheck) {
+        lastScheduleCheck_ = now;
+        const uint64_t rate = rateForMinuteLocked(time_.minuteOfDay());
+        if (rate != rate_) {
+            const bool wasUnlimited = rate_ == 0;
+            rate_ = rate;
+            burst_ = static_cast<double>(cfg_.burstBytes > 0 ? cfg_.burstBytes : rate_);
+            // Debt owed under an old cap is meaningless once the cap is lifted or newly applied.
+            if (wasUnlimited || rate_ == 0) tokens_ = burst_;
+        }
+    }
+    if (rate_ > 0 && now > last_) {
+        const double elapsed = std::chrono::duration<double>(now - last_).count();
+        tokens_ = std::min(burst_, tokens_ + elapsed * static_cast<double>(rate_));
+    }
+    last_ = now;
+}
+
+bool RateLimiter::acquire(uint64_t bytes, const std::atomic<bool>* cancel) {
+    std::chrono::microseconds wait{0};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        refillLocked(time_.now());
+        if (rate_ == 0) return true;
+        tokens_ -= static_cast<double>(bytes);
+        if (tokens_ >= 0.0) return true;
+        wait = std::chrono::microseconds(
+            static_cast<int64_t>(std::ceil(-tokens_ * 1e6 / static_cast<double>(rate_))));
+    }
+    // Later callers see the debt and queue behind it, so the combined rate stays at the cap.
+    while (wait.count() > 0) {
+        if (cancel && cancel->load(std::memory_order_acquire)) return false;
+        const auto slice = std::min<std::chrono::microseconds>(wait, kMaxSleepSlice);
+        time_.sleep(slice);
+        throttledUs_.fetch_add(static_cast<uint64_t>(slice.count()), std::memory_order_relaxed);
+        wait -= slice;
+    }
+    return true;
+}
+
+} // namespace romm
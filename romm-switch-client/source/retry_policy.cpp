@@ -0,0 +1,56 @@
+#include "romm/retry_policy.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace romm {
+
+uint32_t backoffDelayMs(const RetryPolicy& policy, int failure, uint32_t random) {
+    uint64_t d = std::max<uint32_t>(policy.baseDelayMs, 1);
+    for (int i = 1; i < failure && d < policy.maxDelayMs; ++i) d *= 2;
+    d = std::min<uint64_t>(d, std::max(policy.maxDelayMs, policy.baseDelayMs));
+    const uint64_t half = d / 2;
+    return static_cast<uint32_t>(half + random % (d - half + 1));
+}
+
+RetryBudget::RetryBudget(const RetryPolicy& policy)
+    : RetryBudget(policy, static_cast<uint32_t>(
+                              std::chrono::steady_clock::now().time_since_epoch().count())) {}
+
+RetryBudget::RetryBudget(const RetryPolicy& policy, uint32_t seed) : policy_(policy), rng_(seed) {}
+
+RetryDecision RetryBudget::onFailure(const ErrorInfo& info, bool madeProgress) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    RetryDecision out;
+    if (!info.retryable) {
+        out.reason = std::string("not retryable (") + errorCodeLabel(info.code) + ")";
+        return out;
+    }
+    if (retries_ >= policy_.maxRetries) {
+        out.reason = "retry budget spent (" + std::to_string(retries_) + " retries)";
+        return out;
+    }
+    streak_ = madeProgress ? 1 : streak_ + 1;
+    const uint32_t delay = backoffDelayMs(policy_, streak_, static_cast<uint32_t>(rng_()));
+    if (delayedMs_ + delay > policy_.maxTotalDelayMs) {
+        out.reason = "retry budget spent (" + std::to_string(delayedMs_ / 1000) + "s of backoff)";
+        return out;
+    }
+    ++retries_;
+    delayedMs_ += delay;
+    out.retry = true;
+    out.delayMs = delay;
+    return out;
+}
+
+int RetryBudget::retriesUsed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return retries_;
+}
+
+uint64_t RetryBudget::delayedMs() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return delayedMs_;
+}
+
+} // namespace romm
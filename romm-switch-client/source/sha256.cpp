@@ -0,0 +1,187 @@
+#include "romm/sha256.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+#define ROMM_SHA256_ARMV8 1
+#include <arm_neon.h>
+#endif
+
+namespace romm {
+
+namespace {
+
+constexpr uint32_t kInit[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+alignas(16) constexpr uint32_t kRound[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#if defined(ROMM_SHA256_ARMV8)
+
+void compress(uint32_t h[8], const uint8_t* data, size_t blocks) {
+    uint32x4_t abcd = vld1q_u32(&h[0]);
+    uint32x4_t efgh = vld1q_u32(&h[4]);
+    while (blocks--) {
+        const uint32x4_t abcdSave = abcd;
+        const uint32x4_t efghSave = efgh;
+        uint32x4_t msg[4];
+        for (int i = 0; i < 4; ++i) {
+            msg[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+        }
+        // 16 groups of 4 rounds; the schedule for group i+4 is derived while group i runs.
+        for (int i = 0; i < 16; ++i) {
+            const uint32x4_t wk = vaddq_u32(msg[i & 3], vld1q_u32(&kRound[4 * i]));
+            if (i < 12) {
+                msg[i & 3] = vsha256su1q_u32(vsha256su0q_u32(msg[i & 3], msg[(i + 1) & 3]),
+                                             msg[(i + 2) & 3], msg[(i + 3) & 3]);
+            }
+            const uint32x4_t prev = abcd;
+            abcd = vsha256hq_u32(abcd, efgh, wk);
+            efgh = vsha256h2q_u32(efgh, prev, wk);
+        }
+        abcd = vaddq_u32(abcd, abcdSave);
+        efgh = vaddq_u32(efgh, efghSave);
+        data += 64;
+    }
+    vst1q_u32(&h[0], abcd);
+    vst1q_u32(&h[4], efgh);
+}
+
+#else
+
+inline uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+void compress(uint32_t h[8], const uint8_t* data, size_t blocks) {
+    uint32_t w[64];
+    while (blocks--) {
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (uint32_t(data[4 * i]) << 24) | (uint32_t(data[4 * i + 1]) << 16) |
+                   (uint32_t(data[4 * i + 2]) << 8) | uint32_t(data[4 * i + 3]);
+        }
+        for (int i = 16; i < 64; ++i) {
+            const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+        for (int i = 0; i < 64; ++i) {
+            const uint32_t t1 = k + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + kRound[i] + w[i];
+            const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            k = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+        h[5] += f;
+        h[6] += g;
+        h[7] += k;
+        data += 64;
+    }
+}
+
+#endif
+
+} // namespace
+
+bool Sha256::State::operator==(const State& o) const {
+    if (h != o.h || bytes != o.bytes) return false;
+    const size_t n = static_cast<size_t>(bytes % 64);
+    return std::memcmp(tail.data(), o.tail.data(), n) == 0;
+}
+
+Sha256::Sha256() {
+    for (int i = 0; i < 8; ++i) s_.h[i] = kInit[i];
+}
+
+void Sha256::update(const void* data, size_t len) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    size_t used = static_cast<size_t>(s_.bytes % 64);
+    s_.bytes += len;
+    if (used > 0) {
+        const size_t n = std::min(len, 64 - used);
+        std::memcpy(s_.tail.data() + used, p, n);
+        used += n;
+        p += n;
+        len -= n;
+        if (used < 64) return;
+        compress(s_.h.data(), s_.tail.data(), 1);
+    }
+    const size_t blocks = len / 64;
+    if (blocks > 0) {
+        compress(s_.h.data(), p, blocks);
+        p += blocks * 64;
+        len -= blocks * 64;
+    }
+    if (len > 0) std::memcpy(s_.tail.data(), p, len);
+}
+
+Sha256::Digest Sha256::digest() const {
+    State s = s_;
+    const uint64_t bitLen = s.bytes * 8;
+    size_t used = static_cast<size_t>(s.bytes % 64);
+    s.tail[used++] = 0x80;
+    if (used > 56) {
+        std::memset(s.tail.data() + used, 0, 64 - used);
+        compress(s.h.data(), s.tail.data(), 1);
+        used = 0;
+    }
+    std::memset(s.tail.data() + used, 0, 56 - used);
+    for (int i = 0; i < 8; ++i) s.tail[56 + i] = static_cast<uint8_t>(bitLen >> (56 - 8 * i));
+    compress(s.h.data(), s.tail.data(), 1);
+
+    Digest out{};
+    for (int i = 0; i < 8; ++i) {
+        out[4 * i] = static_cast<uint8_t>(s.h[i] >> 24);
+        out[4 * i + 1] = static_cast<uint8_t>(s.h[i] >> 16);
+        out[4 * i + 2] = static_cast<uint8_t>(s.h[i] >> 8);
+        out[4 * i + 3] = static_cast<uint8_t>(s.h[i]);
+    }
+    return out;
+}
+
+Sha256::Digest Sha256::hash(const void* data, size_t len) {
+    Sha256 s;
+    s.update(data, len);
+    return s.digest();
+}
+
+std::string Sha256::toHex(const Digest& d) {
+    static const char* kHex = "0123456789abcdef";
+    std::string out;
+    out.reserve(d.size() * 2);
+    for (uint8_t b : d) {
+        out.push_back(kHex[b >> 4]);
+        out.push_back(kHex[b & 0x0F]);
+    }
+    return out;
+}
+
+bool Sha256::accelerated() {
+#if defined(ROMM_SHA256_ARMV8)
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace romm
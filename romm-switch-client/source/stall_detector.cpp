@@ -0,0 +1,121 @@
+#include "romm/stall_detector.hpp"
+
+#include <algorithm>
+
+namespace romm {
+
+StallDetector::StallDetector(const StallPolicy& policy) : policy_(policy) {}
+
+int StallDetector::track(uint64_t nowMs) {
+    Conn c;
+    c.id = nextId_++;
+    c.startMs = nowMs;
+    c.samples.emplace_back(nowMs, 0);
+    conns_.push_back(std::move(c));
+    return conns_.back().id;
+}
+
+void StallDetector::untrack(int id) {
+    conns_.erase(std::remove_if(conns_.begin(), conns_.end(), [id](const Conn& c) { return c.id == id; }),
+                 conns_.end());
+}
+
+StallDetector::Conn* StallDetector::find(int id) {
+    for (auto& c : conns_) {
+        if (c.id == id) return &c;
+    }
+    return nullptr;
+}
+
+const StallDetector::Conn* StallDetector::find(int id) const {
+    for (const auto& c : conns_) {
+        if (c.id == id) return &c;
+    }
+    return nullptr;
+}
+
+void StallDetector::sample(int id, uint64_t bytes, uint64_t nowMs) {
+    Conn* c = find(id);
+    if (!c) return;
+    c->samples.emplace_back(nowMs, bytes);
+    // Keep one sample at or before the window start as the anchor of the rate.
+    while (c->samples.size() > 2 && c->samples[1].first + policy_.windowMs <= nowMs) c->samples.pop_front();
+}
+
+void StallDetector::restartWindows(uint64_t nowMs) {
+    for (auto& c : conns_) {
+        const uint64_t bytes = c.samples.empty() ? 0 : c.samples.back().second;
+        c.samples.clear();
+        c.samples.emplace_back(nowMs, bytes);
+    }
+}
+
+double StallDetector::windowRate(const Conn& c) const {
+    if (c.samples.size() < 2) return 0.0;
+    const auto& first = c.samples.front();
+    const auto& last = c.samples.back();
+    const uint64_t span = last.first - first.first;
+    if (span < policy_.windowMs) return 0.0;
+    return static_cast<double>(last.second - first.second) * 1000.0 / static_cast<double>(span);
+}
+
+double StallDetector::rate(int id) const {
+    const Conn* c = find(id);
+    return c ? windowRate(*c) : 0.0;
+}
+
+std::vector<int> StallDetector::poll(uint64_t nowMs) {
+    std::vector<std::pair<Conn*, double>> measured;
+    for (auto& c : conns_) {
+        if (nowMs < c.startMs + policy_.warmupMs) continue;
+        const bool full = c.samples.size() >= 2 && c.samples.back().first - c.samples.front().first >= policy_.windowMs;
+        if (!full) continue;
+        measured.emplace_back(&c, windowRate(c));
+    }
+
+    std::vector<double> healthy;
+    for (const auto& m : measured) {
+        if (baseline_ <= 0.0 || m.second >= policy_.lagRatio * baseline_) healthy.push_back(m.second);
+    }
+    if (!healthy.empty()) {
+        std::sort(healthy.begin(), healthy.end());
+        const double median = healthy[healthy.size() / 2];
+        baseline_ = baseline_ <= 0.0 ? median : baseline_ + policy_.baselineAlpha * (median - baseline_);
+    }
+
+    std::vector<int> out;
+    if (baseline_ < policy_.minBaselineBytesPerSec) return out;
+    for (auto& m : measured) {
+        if (m.first->flagged || m.second >= policy_.lagRatio * baseline_) continue;
+        m.first->flagged = true;
+        out.push_back(m.first->id);
+    }
+    return out;
+}
+
+RaceCursor::RaceCursor(uint64_t start, uint64_t end, WriteFn write)
+    : end_(end), write_(std::move(write)), cursor_(start) {}
+
+bool RaceCursor::deliver(uint64_t pos, const char* data, size_t len, size_t& wrote, std::string& err) {
+    wrote = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pos > cursor_) {
+        err = "Hedged range gap (at " + std::to_string(pos) + ", cursor " + std::to_string(cursor_) + ")";
+        return false;
+    }
+    const uint64_t stop = std::min<uint64_t>(pos + len, end_);
+    if (stop <= cursor_) return true; // the other connection already wrote these
+    const size_t skip = static_cast<size_t>(cursor_ - pos);
+    const size_t n = static_cast<size_t>(stop - cursor_);
+    if (!write_(cursor_, data + skip, n, err)) return false;
+    cursor_ += n;
+    wrote = n;
+    return true;
+}
+
+uint64_t RaceCursor::cursor() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cursor_;
+}
+
+} // namespace romm
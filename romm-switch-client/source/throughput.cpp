@@ -0,0 +1,94 @@
+#include "romm/throughput.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+namespace romm {
+
+namespace {
+uint64_t steadyNowMs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+} // namespace
+
+ThroughputMeter::ThroughputMeter() : ThroughputMeter(NowFn{}) {}
+
+ThroughputMeter::ThroughputMeter(NowFn now) : now_(now ? std::move(now) : NowFn(steadyNowMs)) {
+    originMs_.store(now_());
+}
+
+uint64_t ThroughputMeter::secondNow() const {
+    const uint64_t now = now_();
+    const uint64_t origin = originMs_.load(std::memory_order_relaxed);
+    return now > origin ? (now - origin) / 1000 : 0;
+}
+
+void ThroughputMeter::add(uint64_t bytes) {
+    if (bytes == 0) return;
+    total_.fetch_add(bytes, std::memory_order_relaxed);
+    const uint64_t second = secondNow();
+    const uint64_t tag = tagOf(second);
+    auto& slot = ring_[second % kWindowSeconds];
+    uint64_t cur = slot.load(std::memory_order_relaxed);
+    uint64_t next = 0;
+    do {
+        // A bucket still tagged with an older second is recycled for this one.
+        const uint64_t base = (cur & ~kCountMask) == tag ? (cur & kCountMask) : 0;
+        next = tag | std::min<uint64_t>(base + bytes, kCountMask);
+    } while (!slot.compare_exchange_weak(cur, next, std::memory_order_relaxed));
+}
+
+uint64_t ThroughputMeter::bytesIn(uint64_t second) const {
+    const uint64_t v = ring_[second % kWindowSeconds].load(std::memory_order_relaxed);
+    return (v & ~kCountMask) == tagOf(second) ? (v & kCountMask) : 0;
+}
+
+ThroughputSnapshot ThroughputMeter::snapshot() const {
+    ThroughputSnapshot out;
+    out.totalBytes = total_.load(std::memory_order_relaxed);
+    const uint64_t cur = secondNow();
+    // Completed seconds only; the bucket of (cur - kWindowSeconds) is the one being reused now.
+    const uint64_t first = cur >= kWindowSeconds - 1 ? cur - (kWindowSeconds - 1) : 0;
+    bool started = false;
+    double ewma = 0.0;
+    uint64_t sum = 0;
+    uint64_t seconds = 0;
+    for (uint64_t s = first; s < cur; ++s) {
+        const uint64_t b = bytesIn(s);
+        if (!started) {
+            if (b == 0) continue; // idle lead-in is not part of the rate
+            started = true;
+            ewma = static_cast<double>(b);
+            out.minBytesPerSec = b;
+        } else {
+            ewma += kEwmaAlpha * (static_cast<double>(b) - ewma);
+            out.minBytesPerSec = std::min(out.minBytesPerSec, b);
+        }
+        out.peakBytesPerSec = std::max(out.peakBytesPerSec, b);
+        sum += b;
+        seconds++;
+    }
+    out.bytesPerSec = ewma;
+    out.lastSecondBytes = cur > 0 ? static_cast<double>(bytesIn(cur - 1)) : 0.0;
+    out.averageBytesPerSec = seconds > 0 ? static_cast<double>(sum) / static_cast<double>(seconds) : 0.0;
+    out.active = started || bytesIn(cur) > 0;
+    return out;
+}
+
+void ThroughputMeter::reset() {
+    for (auto& slot : ring_) slot.store(0, std::memory_order_relaxed);
+    total_.store(0, std::memory_order_relaxed);
+    originMs_.store(now_(), std::memory_order_relaxed);
+}
+
+int64_t ThroughputMeter::etaSeconds(uint64_t remainingBytes, double bytesPerSec) {
+    if (remainingBytes == 0) return 0;
+    if (bytesPerSec < 1.0) return -1;
+    return static_cast<int64_t>(std::ceil(static_cast<double>(remainingBytes) / bytesPerSec));
+}
+
+} // namespace romm
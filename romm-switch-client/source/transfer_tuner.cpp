@@ -0,0 +1,206 @@
+#include "romm/transfer_tuner.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace romm {
+
+namespace {
+
+std::string formatRate(double bytesPerSec) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.1f MB/s", bytesPerSec / (1024.0 * 1024.0));
+    return buf;
+}
+
+std::string formatPercent(double fraction) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%+.0f%%", fraction * 100.0);
+    return buf;
+}
+
+std::string formatBytes(size_t bytes) {
+    if (bytes >= 1024 * 1024 && bytes % (1024 * 1024) == 0) return std::to_string(bytes / (1024 * 1024)) + "MB";
+    return std::to_string(bytes / 1024) + "KB";
+}
+
+TuningParams clampParams(const TuningParams& p, const TuningBounds& b) {
+    TuningParams out;
+    out.recvBufferBytes = std::clamp(p.recvBufferBytes, b.min.recvBufferBytes, b.max.recvBufferBytes);
+    out.ioBufferBytes = std::clamp(p.ioBufferBytes, b.min.ioBufferBytes, b.max.ioBufferBytes);
+    out.writeBatchBytes = std::clamp(p.writeBatchBytes, b.min.writeBatchBytes, b.max.writeBatchBytes);
+    out.connections = std::clamp(p.connections, b.min.connections, b.max.connections);
+    return out;
+}
+
+} // namespace
+
+void TransferTuner::reset(const TuningBounds& bounds, const TuningParams& start) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bounds_ = bounds;
+    params_ = clampParams(start, bounds_);
+    trial_ = Trial{};
+    for (auto& h : hold_) h[0] = h[1] = 0;
+}
+
+TuningParams TransferTuner::beginStream() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    trial_.awaitingStream = false;
+    return params_;
+}
+
+TuningParams TransferTuner::current() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return params_;
+}
+
+const char* TransferTuner::knobName(Knob knob) {
+    switch (knob) {
+        case kRecvBuffer: return "recv_buffer";
+        case kIoBuffer: return "io_buffer";
+        case kWriteBatch: return "write_batch";
+        case kConnections: return "connections";
+        default: return "none";
+    }
+}
+
+std::string TransferTuner::knobValue(Knob knob, const TuningParams& p) {
+    switch (knob) {
+        case kRecvBuffer: return formatBytes(p.recvBufferBytes);
+        case kIoBuffer: return formatBytes(p.ioBufferBytes);
+        case kWriteBatch: return formatBytes(p.writeBatchBytes);
+        case kConnections: return std::to_string(p.connections);
+        default: return "";
+    }
+}
+
+bool TransferTuner::stepLocked(Knob knob, bool down, TuningParams& p) const {
+    const TuningParams before = p;
+    if (down) {
+        // Only the connection count is ever stepped down; buffers shrink through reverts.
+        if (knob != kConnections) return false;
+        p.connections = std::max(p.connections - 1, bounds_.min.connections);
+        return p.connections != before.connections;
+    }
+    switch (knob) {
+        case kRecvBuffer: p.recvBufferBytes = std::min(p.recvBufferBytes * 2, bounds_.max.recvBufferBytes); break;
+        case kIoBuffer: p.ioBufferBytes = std::min(p.ioBufferBytes * 2, bounds_.max.ioBufferBytes); break;
+        case kWriteBatch: p.writeBatchBytes = std::min(p.writeBatchBytes * 2, bounds_.max.writeBatchBytes); break;
+        case kConnections: p.connections = std::min(p.connections + 1, bounds_.max.connections); break;
+        default: return false;
+    }
+    return knobValue(knob, p) != knobValue(knob, before);
+}
+
+std::string TransferTuner::observe(const TuningSample& sample) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sample.elapsedMs < kMinWindowMs || sample.bytes < kMinWindowBytes) return "";
+    // While the bandwidth limiter sets the pace, throughput says nothing about the knobs.
+    if (sample.throttledMs * 4 > sample.elapsedMs) return "";
+    // A non-live step (or its revert) only counts once a stream actually runs with it.
+    if (trial_.awaitingStream) return "";
+
+    const double rate = static_cast<double>(sample.bytes) * 1000.0 / static_cast<double>(sample.elapsedMs);
+    const double stall = static_cast<double>(sample.stallMs) / static_cast<double>(sample.elapsedMs);
+    for (auto& h : hold_) {
+        if (h[0] > 0) --h[0];
+        if (h[1] > 0) --h[1];
+    }
+
+    if (trial_.knob != kKnobCount) {
+        const Trial t = trial_;
+        trial_ = Trial{};
+        const double gain = t.baseline > 0.0 ? rate / t.baseline - 1.0 : 0.0;
+        if (t.down ? gain > -kMinGain : gain >= kMinGain) {
+            return std::string("keep ") + knobName(t.knob) + "=" + knobValue(t.knob, params_) + " (" +
+                   formatPercent(gain) + ", " + formatRate(rate) + ")";
+        }
+        const TuningParams tried = params_;
+        switch (t.knob) {
+            case kRecvBuffer: params_.recvBufferBytes = t.before.recvBufferBytes; break;
+            case kIoBuffer: params_.ioBufferBytes = t.before.ioBufferBytes; break;
+            case kWriteBatch: params_.writeBatchBytes = t.before.writeBatchBytes; break;
+            case kConnections: params_.connections = t.before.connections; break;
+            default: break;
+        }
+        hold_[t.knob][t.down ? 1 : 0] = kHoldWindows;
+        trial_.awaitingStream = !liveKnob(t.knob);
+        return std::string("revert ") + knobName(t.knob) + " " + knobValue(t.knob, tried) + " -> " +
+               knobValue(t.knob, params_) + " (" + formatPercent(gain) + ", " + formatRate(rate) + ")";
+    }
+
+    const bool sdBound = stall >= kSdBoundStall;
+    if (!sdBound && stall > kNetBoundStall) return ""; // balanced: nothing obvious to gain
+    // SD-bound: hand the card bigger writes, then shed a connection the card cannot keep up with.
+    // Network-bound: deeper receive buffers, then more connections.
+    struct Step {
+        Knob knob;
+        bool down;
+    };
+    const Step sdOrder[3] = {{kWriteBatch, false}, {kIoBuffer, false}, {kConnections, true}};
+    const Step netOrder[3] = {{kRecvBuffer, false}, {kConnections, false}, {kKnobCount, false}};
+    const Step* order = sdBound ? sdOrder : netOrder;
+    for (int i = 0; i < 3; ++i) {
+        const Knob knob = order[i].knob;
+        const bool down = order[i].down;
+        if (knob == kKnobCount || hold_[knob][down ? 1 : 0] > 0) continue;
+        TuningParams next = params_;
+        if (!stepLocked(knob, down, next)) continue;
+        trial_.knob = knob;
+        trial_.before = params_;
+        trial_.baseline = rate;
+        trial_.down = down;
+        trial_.awaitingStream = !liveKnob(knob);
+        const TuningParams before = params_;
+        params_ = next;
+        return std::string("try ") + knobName(knob) + " " + knobValue(knob, before) + " -> " +
+               knobValue(knob, params_) + " (" + (sdBound ? "SD-bound" : "network-bound") + ", stall " +
+               formatPercent(stall).substr(1) + ", " + formatRate(rate) +
+               (liveKnob(knob) ? ")" : "; from next stream)");
+    }
+    return "";
+}
+
+void TuningSampler::restartLocked(const Clocks& clocks) {
+    start_ = clocks;
+    bytes_ = 0;
+}
+
+void TuningSampler::streamStarted(const Clocks& clocks) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++active_;
+    restartLocked(clocks);
+}
+
+void TuningSampler::streamEnded(const Clocks& clocks) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (active_ > 0) --active_;
+    restartLocked(clocks);
+}
+
+void TuningSampler::add(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (active_ > 0) bytes_ += bytes;
+}
+
+std::string TuningSampler::poll(const Clocks& clocks) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (active_ == 0 || clocks.nowMs < start_.nowMs) return "";
+    const uint64_t elapsedMs = clocks.nowMs - start_.nowMs;
+    if (elapsedMs < TransferTuner::kMinWindowMs) return "";
+    if (bytes_ < TransferTuner::kMinWindowBytes && elapsedMs < kMaxWindowMs) return "";
+    TuningSample s;
+    s.bytes = bytes_;
+    s.elapsedMs = elapsedMs;
+    s.stallMs = clocks.stallMs >= start_.stallMs ? clocks.stallMs - start_.stallMs : 0;
+    s.throttledMs = clocks.throttledMs >= start_.throttledMs ? clocks.throttledMs - start_.throttledMs : 0;
+    restartLocked(clocks);
+    return tuner_.observe(s);
+}
+
+int TuningSampler::activeStreams() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return active_;
+}
+
+} // namespace romm
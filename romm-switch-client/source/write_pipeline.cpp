@@ -0,0 +1,250 @@
+#include "romm/write_pipeline.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace romm {
+
+BlockRing::BlockRing(size_t blockBytes, size_t blockCount, WriteQueueStats* stats)
+    : blockBytes_(blockBytes > 0 ? blockBytes : 1), blocks_(blockCount > 0 ? blockCount : 1), stats_(stats) {
+    free_.reserve(blocks_.size());
+    for (auto& b : blocks_) {
+        b.data.resize(blockBytes_);
+        free_.push_back(&b);
+    }
+}
+
+BlockRing::Block* BlockRing::acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (free_.empty() && !aborted_) {
+        auto waitStart = std::chrono::steady_clock::now();
+        freeCv_.wait(lock, [&]() { return aborted_ || !free_.empty(); });
+        if (stats_) {
+            auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - waitStart).count();
+            stats_->stallCount.fetch_add(1);
+            stats_->stallMs.fetch_add(static_cast<uint64_t>(waited));
+        }
+    }
+    if (aborted_) return nullptr;
+    Block* b = free_.back();
+    free_.pop_back();
+    b->offset = 0;
+    b->len = 0;
+    b->written = nullptr;
+    return b;
+}
+
+void BlockRing::submit(Block* b) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (aborted_) {
+            free_.push_back(b);
+            return;
+        }
+        filled_.push_back(b);
+        if (stats_) {
+            uint32_t depth = static_cast<uint32_t>(filled_.size());
+            stats_->depth.store(depth);
+            if (depth > stats_->peakDepth.load()) stats_->peakDepth.store(depth);
+        }
+    }
+    filledCv_.notify_one();
+}
+
+void BlockRing::recycle(Block* b) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(b);
+    }
+    freeCv_.notify_one();
+}
+
+BlockRing::Block* BlockRing::pop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    filledCv_.wait(lock, [&]() { return aborted_ || closed_ || !filled_.empty(); });
+    if (aborted_ || filled_.empty()) return nullptr;
+    Block* b = filled_.front();
+    filled_.pop_front();
+    if (stats_) stats_->depth.store(static_cast<uint32_t>(filled_.size()));
+    return b;
+}
+
+void BlockRing::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+    filledCv_.notify_all();
+}
+
+void BlockRing::abort() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        aborted_ = true;
+        while (!filled_.empty()) {
+            free_.push_back(filled_.front());
+            filled_.pop_front();
+        }
+        if (stats_) stats_->depth.store(0);
+    }
+    freeCv_.notify_all();
+    filledCv_.notify_all();
+}
+
+bool BlockRing::aborted() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return aborted_;
+}
+
+AsyncPartWriter::AsyncPartWriter(const std::string& dir,
+                                 uint64_t partSize,
+                                 size_t blockBytes,
+                                 size_t blockCount,
+                                 WriteQueueStats* stats,
+                                 size_t ioBufferBytes,
+                                 WriteBackend backend)
+    : sink_(dir, partSize, ioBufferBytes, backend),
+      ring_(blockBytes, blockCount, stats),
+      batchBytes_(ring_.blockBytes()),
+      stats_(stats) {}
+
+AsyncPartWriter::~AsyncPartWriter() {
+    if (thread_.joinable()) {
+        ring_.abort();
+        thread_.join();
+    }
+    sink_.close();
+}
+
+void AsyncPartWriter::start() {
+    if (thread_.joinable()) return;
+    thread_ = std::thread([this]() { run(); });
+}
+
+void AsyncPartWriter::run() {
+    lastCheckpoint_ = std::chrono::steady_clock::now();
+    while (BlockRing::Block* b = ring_.pop()) {
+        if (!failed()) {
+            std::string err;
+            if (sink_.write(b->offset, b->data.data(), b->len, err)) {
+                if (b->written) b->written->fetch_add(b->len, std::memory_order_release);
+                if (stats_) stats_->bytesWritten.fetch_add(b->len);
+                sinceCheckpoint_ += b->len;
+                if (checkpointHook_) {
+                    const auto now = std::chrono::steady_clock::now();
+                    const bool byBytes = checkpointBytes_ > 0 && sinceCheckpoint_ >= checkpointBytes_;
+                    const bool byTime = checkpointMs_ > 0 &&
+                                        now - lastCheckpoint_ >= std::chrono::milliseconds(checkpointMs_);
+                    if ((byBytes || byTime) && !checkpoint(err)) fail(err);
+                }
+            } else {
+                fail(err);
+            }
+        }
+        ring_.recycle(b);
+        // Stop accepting data once the sink is broken; producers see failed() on their next write.
+        if (failed()) ring_.abort();
+    }
+}
+
+void AsyncPartWriter::fail(const std::string& err) {
+    {
+        std::lock_guard<std::mutex> lock(errMutex_);
+        if (err_.empty()) err_ = err.empty() ? "Write failed" : err;
+    }
+    failed_.store(true, std::memory_order_release);
+}
+
+std::string AsyncPartWriter::error() const {
+    std::lock_guard<std::mutex> lock(errMutex_);
+    return err_;
+}
+
+bool AsyncPartWriter::checkpoint(std::string& err) {
+    if (!sink_.sync(err)) return false;
+    checkpointHook_(sink_.partHashes());
+    sinceCheckpoint_ = 0;
+    lastCheckpoint_ = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool AsyncPartWriter::finish(std::string& err) {
+    ring_.close();
+    if (thread_.joinable()) thread_.join();
+    std::string flushErr;
+    if (checkpointHook_) {
+        // Even after a write failure every counted byte is on disk; record them as durable.
+        if (!checkpoint(flushErr) && !failed()) fail(flushErr);
+    } else if (!failed() && !sink_.flush(flushErr)) {
+        fail(flushErr);
+    }
+    sink_.close();
+    if (failed()) {
+        err = error();
+        return false;
+    }
+    return true;
+}
+
+void AsyncPartWriter::abort() {
+    ring_.abort();
+    if (thread_.joinable()) thread_.join();
+    sink_.close();
+}
+
+AsyncPartWriter::Stream::~Stream() {
+    if (cur_) owner_.ring_.recycle(cur_);
+}
+
+bool AsyncPartWriter::Stream::submitCurrent(std::string& err) {
+    if (!cur_) return true;
+    BlockRing::Block* b = cur_;
+    cur_ = nullptr;
+    if (b->len == 0) {
+        owner_.ring_.recycle(b);
+        return true;
+    }
+    owner_.ring_.submit(b);
+    if (owner_.failed()) {
+        err = owner_.error();
+        return false;
+    }
+    return true;
+}
+
+bool AsyncPartWriter::Stream::write(uint64_t offset, const char* data, size_t len, std::string& err) {
+    while (len > 0) {
+        if (owner_.failed()) {
+            err = owner_.error();
+            return false;
+        }
+        const size_t batch = owner_.batchBytes();
+        if (cur_ && (cur_->offset + cur_->len != offset || cur_->len >= batch)) {
+            if (!submitCurrent(err)) return false;
+        }
+        if (!cur_) {
+            cur_ = owner_.ring_.acquire();
+            if (!cur_) {
+                err = owner_.failed() ? owner_.error() : "Write aborted";
+                return false;
+            }
+            cur_->offset = offset;
+            cur_->written = &written_;
+        }
+        size_t n = std::min(len, batch - cur_->len);
+        std::memcpy(cur_->data.data() + cur_->len, data, n);
+        cur_->len += n;
+        offset += n;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool AsyncPartWriter::Stream::flush(std::string& err) {
+    return submitCurrent(err);
+}
+
+} // namespace romm
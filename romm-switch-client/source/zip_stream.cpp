@@ -0,0 +1,276 @@
+#include "romm/zip_stream.hpp"
+#include "romm/crc32.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace romm {
+
+namespace {
+
+constexpr uint32_t kLocalHeaderSig = 0x04034b50;
+constexpr uint32_t kCentralHeaderSig = 0x02014b50;
+constexpr uint32_t kEndOfCentralSig = 0x06054b50;
+constexpr uint32_t kZip64EndSig = 0x06064b50;
+constexpr uint32_t kDescriptorSig = 0x08074b50;
+constexpr size_t kLocalHeaderRest = 26; // after the signature
+constexpr uint16_t kZip64ExtraId = 0x0001;
+constexpr size_t kInflateChunk = 64 * 1024;
+
+uint16_t le16(const char* p) {
+    const auto* u = reinterpret_cast<const unsigned char*>(p);
+    return static_cast<uint16_t>(u[0] | (u[1] << 8));
+}
+
+uint32_t le32(const char* p) {
+    const auto* u = reinterpret_cast<const unsigned char*>(p);
+    return static_cast<uint32_t>(u[0]) | (static_cast<uint32_t>(u[1]) << 8) | (static_cast<uint32_t>(u[2]) << 16) |
+           (static_cast<uint32_t>(u[3]) << 24);
+}
+
+uint64_t le64(const char* p) {
+    return static_cast<uint64_t>(le32(p)) | (static_cast<uint64_t>(le32(p + 4)) << 32);
+}
+
+} // namespace
+
+struct ZipStreamReader::Inflater {
+    z_stream z{};
+    bool ready{false};
+    ~Inflater() {
+        if (ready) inflateEnd(&z);
+    }
+};
+
+ZipStreamReader::ZipStreamReader(Handler handler) : handler_(std::move(handler)) {}
+
+ZipStreamReader::~ZipStreamReader() = default;
+
+bool ZipStreamReader::fail(const std::string& msg, std::string& err) {
+    state_ = State::Failed;
+    err = msg;
+    return false;
+}
+
+bool ZipStreamReader::take(const char*& p, size_t& n, size_t want) {
+    const size_t k = std::min(n, want - buf_.size());
+    buf_.append(p, k);
+    p += k;
+    n -= k;
+    return buf_.size() == want;
+}
+
+void ZipStreamReader::parseHeader() {
+    const char* h = buf_.data();
+    entry_ = ZipEntry{};
+    entry_.flags = le16(h + 2);
+    entry_.method = le16(h + 4);
+    entry_.crc32 = le32(h + 10);
+    entry_.compressedSize = le32(h + 14);
+    entry_.uncompressedSize = le32(h + 18);
+    entry_.sizesInDescriptor = (entry_.flags & 0x0008) != 0;
+    nameLen_ = le16(h + 22);
+    extraLen_ = le16(h + 24);
+}
+
+void ZipStreamReader::parseNames() {
+    entry_.name = buf_.substr(0, nameLen_);
+    const bool bigU = entry_.uncompressedSize == 0xFFFFFFFFu;
+    const bool bigC = entry_.compressedSize == 0xFFFFFFFFu;
+    size_t pos = nameLen_;
+    const size_t end = nameLen_ + static_cast<size_t>(extraLen_);
+    while (pos + 4 <= end) {
+        const uint16_t id = le16(buf_.data() + pos);
+        const uint16_t size = le16(buf_.data() + pos + 2);
+        pos += 4;
+        if (pos + size > end) break;
+        if (id == kZip64ExtraId) {
+            // Sizes appear only for header fields set to 0xFFFFFFFF, uncompressed first. The extra's
+            // presence alone also makes the data descriptor use 8-byte sizes.
+            entry_.zip64 = true;
+            size_t off = pos;
+            if (bigU && off + 8 <= pos + size) {
+                entry_.uncompressedSize = le64(buf_.data() + off);
+                off += 8;
+            }
+            if (bigC && off + 8 <= pos + size) entry_.compressedSize = le64(buf_.data() + off);
+        }
+        pos += size;
+    }
+}
+
+bool ZipStreamReader::startData(std::string& err) {
+    if (entry_.flags & 0x0001) return fail("Encrypted ZIP entries are not supported: " + entry_.name, err);
+    if (entry_.method != 0 && entry_.method != 8) {
+        return fail("ZIP compression method " + std::to_string(entry_.method) + " not supported: " + entry_.name, err);
+    }
+    skip_ = false;
+    uint64_t sizeHint = 0;
+    if (handler_.onEntry && !handler_.onEntry(entry_, skip_, sizeHint)) {
+        return fail("ZIP entry rejected: " + entry_.name, err);
+    }
+    ++entries_;
+    crc_ = 0;
+    produced_ = 0;
+    compressedRead_ = 0;
+    if (entry_.method == 0) {
+        if (entry_.sizesInDescriptor && entry_.compressedSize == 0) {
+            if (sizeHint == 0) return fail("Stored ZIP entry without sizes: " + entry_.name, err);
+            entry_.compressedSize = entry_.uncompressedSize = sizeHint;
+        }
+        remaining_ = entry_.compressedSize;
+        state_ = State::Data;
+        return remaining_ > 0 ? true : endData(err);
+    }
+    if (!inflater_) inflater_ = std::make_unique<Inflater>();
+    if (!inflater_->ready) {
+        if (inflateInit2(&inflater_->z, -MAX_WBITS) != Z_OK) return fail("inflateInit failed", err);
+        inflater_->ready = true;
+    } else if (inflateReset(&inflater_->z) != Z_OK) {
+        return fail("inflateReset failed", err);
+    }
+    if (out_.empty()) out_.resize(kInflateChunk);
+    state_ = State::Data;
+    return true;
+}
+
+bool ZipStreamReader::emit(const char* data, size_t len, std::string& err) {
+    if (len == 0) return true;
+    crc_ = crc32Update(crc_, data, len);
+    produced_ += len;
+    if (skip_ || !handler_.onData) return true;
+    if (!handler_.onData(data, len)) return fail("ZIP entry write failed: " + entry_.name, err);
+    return true;
+}
+
+bool ZipStreamReader::dataStored(const char*& p, size_t& n, std::string& err) {
+    const size_t k = static_cast<size_t>(std::min<uint64_t>(n, remaining_));
+    if (!emit(p, k, err)) return false;
+    p += k;
+    n -= k;
+    remaining_ -= k;
+    compressedRead_ += k;
+    return remaining_ > 0 ? true : endData(err);
+}
+
+bool ZipStreamReader::dataDeflate(const char*& p, size_t& n, std::string& err) {
+    z_stream& z = inflater_->z;
+    const size_t avail = std::min<size_t>(n, static_cast<size_t>(INT_MAX));
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(p));
+    z.avail_in = static_cast<uInt>(avail);
+    int ret = Z_OK;
+    do {
+        z.next_out = reinterpret_cast<Bytef*>(out_.data());
+        z.avail_out = static_cast<uInt>(out_.size());
+        ret = inflate(&z, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            return fail("Inflate failed in " + entry_.name + (z.msg ? std::string(": ") + z.msg : ""), err);
+        }
+        if (!emit(out_.data(), out_.size() - z.avail_out, err)) return false;
+    } while (ret != Z_STREAM_END && (z.avail_in > 0 || z.avail_out == 0) && ret != Z_BUF_ERROR);
+    const size_t used = avail - z.avail_in;
+    p += used;
+    n -= used;
+    compressedRead_ += used;
+    if (!entry_.sizesInDescriptor && compressedRead_ > entry_.compressedSize) {
+        return fail("Deflate data overruns its entry: " + entry_.name, err);
+    }
+    return ret == Z_STREAM_END ? endData(err) : true;
+}
+
+bool ZipStreamReader::endData(std::string& err) {
+    if (!entry_.sizesInDescriptor) return endEntry(err);
+    state_ = State::Descriptor;
+    descriptorSigChecked_ = false;
+    buf_.clear();
+    return true;
+}
+
+bool ZipStreamReader::endEntry(std::string& err) {
+    if (produced_ != entry_.uncompressedSize) {
+        return fail("ZIP size mismatch in " + entry_.name + " (" + std::to_string(produced_) + " != " +
+                        std::to_string(entry_.uncompressedSize) + ")",
+                    err);
+    }
+    if (compressedRead_ != entry_.compressedSize) {
+        return fail("ZIP compressed size mismatch in " + entry_.name, err);
+    }
+    if (crc_ != entry_.crc32) return fail("ZIP CRC mismatch in " + entry_.name, err);
+    if (!skip_ && handler_.onEntryEnd && !handler_.onEntryEnd(entry_)) {
+        return fail("ZIP entry finalize failed: " + entry_.name, err);
+    }
+    state_ = State::Signature;
+    buf_.clear();
+    return true;
+}
+
+bool ZipStreamReader::feed(const char* data, size_t len, std::string& err) {
+    if (state_ == State::Failed) {
+        err = "ZIP reader already failed";
+        return false;
+    }
+    const char* p = data;
+    size_t n = len;
+    while (n > 0) {
+        switch (state_) {
+            case State::Signature: {
+                if (!take(p, n, 4)) return true;
+                const uint32_t sig = le32(buf_.data());
+                buf_.clear();
+                if (sig == kLocalHeaderSig) {
+                    state_ = State::Header;
+                } else if (sig == kCentralHeaderSig || sig == kEndOfCentralSig || sig == kZip64EndSig) {
+                    state_ = State::Done;
+                } else {
+                    return fail("Bad ZIP signature", err);
+                }
+                break;
+            }
+            case State::Header:
+                if (!take(p, n, kLocalHeaderRest)) return true;
+                parseHeader();
+                buf_.clear();
+                state_ = State::Names;
+                if (nameLen_ + extraLen_ == 0) return fail("ZIP entry without a name", err);
+                break;
+            case State::Names:
+                if (!take(p, n, static_cast<size_t>(nameLen_) + extraLen_)) return true;
+                parseNames();
+                buf_.clear();
+                if (!startData(err)) return false;
+                break;
+            case State::Data:
+                if (!(entry_.method == 0 ? dataStored(p, n, err) : dataDeflate(p, n, err))) return false;
+                break;
+            case State::Descriptor: {
+                if (!descriptorSigChecked_) {
+                    if (!take(p, n, 4)) return true;
+                    descriptorSigChecked_ = true;
+                    if (le32(buf_.data()) == kDescriptorSig) buf_.clear(); // optional signature
+                }
+                const size_t want = 4 + (entry_.zip64 ? 16 : 8);
+                if (!take(p, n, want)) return true;
+                entry_.crc32 = le32(buf_.data());
+                if (entry_.zip64) {
+                    entry_.compressedSize = le64(buf_.data() + 4);
+                    entry_.uncompressedSize = le64(buf_.data() + 12);
+                } else {
+                    entry_.compressedSize = le32(buf_.data() + 4);
+                    entry_.uncompressedSize = le32(buf_.data() + 8);
+                }
+                if (!endEntry(err)) return false;
+                break;
+            }
+            case State::Done:
+                return true; // central directory: nothing left to extract
+            case State::Failed:
+                return false;
+        }
+    }
+    return true;
+}
+
+} // namespace romm
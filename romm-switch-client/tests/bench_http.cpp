@@ -0,0 +1,106 @@
+// Host benchmark for bursts of small requests over HTTP/1.1 vs HTTP/2 (not part of romm_tests).
+// Usage: romm_bench_http <baseUrl> [bursts] [coversPerBurst] [pagePath] [coverPath]
+// Each burst is what opening a platform does: one API page plus a screenful of covers, all submitted
+// at once. Point it at a local server that speaks both protocols (see docs/downloads.md).
+#include "romm/http_engine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Result {
+    std::vector<double> burstMs;
+    std::vector<double> requestMs;
+    uint64_t failed{0};
+    uint64_t connOpened{0};
+    uint64_t http2Requests{0};
+    uint64_t http2Fallbacks{0};
+};
+
+double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    const size_t i = std::min(v.size() - 1, static_cast<size_t>(p * static_cast<double>(v.size() - 1) + 0.5));
+    return v[i];
+}
+
+// A fresh engine per mode, so neither run inherits the other's connections.
+Result run(bool http2, const std::string& base, int bursts, int covers, const std::string& pagePath,
+           const std::string& coverPath) {
+    Result r;
+    romm::HttpEngine engine;
+    if (http2 && !engine.setHttp2(true)) {
+        std::fprintf(stderr, "libcurl has no HTTP/2 support\n");
+        return r;
+    }
+    for (int b = 0; b < bursts; ++b) {
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<romm::HttpCallPtr> calls;
+        std::vector<double> doneMs(static_cast<size_t>(covers) + 1, 0);
+        for (int i = 0; i <= covers; ++i) {
+            romm::HttpRequest req;
+            req.url = base + (i == 0 ? pagePath : coverPath);
+            req.options.timeoutSec = 10;
+            req.options.keepAlive = true;
+            double* slot = &doneMs[static_cast<size_t>(i)];
+            req.onDone = [slot, start](romm::HttpResult&) { *slot = msSince(start); };
+            calls.push_back(engine.submit(std::move(req)));
+        }
+        for (auto& call : calls) {
+            const romm::HttpResult& res = call->wait();
+            if (!res.ok || res.parsed.statusCode >= 400) {
+                if (r.failed++ == 0) std::fprintf(stderr, "request failed: %s (status %d)\n", res.err.c_str(),
+                                                  res.parsed.statusCode);
+            }
+        }
+        r.burstMs.push_back(msSince(start));
+        r.requestMs.insert(r.requestMs.end(), doneMs.begin(), doneMs.end());
+    }
+    const romm::HttpEngineStats& s = engine.stats();
+    r.connOpened = s.connOpened.load();
+    r.http2Requests = s.http2Requests.load();
+    r.http2Fallbacks = s.http2Fallbacks.load();
+    engine.shutdown();
+    return r;
+}
+
+void report(const char* label, const Result& r) {
+    // The first burst pays for the connects and handshakes; the percentiles mostly show warm ones.
+    std::printf("%-9s first %7.2f ms  burst p50 %7.2f ms  p95 %7.2f ms  request p50 %7.2f ms  p95 %7.2f ms  "
+                "connections %3llu  h2 %llu  fallbacks %llu  failed %llu\n",
+                label, r.burstMs.empty() ? 0.0 : r.burstMs.front(), percentile(r.burstMs, 0.5), percentile(r.burstMs, 0.95), percentile(r.requestMs, 0.5),
+                percentile(r.requestMs, 0.95), static_cast<unsigned long long>(r.connOpened),
+                static_cast<unsigned long long>(r.http2Requests), static_cast<unsigned long long>(r.http2Fallbacks),
+                static_cast<unsigned long long>(r.failed));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <baseUrl> [bursts] [coversPerBurst] [pagePath] [coverPath]\n", argv[0]);
+        return 2;
+    }
+    const std::string base = argv[1];
+    const int bursts = argc > 2 ? std::max(1, std::atoi(argv[2])) : 50;
+    const int covers = argc > 3 ? std::max(0, std::atoi(argv[3])) : 12;
+    const std::string pagePath = argc > 4 ? argv[4] : "/";
+    const std::string coverPath = argc > 5 ? argv[5] : "/";
+
+    std::printf("%s: %d bursts of 1 page + %d covers\n", base.c_str(), bursts, covers);
+    const Result h1 = run(false, base, bursts, covers, pagePath, coverPath);
+    report("HTTP/1.1", h1);
+    const Result h2 = run(true, base, bursts, covers, pagePath, coverPath);
+    report("HTTP/2", h2);
+    romm::httpShutdown();
+    return (h1.failed || h2.failed) ? 1 : 0;
+}
@@ -0,0 +1,130 @@
+// Host benchmark for the SD write path (not part of romm_tests).
+// Usage: romm_bench_write [dir] [MB] [partMB] [rawBlockKB]
+// Point `dir` at a loopback-mounted FAT32/exFAT image to approximate the Switch SD card.
+#include "romm/part_writer.hpp"
+#include "romm/sha256.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t kChunkBytes = 1024 * 1024;  // matches the downloader's write block
+constexpr size_t kStdioBufferBytes = 256 * 1024; // downloader's stdio buffer
+
+struct Result {
+    bool ok{false};
+    double seconds{0};
+};
+
+Result runOnce(const std::string& dir,
+               uint64_t totalBytes,
+               uint64_t partBytes,
+               bool preallocate,
+               romm::WriteBackend backend,
+               size_t ioBufferBytes,
+               bool hash) {
+    Result r;
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+    std::filesystem::create_directories(dir, ec);
+
+    std::vector<char> chunk(kChunkBytes);
+    for (size_t i = 0; i < chunk.size(); ++i) chunk[i] = static_cast<char>(i * 31 + 7);
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        romm::PartWriter w(dir, partBytes, ioBufferBytes, backend);
+        if (preallocate) w.setPreallocate(totalBytes);
+        if (hash) w.enableHashing();
+        std::string err;
+        for (uint64_t off = 0; off < totalBytes; off += chunk.size()) {
+            size_t n = static_cast<size_t>(std::min<uint64_t>(chunk.size(), totalBytes - off));
+            if (!w.write(off, chunk.data(), n, err)) {
+                std::fprintf(stderr, "write failed at %llu: %s\n", static_cast<unsigned long long>(off), err.c_str());
+                return r;
+            }
+        }
+        if (!w.flush(err)) {
+            std::fprintf(stderr, "flush failed: %s\n", err.c_str());
+            return r;
+        }
+    }
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    r.ok = true;
+    std::filesystem::remove_all(dir, ec);
+    return r;
+}
+
+void report(const char* label, const Result& r, uint64_t totalBytes) {
+    if (!r.ok) {
+        std::printf("%-22s failed\n", label);
+        return;
+    }
+    double mb = static_cast<double>(totalBytes) / (1024.0 * 1024.0);
+    std::printf("%-22s %8.2f s  %8.1f MB/s\n", label, r.seconds, r.seconds > 0 ? mb / r.seconds : 0.0);
+}
+
+// In-memory SHA-256 throughput: the ceiling for hashing on the writer thread.
+void reportHash(uint64_t totalBytes) {
+    std::vector<char> chunk(kChunkBytes);
+    for (size_t i = 0; i < chunk.size(); ++i) chunk[i] = static_cast<char>(i * 13 + 1);
+    romm::Sha256 sha;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t off = 0; off < totalBytes; off += chunk.size()) {
+        sha.update(chunk.data(), static_cast<size_t>(std::min<uint64_t>(chunk.size(), totalBytes - off)));
+    }
+    volatile uint8_t sink = sha.digest()[0];
+    (void)sink;
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double mb = static_cast<double>(totalBytes) / (1024.0 * 1024.0);
+    std::printf("%-22s %8.2f s  %8.1f MB/s (%s)\n", "sha256 only", secs, secs > 0 ? mb / secs : 0.0,
+                romm::Sha256::accelerated() ? "armv8 sha2" : "portable");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string base = argc > 1 ? argv[1] : (std::filesystem::temp_directory_path() / "romm_bench").string();
+    uint64_t totalMb = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 512;
+    uint64_t partMb = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 256;
+    uint64_t rawKb = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 2048;
+    if (totalMb == 0 || partMb == 0 || rawKb == 0) {
+        std::fprintf(stderr, "usage: %s [dir] [MB] [partMB] [rawBlockKB]\n", argv[0]);
+        return 2;
+    }
+    const uint64_t totalBytes = totalMb * 1024 * 1024;
+    const uint64_t partBytes = partMb * 1024 * 1024;
+    const std::string dir = base + "/bench.tmp";
+    const size_t rawBytes = static_cast<size_t>(rawKb * 1024);
+    std::printf("dir=%s total=%lluMB part=%lluMB chunk=%zuKB rawBlock=%lluKB\n", dir.c_str(),
+                static_cast<unsigned long long>(totalMb), static_cast<unsigned long long>(partMb), kChunkBytes / 1024,
+                static_cast<unsigned long long>(rawKb));
+
+    struct Variant {
+        const char* label;
+        bool preallocate;
+        romm::WriteBackend backend;
+        size_t bufferBytes;
+        bool hash;
+    };
+    const Variant variants[] = {
+        {"stdio append", false, romm::WriteBackend::Stdio, kStdioBufferBytes, false},
+        {"stdio preallocated", true, romm::WriteBackend::Stdio, kStdioBufferBytes, false},
+        {"raw append", false, romm::WriteBackend::Raw, rawBytes, false},
+        {"raw preallocated", true, romm::WriteBackend::Raw, rawBytes, false},
+        {"stdio prealloc+sha256", true, romm::WriteBackend::Stdio, kStdioBufferBytes, true},
+    };
+    reportHash(totalBytes);
+    bool allOk = true;
+    for (const auto& v : variants) {
+        Result r = runOnce(dir, totalBytes, partBytes, v.preallocate, v.backend, v.bufferBytes, v.hash);
+        report(v.label, r, totalBytes);
+        allOk = allOk && r.ok;
+    }
+    return allOk ? 0 : 1;
+}
@@ -3,6 +3,43 @@
 #include "romm/api.hpp"
 #include "romm/http_common.hpp"
 
+#include <zlib.h>
+
+namespace {
+// windowBits as for deflateInit2: 31 = gzip, 15 = zlib, -15 = raw deflate.
+std::string compress(const std::string& in, int windowBits) {
+    z_stream z{};
+    REQUIRE(deflateInit2(&z, Z_BEST_COMPRESSION, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+    std::string out(deflateBound(&z, static_cast<uLong>(in.size())), '\0');
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    z.avail_in = static_cast<uInt>(in.size());
+    z.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    z.avail_out = static_cast<uInt>(out.size());
+    REQUIRE(deflate(&z, Z_FINISH) == Z_STREAM_END);
+    out.resize(z.total_out);
+    deflateEnd(&z);
+    return out;
+}
+
+std::string catalogJson() {
+    std::string json = "[";
+    for (int i = 0; i < 500; ++i) {
+        if (i) json += ",";
+        json += "{\"id\":" + std::to_string(i) + ",\"name\":\"Game " + std::to_string(i) +
+                "\",\"platform_slug\":\"switch\",\"fs_size_bytes\":" + std::to_string(1000000 + i) + "}";
+    }
+    return json + "]";
+}
+
+// Feed `wire` in pieces of `step` bytes.
+bool decodeAll(romm::HttpBodyDecoder& dec, const std::string& wire, size_t step, std::string& out, std::string& err) {
+    for (size_t off = 0; off < wire.size(); off += step) {
+        if (!dec.write(wire.data() + off, std::min(step, wire.size() - off), out, err)) return false;
+    }
+    return dec.finish(err);
+}
+} // namespace
+
 TEST_CASE("httpRequestStreamMock parses status and headers") {
     const std::string raw =
         "HTTP/1.1 206 Partial Content\r\n"
@@ -158,3 +195,72 @@ TEST_CASE("parseHttpResponseHeaders parses Connection close and Location") {
     REQUIRE(parsed.connectionClose);
     REQUIRE(parsed.location == "https://example.com/new");
 }
+
+TEST_CASE("parseHttpResponseHeaders records Content-Encoding") {
+    romm::ParsedHttpResponse parsed;
+    std::string err;
+    REQUIRE(romm::parseHttpResponseHeaders("HTTP/1.1 200 OK\r\nContent-Encoding: GZip \r\nContent-Length: 10",
+                                           parsed, err));
+    REQUIRE(parsed.contentEncoding == "gzip");
+    romm::HttpBodyDecoder::Coding coding;
+    REQUIRE(romm::HttpBodyDecoder::codingOf(parsed.contentEncoding, coding));
+    REQUIRE(coding == romm::HttpBodyDecoder::Coding::Gzip);
+    REQUIRE_FALSE(romm::HttpBodyDecoder::codingOf("br", coding));
+    REQUIRE_FALSE(romm::HttpBodyDecoder::codingOf("", coding));
+}
+
+TEST_CASE("HttpBodyDecoder decodes gzip and both deflate forms in any split") {
+    const std::string json = catalogJson();
+    struct Form {
+        romm::HttpBodyDecoder::Coding coding;
+        int windowBits;
+    };
+    for (const Form& form : {Form{romm::HttpBodyDecoder::Coding::Gzip, 31}, Form{romm::HttpBodyDecoder::Coding::Deflate, 15},
+                             Form{romm::HttpBodyDecoder::Coding::Deflate, -15}}) {
+        const std::string wire = compress(json, form.windowBits);
+        REQUIRE(wire.size() * 4 < json.size());
+        for (size_t step : {size_t(1), size_t(7), size_t(4096), wire.size()}) {
+            romm::HttpBodyDecoder dec(form.coding, 0);
+            std::string out;
+            std::string err;
+            REQUIRE(decodeAll(dec, wire, step, out, err));
+            REQUIRE(out == json);
+        }
+    }
+}
+
+TEST_CASE("HttpBodyDecoder caps the decoded size and rejects broken bodies") {
+    const std::string json = catalogJson();
+    const std::string wire = compress(json, 31);
+    std::string out;
+    std::string err;
+
+    // The cap applies to what the body expands to, not to the bytes on the wire.
+    romm::HttpBodyDecoder capped(romm::HttpBodyDecoder::Coding::Gzip, wire.size() * 2);
+    REQUIRE_FALSE(decodeAll(capped, wire, 1024, out, err));
+    REQUIRE(capped.exceeded());
+    REQUIRE(err == "HTTP body exceeds configured max size");
+    REQUIRE(out.size() <= wire.size() * 2);
+
+    romm::HttpBodyDecoder exact(romm::HttpBodyDecoder::Coding::Gzip, json.size());
+    out.clear();
+    REQUIRE(decodeAll(exact, wire, 1024, out, err));
+
+    romm::HttpBodyDecoder truncated(romm::HttpBodyDecoder::Coding::Gzip, 0);
+    out.clear();
+    REQUIRE_FALSE(decodeAll(truncated, wire.substr(0, wire.size() - 8), 1024, out, err));
+    REQUIRE(err == "Truncated compressed body");
+
+    romm::HttpBodyDecoder corrupt(romm::HttpBodyDecoder::Coding::Gzip, 0);
+    out.clear();
+    REQUIRE_FALSE(decodeAll(corrupt, "this is not gzip at all", 4, out, err));
+    REQUIRE_FALSE(corrupt.exceeded());
+
+    romm::HttpBodyDecoder trailing(romm::HttpBodyDecoder::Coding::Gzip, 0);
+    out.clear();
+    REQUIRE_FALSE(decodeAll(trailing, wire + "junk", 1 << 20, out, err));
+    REQUIRE(err == "Data after the end of the compressed body");
+
+    romm::HttpBodyDecoder empty(romm::HttpBodyDecoder::Coding::Deflate, 0);
+    REQUIRE(empty.finish(err));
+}
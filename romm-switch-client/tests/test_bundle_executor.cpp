@@ -0,0 +1,124 @@
+#include "catch.hpp"
+#include "romm/bundle_executor.hpp"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+
+TEST_CASE("runBoundedTasks runs every task and caps concurrency") {
+    std::atomic<int> inFlight{0};
+    std::atomic<int> peak{0};
+    std::mutex seenMutex;
+    std::set<size_t> seen;
+    bool ok = romm::runBoundedTasks(
+        10, 3,
+        [&](size_t i) {
+            int now = inFlight.fetch_add(1) + 1;
+            int prev = peak.load();
+            while (now > prev && !peak.compare_exchange_weak(prev, now)) {}
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            {
+                std::lock_guard<std::mutex> lock(seenMutex);
+                seen.insert(i);
+            }
+            inFlight.fetch_sub(1);
+            return true;
+        },
+        {}, {}, 1);
+    REQUIRE(ok);
+    REQUIRE(seen.size() == 10);
+    REQUIRE(peak.load() <= 3);
+    REQUIRE(peak.load() >= 2);
+}
+
+TEST_CASE("runBoundedTasks stops dispatching after a failure") {
+    std::atomic<int> started{0};
+    bool ok = romm::runBoundedTasks(
+        20, 1,
+        [&](size_t i) {
+            started.fetch_add(1);
+            return i != 2;
+        },
+        {}, {}, 1);
+    REQUIRE_FALSE(ok);
+    REQUIRE(started.load() == 3);
+}
+
+TEST_CASE("runBoundedTasks honors shouldStop and ticks the caller") {
+    std::atomic<bool> stop{false};
+    std::atomic<int> started{0};
+    int ticks = 0;
+    bool ok = romm::runBoundedTasks(
+        50, 2,
+        [&](size_t) {
+            if (started.fetch_add(1) + 1 >= 4) stop.store(true);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            return true;
+        },
+        [&]() { return stop.load(); },
+        [&]() { ticks++; }, 1);
+    REQUIRE_FALSE(ok);
+    REQUIRE(started.load() < 50);
+    REQUIRE(ticks >= 1);
+}
+
+TEST_CASE("runBoundedTasks with no tasks succeeds") {
+    REQUIRE(romm::runBoundedTasks(0, 4, [](size_t) { return false; }));
+}
+
+TEST_CASE("A failed file takes back only its own bytes while a sibling keeps counting") {
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> fileBytes[2];
+    fileBytes[0] = 0;
+    fileBytes[1] = 0;
+    std::atomic<bool> attemptStarted{false};
+    std::atomic<bool> siblingDone{false};
+    auto add = [&](size_t i, uint64_t n) {
+        fileBytes[i].fetch_add(n);
+        total.fetch_add(n);
+    };
+    // File 1 resumes with 300 bytes, streams 200 more, then fails after file 0 downloaded all of its
+    // 1000 bytes during that attempt.
+    fileBytes[1] = 300;
+    total = 300;
+    bool ok = romm::runBoundedTasks(
+        2, 2,
+        [&](size_t i) {
+            if (i == 0) {
+                while (!attemptStarted.load()) std::this_thread::yield();
+                for (int c = 0; c < 10; ++c) add(0, 100);
+                siblingDone = true;
+                return true;
+            }
+            const uint64_t haveBefore = fileBytes[1].load();
+            attemptStarted = true;
+            add(1, 120);
+            add(1, 80);
+            while (!siblingDone.load()) std::this_thread::yield();
+            romm::rollbackFileCredit(fileBytes[1], total, haveBefore);
+            return false;
+        },
+        {}, {}, 1);
+    REQUIRE_FALSE(ok);
+    REQUIRE(fileBytes[0].load() == 1000);
+    REQUIRE(fileBytes[1].load() == 300);
+    REQUIRE(total.load() == 1300);
+
+    // The retry keeps 150 bytes the failed attempt had checkpointed.
+    romm::creditFileBytes(fileBytes[1], total, 450);
+    REQUIRE(fileBytes[1].load() == 450);
+    REQUIRE(total.load() == 1450);
+    romm::creditFileBytes(fileBytes[1], total, 450);
+    REQUIRE(total.load() == 1450);
+}
+
+TEST_CASE("rollbackFileCredit never takes the total below zero") {
+    std::atomic<uint64_t> fileBytes{500};
+    std::atomic<uint64_t> total{200};
+    romm::rollbackFileCredit(fileBytes, total, 0);
+    REQUIRE(fileBytes.load() == 0);
+    REQUIRE(total.load() == 0);
+    romm::rollbackFileCredit(fileBytes, total, 0);
+    REQUIRE(total.load() == 0);
+}
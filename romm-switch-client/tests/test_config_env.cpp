@@ -81,6 +81,26 @@ TEST_CASE("parseEnvString normalizes booleans and log level") {
     REQUIRE(cfg.logLevel == "debug");
 }
 
+TEST_CASE("parseEnvString reads part-file write options") {
+    const std::string env =
+        "server_url=http://ok\n"
+        "download_dir=sdmc:/romm_cache/switch\n"
+        "preallocate_parts=no\n"
+        "write_backend=RAW\n";
+    romm::Config cfg;
+    std::string err;
+    REQUIRE(romm::parseEnvString(env, cfg, err));
+    REQUIRE(cfg.preallocateParts == false);
+    REQUIRE(cfg.writeBackend == "raw");
+
+    romm::Config json;
+    REQUIRE(romm::parseJsonString("{\"serverUrl\":\"http://ok\",\"downloadDir\":\"sdmc:/x\","
+                                  "\"writeBackend\":\"stdio\",\"preallocateParts\":true}",
+                                  json, err));
+    REQUIRE(json.writeBackend == "stdio");
+    REQUIRE(json.preallocateParts == true);
+}
+
 TEST_CASE("parseEnvString ignores comments (full-line and inline)") {
     const std::string env =
         "# full line comment\n"
@@ -189,3 +209,74 @@ TEST_CASE("parseJsonString rejects unsupported schema version") {
     REQUIRE_FALSE(ok);
     REQUIRE(err.find("Unsupported config schema_version") != std::string::npos);
 }
+
+TEST_CASE("parseEnvString reads rate limit options") {
+    const std::string env =
+        "server_url=http://ok\n"
+        "download_dir=sdmc:/romm_cache/switch\n"
+        "RATE_LIMIT_KBPS=2048\n"
+        "rate_limit_burst_kb=512\n"
+        "rate_limit_schedule=08:00-18:00=256,23:00-07:00=0\n";
+    romm::Config cfg;
+    std::string err;
+    REQUIRE(romm::parseEnvString(env, cfg, err));
+    REQUIRE(cfg.rateLimitKBps == 2048);
+    REQUIRE(cfg.rateLimitBurstKB == 512);
+    REQUIRE(cfg.rateLimitSchedule == "08:00-18:00=256,23:00-07:00=0");
+
+    romm::Config json;
+    REQUIRE(romm::parseJsonString("{\"serverUrl\":\"http://ok\",\"downloadDir\":\"sdmc:/x\","
+                                  "\"rateLimitKBps\":100,\"rateLimitSchedule\":\"00:00-06:00=0\"}",
+                                  json, err));
+    REQUIRE(json.rateLimitKBps == 100);
+    REQUIRE(json.rateLimitBurstKB == 0);
+    REQUIRE(json.rateLimitSchedule == "00:00-06:00=0");
+}
+
+TEST_CASE("archive_bundles defaults off and parses from env and json") {
+    romm::Config cfg;
+    std::string err;
+    REQUIRE(romm::parseEnvString("server_url=http://ok\ndownload_dir=sdmc:/x\n", cfg, err));
+    REQUIRE_FALSE(cfg.archiveBundles);
+
+    romm::Config on;
+    REQUIRE(romm::parseEnvString("server_url=http://ok\ndownload_dir=sdmc:/x\nARCHIVE_BUNDLES=yes\n", on, err));
+    REQUIRE(on.archiveBundles);
+
+    romm::Config json;
+    REQUIRE(romm::parseJsonString("{\"serverUrl\":\"http://ok\",\"downloadDir\":\"sdmc:/x\",\"archiveBundles\":true}",
+                                  json, err));
+    REQUIRE(json.archiveBundles);
+}
+
+TEST_CASE("http2 defaults off and parses from env and json") {
+    romm::Config cfg;
+    std::string err;
+    REQUIRE(romm::parseEnvString("server_url=http://ok\ndownload_dir=sdmc:/x\n", cfg, err));
+    REQUIRE_FALSE(cfg.http2);
+
+    romm::Config on;
+    REQUIRE(romm::parseEnvString("server_url=http://ok\ndownload_dir=sdmc:/x\nHTTP2=true\n", on, err));
+    REQUIRE(on.http2);
+
+    romm::Config json;
+    REQUIRE(romm::parseJsonString("{\"server_url\":\"http://ok\",\"download_dir\":\"sdmc:/x\",\"HTTP2\":true}",
+                                  json, err));
+    REQUIRE(json.http2);
+}
+
+TEST_CASE("http_cache_mb defaults to 32 and parses from env and json") {
+    romm::Config cfg;
+    std::string err;
+    REQUIRE(romm::parseEnvString("server_url=http://ok\ndownload_dir=sdmc:/x\n", cfg, err));
+    REQUIRE(cfg.httpCacheMb == 32);
+
+    romm::Config off;
+    REQUIRE(romm::parseEnvString("server_url=http://ok\ndownload_dir=sdmc:/x\nHTTP_CACHE_MB=0\n", off, err));
+    REQUIRE(off.httpCacheMb == 0);
+
+    romm::Config json;
+    REQUIRE(romm::parseJsonString("{\"server_url\":\"http://ok\",\"download_dir\":\"sdmc:/x\",\"HTTP_CACHE_MB\":64}",
+                                  json, err));
+    REQUIRE(json.httpCacheMb == 64);
+}
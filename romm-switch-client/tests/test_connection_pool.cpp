@@ -0,0 +1,99 @@
+#include "catch.hpp"
+#include "romm/connection_pool.hpp"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+// Handles are opaque to the pool; tests use ints and count how many were destroyed.
+std::vector<int*> gDestroyed;
+void destroyInt(void* h) { gDestroyed.push_back(static_cast<int*>(h)); }
+} // namespace
+
+TEST_CASE("ConnectionPool hands idle handles back per origin, most recent first") {
+    gDestroyed.clear();
+    int a = 1, b = 2, c = 3;
+    romm::ConnectionPool pool(8, destroyInt);
+    REQUIRE(pool.acquire("http://host:80") == nullptr);
+
+    pool.release("http://host:80", &a);
+    pool.release("https://host:443", &b);
+    pool.release("http://host:80", &c);
+    REQUIRE(pool.idleCount() == 3);
+
+    REQUIRE(pool.acquire("http://host:80") == &c);
+    REQUIRE(pool.acquire("http://host:80") == &a);
+    REQUIRE(pool.acquire("http://host:80") == nullptr);
+    REQUIRE(pool.acquire("https://host:443") == &b);
+    REQUIRE(pool.idleCount() == 0);
+    REQUIRE(gDestroyed.empty());
+}
+
+TEST_CASE("ConnectionPool closes the least recently parked handle beyond maxIdle and on clear") {
+    gDestroyed.clear();
+    int h[4] = {0, 1, 2, 3};
+    romm::ConnectionStats stats;
+    {
+        romm::ConnectionPool pool(2, destroyInt);
+        pool.setStats(&stats);
+        pool.release("o", &h[0]);
+        pool.release("o", &h[1]);
+        pool.release("o", &h[2]);
+        REQUIRE(pool.idleCount() == 2);
+        REQUIRE(gDestroyed == std::vector<int*>{&h[0]});
+        REQUIRE(stats.evicted.load() == 1);
+
+        pool.release("p", &h[3]);
+        REQUIRE(gDestroyed == std::vector<int*>{&h[0], &h[1]});
+        pool.clear();
+        REQUIRE(pool.idleCount() == 0);
+        REQUIRE(gDestroyed.size() == 4);
+
+        pool.release("o", &h[0]);
+    }
+    // The destructor closes what is still idle.
+    REQUIRE(gDestroyed.size() == 5);
+}
+
+TEST_CASE("ConnectionPool counts reused and newly opened connections") {
+    romm::ConnectionStats stats;
+    romm::ConnectionPool pool;
+    pool.noteRequest(1, 150); // ignored: no stats attached yet
+    pool.setStats(&stats);
+    pool.noteRequest(1, 150);
+    pool.noteRequest(0, 0);
+    pool.noteRequest(0, 0);
+    pool.noteRequest(2, 300); // a redirect or reconnect inside one request
+    REQUIRE(stats.requests.load() == 4);
+    REQUIRE(stats.reused.load() == 2);
+    REQUIRE(stats.opened.load() == 3);
+    REQUIRE(stats.connectMs.load() == 450);
+    stats.reset();
+    REQUIRE(stats.requests.load() == 0);
+}
+
+TEST_CASE("ConnectionPool never hands one handle to two threads") {
+    romm::ConnectionPool pool(4);
+    std::vector<int> handles(4);
+    for (auto& h : handles) pool.release("o", &h);
+    std::atomic<int> inUse[4] = {};
+    std::atomic<bool> clash{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 2000; ++i) {
+                void* h = pool.acquire("o");
+                if (!h) continue;
+                const size_t idx = static_cast<size_t>(static_cast<int*>(h) - handles.data());
+                if (inUse[idx].fetch_add(1) != 0) clash = true;
+                inUse[idx].fetch_sub(1);
+                pool.release("o", h);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    REQUIRE_FALSE(clash.load());
+    REQUIRE(pool.idleCount() == 4);
+}
@@ -0,0 +1,147 @@
+#include "catch.hpp"
+#include "romm/crc32.hpp"
+#include "romm/part_writer.hpp"
+
+#include <filesystem>
+#include <string>
+
+namespace {
+std::string pattern(size_t n) {
+    std::string s(n, '\0');
+    for (size_t i = 0; i < n; ++i) s[i] = static_cast<char>((i * 131 + i / 977) & 0xFF);
+    return s;
+}
+
+uint32_t crcOf(const std::string& s, size_t start = 0, size_t len = std::string::npos) {
+    const std::string sub = s.substr(start, len);
+    return romm::crc32Update(0, sub.data(), sub.size());
+}
+} // namespace
+
+TEST_CASE("crc32Update matches the standard check values") {
+    REQUIRE(romm::crc32Update(0, "", 0) == 0u);
+    REQUIRE(romm::crc32Update(0, "123456789", 9) == 0xCBF43926u);
+    REQUIRE(romm::crc32Update(0, "The quick brown fox jumps over the lazy dog", 43) == 0x414FA339u);
+
+    // Any split (unaligned heads and tails included) continues to the same value.
+    const std::string data = pattern(4099);
+    const uint32_t whole = crcOf(data);
+    for (size_t split : {size_t(1), size_t(7), size_t(8), size_t(33), size_t(2048), size_t(4098)}) {
+        const uint32_t head = crcOf(data, 0, split);
+        REQUIRE(romm::crc32Update(head, data.data() + split, data.size() - split) == whole);
+    }
+
+    uint32_t parsed = 0;
+    REQUIRE(romm::crc32ToHex(0x0BF43926u) == "0bf43926");
+    REQUIRE(romm::crc32FromHex("CBF43926", parsed));
+    REQUIRE(parsed == 0xCBF43926u);
+    REQUIRE_FALSE(romm::crc32FromHex("cbf4392", parsed));
+    REQUIRE_FALSE(romm::crc32FromHex("cbf4392g", parsed));
+}
+
+TEST_CASE("crc32Combine joins independently computed pieces") {
+    const std::string data = pattern(70000);
+    for (size_t split : {size_t(0), size_t(1), size_t(65536), size_t(69999), size_t(70000)}) {
+        const uint32_t a = crcOf(data, 0, split);
+        const uint32_t b = crcOf(data, split);
+        REQUIRE(romm::crc32Combine(a, b, data.size() - split) == crcOf(data));
+    }
+}
+
+TEST_CASE("FileCrc assembles a file written out of order") {
+    const std::string data = pattern(10000);
+    romm::FileCrc crc;
+    // Three segments arriving interleaved, the way segmented downloads commit them.
+    crc.update(6000, data.data() + 6000, 1000);
+    crc.update(0, data.data(), 2500);
+    crc.update(3000, data.data() + 3000, 1500);
+    crc.update(7000, data.data() + 7000, 3000);
+    crc.update(4500, data.data() + 4500, 1500);
+    REQUIRE(crc.runCount() == 2);
+    REQUIRE(crc.prefixEnd() == 2500);
+    REQUIRE(crc.prefixCrc() == crcOf(data, 0, 2500));
+    uint32_t value = 0;
+    REQUIRE_FALSE(crc.whole(data.size(), value));
+    const auto gaps = crc.missing(data.size());
+    REQUIRE(gaps.size() == 1);
+    REQUIRE(gaps[0].start == 2500);
+    REQUIRE(gaps[0].end == 3000);
+
+    crc.update(2500, data.data() + 2500, 500);
+    REQUIRE(crc.runCount() == 1);
+    REQUIRE(crc.whole(data.size(), value));
+    REQUIRE(value == crcOf(data));
+
+    // Rewriting bytes inside a run drops it: the run no longer provably matches the file.
+    crc.update(100, data.data() + 100, 10);
+    REQUIRE(crc.prefixEnd() == 0);
+    REQUIRE_FALSE(crc.whole(data.size(), value));
+}
+
+TEST_CASE("FileCrc resumes from a seed and keeps only durable runs") {
+    const std::string data = pattern(8192);
+    romm::FileCrc crc;
+    crc.seed(4096, crcOf(data, 0, 4096));
+    crc.update(4096, data.data() + 4096, 1024);
+    crc.update(6144, data.data() + 6144, 2048);
+    REQUIRE(crc.prefixEnd() == 5120);
+
+    romm::RangeSet durable;
+    durable.add(0, 5120);
+    durable.add(6144, 7000); // the tail segment was only partly flushed
+    crc.keepInside(durable);
+    REQUIRE(crc.runCount() == 1);
+    REQUIRE(crc.prefixEnd() == 5120);
+    REQUIRE(crc.prefixCrc() == crcOf(data, 0, 5120));
+}
+
+TEST_CASE("completeFileCrc reads back only what the streams missed") {
+    const std::string data = pattern(300 * 1024);
+    const uint64_t partSize = 128 * 1024;
+    auto dir = std::filesystem::temp_directory_path() / "romm_crc32_parts";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    {
+        romm::PartWriter writer(dir.string(), partSize);
+        std::string err;
+        REQUIRE(writer.write(0, data.data(), data.size(), err));
+        writer.close();
+    }
+
+    romm::FileCrc crc;
+    crc.update(0, data.data(), 100 * 1024);
+    crc.update(200 * 1024, data.data() + 200 * 1024, 50 * 1024);
+    std::string err;
+    uint64_t readBack = 0;
+    REQUIRE(romm::completeFileCrc(dir.string(), partSize, data.size(), crc, err, &readBack));
+    REQUIRE(readBack == data.size() - 150 * 1024);
+    uint32_t value = 0;
+    REQUIRE(crc.whole(data.size(), value));
+    REQUIRE(value == crcOf(data));
+
+    // A part that went missing is an error, not a silent pass.
+    std::filesystem::remove(romm::partFilePath(dir.string(), 2));
+    romm::FileCrc partial;
+    partial.update(0, data.data(), 100);
+    REQUIRE_FALSE(romm::completeFileCrc(dir.string(), partSize, data.size(), partial, err));
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("PartWriter tracks the whole-file CRC of committed bytes") {
+    const std::string data = pattern(200 * 1024);
+    auto dir = std::filesystem::temp_directory_path() / "romm_crc32_writer";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    {
+        romm::PartWriter writer(dir.string(), 64 * 1024);
+        writer.enableFileCrc();
+        std::string err;
+        REQUIRE(writer.write(100 * 1024, data.data() + 100 * 1024, 100 * 1024, err));
+        REQUIRE(writer.write(0, data.data(), 100 * 1024, err));
+        writer.close();
+        uint32_t value = 0;
+        REQUIRE(writer.fileCrc().whole(data.size(), value));
+        REQUIRE(value == crcOf(data));
+    }
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,87 @@
+#include "catch.hpp"
+#include "romm/download_segments.hpp"
+
+using romm::ByteRange;
+
+TEST_CASE("planSegments covers the span with aligned interior boundaries") {
+    const uint64_t mb = 1024ULL * 1024ULL;
+    auto segs = romm::planSegments(1000, 1000 + 100 * mb, 4, 16 * mb);
+    REQUIRE(segs.size() == 4);
+    REQUIRE(segs.front().start == 1000);
+    REQUIRE(segs.back().end == 1000 + 100 * mb);
+    for (size_t i = 0; i + 1 < segs.size(); ++i) {
+        REQUIRE(segs[i].end == segs[i + 1].start);
+        REQUIRE(segs[i].end % romm::kSegmentAlignBytes == 0);
+    }
+}
+
+TEST_CASE("planSegments honors the minimum segment size") {
+    const uint64_t mb = 1024ULL * 1024ULL;
+    REQUIRE(romm::planSegments(0, 40 * mb, 8, 16 * mb).size() == 2);
+    REQUIRE(romm::planSegments(0, 10 * mb, 8, 16 * mb).size() == 1);
+    REQUIRE(romm::planSegments(0, 10 * mb, 1, 0).size() == 1);
+    REQUIRE(romm::planSegments(5, 5, 4, 0).empty());
+}
+
+TEST_CASE("RangeSet keeps ranges sorted and merges touching ones") {
+    romm::RangeSet set;
+    set.add(200, 300);
+    set.add(0, 100);
+    set.add(500, 600);
+    REQUIRE(set.ranges().size() == 3);
+    set.add(100, 150); // touches [0,100)
+    set.add(250, 520); // bridges [200,300) and [500,600)
+    REQUIRE(set.ranges().size() == 2);
+    REQUIRE(set.ranges()[0].start == 0);
+    REQUIRE(set.ranges()[0].end == 150);
+    REQUIRE(set.ranges()[1].start == 200);
+    REQUIRE(set.ranges()[1].end == 600);
+    REQUIRE(set.covered() == 550);
+    set.add(10, 10); // empty ranges are ignored
+    REQUIRE(set.ranges().size() == 2);
+}
+
+TEST_CASE("RangeSet reports gaps, runs and containment") {
+    romm::RangeSet set;
+    set.add(100, 200);
+    set.add(300, 400);
+    auto gaps = set.missing(0, 500);
+    REQUIRE(gaps.size() == 3);
+    REQUIRE(gaps[0].start == 0);
+    REQUIRE(gaps[0].end == 100);
+    REQUIRE(gaps[1].start == 200);
+    REQUIRE(gaps[1].end == 300);
+    REQUIRE(gaps[2].start == 400);
+    REQUIRE(gaps[2].end == 500);
+    REQUIRE(set.missing(120, 180).empty());
+    REQUIRE(set.missing(150, 350).size() == 1);
+
+    REQUIRE(set.runEnd(0) == 0);
+    REQUIRE(set.runEnd(150) == 200);
+    REQUIRE(set.contains(300, 400));
+    REQUIRE_FALSE(set.contains(150, 350));
+
+    auto clipped = set.clipped(150, 350);
+    REQUIRE(clipped.ranges().size() == 2);
+    REQUIRE(clipped.covered() == 100);
+}
+
+TEST_CASE("planSegmentsOver spreads connections across gaps") {
+    const uint64_t mb = 1024ULL * 1024ULL;
+    std::vector<ByteRange> gaps{{0, 96 * mb}, {200 * mb, 232 * mb}};
+    auto segs = romm::planSegmentsOver(gaps, 4, 16 * mb);
+    REQUIRE(segs.size() == 4); // 3 for the 96MB gap, 1 for the 32MB gap
+    REQUIRE(segs.front().start == 0);
+    REQUIRE(segs[2].end == 96 * mb);
+    REQUIRE(segs[3].start == 200 * mb);
+    REQUIRE(segs[3].end == 232 * mb);
+
+    // Every gap gets a segment even when there are more gaps than connections.
+    std::vector<ByteRange> many{{0, 10}, {20, 30}, {40, 50}};
+    REQUIRE(romm::planSegmentsOver(many, 2, 16 * mb).size() == 3);
+    REQUIRE(romm::planSegmentsOver({}, 4, 0).empty());
+}
+
+TEST_CASE("rangeHeaderValue uses inclusive end") {
+    REQUIRE(romm::rangeHeaderValue(ByteRange{10, 20}) == "bytes=10-19");
+}
@@ -37,3 +37,16 @@ TEST_CASE("classifyError maps free-space failures") {
     REQUIRE(info.code == romm::ErrorCode::InvalidData);
     REQUIRE_FALSE(info.retryable);
 }
+
+TEST_CASE("classifyError treats dropped streams as retryable transport failures") {
+    for (const char* detail : {"Short read", "Short segment (Content-Range end 9 < 10)",
+                               "CURL failed: Failure when receiving data from the peer",
+                               "Connection closed before HTTP headers"}) {
+        romm::ErrorInfo info = romm::classifyError(detail, romm::ErrorCategory::Network);
+        REQUIRE(info.code == romm::ErrorCode::TransportFailure);
+        REQUIRE(info.retryable);
+    }
+    romm::ErrorInfo stalled = romm::classifyError("Stream stalled (no data for 20s)", romm::ErrorCategory::Network);
+    REQUIRE(stalled.code == romm::ErrorCode::Timeout);
+    REQUIRE(stalled.retryable);
+}
@@ -0,0 +1,227 @@
+#include "catch.hpp"
+#include "romm/http_cache.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+namespace fs = std::filesystem;
+
+fs::path freshDir(const char* name) {
+    auto dir = fs::temp_directory_path() / name;
+    fs::remove_all(dir);
+    return dir;
+}
+
+romm::ParsedHttpResponse response(const std::string& headerLines) {
+    romm::ParsedHttpResponse parsed;
+    std::string err;
+    REQUIRE(romm::parseHttpResponseHeaders("HTTP/1.1 200 OK\r\n" + headerLines, parsed, err));
+    return parsed;
+}
+
+std::string keyOf(const std::string& url) { return romm::HttpResponseCache::keyFor("GET", url, {}); }
+
+// Same-length URLs and bodies, so every entry takes the same number of bytes.
+std::string urlN(int i) { return "http://romm.local/api/roms/" + std::to_string(10 + i); }
+} // namespace
+
+TEST_CASE("HttpResponseCache keeps a validated response and serves it back") {
+    const fs::path dir = freshDir("romm_http_cache_roundtrip");
+    romm::HttpResponseCache cache;
+    std::string err;
+    REQUIRE(cache.open(dir.string(), 1 << 20, err));
+    REQUIRE(cache.enabled());
+
+    const std::string url = "http://romm.local/api/platforms";
+    const std::string key = keyOf(url);
+    romm::HttpResponseCache::Validators v;
+    REQUIRE_FALSE(cache.validators(key, v));
+
+    auto parsed = response("Content-Type: application/json\r\nETag: W/\"abc\"\r\nLast-Modified: Tue, 01 Sep 2026 10:00:00 GMT");
+    REQUIRE(cache.store(key, url, parsed, "[{\"id\":1}]"));
+    REQUIRE(cache.entries() == 1);
+    REQUIRE(cache.validators(key, v));
+    REQUIRE(v.etag == "W/\"abc\"");
+    REQUIRE(v.lastModified == "Tue, 01 Sep 2026 10:00:00 GMT");
+
+    romm::ParsedHttpResponse loaded;
+    std::string body;
+    REQUIRE(cache.load(key, loaded, body));
+    REQUIRE(loaded.statusCode == 200);
+    REQUIRE(loaded.etag == "W/\"abc\"");
+    REQUIRE(loaded.headersRaw == parsed.headersRaw);
+    REQUIRE(body == "[{\"id\":1}]");
+    REQUIRE(cache.stats().hits.load() == 1);
+    REQUIRE(cache.stats().hitBytes.load() == body.size());
+    fs::remove_all(dir);
+}
+
+TEST_CASE("HttpResponseCache only stores 200s with a validator and without no-store") {
+    const fs::path dir = freshDir("romm_http_cache_filter");
+    romm::HttpResponseCache cache;
+    std::string err;
+    REQUIRE(cache.open(dir.string(), 1 << 20, err));
+
+    const std::string url = "http://romm.local/api/roms";
+    REQUIRE_FALSE(cache.store(keyOf(url), url, response("Content-Type: application/json"), "{}"));
+    REQUIRE_FALSE(cache.store(keyOf(url), url, response("ETag: \"1\"\r\nCache-Control: private, No-Store"), "{}"));
+    romm::ParsedHttpResponse partial;
+    REQUIRE(romm::parseHttpResponseHeaders("HTTP/1.1 206 Partial Content\r\nETag: \"1\"", partial, err));
+    REQUIRE_FALSE(cache.store(keyOf(url), url, partial, "{}"));
+    // One entry may not take more than an eighth of the budget.
+    REQUIRE_FALSE(cache.store(keyOf(url), url, response("ETag: \"1\""), std::string(200 * 1024, 'x')));
+    REQUIRE(cache.entries() == 0);
+    REQUIRE(cache.stats().stores.load() == 0);
+
+    romm::HttpResponseCache off;
+    REQUIRE(off.open(dir.string(), 0, err));
+    REQUIRE_FALSE(off.enabled());
+    REQUIRE_FALSE(off.store(keyOf(url), url, response("ETag: \"1\""), "{}"));
+    fs::remove_all(dir);
+}
+
+TEST_CASE("HttpResponseCache keys on credentials, not just the URL") {
+    const std::string url = "http://romm.local/api/platforms";
+    const auto anon = romm::HttpResponseCache::keyFor("GET", url, {});
+    const auto alice = romm::HttpResponseCache::keyFor("GET", url, {{"Authorization", "Basic YWxpY2U6eA=="}});
+    const auto bob = romm::HttpResponseCache::keyFor("GET", url, {{"authorization", "Basic Ym9iOng="}});
+    REQUIRE(anon != alice);
+    REQUIRE(alice != bob);
+    REQUIRE(alice == romm::HttpResponseCache::keyFor("GET", url,
+                                                      {{"Accept", "application/json"}, {"Authorization", "Basic YWxpY2U6eA=="}}));
+    REQUIRE(anon.size() == 32);
+    REQUIRE(anon.find_first_not_of("0123456789abcdef") == std::string::npos);
+}
+
+TEST_CASE("HttpResponseCache evicts the least recently used entries over budget") {
+    const fs::path dir = freshDir("romm_http_cache_lru");
+    const std::string body(300, 'b');
+    const auto parsed = response("ETag: \"v1\"");
+    std::string err;
+
+    // Measure one entry, then size the budget for a known number of them.
+    uint64_t entrySize = 0;
+    {
+        romm::HttpResponseCache probe;
+        REQUIRE(probe.open(dir.string(), 1 << 20, err));
+        REQUIRE(probe.store(keyOf(urlN(0)), urlN(0), parsed, body));
+        entrySize = probe.bytes();
+        probe.remove(keyOf(urlN(0)));
+    }
+    const int fit = 9;
+    romm::HttpResponseCache cache;
+    REQUIRE(cache.open(dir.string(), entrySize * fit, err));
+    REQUIRE(body.size() * 8 < entrySize * fit); // within the per-entry share
+    for (int i = 0; i < fit; ++i) REQUIRE(cache.store(keyOf(urlN(i)), urlN(i), parsed, body));
+    REQUIRE(cache.entries() == static_cast<size_t>(fit));
+    REQUIRE(cache.stats().evictions.load() == 0);
+
+    // Reading entry 0 makes entry 1 the oldest.
+    romm::ParsedHttpResponse loaded;
+    std::string got;
+    REQUIRE(cache.load(keyOf(urlN(0)), loaded, got));
+    REQUIRE(cache.store(keyOf(urlN(fit)), urlN(fit), parsed, body));
+    REQUIRE(cache.stats().evictions.load() == 1);
+    REQUIRE(cache.entries() == static_cast<size_t>(fit));
+    REQUIRE(cache.bytes() <= entrySize * fit);
+    romm::HttpResponseCache::Validators v;
+    REQUIRE(cache.validators(keyOf(urlN(0)), v));
+    REQUIRE_FALSE(cache.validators(keyOf(urlN(1)), v));
+    REQUIRE_FALSE(fs::exists(dir / (keyOf(urlN(1)) + ".entry")));
+    fs::remove_all(dir);
+}
+
+TEST_CASE("HttpResponseCache picks up stored entries on reopen and drops damaged files") {
+    const fs::path dir = freshDir("romm_http_cache_reopen");
+    const auto parsed = response("ETag: \"v1\"");
+    const std::string body(100, 'b');
+    std::string err;
+    uint64_t entrySize = 0;
+    {
+        romm::HttpResponseCache cache;
+        REQUIRE(cache.open(dir.string(), 1 << 20, err));
+        for (int i = 0; i < 3; ++i) REQUIRE(cache.store(keyOf(urlN(i)), urlN(i), parsed, body));
+        entrySize = cache.bytes() / 3;
+    }
+    // Entry 2 loses its tail; a stray temp file and a foreign .entry are left behind.
+    const fs::path damaged = dir / (keyOf(urlN(2)) + ".entry");
+    fs::resize_file(damaged, fs::file_size(damaged) - 10);
+    std::ofstream(dir / "abc.1.tmp") << "partial";
+    std::ofstream(dir / "junk.entry") << "not an entry";
+    // Entry 0 was written last, so it is the one that survives a smaller budget.
+    const auto now = fs::file_time_type::clock::now();
+    fs::last_write_time(dir / (keyOf(urlN(1)) + ".entry"), now - std::chrono::hours(2));
+    fs::last_write_time(dir / (keyOf(urlN(0)) + ".entry"), now - std::chrono::hours(1));
+
+    romm::HttpResponseCache cache;
+    REQUIRE(cache.open(dir.string(), 1 << 20, err));
+    REQUIRE(cache.entries() == 2);
+    REQUIRE_FALSE(fs::exists(damaged));
+    REQUIRE_FALSE(fs::exists(dir / "abc.1.tmp"));
+    REQUIRE_FALSE(fs::exists(dir / "junk.entry"));
+    romm::ParsedHttpResponse loaded;
+    std::string got;
+    REQUIRE(cache.load(keyOf(urlN(1)), loaded, got));
+    REQUIRE(got == body);
+
+    REQUIRE(cache.open(dir.string(), entrySize + entrySize / 2, err));
+    REQUIRE(cache.entries() == 1);
+    romm::HttpResponseCache::Validators v;
+    REQUIRE(cache.validators(keyOf(urlN(0)), v));
+    fs::remove_all(dir);
+}
+
+TEST_CASE("HttpResponseCache drops an entry whose file went bad") {
+    const fs::path dir = freshDir("romm_http_cache_bad_load");
+    romm::HttpResponseCache cache;
+    std::string err;
+    REQUIRE(cache.open(dir.string(), 1 << 20, err));
+    const std::string key = keyOf(urlN(0));
+    REQUIRE(cache.store(key, urlN(0), response("Last-Modified: Tue, 01 Sep 2026 10:00:00 GMT"), "payload"));
+    std::ofstream(dir / (key + ".entry"), std::ios::trunc) << "romm-http-cache 1\n";
+
+    romm::ParsedHttpResponse loaded;
+    std::string body;
+    REQUIRE_FALSE(cache.load(key, loaded, body));
+    REQUIRE(body.empty());
+    REQUIRE(cache.entries() == 0);
+    REQUIRE(cache.bytes() == 0);
+    REQUIRE(cache.stats().hits.load() == 0);
+    fs::remove_all(dir);
+}
+
+TEST_CASE("HttpResponseCache answers a 304 for a gzip response with headers that fit the decoded body") {
+    const fs::path dir = freshDir("romm_http_cache_gzip");
+    romm::HttpResponseCache cache;
+    std::string err;
+    REQUIRE(cache.open(dir.string(), 1 << 20, err));
+    const std::string url = "http://romm.local/api/roms";
+    const std::string key = keyOf(url);
+
+    // 200 with a 38-byte gzip body on the wire; the engine hands over the decoded JSON.
+    const auto wire = response("Content-Type: application/json\r\nContent-Encoding: gzip\r\nContent-Length: 38\r\n"
+                               "ETag: \"r1\"");
+    const std::string decoded = "[{\"id\":1},{\"id\":2},{\"id\":3},{\"id\":4},{\"id\":5}]";
+    REQUIRE(cache.store(key, url, wire, decoded));
+
+    // The next request revalidates and the server answers 304: the stored copy is served.
+    romm::HttpResponseCache::Validators v;
+    REQUIRE(cache.validators(key, v));
+    REQUIRE(v.etag == "\"r1\"");
+    romm::ParsedHttpResponse loaded;
+    std::string body;
+    REQUIRE(cache.load(key, loaded, body));
+    REQUIRE(body == decoded);
+    REQUIRE(loaded.contentEncoding.empty());
+    REQUIRE(loaded.hasContentLength);
+    REQUIRE(loaded.contentLength == decoded.size());
+    REQUIRE(loaded.headersRaw.find("Content-Encoding") == std::string::npos);
+    REQUIRE(loaded.headersRaw.find("Content-Type: application/json") != std::string::npos);
+    REQUIRE(loaded.etag == "\"r1\"");
+    fs::remove_all(dir);
+}
@@ -0,0 +1,129 @@
+#include "catch.hpp"
+#include "romm/http_engine.hpp"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+TEST_CASE("HttpBodyQueue hands chunks over with headers first and pauses when full") {
+    romm::HttpBodyQueue queue(10);
+    std::atomic<int> resumes{0};
+    queue.setOnResume([&]() { resumes++; });
+
+    romm::ParsedHttpResponse parsed;
+    parsed.statusCode = 206;
+    queue.setHeaders(parsed);
+    // A chunk larger than the queue still goes in when the queue is empty.
+    REQUIRE(queue.push("0123456789AB", 12) == romm::HttpBodyQueue::Push::Accepted);
+    REQUIRE(queue.push("x", 1) == romm::HttpBodyQueue::Push::Full);
+    REQUIRE(queue.bufferedBytes() == 12);
+
+    romm::ParsedHttpResponse seen;
+    std::string chunk;
+    REQUIRE(queue.take(chunk, seen));
+    REQUIRE(seen.statusCode == 206);
+    REQUIRE(chunk == "0123456789AB");
+    REQUIRE(resumes == 1); // drained: the paused producer may retry
+    queue.recycle(std::move(chunk));
+
+    REQUIRE(queue.push("ab", 2) == romm::HttpBodyQueue::Push::Accepted);
+    REQUIRE(queue.push("cdefgh", 6) == romm::HttpBodyQueue::Push::Accepted);
+    REQUIRE(queue.push("ijk", 3) == romm::HttpBodyQueue::Push::Full);
+    REQUIRE(queue.take(chunk, seen));
+    REQUIRE(chunk == "ab");
+    REQUIRE(resumes == 1); // 6 bytes left is still above half the capacity
+    REQUIRE(queue.take(chunk, seen));
+    REQUIRE(chunk == "cdefgh");
+    REQUIRE(resumes == 2);
+
+    queue.finish();
+    REQUIRE_FALSE(queue.take(chunk, seen));
+}
+
+TEST_CASE("HttpBodyQueue close drops pending data and wakes a paused producer") {
+    romm::HttpBodyQueue queue(4);
+    std::atomic<int> resumes{0};
+    queue.setOnResume([&]() { resumes++; });
+    REQUIRE(queue.push("abcd", 4) == romm::HttpBodyQueue::Push::Accepted);
+    REQUIRE(queue.push("e", 1) == romm::HttpBodyQueue::Push::Full);
+    queue.close();
+    REQUIRE(resumes == 1);
+    REQUIRE(queue.bufferedBytes() == 0);
+    REQUIRE(queue.push("e", 1) == romm::HttpBodyQueue::Push::Closed);
+    std::string chunk;
+    romm::ParsedHttpResponse seen;
+    REQUIRE_FALSE(queue.take(chunk, seen));
+}
+
+TEST_CASE("HttpBodyQueue streams across threads in order") {
+    romm::HttpBodyQueue queue(64);
+    std::atomic<bool> resumed{false};
+    queue.setOnResume([&]() { resumed = true; });
+    std::thread producer([&]() {
+        for (int i = 0; i < 200; ++i) {
+            const std::string piece = std::to_string(i) + ",";
+            while (queue.push(piece.data(), piece.size()) == romm::HttpBodyQueue::Push::Full) {
+                while (!resumed.exchange(false)) std::this_thread::yield();
+            }
+        }
+        queue.finish();
+    });
+    std::string all;
+    std::string chunk;
+    romm::ParsedHttpResponse seen;
+    while (queue.take(chunk, seen)) {
+        all += chunk;
+        queue.recycle(std::move(chunk));
+    }
+    producer.join();
+    std::string expected;
+    for (int i = 0; i < 200; ++i) expected += std::to_string(i) + ",";
+    REQUIRE(all == expected);
+}
+
+TEST_CASE("HttpCall publishes its result to waiters and records cancellation") {
+    romm::HttpCall call(nullptr);
+    REQUIRE_FALSE(call.done());
+    REQUIRE_FALSE(call.waitFor(1));
+    call.cancel();
+    REQUIRE(call.cancelled());
+
+    std::thread engine([&]() {
+        romm::HttpResult r;
+        r.ok = true;
+        r.parsed.statusCode = 200;
+        r.body = "payload";
+        call.complete(std::move(r));
+    });
+    romm::HttpResult& res = call.wait();
+    engine.join();
+    REQUIRE(call.done());
+    REQUIRE(res.ok);
+    REQUIRE(res.body == "payload");
+}
+
+TEST_CASE("HttpEngine completes rejected requests inline with their callbacks") {
+    romm::HttpEngine engine;
+    romm::HttpRequest bad;
+    bad.url = "ftp://example.com/file";
+    std::string doneErr;
+    bad.onDone = [&](romm::HttpResult& r) { doneErr = r.err; };
+    auto call = engine.submit(std::move(bad));
+    REQUIRE(call->done());
+    REQUIRE_FALSE(call->wait().ok);
+    REQUIRE(doneErr == "URL must start with http:// or https://");
+
+    // The host build has no libcurl: valid requests fail the same way, and a streamed body ends.
+    romm::HttpRequest req;
+    req.url = "http://127.0.0.1:1/";
+    req.bodyQueue = std::make_shared<romm::HttpBodyQueue>(16);
+    auto queue = req.bodyQueue;
+    auto call2 = engine.submit(std::move(req));
+    REQUIRE_FALSE(call2->wait().ok);
+    std::string chunk;
+    romm::ParsedHttpResponse seen;
+    REQUIRE_FALSE(queue->take(chunk, seen));
+    REQUIRE(engine.stats().submitted.load() == 2);
+    REQUIRE(engine.stats().failed.load() == 2);
+    REQUIRE_FALSE(engine.onIoThread());
+}
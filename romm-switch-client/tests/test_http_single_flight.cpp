@@ -0,0 +1,141 @@
+#include "catch.hpp"
+#include "romm/http_single_flight.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+// Stands in for the server: counts the requests that reach it and holds each one open until
+// released, so the test decides when the response arrives.
+struct StandInServer {
+    std::atomic<int> hits{0};
+    std::atomic<bool> release{false};
+    bool fail{false};
+
+    bool serve(const std::string& path, romm::HttpTransaction& tx, std::string& err) {
+        hits.fetch_add(1);
+        while (!release.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (fail) {
+            err = "Connection reset";
+            return false;
+        }
+        tx.parsed.statusCode = 200;
+        tx.body = "body of " + path;
+        return true;
+    }
+};
+
+bool waitUntil(const std::function<bool()>& cond) {
+    for (int i = 0; i < 5000; ++i) {
+        if (cond()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+struct Outcome {
+    bool ok{false};
+    romm::HttpTransaction tx;
+    std::string err;
+};
+
+// Starts `n` identical requests, each on its own thread.
+std::vector<std::thread> startRequests(romm::HttpSingleFlight& flights, StandInServer& server, const std::string& key,
+                                       const std::string& path, std::vector<Outcome>& outcomes, size_t first, int n) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < n; ++i) {
+        Outcome* o = &outcomes[first + static_cast<size_t>(i)];
+        threads.emplace_back([&flights, &server, key, path, o] {
+            o->ok = flights.run(
+                key, [&](romm::HttpTransaction& tx, std::string& err) { return server.serve(path, tx, err); }, o->tx,
+                o->err);
+        });
+    }
+    return threads;
+}
+} // namespace
+
+TEST_CASE("HttpSingleFlight shares one transfer among identical concurrent requests") {
+    romm::HttpSingleFlight flights;
+    StandInServer server;
+    const std::string key = romm::HttpSingleFlight::keyFor("GET", "http://romm.local/api/roms/7", {}, 0);
+    std::vector<Outcome> outcomes(6);
+    auto threads = startRequests(flights, server, key, "/api/roms/7", outcomes, 0, 6);
+    REQUIRE(waitUntil([&] { return flights.stats().joined.load() == 5; }));
+    REQUIRE(flights.inFlight() == 1);
+    server.release = true;
+    for (auto& t : threads) t.join();
+
+    REQUIRE(server.hits.load() == 1);
+    for (const auto& o : outcomes) {
+        REQUIRE(o.ok);
+        REQUIRE(o.tx.parsed.statusCode == 200);
+        REQUIRE(o.tx.body == "body of /api/roms/7");
+    }
+    REQUIRE(flights.stats().leaders.load() == 1);
+    REQUIRE(flights.stats().peakWaiters.load() == 5);
+    REQUIRE(flights.inFlight() == 0);
+
+    // Nothing is kept once the request ended: the next caller goes to the server again.
+    Outcome again;
+    again.ok = flights.run(
+        key, [&](romm::HttpTransaction& tx, std::string& err) { return server.serve("/api/roms/7", tx, err); },
+        again.tx, again.err);
+    REQUIRE(again.ok);
+    REQUIRE(server.hits.load() == 2);
+}
+
+TEST_CASE("HttpSingleFlight keeps different requests apart") {
+    romm::HttpSingleFlight flights;
+    StandInServer server;
+    const std::string a = romm::HttpSingleFlight::keyFor("GET", "http://romm.local/api/roms/1", {}, 0);
+    const std::string b = romm::HttpSingleFlight::keyFor("GET", "http://romm.local/api/roms/2", {}, 0);
+    std::vector<Outcome> outcomes(4);
+    auto ta = startRequests(flights, server, a, "/api/roms/1", outcomes, 0, 2);
+    auto tb = startRequests(flights, server, b, "/api/roms/2", outcomes, 2, 2);
+    REQUIRE(waitUntil([&] { return server.hits.load() == 2 && flights.stats().joined.load() == 2; }));
+    server.release = true;
+    for (auto& t : ta) t.join();
+    for (auto& t : tb) t.join();
+
+    REQUIRE(server.hits.load() == 2);
+    REQUIRE(outcomes[0].tx.body == "body of /api/roms/1");
+    REQUIRE(outcomes[1].tx.body == "body of /api/roms/1");
+    REQUIRE(outcomes[2].tx.body == "body of /api/roms/2");
+    REQUIRE(outcomes[3].tx.body == "body of /api/roms/2");
+}
+
+TEST_CASE("HttpSingleFlight hands a failure to every waiter") {
+    romm::HttpSingleFlight flights;
+    StandInServer server;
+    server.fail = true;
+    const std::string key = romm::HttpSingleFlight::keyFor("GET", "http://romm.local/api/platforms", {}, 0);
+    std::vector<Outcome> outcomes(3);
+    auto threads = startRequests(flights, server, key, "/api/platforms", outcomes, 0, 3);
+    REQUIRE(waitUntil([&] { return flights.stats().joined.load() == 2; }));
+    server.release = true;
+    for (auto& t : threads) t.join();
+
+    REQUIRE(server.hits.load() == 1);
+    for (const auto& o : outcomes) {
+        REQUIRE_FALSE(o.ok);
+        REQUIRE(o.err == "Connection reset");
+    }
+    REQUIRE(flights.inFlight() == 0);
+}
+
+TEST_CASE("HttpSingleFlight keys on credentials and the body cap") {
+    const std::string url = "http://romm.local/api/roms/7";
+    const auto anon = romm::HttpSingleFlight::keyFor("GET", url, {}, 0);
+    const auto alice = romm::HttpSingleFlight::keyFor("GET", url, {{"Authorization", "Bearer a"}}, 0);
+    const auto bob = romm::HttpSingleFlight::keyFor("GET", url, {{"authorization", "Bearer b"}}, 0);
+    REQUIRE(anon != alice);
+    REQUIRE(alice != bob);
+    REQUIRE(alice == romm::HttpSingleFlight::keyFor("GET", url, {{"Accept", "image/*"}, {"Authorization", "Bearer a"}}, 0));
+    REQUIRE(anon != romm::HttpSingleFlight::keyFor("GET", url, {}, 1024));
+    REQUIRE(anon != romm::HttpSingleFlight::keyFor("HEAD", url, {}, 0));
+}
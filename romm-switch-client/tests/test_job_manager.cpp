@@ -0,0 +1,41 @@
+#include "catch.hpp"
+#include "romm/job_manager.hpp"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+TEST_CASE("SerialJobWorker runs every job in submission order") {
+    romm::SerialJobWorker<int> worker;
+    std::mutex mu;
+    std::vector<int> ran;
+    worker.start([&](const int& job) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::lock_guard<std::mutex> lock(mu);
+        ran.push_back(job);
+    });
+    for (int i = 0; i < 20; ++i) REQUIRE(worker.submit(i));
+    worker.finish(); // drains before joining
+    REQUIRE(worker.pending() == 0);
+    std::vector<int> expected;
+    for (int i = 0; i < 20; ++i) expected.push_back(i);
+    REQUIRE(ran == expected);
+}
+
+TEST_CASE("SerialJobWorker refuses jobs when not running and restarts cleanly") {
+    romm::SerialJobWorker<int> worker;
+    REQUIRE_FALSE(worker.submit(1)); // never started
+
+    int sum = 0;
+    worker.start([&](const int& job) { sum += job; });
+    REQUIRE(worker.submit(2));
+    worker.finish();
+    REQUIRE_FALSE(worker.submit(3)); // closed
+    REQUIRE(sum == 2);
+
+    worker.start([&](const int& job) { sum += job * 10; });
+    REQUIRE(worker.submit(4));
+    worker.finish();
+    REQUIRE(sum == 42);
+}
@@ -0,0 +1,68 @@
+#include "catch.hpp"
+#include "romm/lookahead.hpp"
+
+using Clock = romm::PreflightCache::Clock;
+
+TEST_CASE("PreflightCache entries are single-use") {
+    romm::PreflightCache cache(std::chrono::seconds(10));
+    auto t0 = Clock::now();
+    cache.put("http://h/a", romm::PreparedPreflight{1234, true}, t0);
+    REQUIRE(cache.contains("http://h/a", t0));
+    auto got = cache.take("http://h/a", t0);
+    REQUIRE(got.has_value());
+    REQUIRE(got->contentLength == 1234);
+    REQUIRE(got->supportsRanges);
+    REQUIRE_FALSE(cache.take("http://h/a", t0).has_value());
+}
+
+TEST_CASE("PreflightCache expires stale entries") {
+    romm::PreflightCache cache(std::chrono::seconds(10));
+    auto t0 = Clock::now();
+    cache.put("u", romm::PreparedPreflight{1, false}, t0);
+    REQUIRE_FALSE(cache.contains("u", t0 + std::chrono::seconds(11)));
+    REQUIRE_FALSE(cache.take("u", t0 + std::chrono::seconds(11)).has_value());
+    REQUIRE(cache.size() == 0);
+}
+
+TEST_CASE("PreflightCache evicts the oldest entry at capacity") {
+    romm::PreflightCache cache(std::chrono::minutes(1), 2);
+    auto t0 = Clock::now();
+    cache.put("a", romm::PreparedPreflight{1, false}, t0);
+    cache.put("b", romm::PreparedPreflight{2, false}, t0 + std::chrono::seconds(1));
+    cache.put("c", romm::PreparedPreflight{3, false}, t0 + std::chrono::seconds(2));
+    auto now = t0 + std::chrono::seconds(3);
+    REQUIRE(cache.size() == 2);
+    REQUIRE_FALSE(cache.contains("a", now));
+    REQUIRE(cache.contains("b", now));
+    REQUIRE(cache.contains("c", now));
+}
+
+TEST_CASE("lookaheadWindow skips the active front and non-pending items") {
+    std::vector<romm::QueueItem> q;
+    for (int i = 0; i < 6; ++i) {
+        romm::Game g;
+        g.id = std::to_string(i);
+        q.emplace_back(g, romm::QueueState::Pending);
+    }
+    q[0].state = romm::QueueState::Downloading;
+    q[2].state = romm::QueueState::Failed;
+    auto win = romm::lookaheadWindow(q, 3);
+    REQUIRE(win.size() == 3);
+    REQUIRE(win[0].game.id == "1");
+    REQUIRE(win[1].game.id == "3");
+    REQUIRE(win[2].game.id == "4");
+    REQUIRE(romm::lookaheadWindow(q, 0).empty());
+}
+
+TEST_CASE("bundleNeedsResolve detects missing URLs") {
+    romm::QueueItem q;
+    REQUIRE(romm::bundleNeedsResolve(q));
+    q.game.downloadUrl = "http://h/rom";
+    REQUIRE_FALSE(romm::bundleNeedsResolve(q));
+    romm::DownloadFileSpec f;
+    f.name = "a.nsp";
+    q.bundle.files.push_back(f);
+    REQUIRE(romm::bundleNeedsResolve(q));
+    q.bundle.files[0].url = "http://h/a";
+    REQUIRE_FALSE(romm::bundleNeedsResolve(q));
+}
@@ -143,3 +143,208 @@ TEST_CASE("manifestCompatible matches game identity and sizes") {
     REQUIRE_FALSE(romm::manifestCompatible(m, g, 200, 100));
     REQUIRE_FALSE(romm::manifestCompatible(m, g, 300, 200));
 }
+
+TEST_CASE("preallocated parts round-trip and cap resume at the written extent") {
+    romm::Manifest m;
+    m.rommId = "1";
+    m.fileId = "2";
+    m.fsName = "Game.nsp";
+    m.url = "http://host/rom";
+    m.totalSize = 3 * 4096;
+    m.partSize = 4096;
+    m.parts = { {0, 4096, ""}, {1, 4096, ""}, {2, 4096, ""} };
+    m.parts[0].completed = true;
+    m.parts[1].preallocated = true;
+    m.parts[1].written = 1500;
+    m.parts[2].preallocated = true;
+
+    std::string json = romm::manifestToJson(m);
+    REQUIRE(json.find("\"preallocated\":true,\"written\":1500") != std::string::npos);
+    REQUIRE(json.find("\"index\":0,\"size\":4096,\"sha256\":\"\",\"done\":true}") != std::string::npos);
+
+    romm::Manifest parsed;
+    std::string err;
+    REQUIRE(romm::manifestFromJson(json, parsed, err));
+    REQUIRE(parsed.parts[0].preallocated == false);
+    REQUIRE(parsed.parts[1].preallocated == true);
+    REQUIRE(parsed.parts[1].written == 1500);
+    REQUIRE(parsed.parts[2].written == 0);
+
+    // On disk every part is full length; only the manifest knows how much is real.
+    std::vector<std::pair<int, uint64_t>> observed = { {0, 4096}, {1, 4096}, {2, 4096} };
+    romm::ResumePlan plan = romm::planResume(parsed, observed);
+    REQUIRE(plan.validParts == std::vector<int>{0});
+    REQUIRE(plan.partialIndex == 1);
+    REQUIRE(plan.partialBytes == 1500);
+    REQUIRE(plan.bytesHave == 4096 + 1500);
+    REQUIRE(plan.invalidParts == std::vector<int>{2});
+}
+
+TEST_CASE("part hash records round-trip through manifest JSON") {
+    romm::Manifest m;
+    m.rommId = "1";
+    m.fileId = "2";
+    m.fsName = "Game.nsp";
+    m.url = "http://host/rom";
+    m.totalSize = 8192;
+    m.partSize = 4096;
+    m.parts = { {0, 4096, ""}, {1, 4096, ""} };
+    m.parts[0].sha256 = std::string(64, 'a');
+    m.parts[0].checkOffset = 0;
+    m.parts[0].checkState = std::string(64, 'b');
+    m.parts[1].hashOffset = 1000;
+    m.parts[1].hashState = std::string(64 + 2 * (1000 % 64), 'c');
+    m.parts[1].checkOffset = 960;
+    m.parts[1].checkState = std::string(64, 'd');
+
+    romm::Manifest parsed;
+    std::string err;
+    REQUIRE(romm::manifestFromJson(romm::manifestToJson(m), parsed, err));
+    REQUIRE(parsed.parts[0].sha256 == m.parts[0].sha256);
+    REQUIRE(parsed.parts[0].hashState.empty());
+    REQUIRE(parsed.parts[0].checkState == m.parts[0].checkState);
+    REQUIRE(parsed.parts[1].hashOffset == 1000);
+    REQUIRE(parsed.parts[1].hashState == m.parts[1].hashState);
+    REQUIRE(parsed.parts[1].checkOffset == 960);
+    REQUIRE(parsed.parts[1].checkState == m.parts[1].checkState);
+}
+
+TEST_CASE("server checksums and the CRC resume point round-trip through manifest JSON") {
+    romm::Manifest m;
+    m.rommId = "1";
+    m.fileId = "2";
+    m.fsName = "Game.nsp";
+    m.url = "http://host/rom";
+    m.totalSize = 8192;
+    m.partSize = 8192;
+    m.parts = { {0, 8192, ""} };
+    m.checksums.crc32 = "0bf43926";
+    m.checksums.sha1 = std::string(40, 'e');
+    m.crcOffset = 4096;
+    m.crcState = "deadbeef";
+
+    romm::Manifest parsed;
+    std::string err;
+    REQUIRE(romm::manifestFromJson(romm::manifestToJson(m), parsed, err));
+    REQUIRE(parsed.checksums == m.checksums);
+    REQUIRE(parsed.checksums.md5.empty());
+    REQUIRE(parsed.crcOffset == 4096);
+    REQUIRE(parsed.crcState == "deadbeef");
+
+    // Manifests written before checksums existed parse with none.
+    m.checksums = romm::FileChecksums{};
+    m.crcOffset = 0;
+    m.crcState.clear();
+    REQUIRE(romm::manifestToJson(m).find("crc") == std::string::npos);
+    REQUIRE(romm::manifestFromJson(romm::manifestToJson(m), parsed, err));
+    REQUIRE(parsed.checksums.empty());
+    REQUIRE(parsed.crcState.empty());
+}
+
+TEST_CASE("durable offset round-trips and caps resume at the last checkpoint") {
+    romm::Manifest m;
+    m.rommId = "1";
+    m.fileId = "2";
+    m.fsName = "Game.nsp";
+    m.url = "http://host/rom";
+    m.totalSize = 3 * 4096;
+    m.partSize = 4096;
+    m.parts = { {0, 4096, ""}, {1, 4096, ""}, {2, 4096, ""} };
+
+    // Manifests written before checkpointing carry no durable offset and are not capped.
+    REQUIRE(romm::manifestToJson(m).find("durable_offset") == std::string::npos);
+
+    m.hasDurableOffset = true;
+    m.durableOffset = 4096 + 1000;
+    std::string json = romm::manifestToJson(m);
+    REQUIRE(json.find("\"durable_offset\":5096") != std::string::npos);
+
+    romm::Manifest parsed;
+    std::string err;
+    REQUIRE(romm::manifestFromJson(json, parsed, err));
+    REQUIRE(parsed.hasDurableOffset);
+    REQUIRE(parsed.durableOffset == 5096);
+
+    // Bytes past the checkpoint were never fsynced; the plan must not count them.
+    std::vector<std::pair<int, uint64_t>> observed = { {0, 4096}, {1, 3000} };
+    romm::ResumePlan plan = romm::planResume(parsed, observed);
+    REQUIRE(plan.validParts == std::vector<int>{0});
+    REQUIRE(plan.partialIndex == 1);
+    REQUIRE(plan.partialBytes == 1000);
+    REQUIRE(plan.bytesHave == 5096);
+
+    parsed.hasDurableOffset = false;
+    plan = romm::planResume(parsed, observed);
+    REQUIRE(plan.bytesHave == 4096 + 3000);
+}
+
+TEST_CASE("range map round-trips and resumes every recorded range") {
+    romm::Manifest m;
+    m.rommId = "1";
+    m.fileId = "2";
+    m.fsName = "Game.nsp";
+    m.url = "http://host/rom";
+    m.totalSize = 3 * 4096;
+    m.partSize = 4096;
+    m.parts = { {0, 4096, ""}, {1, 4096, ""}, {2, 4096, ""} };
+
+    // Older manifests have no map and keep contiguous resume.
+    REQUIRE(romm::manifestToJson(m).find("ranges") == std::string::npos);
+
+    // Segments finished out of order: the head of part 0, all of part 1, a slice of part 2.
+    romm::RangeSet have;
+    have.add(0, 1000);
+    have.add(4096, 2 * 4096 + 500);
+    have.add(2 * 4096 + 1000, 2 * 4096 + 2000);
+    romm::recordDurableRanges(m, have);
+    REQUIRE(m.hasDurableOffset);
+    REQUIRE(m.durableOffset == 1000);
+    std::string json = romm::manifestToJson(m);
+    REQUIRE(json.find("\"ranges\":[[0,1000]]") != std::string::npos);
+    REQUIRE(json.find("\"ranges\":[[0,500],[1000,2000]]") != std::string::npos);
+
+    romm::Manifest parsed;
+    std::string err;
+    REQUIRE(romm::manifestFromJson(json, parsed, err));
+    REQUIRE(parsed.hasRangeMap);
+    REQUIRE(parsed.parts[1].ranges.covered() == 4096);
+
+    std::vector<std::pair<int, uint64_t>> observed = { {0, 4096}, {1, 4096}, {2, 2000} };
+    romm::ResumePlan plan = romm::planResume(parsed, observed);
+    REQUIRE(plan.validParts == std::vector<int>{1});
+    REQUIRE(plan.invalidParts.empty());
+    REQUIRE(plan.partialIndex == 0);
+    REQUIRE(plan.partialBytes == 1000);
+    REQUIRE(plan.bytesHave == have.covered());
+    REQUIRE(plan.missing.size() == 3);
+    REQUIRE(plan.missing[0].start == 1000);
+    REQUIRE(plan.missing[0].end == 4096);
+    REQUIRE(plan.missing[1].start == 2 * 4096 + 500);
+    REQUIRE(plan.missing[1].end == 2 * 4096 + 1000);
+    REQUIRE(plan.missing[2].start == 2 * 4096 + 2000);
+    REQUIRE(plan.missing[2].end == 3 * 4096);
+
+    // A part file that lost its recorded bytes only keeps what is still on disk; a vanished
+    // file keeps nothing, and an unexpected file is invalid.
+    observed = { {0, 4096}, {2, 700}, {7, 10} };
+    plan = romm::planResume(parsed, observed);
+    REQUIRE(plan.validParts.empty());
+    REQUIRE(plan.bytesHave == 1000 + 500);
+    REQUIRE(plan.invalidParts == std::vector<int>{7});
+    observed = { {0, 4096}, {1, 4096}, {2, 0} };
+    plan = romm::planResume(parsed, observed);
+    REQUIRE(plan.invalidParts == std::vector<int>{2});
+}
+
+TEST_CASE("legacy resume plans report a single trailing gap") {
+    romm::Manifest m;
+    m.totalSize = 2 * 4096;
+    m.partSize = 4096;
+    m.parts = { {0, 4096, ""}, {1, 4096, ""} };
+    std::vector<std::pair<int, uint64_t>> observed = { {0, 4096}, {1, 100} };
+    romm::ResumePlan plan = romm::planResume(m, observed);
+    REQUIRE(plan.have.covered() == 4196);
+    REQUIRE(plan.missing.size() == 1);
+    REQUIRE(plan.missing[0].start == 4196);
+    REQUIRE(plan.missing[0].end == 2 * 4096);
+}
@@ -1,8 +1,10 @@
 #include "catch.hpp"
 #include "romm/downloader.hpp"
+#include "romm/filesystem.hpp"
 #include "romm/manifest.hpp"
 #include <filesystem>
 #include <fstream>
+#include <vector>
 
 namespace {
 std::string writeTempManifest(const std::filesystem::path& root,
@@ -44,3 +46,65 @@ TEST_CASE("loadLocalManifests seeds history from temp manifests") {
 
     std::filesystem::remove_all(tmp);
 }
+
+TEST_CASE("writeFileAtomic replaces content and readFileAtomic falls back to the temp copy") {
+    std::filesystem::path tmp = std::filesystem::temp_directory_path() / "romm_atomic_write_test";
+    std::filesystem::remove_all(tmp);
+    std::filesystem::create_directories(tmp);
+    const std::string path = (tmp / "manifest.json").string();
+
+    std::string err;
+    REQUIRE(romm::writeFileAtomic(path, "first", err));
+    REQUIRE(romm::writeFileAtomic(path, "second", err));
+    REQUIRE_FALSE(std::filesystem::exists(path + ".tmp"));
+    std::string content;
+    REQUIRE(romm::readFileAtomic(path, content));
+    REQUIRE(content == "second");
+
+    // Crash after removing the target but before the rename: the temp copy is the latest state.
+    std::filesystem::rename(path, path + ".tmp");
+    REQUIRE(romm::readFileAtomic(path, content));
+    REQUIRE(content == "second");
+    REQUIRE_FALSE(romm::readFileAtomic((tmp / "missing.json").string(), content));
+
+    std::filesystem::remove_all(tmp);
+}
+
+TEST_CASE("copyFileStreaming copies in buffer-sized chunks and reports progress") {
+    std::filesystem::path tmp = std::filesystem::temp_directory_path() / "romm_stream_copy_test";
+    std::filesystem::remove_all(tmp);
+    std::filesystem::create_directories(tmp);
+    const std::string src = (tmp / "game.part").string();
+    const std::string dst = (tmp / "game.nsp").string();
+    std::string data(10000, '\0');
+    for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<char>(i * 31);
+    {
+        std::ofstream out(src, std::ios::binary);
+        out << data;
+    }
+    {
+        std::ofstream stale(dst, std::ios::binary);
+        stale << "stale content that is longer than nothing";
+    }
+
+    std::vector<uint64_t> seen;
+    uint64_t seenTotal = 0;
+    std::string err;
+    REQUIRE(romm::copyFileStreaming(src, dst, [&](uint64_t copied, uint64_t total) {
+        seen.push_back(copied);
+        seenTotal = total;
+    }, err, 4096));
+    REQUIRE(seen == std::vector<uint64_t>{4096, 8192, 10000});
+    REQUIRE(seenTotal == 10000);
+    std::string content;
+    REQUIRE(romm::readFileAtomic(dst, content));
+    REQUIRE(content == data);
+    REQUIRE(std::filesystem::exists(src));
+
+    // A destination that cannot be opened fails cleanly and leaves the source alone.
+    REQUIRE_FALSE(romm::copyFileStreaming(src, (tmp / "missing_dir" / "x.nsp").string(), nullptr, err));
+    REQUIRE_FALSE(err.empty());
+    REQUIRE(std::filesystem::file_size(src) == data.size());
+
+    std::filesystem::remove_all(tmp);
+}
@@ -0,0 +1,144 @@
+#include "catch.hpp"
+#include "romm/part_hash.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace {
+std::string pattern(size_t n) {
+    std::string s(n, '\0');
+    for (size_t i = 0; i < n; ++i) s[i] = static_cast<char>((i * 131 + i / 977) & 0xFF);
+    return s;
+}
+
+std::filesystem::path writeTemp(const char* name, const std::string& content) {
+    auto p = std::filesystem::temp_directory_path() / name;
+    std::ofstream out(p.string(), std::ios::binary | std::ios::trunc);
+    out.write(content.data(), static_cast<std::streamsize>(content.size()));
+    return p;
+}
+} // namespace
+
+TEST_CASE("hash state encodes the chaining value and tail") {
+    romm::Sha256 sha;
+    sha.update("hello world, partial block", 26);
+    const std::string hex = romm::encodeHashState(sha.state());
+    REQUIRE(hex.size() == 64 + 2 * 26);
+    romm::Sha256::State back;
+    REQUIRE(romm::decodeHashState(hex, 26, back));
+    REQUIRE(back == sha.state());
+    REQUIRE_FALSE(romm::decodeHashState(hex, 27, back));
+    REQUIRE_FALSE(romm::decodeHashState(std::string(64, 'z'), 0, back));
+}
+
+TEST_CASE("PartHasher records digest for a complete part and state for a partial one") {
+    const std::string data = pattern(300 * 1024);
+    romm::ManifestPart part;
+    part.index = 0;
+    part.size = data.size();
+
+    romm::PartHasher h;
+    h.update(data.data(), 200 * 1024 + 17);
+    h.record(part);
+    REQUIRE(part.sha256.empty());
+    REQUIRE(part.hashOffset == 200 * 1024 + 17);
+    // Anchor sits on the last 64KB boundary before the prefix end.
+    REQUIRE(part.checkOffset == 192 * 1024);
+
+    romm::PartHasher resumed;
+    REQUIRE(romm::PartHasher::fromRecord(part, part.hashOffset, resumed));
+    REQUIRE_FALSE(romm::PartHasher::fromRecord(part, part.hashOffset + 1, resumed));
+    resumed.update(data.data() + part.hashOffset, data.size() - part.hashOffset);
+    resumed.record(part);
+    REQUIRE(part.sha256 == romm::Sha256::toHex(romm::Sha256::hash(data.data(), data.size())));
+    REQUIRE(part.hashState.empty());
+    REQUIRE(part.checkOffset == 256 * 1024);
+
+    // A prefix ending exactly on a boundary still gets a non-empty check window.
+    romm::ManifestPart edge;
+    edge.size = data.size();
+    romm::PartHasher e;
+    e.update(data.data(), 128 * 1024);
+    e.record(edge);
+    REQUIRE(edge.checkOffset == 64 * 1024);
+}
+
+TEST_CASE("verifyPartHash spot-checks partial and complete parts") {
+    const std::string data = pattern(200 * 1024);
+    romm::ManifestPart part;
+    part.size = data.size();
+    std::string err;
+
+    romm::PartHasher h;
+    h.update(data.data(), 150 * 1024);
+    h.record(part);
+    // The file may hold more than the hashed prefix (e.g. bytes after the last record).
+    auto path = writeTemp("romm_part_hash_partial", data.substr(0, 160 * 1024));
+    REQUIRE(romm::verifyPartHash(path.string(), part, 160 * 1024, err));
+    // Shorter than the hashed prefix: nothing to prove, left to size checks.
+    REQUIRE(romm::verifyPartHash(path.string(), part, 100 * 1024, err));
+
+    std::string corrupt = data.substr(0, 160 * 1024);
+    corrupt[150 * 1024 - 5] ^= 0x40;
+    path = writeTemp("romm_part_hash_partial", corrupt);
+    REQUIRE_FALSE(romm::verifyPartHash(path.string(), part, 160 * 1024, err));
+    REQUIRE(err == "SHA-256 state mismatch");
+
+    // Corruption before the check window is out of reach of the spot-check.
+    corrupt = data.substr(0, 160 * 1024);
+    corrupt[10] ^= 0x40;
+    path = writeTemp("romm_part_hash_partial", corrupt);
+    REQUIRE(romm::verifyPartHash(path.string(), part, 160 * 1024, err));
+
+    romm::ManifestPart full;
+    full.size = data.size();
+    romm::PartHasher f;
+    f.update(data.data(), data.size());
+    f.record(full);
+    path = writeTemp("romm_part_hash_full", data);
+    REQUIRE(romm::verifyPartHash(path.string(), full, data.size(), err));
+    std::string bad = data;
+    bad[data.size() - 1] ^= 0x01;
+    path = writeTemp("romm_part_hash_full", bad);
+    err.clear();
+    REQUIRE_FALSE(romm::verifyPartHash(path.string(), full, data.size(), err));
+    REQUIRE(err == "SHA-256 mismatch");
+
+    romm::ManifestPart unhashed;
+    unhashed.size = data.size();
+    REQUIRE(romm::verifyPartHash(path.string(), unhashed, data.size(), err));
+    std::filesystem::remove(std::filesystem::temp_directory_path() / "romm_part_hash_partial");
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("dropHashesBeyond forgets prefixes past the durable end") {
+    romm::PartHashes hashes;
+    romm::PartHasher a;
+    a.update("0123456789", 10);
+    romm::PartHasher b;
+    b.update("0123", 4);
+    hashes.emplace(0, a);
+    hashes.emplace(1, b);
+    romm::dropHashesBeyond(hashes, 10, 13);
+    REQUIRE(hashes.size() == 1);
+    REQUIRE(hashes.count(0) == 1);
+    romm::dropHashesBeyond(hashes, 10, 0);
+    REQUIRE(hashes.empty());
+}
+
+TEST_CASE("dropHashesOutside keeps prefixes fully inside the durable ranges") {
+    romm::PartHashes hashes;
+    romm::PartHasher a;
+    a.update("0123456789", 10);
+    romm::PartHasher b;
+    b.update("0123", 4);
+    hashes.emplace(0, a);
+    hashes.emplace(1, b);
+    romm::RangeSet durable;
+    durable.add(0, 5);   // part 0 prefix (10 bytes) is only half durable
+    durable.add(10, 20); // part 1 prefix is durable although part 0 has a hole
+    romm::dropHashesOutside(hashes, 10, durable);
+    REQUIRE(hashes.size() == 1);
+    REQUIRE(hashes.count(1) == 1);
+}
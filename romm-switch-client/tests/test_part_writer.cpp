@@ -0,0 +1,287 @@
+#include "catch.hpp"
+#include "romm/part_writer.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace {
+std::string readFile(const std::filesystem::path& p) {
+    std::ifstream in(p.string(), std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+std::filesystem::path freshDir(const char* name) {
+    auto dir = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+} // namespace
+
+TEST_CASE("partFileName pads to two digits") {
+    REQUIRE(romm::partFileName(0) == "00.part");
+    REQUIRE(romm::partFileName(9) == "09.part");
+    REQUIRE(romm::partFileName(12) == "12.part");
+    REQUIRE(romm::partFilePath("a/b", 1) == "a/b/01.part");
+}
+
+TEST_CASE("PartWriter splits writes across part boundaries") {
+    auto dir = freshDir("romm_part_writer_split");
+    std::string err;
+    {
+        romm::PartWriter w(dir.string(), 4, 0);
+        REQUIRE(w.write(0, "abcdefghij", 10, err));
+        REQUIRE(w.flush(err));
+    }
+    REQUIRE(readFile(dir / "00.part") == "abcd");
+    REQUIRE(readFile(dir / "01.part") == "efgh");
+    REQUIRE(readFile(dir / "02.part") == "ij");
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("PartWriter instances fill disjoint ranges of the same part") {
+    auto dir = freshDir("romm_part_writer_disjoint");
+    std::string err;
+    romm::PartWriter a(dir.string(), 8, 16);
+    romm::PartWriter b(dir.string(), 8, 16);
+    // b writes the tail first; a must not truncate it when opening the shared part.
+    REQUIRE(b.write(6, "GHIJ", 4, err));
+    REQUIRE(b.flush(err));
+    REQUIRE(a.write(0, "ABCDEF", 6, err));
+    a.close();
+    b.close();
+    REQUIRE(readFile(dir / "00.part") == "ABCDEFGH");
+    REQUIRE(readFile(dir / "01.part") == "IJ");
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("PartWriter open hook can veto a new part") {
+    auto dir = freshDir("romm_part_writer_hook");
+    romm::PartWriter w(dir.string(), 4, 0);
+    std::vector<uint64_t> opened;
+    w.setOpenHook([&](uint64_t idx, uint64_t, std::string& err) {
+        opened.push_back(idx);
+        if (idx == 1) {
+            err = "Not enough free space";
+            return false;
+        }
+        return true;
+    });
+    std::string err;
+    REQUIRE_FALSE(w.write(0, "abcdef", 6, err));
+    REQUIRE(err == "Not enough free space");
+    REQUIRE(opened == std::vector<uint64_t>{0, 1});
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("truncatePartsTo trims the partial part and drops later ones") {
+    auto dir = freshDir("romm_part_writer_trunc");
+    std::string err;
+    {
+        romm::PartWriter w(dir.string(), 4, 0);
+        REQUIRE(w.write(0, "abcdefghij", 10, err));
+    }
+    REQUIRE(romm::truncatePartsTo(dir.string(), 4, 6, err));
+    REQUIRE(readFile(dir / "00.part") == "abcd");
+    REQUIRE(readFile(dir / "01.part") == "ef");
+    REQUIRE_FALSE(std::filesystem::exists(dir / "02.part"));
+
+    REQUIRE(romm::truncatePartsTo(dir.string(), 4, 0, err));
+    REQUIRE_FALSE(std::filesystem::exists(dir / "00.part"));
+    REQUIRE_FALSE(std::filesystem::exists(dir / "01.part"));
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("truncatePartsToRanges keeps holes and cuts after the last kept byte") {
+    auto dir = freshDir("romm_part_writer_trunc_ranges");
+    std::string err;
+    {
+        romm::PartWriter w(dir.string(), 4, 0);
+        REQUIRE(w.write(0, "abcdefghijkl", 12, err));
+    }
+    romm::RangeSet keep;
+    keep.add(0, 1);
+    keep.add(3, 6); // hole at [1,3) stays in part 0; part 1 is cut after "ef"
+    REQUIRE(romm::truncatePartsToRanges(dir.string(), 4, keep, err));
+    REQUIRE(readFile(dir / "00.part") == "abcd");
+    REQUIRE(readFile(dir / "01.part") == "ef");
+    REQUIRE_FALSE(std::filesystem::exists(dir / "02.part"));
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("PartWriter preallocates each part to its final size once") {
+    auto dir = freshDir("romm_part_writer_prealloc");
+    std::vector<uint64_t> hooked;
+    std::string err;
+    {
+        romm::PartWriter w(dir.string(), 8, 0);
+        w.setPreallocate(20, [&](uint64_t idx) {
+            // The hook runs before the file is extended.
+            REQUIRE(std::filesystem::file_size(dir / romm::partFileName(idx)) == 0);
+            hooked.push_back(idx);
+        });
+        REQUIRE(w.write(0, "abc", 3, err));
+        REQUIRE(std::filesystem::file_size(dir / "00.part") == 8);
+        REQUIRE(w.write(3, "defghijklmnopqrst", 17, err));
+        REQUIRE(w.flush(err));
+    }
+    REQUIRE(hooked == std::vector<uint64_t>{0, 1, 2});
+    REQUIRE(readFile(dir / "00.part") == "abcdefgh");
+    REQUIRE(readFile(dir / "02.part") == "qrst");
+
+    // Reopening a part that already has its full length does not preallocate again.
+    hooked.clear();
+    {
+        romm::PartWriter w(dir.string(), 8, 0);
+        w.setPreallocate(20, [&](uint64_t idx) { hooked.push_back(idx); });
+        REQUIRE(w.write(8, "IJ", 2, err));
+    }
+    REQUIRE(hooked.empty());
+    REQUIRE(readFile(dir / "01.part") == "IJklmnop");
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("truncatePartsTo cuts a preallocated tail back to the committed bytes") {
+    auto dir = freshDir("romm_part_writer_prealloc_trunc");
+    std::string err;
+    {
+        romm::PartWriter w(dir.string(), 8, 0);
+        w.setPreallocate(16);
+        REQUIRE(w.write(0, "abcdefghij", 10, err));
+    }
+    REQUIRE(std::filesystem::file_size(dir / "01.part") == 8);
+    REQUIRE(romm::truncatePartsTo(dir.string(), 8, 10, err));
+    REQUIRE(readFile(dir / "01.part") == "ij");
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("parseWriteBackend maps names and falls back to stdio") {
+    romm::WriteBackend b = romm::WriteBackend::Raw;
+    REQUIRE(romm::parseWriteBackend("stdio", b));
+    REQUIRE(b == romm::WriteBackend::Stdio);
+    REQUIRE(romm::parseWriteBackend("raw", b));
+    REQUIRE(b == romm::WriteBackend::Raw);
+    REQUIRE_FALSE(romm::parseWriteBackend("mmap", b));
+    REQUIRE(b == romm::WriteBackend::Stdio);
+    REQUIRE(std::string(romm::writeBackendName(romm::WriteBackend::Raw)) == "raw");
+}
+
+TEST_CASE("Raw backend stages unaligned writes and flushes the tail") {
+    auto dir = freshDir("romm_part_writer_raw");
+    std::string err;
+    std::string expected;
+    for (int i = 0; i < 40; ++i) expected.push_back(static_cast<char>('a' + i % 26));
+    {
+        // 16-byte parts, 4-byte aligned blocks: exercises staging, direct blocks and part rotation.
+        romm::PartWriter w(dir.string(), 16, 4, romm::WriteBackend::Raw);
+        REQUIRE(w.backend() == romm::WriteBackend::Raw);
+        REQUIRE(w.write(0, expected.data(), 3, err));       // staged
+        REQUIRE(w.write(3, expected.data() + 3, 14, err));  // fills block, direct blocks, crosses part
+        REQUIRE(std::filesystem::file_size(dir / "00.part") == 16);
+        REQUIRE(w.write(17, expected.data() + 17, 23, err));
+        REQUIRE(w.flush(err));
+        REQUIRE(std::filesystem::file_size(dir / "02.part") == 8);
+    }
+    REQUIRE(readFile(dir / "00.part") == expected.substr(0, 16));
+    REQUIRE(readFile(dir / "01.part") == expected.substr(16, 16));
+    REQUIRE(readFile(dir / "02.part") == expected.substr(32));
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Raw backend handles out-of-order writes into a preallocated part") {
+    auto dir = freshDir("romm_part_writer_raw_seek");
+    std::string err;
+    {
+        romm::PartWriter w(dir.string(), 8, 4, romm::WriteBackend::Raw);
+        w.setPreallocate(12);
+        REQUIRE(w.write(6, "GHIJ", 4, err));
+        REQUIRE(w.write(0, "ABCDEF", 6, err));
+        REQUIRE(w.write(10, "KL", 2, err));
+    } // destructor writes staged tails
+    REQUIRE(readFile(dir / "00.part") == "ABCDEFGH");
+    REQUIRE(readFile(dir / "01.part") == "IJKL");
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("PartWriter hashes each part's in-order prefix") {
+    auto dir = freshDir("romm_part_writer_hash");
+    std::string err;
+    const std::string data = "abcdefghijklmnopqrstuvwx";
+    romm::PartWriter w(dir.string(), 8, 0);
+    romm::Sha256 seed;
+    seed.update("ijk", 3);
+    romm::PartHashes seeds;
+    seeds.emplace(1, romm::PartHasher(seed.state()));
+    w.enableHashing(seeds);
+    // Part 1 resumes at offset 3 from its seed; part 2 is written out of order (tail first).
+    REQUIRE(w.write(11, data.data() + 11, 5, err));
+    REQUIRE(w.write(20, data.data() + 20, 4, err));
+    REQUIRE(w.write(16, data.data() + 16, 4, err));
+    REQUIRE(w.write(0, data.data(), 8, err));
+    w.close();
+
+    const auto& hashes = w.partHashes();
+    REQUIRE(hashes.at(0).offset() == 8);
+    REQUIRE(hashes.at(1).offset() == 8);
+    REQUIRE(hashes.at(2).offset() == 4); // only the leading run of part 2
+    romm::ManifestPart p1;
+    p1.size = 8;
+    hashes.at(1).record(p1);
+    REQUIRE(p1.sha256 == romm::Sha256::toHex(romm::Sha256::hash("ijklmnop", 8)));
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("PartWriter fsyncs parts it closes to make room before the next sync") {
+    for (auto backend : {romm::WriteBackend::Stdio, romm::WriteBackend::Raw}) {
+        auto dir = freshDir("romm_part_writer_evict_sync");
+        std::string err;
+        const std::string data = "abcdefghijklmnopqrstuvwx";
+        romm::PartWriter w(dir.string(), 4, 4, backend);
+        // Six parts between two syncs: the first two are pushed out of the four open slots.
+        REQUIRE(w.write(0, data.data(), data.size(), err));
+        REQUIRE(w.fsyncCount() == 2);
+        REQUIRE(w.sync(err));
+        REQUIRE(w.fsyncCount() == 6);
+        // Nothing written since: the next sync has nothing to push.
+        REQUIRE(w.sync(err));
+        REQUIRE(w.fsyncCount() == 6);
+        // Part 0 comes back, evicting a clean part (no fsync), and is fsynced by the next sync.
+        REQUIRE(w.write(0, "ABCD", 4, err));
+        REQUIRE(w.fsyncCount() == 6);
+        REQUIRE(w.sync(err));
+        REQUIRE(w.fsyncCount() == 7);
+        w.close();
+        REQUIRE(readFile(dir / "00.part") == "ABCD");
+        REQUIRE(readFile(dir / "05.part") == "uvwx");
+        std::filesystem::remove_all(dir);
+    }
+}
+
+TEST_CASE("PartWriter keeps one part open per side-by-side stream") {
+    auto dir = freshDir("romm_part_writer_open_set");
+    std::string err;
+    // Eight streams, one per part, taking turns block by block like a segmented download.
+    auto roundRobin = [&](romm::PartWriter& w) {
+        for (uint64_t round = 0; round < 3; ++round) {
+            for (uint64_t part = 0; part < 8; ++part) REQUIRE(w.write(part * 16 + round * 4, "abcd", 4, err));
+        }
+    };
+    int opens = 0;
+    {
+        romm::PartWriter w(dir.string(), 16, 0);
+        w.setOpenHook([&](uint64_t, uint64_t, std::string&) { return ++opens > 0; });
+        roundRobin(w);
+    }
+    REQUIRE(opens == 24); // four slots: every block reopens its part
+    opens = 0;
+    {
+        romm::PartWriter w(dir.string(), 16, 0);
+        w.setMaxOpenParts(8);
+        w.setOpenHook([&](uint64_t, uint64_t, std::string&) { return ++opens > 0; });
+        roundRobin(w);
+    }
+    REQUIRE(opens == 8);
+    REQUIRE(readFile(dir / "07.part") == "abcdabcdabcd");
+    std::filesystem::remove_all(dir);
+}
@@ -46,6 +46,8 @@ TEST_CASE("queue store save/load roundtrip") {
     {
         std::lock_guard<std::mutex> lock(st.mutex);
         st.downloadQueue.push_back(makeQueueItem("100", "Roundtrip", "switch", "roundtrip.xci"));
+        st.downloadQueue[0].bundle.files[0].checksums.crc32 = "0bf43926";
+        st.downloadQueue[0].bundle.files[0].checksums.md5 = std::string(32, 'a');
     }
 
     std::string err;
@@ -60,6 +62,9 @@ TEST_CASE("queue store save/load roundtrip") {
     REQUIRE(loaded.downloadQueue.size() == 1);
     REQUIRE(loaded.downloadQueue[0].game.id == "100");
     REQUIRE(loaded.downloadQueue[0].bundle.files.size() == 1);
+    REQUIRE(loaded.downloadQueue[0].bundle.files[0].checksums.crc32 == "0bf43926");
+    REQUIRE(loaded.downloadQueue[0].bundle.files[0].checksums.md5 == std::string(32, 'a'));
+    REQUIRE(loaded.downloadQueue[0].bundle.files[0].checksums.sha1.empty());
 
     std::error_code ec;
     fs::remove_all(tempDir, ec);
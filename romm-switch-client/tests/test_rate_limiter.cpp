@@ -0,0 +1,180 @@
+#include "catch.hpp"
+#include "romm/rate_limiter.hpp"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace {
+using Clock = romm::RateLimiter::Clock;
+
+// Simulated time: sleep() advances now(), so tests run instantly and deterministically.
+struct FakeTime {
+    Clock::time_point now{Clock::time_point() + std::chrono::hours(1)};
+    int minute{12 * 60};
+    std::chrono::microseconds slept{0};
+
+    romm::RateLimiter::TimeSource source() {
+        return romm::RateLimiter::TimeSource{
+            [this] { return now; },
+            [this](std::chrono::microseconds d) {
+                now += d;
+                slept += d;
+            },
+            [this] { return minute; }};
+    }
+    double secondsSince(Clock::time_point t0) const { return std::chrono::duration<double>(now - t0).count(); }
+};
+
+constexpr uint64_t kKB = 1024;
+constexpr uint64_t kMB = 1024 * 1024;
+} // namespace
+
+TEST_CASE("RateLimiter holds the sustained rate within tolerance") {
+    FakeTime t;
+    romm::RateLimiter limiter(t.source());
+    romm::RateLimitConfig cfg;
+    cfg.bytesPerSec = 2 * kMB;
+    cfg.burstBytes = 64 * kKB;
+    limiter.configure(cfg);
+
+    const auto t0 = t.now;
+    uint64_t sent = 0;
+    bool ok = true;
+    while (sent < 40 * kMB) {
+        ok = limiter.acquire(16 * kKB) && ok;
+        sent += 16 * kKB;
+        t.now += std::chrono::microseconds(50); // network/callback time per chunk
+    }
+    REQUIRE(ok);
+    // Everything beyond the initial burst has to be paid for at the cap.
+    const double rate = (sent - cfg.burstBytes) / t.secondsSince(t0);
+    REQUIRE(rate == Approx(static_cast<double>(cfg.bytesPerSec)).epsilon(0.01));
+    REQUIRE(limiter.throttledMs() > 0);
+}
+
+TEST_CASE("RateLimiter lets a full bucket through without sleeping") {
+    FakeTime t;
+    romm::RateLimiter limiter(t.source());
+    romm::RateLimitConfig cfg;
+    cfg.bytesPerSec = 1 * kMB;
+    cfg.burstBytes = 512 * kKB;
+    limiter.configure(cfg);
+
+    for (int i = 0; i < 8; ++i) REQUIRE(limiter.acquire(64 * kKB));
+    REQUIRE(t.slept.count() == 0);
+
+    // The next chunk goes into debt and waits for it to be repaid.
+    REQUIRE(limiter.acquire(64 * kKB));
+    REQUIRE(t.slept.count() == Approx(62500).margin(1));
+
+    // After an idle second the bucket refills up to the burst size, not beyond.
+    t.now += std::chrono::seconds(5);
+    t.slept = std::chrono::microseconds(0);
+    for (int i = 0; i < 8; ++i) REQUIRE(limiter.acquire(64 * kKB));
+    REQUIRE(t.slept.count() == 0);
+    REQUIRE(limiter.acquire(64 * kKB));
+    REQUIRE(t.slept.count() > 0);
+}
+
+TEST_CASE("RateLimiter shares one budget across connections") {
+    FakeTime t;
+    romm::RateLimiter limiter(t.source());
+    romm::RateLimitConfig cfg;
+    cfg.bytesPerSec = 4 * kMB;
+    limiter.configure(cfg); // burst defaults to one second at the cap
+
+    const auto t0 = t.now;
+    uint64_t perConn[3] = {0, 0, 0};
+    const uint64_t chunk[3] = {16 * kKB, 32 * kKB, 256 * kKB};
+    bool ok = true;
+    for (int round = 0; round < 400; ++round) {
+        for (int c = 0; c < 3; ++c) {
+            ok = limiter.acquire(chunk[c]) && ok;
+            perConn[c] += chunk[c];
+        }
+    }
+    REQUIRE(ok);
+    const uint64_t total = perConn[0] + perConn[1] + perConn[2];
+    const double rate = (total - cfg.bytesPerSec) / t.secondsSince(t0);
+    REQUIRE(rate == Approx(static_cast<double>(cfg.bytesPerSec)).epsilon(0.01));
+}
+
+TEST_CASE("RateLimiter follows the time-of-day schedule") {
+    FakeTime t;
+    t.minute = 9 * 60;
+    romm::RateLimiter limiter(t.source());
+    romm::RateLimitConfig cfg;
+    cfg.bytesPerSec = 1 * kMB;
+    cfg.burstBytes = 64 * kKB;
+    std::string err;
+    REQUIRE(romm::parseRateSchedule("08:00-18:00=256, 23:00-07:00=0", cfg.schedule, err));
+    limiter.configure(cfg);
+    REQUIRE(limiter.enabled());
+    REQUIRE(limiter.currentBytesPerSec() == 256 * kKB);
+
+    auto rateOver = [&](uint64_t bytes) {
+        const auto t0 = t.now;
+        uint64_t sent = 0;
+        while (sent < bytes && limiter.acquire(32 * kKB)) sent += 32 * kKB;
+        return sent / t.secondsSince(t0);
+    };
+    REQUIRE(rateOver(8 * kMB) == Approx(256.0 * kKB).epsilon(0.02));
+
+    // Evening: outside every window, so the default cap applies (picked up within a second).
+    t.minute = 20 * 60;
+    t.now += std::chrono::seconds(2);
+    rateOver(2 * kMB); // drains the refreshed burst
+    REQUIRE(limiter.currentBytesPerSec() == 1 * kMB);
+    REQUIRE(rateOver(16 * kMB) == Approx(1.0 * kMB).epsilon(0.02));
+
+    // Night window lifts the cap entirely (wraps past midnight).
+    t.minute = 2 * 60;
+    t.now += std::chrono::seconds(2);
+    const auto slept = t.slept;
+    REQUIRE(limiter.acquire(100 * kMB));
+    REQUIRE(limiter.currentBytesPerSec() == 0);
+    REQUIRE(t.slept == slept);
+}
+
+TEST_CASE("RateLimiter stops waiting when cancelled") {
+    FakeTime t;
+    romm::RateLimiter limiter(t.source());
+    romm::RateLimitConfig cfg;
+    cfg.bytesPerSec = 1 * kKB;
+    cfg.burstBytes = 1 * kKB;
+    limiter.configure(cfg);
+
+    std::atomic<bool> cancel{true};
+    REQUIRE_FALSE(limiter.acquire(1 * kMB, &cancel));
+    REQUIRE(t.slept.count() == 0);
+
+    // Unlimited limiter never blocks.
+    romm::RateLimiter open(t.source());
+    open.configure(romm::RateLimitConfig{});
+    REQUIRE_FALSE(open.enabled());
+    REQUIRE(open.acquire(1024 * kMB));
+    REQUIRE(t.slept.count() == 0);
+}
+
+TEST_CASE("parseRateSchedule accepts windows and rejects malformed ones") {
+    std::vector<romm::RateWindow> windows;
+    std::string err;
+    REQUIRE(romm::parseRateSchedule("", windows, err));
+    REQUIRE(windows.empty());
+
+    REQUIRE(romm::parseRateSchedule("7:30-24:00=1024,22:00-06:15=0", windows, err));
+    REQUIRE(windows.size() == 2);
+    REQUIRE(windows[0].startMinute == 7 * 60 + 30);
+    REQUIRE(windows[0].endMinute == 0);
+    REQUIRE(windows[0].bytesPerSec == 1024 * kKB);
+    REQUIRE(windows[1].startMinute == 22 * 60);
+    REQUIRE(windows[1].endMinute == 6 * 60 + 15);
+    REQUIRE(windows[1].bytesPerSec == 0);
+
+    for (const char* bad : {"08:00-18:00", "08:00=18:00-5", "25:00-01:00=1", "08:60-09:00=1", "8-9=1", "08:00-09:00=-1"}) {
+        windows.clear();
+        REQUIRE_FALSE(romm::parseRateSchedule(bad, windows, err));
+        REQUIRE(err.find("Invalid rate window") != std::string::npos);
+    }
+}
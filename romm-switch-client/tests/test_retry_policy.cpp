@@ -0,0 +1,86 @@
+#include "catch.hpp"
+#include "romm/retry_policy.hpp"
+
+namespace {
+romm::ErrorInfo transient() { return romm::classifyError("Short read", romm::ErrorCategory::Network); }
+} // namespace
+
+TEST_CASE("backoffDelayMs doubles up to the cap with equal jitter") {
+    romm::RetryPolicy p;
+    p.baseDelayMs = 500;
+    p.maxDelayMs = 4000;
+    // random=0 gives the lower bound (half the step), the largest value the full step.
+    REQUIRE(romm::backoffDelayMs(p, 1, 0) == 250);
+    REQUIRE(romm::backoffDelayMs(p, 1, 250) == 500);
+    REQUIRE(romm::backoffDelayMs(p, 2, 0) == 500);
+    REQUIRE(romm::backoffDelayMs(p, 3, 0) == 1000);
+    REQUIRE(romm::backoffDelayMs(p, 4, 0) == 2000);
+    REQUIRE(romm::backoffDelayMs(p, 5, 0) == 2000);
+    REQUIRE(romm::backoffDelayMs(p, 40, 0) == 2000);
+    for (uint32_t r = 0; r < 5000; r += 7) {
+        const uint32_t d = romm::backoffDelayMs(p, 4, r);
+        REQUIRE(d >= 2000);
+        REQUIRE(d <= 4000);
+    }
+}
+
+TEST_CASE("RetryBudget stops on non-retryable errors") {
+    romm::RetryBudget budget(romm::RetryPolicy{}, 1);
+    auto d = budget.onFailure(romm::classifyError("HTTP status 403", romm::ErrorCategory::Network), false);
+    REQUIRE_FALSE(d.retry);
+    REQUIRE(d.reason.find("HttpForbidden") != std::string::npos);
+    d = budget.onFailure(romm::classifyError("Not enough free space (need 1 bytes + margin, have 0)",
+                                             romm::ErrorCategory::Network), false);
+    REQUIRE_FALSE(d.retry);
+    REQUIRE(budget.retriesUsed() == 0);
+}
+
+TEST_CASE("RetryBudget spends a bounded number of retries per item") {
+    romm::RetryPolicy p;
+    p.maxRetries = 3;
+    p.baseDelayMs = 100;
+    p.maxDelayMs = 1000;
+    romm::RetryBudget budget(p, 42);
+    for (int i = 0; i < 3; ++i) {
+        const auto d = budget.onFailure(transient(), false);
+        REQUIRE(d.retry);
+    }
+    const auto last = budget.onFailure(transient(), true);
+    REQUIRE_FALSE(last.retry);
+    REQUIRE(last.reason.find("budget") != std::string::npos);
+    REQUIRE(budget.retriesUsed() == 3);
+}
+
+TEST_CASE("RetryBudget backs off further without progress and restarts after progress") {
+    romm::RetryPolicy p;
+    p.baseDelayMs = 1000;
+    p.maxDelayMs = 16000;
+    p.maxTotalDelayMs = 1000000;
+    romm::RetryBudget budget(p, 7);
+    // Each stalled retry doubles the step: delays fall in [step/2, step].
+    uint32_t step = 1000;
+    for (int i = 0; i < 4; ++i) {
+        const auto d = budget.onFailure(transient(), false);
+        REQUIRE(d.retry);
+        REQUIRE(d.delayMs >= step / 2);
+        REQUIRE(d.delayMs <= step);
+        step *= 2;
+    }
+    const auto afterProgress = budget.onFailure(transient(), true);
+    REQUIRE(afterProgress.retry);
+    REQUIRE(afterProgress.delayMs <= 1000);
+}
+
+TEST_CASE("RetryBudget caps the total time spent backing off") {
+    romm::RetryPolicy p;
+    p.maxRetries = 100;
+    p.baseDelayMs = 1000;
+    p.maxDelayMs = 1000;
+    p.maxTotalDelayMs = 3000;
+    romm::RetryBudget budget(p, 3);
+    int granted = 0;
+    while (budget.onFailure(transient(), false).retry) ++granted;
+    REQUIRE(granted >= 3);
+    REQUIRE(granted <= 6);
+    REQUIRE(budget.delayedMs() <= 3000);
+}
@@ -0,0 +1,45 @@
+#include "catch.hpp"
+#include "romm/sha256.hpp"
+
+#include <string>
+
+namespace {
+std::string hexOf(const std::string& s) {
+    return romm::Sha256::toHex(romm::Sha256::hash(s.data(), s.size()));
+}
+} // namespace
+
+TEST_CASE("Sha256 matches FIPS 180-2 vectors") {
+    REQUIRE(hexOf("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    REQUIRE(hexOf("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    REQUIRE(hexOf("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+            "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    romm::Sha256 million;
+    const std::string chunk(1000, 'a');
+    for (int i = 0; i < 1000; ++i) million.update(chunk.data(), chunk.size());
+    REQUIRE(romm::Sha256::toHex(million.digest()) ==
+            "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+TEST_CASE("Sha256 is independent of update boundaries and resumes from a state copy") {
+    std::string data;
+    for (int i = 0; i < 1000; ++i) data.push_back(static_cast<char>(i * 7 + 3));
+    const std::string whole = romm::Sha256::toHex(romm::Sha256::hash(data.data(), data.size()));
+
+    for (size_t split : {size_t(1), size_t(63), size_t(64), size_t(65), size_t(500), size_t(999)}) {
+        romm::Sha256 a;
+        a.update(data.data(), split);
+        // Continue from a copy of the state, as resume does after reading it back from the manifest.
+        romm::Sha256 b(a.state());
+        REQUIRE(b.state() == a.state());
+        b.update(data.data() + split, data.size() - split);
+        REQUIRE(romm::Sha256::toHex(b.digest()) == whole);
+    }
+
+    // digest() does not disturb the running hash.
+    romm::Sha256 c;
+    c.update(data.data(), 100);
+    (void)c.digest();
+    c.update(data.data() + 100, data.size() - 100);
+    REQUIRE(romm::Sha256::toHex(c.digest()) == whole);
+}
@@ -0,0 +1,147 @@
+#include "catch.hpp"
+#include "romm/stall_detector.hpp"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr uint64_t kMB = 1024 * 1024;
+
+// Advance every connection by its rate (bytes/s) in 200ms steps, polling like the stream monitor.
+struct Sim {
+    romm::StallDetector det;
+    std::vector<int> ids;
+    std::vector<uint64_t> bytes;
+    uint64_t now{0};
+    std::vector<int> flagged;
+
+    explicit Sim(size_t connections) {
+        for (size_t i = 0; i < connections; ++i) {
+            ids.push_back(det.track(now));
+            bytes.push_back(0);
+        }
+    }
+
+    void run(const std::vector<double>& rates, uint64_t ms) {
+        for (uint64_t t = 0; t < ms; t += 200) {
+            now += 200;
+            for (size_t i = 0; i < ids.size(); ++i) {
+                bytes[i] += static_cast<uint64_t>(rates[i] / 5.0);
+                det.sample(ids[i], bytes[i], now);
+            }
+            for (int id : det.poll(now)) flagged.push_back(id);
+        }
+    }
+};
+} // namespace
+
+TEST_CASE("StallDetector flags a connection that falls far behind its peers") {
+    Sim sim(3);
+    sim.run({4.0 * kMB, 4.0 * kMB, 4.0 * kMB}, 10000);
+    REQUIRE(sim.flagged.empty());
+    REQUIRE(sim.det.baseline() > 3.5 * kMB);
+    sim.run({4.0 * kMB, 10.0 * 1024, 4.0 * kMB}, 8000);
+    REQUIRE(sim.flagged.size() == 1);
+    REQUIRE(sim.flagged[0] == sim.ids[1]);
+    // Reported once, and the laggard does not drag the baseline down.
+    sim.run({4.0 * kMB, 10.0 * 1024, 4.0 * kMB}, 8000);
+    REQUIRE(sim.flagged.size() == 1);
+    REQUIRE(sim.det.baseline() > 3.5 * kMB);
+}
+
+TEST_CASE("StallDetector compares a lone connection with its own history") {
+    Sim sim(1);
+    sim.run({8.0 * kMB}, 12000);
+    // A gradual slowdown moves the baseline with it.
+    sim.run({5.0 * kMB}, 10000);
+    sim.run({3.0 * kMB}, 10000);
+    REQUIRE(sim.flagged.empty());
+    // A sudden crawl does not.
+    sim.run({20.0 * 1024}, 6000);
+    REQUIRE(sim.flagged.size() == 1);
+}
+
+TEST_CASE("StallDetector leaves young connections and slow links alone") {
+    SECTION("warm-up") {
+        Sim sim(2);
+        sim.run({4.0 * kMB, 1024.0}, 7000);
+        REQUIRE(sim.flagged.empty());
+    }
+    SECTION("slow link") {
+        Sim sim(2);
+        sim.run({100.0 * 1024, 100.0 * 1024}, 10000);
+        sim.run({100.0 * 1024, 1024.0}, 10000);
+        REQUIRE(sim.flagged.empty());
+    }
+    SECTION("restarted windows") {
+        Sim sim(1);
+        sim.run({4.0 * kMB}, 10000);
+        sim.det.restartWindows(sim.now);
+        sim.run({10.0 * 1024}, 3000);
+        REQUIRE(sim.flagged.empty());
+    }
+}
+
+TEST_CASE("RaceCursor writes each byte once, from whichever connection is ahead") {
+    std::string file(100, '.');
+    romm::RaceCursor race(10, 60, [&](uint64_t off, const char* data, size_t len, std::string&) {
+        file.replace(static_cast<size_t>(off), len, data, len);
+        return true;
+    });
+    std::string payload(100, '\0');
+    for (size_t i = 0; i < payload.size(); ++i) payload[i] = static_cast<char>('a' + i % 26);
+    auto at = [&](uint64_t pos) { return payload.data() + pos; };
+
+    size_t wrote = 0;
+    std::string err;
+    REQUIRE(race.deliver(10, at(10), 15, wrote, err)); // primary: 10..25
+    REQUIRE(wrote == 15);
+    REQUIRE(race.deliver(10, at(10), 20, wrote, err)); // hedge from 10: only 25..30 is new
+    REQUIRE(wrote == 5);
+    REQUIRE(race.deliver(25, at(25), 3, wrote, err)); // primary is behind now
+    REQUIRE(wrote == 0);
+    REQUIRE_FALSE(race.deliver(45, at(45), 5, wrote, err)); // nobody may skip ahead of the cursor
+    REQUIRE(err.find("gap") != std::string::npos);
+    REQUIRE(race.deliver(28, at(28), 50, wrote, err)); // clipped to the end
+    REQUIRE(wrote == 30);
+    REQUIRE(race.complete());
+    REQUIRE(file.substr(10, 50) == payload.substr(10, 50));
+    REQUIRE(file.substr(0, 10) == std::string(10, '.'));
+    REQUIRE(file.substr(60) == std::string(40, '.'));
+}
+
+TEST_CASE("RaceCursor keeps the run contiguous under two racing threads") {
+    constexpr uint64_t kSize = 1 << 20;
+    std::vector<char> file(kSize, 0);
+    std::atomic<uint64_t> writes{0};
+    uint64_t expectNext = 0;
+    bool ordered = true;
+    romm::RaceCursor race(0, kSize, [&](uint64_t off, const char* data, size_t len, std::string&) {
+        if (off != expectNext) ordered = false;
+        expectNext = off + len;
+        std::copy(data, data + len, file.begin() + static_cast<std::ptrdiff_t>(off));
+        writes.fetch_add(1);
+        return true;
+    });
+    std::vector<char> payload(kSize);
+    for (uint64_t i = 0; i < kSize; ++i) payload[i] = static_cast<char>(i * 7);
+    auto conn = [&](size_t chunk) {
+        uint64_t pos = 0;
+        std::string err;
+        while (pos < kSize && !race.complete()) {
+            const size_t n = static_cast<size_t>(std::min<uint64_t>(chunk, kSize - pos));
+            size_t wrote = 0;
+            if (!race.deliver(pos, payload.data() + pos, n, wrote, err)) return;
+            pos += n;
+        }
+    };
+    std::thread a(conn, 4096);
+    std::thread b(conn, 1500);
+    a.join();
+    b.join();
+    REQUIRE(race.complete());
+    REQUIRE(ordered);
+    REQUIRE(file == payload);
+}
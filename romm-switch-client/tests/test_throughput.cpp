@@ -0,0 +1,109 @@
+#include "catch.hpp"
+#include "romm/throughput.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+struct FakeClock {
+    uint64_t ms{5000}; // arbitrary non-zero start: the meter counts from construction
+    romm::ThroughputMeter::NowFn fn() {
+        return [this]() { return ms; };
+    }
+};
+} // namespace
+
+TEST_CASE("ThroughputMeter reports nothing before a second completes") {
+    FakeClock clock;
+    romm::ThroughputMeter meter(clock.fn());
+    auto snap = meter.snapshot();
+    REQUIRE_FALSE(snap.active);
+    REQUIRE(snap.bytesPerSec == 0.0);
+
+    meter.add(1000);
+    clock.ms += 500;
+    snap = meter.snapshot();
+    REQUIRE(snap.active);
+    REQUIRE(snap.totalBytes == 1000);
+    REQUIRE(snap.bytesPerSec == 0.0); // the current second is still open
+    REQUIRE(romm::ThroughputMeter::etaSeconds(1000, snap.bytesPerSec) == -1);
+}
+
+TEST_CASE("ThroughputMeter EWMA follows per-second buckets with peak and min") {
+    FakeClock clock;
+    romm::ThroughputMeter meter(clock.fn());
+    // Idle lead-in is ignored: the rate starts with the first active second.
+    clock.ms += 3000;
+    const uint64_t perSecond[] = {1000, 1000, 2000, 500};
+    for (uint64_t b : perSecond) {
+        meter.add(b / 2);
+        clock.ms += 400;
+        meter.add(b - b / 2);
+        clock.ms += 600;
+    }
+    const auto snap = meter.snapshot();
+    REQUIRE(snap.active);
+    REQUIRE(snap.totalBytes == 4500);
+    REQUIRE(snap.peakBytesPerSec == 2000);
+    REQUIRE(snap.minBytesPerSec == 500);
+    REQUIRE(snap.lastSecondBytes == Approx(500.0));
+    REQUIRE(snap.averageBytesPerSec == Approx(1125.0));
+    // 1000 -> 1000 -> 1200 -> 1060
+    REQUIRE(snap.bytesPerSec == Approx(1060.0));
+    REQUIRE(romm::ThroughputMeter::etaSeconds(10600, snap.bytesPerSec) == 10);
+    REQUIRE(romm::ThroughputMeter::etaSeconds(10601, snap.bytesPerSec) == 11);
+    REQUIRE(romm::ThroughputMeter::etaSeconds(0, 0.0) == 0);
+}
+
+TEST_CASE("ThroughputMeter decays over idle seconds and forgets the old window") {
+    FakeClock clock;
+    romm::ThroughputMeter meter(clock.fn());
+    for (int i = 0; i < 5; ++i) {
+        meter.add(10000);
+        clock.ms += 1000;
+    }
+    REQUIRE(meter.snapshot().bytesPerSec == Approx(10000.0));
+
+    clock.ms += 3000; // three idle seconds: the rate drops, the stall shows as the minimum
+    auto snap = meter.snapshot();
+    REQUIRE(snap.bytesPerSec == Approx(10000.0 * 0.8 * 0.8 * 0.8));
+    REQUIRE(snap.minBytesPerSec == 0);
+    REQUIRE(snap.peakBytesPerSec == 10000);
+
+    // A full window later every bucket is stale, even though the ring slots were never rewritten.
+    clock.ms += romm::ThroughputMeter::kWindowSeconds * 1000;
+    snap = meter.snapshot();
+    REQUIRE_FALSE(snap.active);
+    REQUIRE(snap.bytesPerSec == 0.0);
+    REQUIRE(snap.peakBytesPerSec == 0);
+    REQUIRE(snap.totalBytes == 50000);
+
+    // Slots are recycled for new seconds without mixing in the old counts.
+    meter.add(700);
+    clock.ms += 1000;
+    snap = meter.snapshot();
+    REQUIRE(snap.lastSecondBytes == Approx(700.0));
+    REQUIRE(snap.bytesPerSec == Approx(700.0));
+
+    meter.reset();
+    snap = meter.snapshot();
+    REQUIRE(snap.totalBytes == 0);
+    REQUIRE_FALSE(snap.active);
+}
+
+TEST_CASE("ThroughputMeter counts concurrent producers exactly") {
+    FakeClock clock;
+    romm::ThroughputMeter meter(clock.fn());
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 10000; ++i) meter.add(3);
+        });
+    }
+    for (auto& t : threads) t.join();
+    clock.ms += 1000;
+    const auto snap = meter.snapshot();
+    REQUIRE(snap.totalBytes == 120000);
+    REQUIRE(snap.lastSecondBytes == Approx(120000.0));
+}
@@ -0,0 +1,186 @@
+#include "catch.hpp"
+#include "romm/transfer_tuner.hpp"
+
+#include <string>
+#include <vector>
+
+namespace {
+constexpr size_t kKB = 1024;
+constexpr size_t kMB = 1024 * 1024;
+
+romm::TuningBounds bounds(int maxConnections) {
+    romm::TuningBounds b;
+    b.min = romm::TuningParams{64 * kKB, 64 * kKB, 256 * kKB, 1};
+    b.max = romm::TuningParams{512 * kKB, 1 * kMB, 2 * kMB, maxConnections};
+    return b;
+}
+
+// One 5s window at `mbps` MB/s with the given share of it spent in writer stalls.
+romm::TuningSample window(double mbps, double stallShare, double throttledShare = 0.0) {
+    romm::TuningSample s;
+    s.elapsedMs = 5000;
+    s.bytes = static_cast<uint64_t>(mbps * 5.0 * kMB);
+    s.stallMs = static_cast<uint64_t>(stallShare * 5000.0);
+    s.throttledMs = static_cast<uint64_t>(throttledShare * 5000.0);
+    return s;
+}
+} // namespace
+
+TEST_CASE("TransferTuner grows receive buffers and connections on a network-bound link") {
+    romm::TransferTuner tuner;
+    tuner.reset(bounds(3), romm::TuningParams{256 * kKB, 256 * kKB, 1 * kMB, 2});
+
+    std::string d = tuner.observe(window(10.0, 0.0));
+    REQUIRE(d.find("try recv_buffer 256KB -> 512KB") == 0);
+    REQUIRE(d.find("network-bound") != std::string::npos);
+    REQUIRE(d.find("from next stream") != std::string::npos);
+    // Until a stream runs with the new buffer, the old stream's windows are not evidence.
+    REQUIRE(tuner.observe(window(10.0, 0.0)).empty());
+
+    REQUIRE(tuner.beginStream().recvBufferBytes == 512 * kKB);
+    d = tuner.observe(window(12.0, 0.0));
+    REQUIRE(d.find("keep recv_buffer=512KB (+20%") == 0);
+
+    // Receive buffer is at its ceiling, so the next step adds a connection.
+    d = tuner.observe(window(12.0, 0.0));
+    REQUIRE(d.find("try connections 2 -> 3") == 0);
+    REQUIRE(tuner.beginStream().connections == 3);
+    // No gain: back to 2, effective from the next stream again.
+    d = tuner.observe(window(12.2, 0.0));
+    REQUIRE(d.find("revert connections 3 -> 2") == 0);
+    REQUIRE(tuner.current().connections == 2);
+    REQUIRE(tuner.observe(window(12.0, 0.0)).empty());
+    tuner.beginStream();
+    // Both network knobs are exhausted or on hold now.
+    REQUIRE(tuner.observe(window(12.0, 0.0)).empty());
+}
+
+TEST_CASE("TransferTuner enlarges writes when the SD card stalls the network") {
+    romm::TransferTuner tuner;
+    tuner.reset(bounds(4), romm::TuningParams{256 * kKB, 256 * kKB, 1 * kMB, 4});
+
+    // The write batch is live: the very next window already measures it.
+    std::string d = tuner.observe(window(8.0, 0.3));
+    REQUIRE(d.find("try write_batch 1MB -> 2MB (SD-bound, stall 30%") == 0);
+    REQUIRE(tuner.current().writeBatchBytes == 2 * kMB);
+    d = tuner.observe(window(8.1, 0.3));
+    REQUIRE(d.find("revert write_batch 2MB -> 1MB") == 0);
+    REQUIRE(tuner.current().writeBatchBytes == 1 * kMB);
+
+    // Batch is on hold, so the stdio buffer is next.
+    d = tuner.observe(window(8.0, 0.3));
+    REQUIRE(d.find("try io_buffer 256KB -> 512KB") == 0);
+    tuner.beginStream();
+    d = tuner.observe(window(9.0, 0.25));
+    REQUIRE(d.find("keep io_buffer=512KB") == 0);
+    d = tuner.observe(window(9.0, 0.25));
+    REQUIRE(d.find("try io_buffer 512KB -> 1MB") == 0);
+    tuner.beginStream();
+    REQUIRE(tuner.observe(window(9.0, 0.25)).find("revert io_buffer") == 0);
+    tuner.beginStream();
+
+    // Buffers exhausted: shed a connection; kept because it does not cost throughput.
+    d = tuner.observe(window(9.0, 0.25));
+    REQUIRE(d.find("try connections 4 -> 3") == 0);
+    tuner.beginStream();
+    d = tuner.observe(window(8.8, 0.2));
+    REQUIRE(d.find("keep connections=3") == 0);
+    REQUIRE(tuner.current().connections == 3);
+}
+
+TEST_CASE("TransferTuner ignores short, throttled and balanced windows") {
+    romm::TransferTuner tuner;
+    tuner.reset(bounds(2), romm::TuningParams{256 * kKB, 256 * kKB, 1 * kMB, 1});
+
+    romm::TuningSample shortWindow = window(10.0, 0.0);
+    shortWindow.elapsedMs = 1000;
+    REQUIRE(tuner.observe(shortWindow).empty());
+    romm::TuningSample tinyWindow = window(0.5, 0.0);
+    REQUIRE(tuner.observe(tinyWindow).empty());
+    REQUIRE(tuner.observe(window(10.0, 0.0, 0.5)).empty()); // the rate limiter set the pace
+    REQUIRE(tuner.observe(window(10.0, 0.08)).empty());     // neither side clearly the bottleneck
+
+    const romm::TuningParams p = tuner.current();
+    REQUIRE(p.recvBufferBytes == 256 * kKB);
+    REQUIRE(p.connections == 1);
+}
+
+TEST_CASE("TransferTuner clamps the starting point to its bounds") {
+    romm::TransferTuner tuner;
+    tuner.reset(bounds(2), romm::TuningParams{4 * kMB, 1 * kKB, 8 * kMB, 6});
+    const romm::TuningParams p = tuner.beginStream();
+    REQUIRE(p.recvBufferBytes == 512 * kKB);
+    REQUIRE(p.ioBufferBytes == 64 * kKB);
+    REQUIRE(p.writeBatchBytes == 2 * kMB);
+    REQUIRE(p.connections == 2);
+}
+
+namespace {
+// Two streams of one bundle both report every 250ms: A at `mbpsA`, B at `mbpsB`, with a third of
+// the time spent in writer stalls. Returns the decision of the window that closes.
+std::string runInterleaved(romm::TuningSampler& sampler, romm::TuningSampler::Clocks& clocks, double mbpsA,
+                           double mbpsB) {
+    for (int tick = 0; tick < 40; ++tick) {
+        clocks.nowMs += 250;
+        clocks.stallMs += 83;
+        sampler.add(static_cast<uint64_t>(mbpsA * kMB / 4));
+        sampler.add(static_cast<uint64_t>(mbpsB * kMB / 4));
+        // Either stream's poll may close the window.
+        std::string d = sampler.poll(clocks);
+        if (!d.empty()) return d;
+        d = sampler.poll(clocks);
+        if (!d.empty()) return d;
+    }
+    return "";
+}
+} // namespace
+
+TEST_CASE("TuningSampler judges trials on the rate of all streams together") {
+    romm::TransferTuner tuner;
+    tuner.reset(bounds(4), romm::TuningParams{256 * kKB, 256 * kKB, 1 * kMB, 4});
+    romm::TuningSampler sampler(tuner);
+    romm::TuningSampler::Clocks clocks;
+    sampler.streamStarted(clocks);
+    sampler.streamStarted(clocks);
+    REQUIRE(sampler.activeStreams() == 2);
+
+    // A fast and a slow file side by side. Judged per stream, a step tried on A's window would be
+    // reverted against B's; the aggregate (10 + 2 MB/s) is what both windows measure.
+    std::string d = runInterleaved(sampler, clocks, 10.0, 2.0);
+    REQUIRE(d.find("try write_batch 1MB -> 2MB (SD-bound") == 0);
+    REQUIRE(d.find("12.0 MB/s") != std::string::npos);
+    d = runInterleaved(sampler, clocks, 11.5, 2.3); // +15% together
+    REQUIRE(d.find("keep write_batch=2MB (+15%") == 0);
+    REQUIRE(tuner.current().writeBatchBytes == 2 * kMB);
+}
+
+TEST_CASE("TuningSampler drops the window when streams come and go") {
+    romm::TransferTuner tuner;
+    tuner.reset(bounds(4), romm::TuningParams{256 * kKB, 256 * kKB, 1 * kMB, 4});
+    romm::TuningSampler sampler(tuner);
+    romm::TuningSampler::Clocks clocks;
+
+    // Nothing running: bytes and time are not counted.
+    sampler.add(64 * kMB);
+    clocks.nowMs = 10000;
+    REQUIRE(sampler.poll(clocks).empty());
+
+    sampler.streamStarted(clocks);
+    sampler.add(40 * kMB);
+    clocks.nowMs += 3000;
+    clocks.stallMs += 1000;
+    // A second file starts: the 3s so far measured one stream only and are dropped.
+    sampler.streamStarted(clocks);
+    clocks.nowMs += 2000;
+    REQUIRE(sampler.poll(clocks).empty());
+    sampler.add(40 * kMB);
+    clocks.nowMs += 2000;
+    clocks.stallMs += 1500;
+    REQUIRE(sampler.poll(clocks).find("try write_batch") == 0);
+
+    sampler.streamEnded(clocks);
+    sampler.streamEnded(clocks);
+    REQUIRE(sampler.activeStreams() == 0);
+    sampler.streamEnded(clocks);
+    REQUIRE(sampler.activeStreams() == 0);
+}
@@ -0,0 +1,220 @@
+#include "catch.hpp"
+#include "romm/write_pipeline.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+std::string readFile(const std::filesystem::path& p) {
+    std::ifstream in(p.string(), std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+std::filesystem::path freshDir(const char* name) {
+    auto dir = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+} // namespace
+
+TEST_CASE("BlockRing hands blocks to the consumer in FIFO order") {
+    romm::WriteQueueStats stats;
+    romm::BlockRing ring(8, 3, &stats);
+    for (uint64_t i = 0; i < 3; ++i) {
+        auto* b = ring.acquire();
+        REQUIRE(b != nullptr);
+        b->offset = i * 8;
+        b->len = 1;
+        ring.submit(b);
+    }
+    REQUIRE(stats.depth.load() == 3);
+    REQUIRE(stats.peakDepth.load() == 3);
+    ring.close();
+    for (uint64_t i = 0; i < 3; ++i) {
+        auto* b = ring.pop();
+        REQUIRE(b != nullptr);
+        REQUIRE(b->offset == i * 8);
+        ring.recycle(b);
+    }
+    REQUIRE(ring.pop() == nullptr);
+    REQUIRE(stats.depth.load() == 0);
+}
+
+TEST_CASE("BlockRing acquire blocks while full and counts the stall") {
+    romm::WriteQueueStats stats;
+    romm::BlockRing ring(4, 1, &stats);
+    auto* first = ring.acquire();
+    REQUIRE(first != nullptr);
+    ring.submit(first);
+    std::thread consumer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        auto* b = ring.pop();
+        ring.recycle(b);
+    });
+    auto* second = ring.acquire(); // waits for the consumer to recycle
+    consumer.join();
+    REQUIRE(second != nullptr);
+    REQUIRE(stats.stallCount.load() == 1);
+    REQUIRE(stats.stallMs.load() >= 10);
+}
+
+TEST_CASE("BlockRing abort wakes a waiting producer") {
+    romm::BlockRing ring(4, 1);
+    auto* held = ring.acquire();
+    REQUIRE(held != nullptr);
+    std::thread aborter([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ring.abort();
+    });
+    REQUIRE(ring.acquire() == nullptr);
+    aborter.join();
+    REQUIRE(ring.aborted());
+}
+
+TEST_CASE("AsyncPartWriter drains small writes into part files") {
+    auto dir = freshDir("romm_write_pipeline_basic");
+    romm::WriteQueueStats stats;
+    std::string expected;
+    {
+        romm::AsyncPartWriter writer(dir.string(), 1000, 64, 2, &stats, 0);
+        writer.start();
+        romm::AsyncPartWriter::Stream sink(writer);
+        std::string err;
+        uint64_t off = 0;
+        for (int i = 0; i < 300; ++i) {
+            std::string chunk = std::to_string(i % 10) + "abcdefg";
+            REQUIRE(sink.write(off, chunk.data(), chunk.size(), err));
+            off += chunk.size();
+            expected += chunk;
+        }
+        REQUIRE(sink.flush(err));
+        REQUIRE(writer.finish(err));
+        REQUIRE(sink.written() == expected.size());
+    }
+    REQUIRE(stats.bytesWritten.load() == expected.size());
+    REQUIRE(readFile(dir / "00.part") == expected.substr(0, 1000));
+    REQUIRE(readFile(dir / "01.part") == expected.substr(1000, 1000));
+    REQUIRE(readFile(dir / "02.part") == expected.substr(2000));
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("AsyncPartWriter streams from several threads fill disjoint ranges") {
+    auto dir = freshDir("romm_write_pipeline_multi");
+    const size_t kSpan = 4096;
+    {
+        romm::AsyncPartWriter writer(dir.string(), 3000, 256, 4, nullptr, 0);
+        writer.start();
+        std::vector<std::unique_ptr<romm::AsyncPartWriter::Stream>> streams;
+        for (int i = 0; i < 3; ++i) streams.push_back(std::make_unique<romm::AsyncPartWriter::Stream>(writer));
+        // Catch assertions are not thread-safe; record results and check after join.
+        std::vector<int> ok(3, 0);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 3; ++i) {
+            threads.emplace_back([&, i]() {
+                std::string err;
+                std::string chunk(100, static_cast<char>('a' + i));
+                bool good = true;
+                for (size_t off = 0; off < kSpan && good; off += chunk.size()) {
+                    size_t n = std::min(chunk.size(), kSpan - off);
+                    good = streams[i]->write(i * kSpan + off, chunk.data(), n, err);
+                }
+                ok[i] = good && streams[i]->flush(err);
+            });
+        }
+        for (auto& t : threads) t.join();
+        REQUIRE(ok == std::vector<int>{1, 1, 1});
+        std::string err;
+        REQUIRE(writer.finish(err));
+    }
+    std::string all;
+    for (int p = 0; p < 5; ++p) all += readFile(dir / romm::partFileName(p));
+    REQUIRE(all.size() == 3 * kSpan);
+    REQUIRE(all == std::string(kSpan, 'a') + std::string(kSpan, 'b') + std::string(kSpan, 'c'));
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("AsyncPartWriter surfaces writer-thread errors to producers") {
+    auto dir = freshDir("romm_write_pipeline_fail");
+    romm::AsyncPartWriter writer(dir.string(), 16, 16, 2, nullptr, 0);
+    writer.setOpenHook([](uint64_t idx, uint64_t, std::string& err) {
+        if (idx >= 1) {
+            err = "Not enough free space";
+            return false;
+        }
+        return true;
+    });
+    writer.start();
+    romm::AsyncPartWriter::Stream sink(writer);
+    std::string err;
+    std::string chunk(16, 'x');
+    bool ok = true;
+    for (uint64_t off = 0; off < 16 * 64 && ok; off += 16) {
+        ok = sink.write(off, chunk.data(), chunk.size(), err);
+    }
+    if (ok) ok = sink.flush(err);
+    std::string finishErr;
+    REQUIRE_FALSE(writer.finish(finishErr));
+    REQUIRE(finishErr == "Not enough free space");
+    REQUIRE(sink.written() == 16);
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("AsyncPartWriter checkpoints by committed bytes and once more on finish") {
+    auto dir = freshDir("romm_write_pipeline_checkpoint");
+    romm::AsyncPartWriter writer(dir.string(), 1000, 100, 2, nullptr, 0);
+    writer.enableHashing();
+    std::vector<uint64_t> durable;   // Stream::written() seen by each checkpoint
+    std::vector<uint64_t> onDisk;    // bytes in 00.part at that moment
+    std::vector<uint64_t> hashed;
+    romm::AsyncPartWriter::Stream sink(writer);
+    writer.setCheckpoint(300, 0, [&](const romm::PartHashes& hashes) {
+        durable.push_back(sink.written());
+        onDisk.push_back(std::filesystem::file_size(dir / "00.part"));
+        hashed.push_back(hashes.count(0) ? hashes.at(0).offset() : 0);
+    });
+    writer.start();
+    std::string err;
+    std::string chunk(100, 'c');
+    for (uint64_t off = 0; off < 750; off += 50) {
+        REQUIRE(sink.write(off, chunk.data(), 50, err));
+    }
+    REQUIRE(sink.flush(err));
+    REQUIRE(writer.finish(err));
+
+    REQUIRE(durable == std::vector<uint64_t>{300, 600, 750});
+    REQUIRE(onDisk == durable);
+    REQUIRE(hashed == durable);
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("AsyncPartWriter batch size bounds the bytes per queued block") {
+    auto dir = freshDir("romm_write_pipeline_batch");
+    romm::WriteQueueStats stats;
+    romm::AsyncPartWriter writer(dir.string(), 1 << 20, 64, 4, &stats, 0);
+    REQUIRE(writer.batchBytes() == 64);
+    writer.setBatchBytes(1000); // clamped to the block size
+    REQUIRE(writer.batchBytes() == 64);
+    writer.setBatchBytes(16);
+    REQUIRE(writer.batchBytes() == 16);
+
+    std::vector<uint64_t> blockEnds;
+    romm::AsyncPartWriter::Stream sink(writer);
+    writer.setCheckpoint(1, 0, [&](const romm::PartHashes&) { blockEnds.push_back(sink.written()); });
+    writer.start();
+    std::string err;
+    std::string data(40, 'b');
+    REQUIRE(sink.write(0, data.data(), 20, err));
+    writer.setBatchBytes(64); // applies to the block being filled
+    REQUIRE(sink.write(20, data.data() + 20, 20, err));
+    REQUIRE(sink.flush(err));
+    REQUIRE(writer.finish(err));
+    // 16-byte block, then the rest (24 bytes) fits the enlarged batch; finish adds one more checkpoint.
+    REQUIRE(blockEnds == std::vector<uint64_t>{16, 40, 40});
+    REQUIRE(readFile(dir / "00.part") == data);
+    std::filesystem::remove_all(dir);
+}
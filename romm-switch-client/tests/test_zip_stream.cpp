@@ -0,0 +1,238 @@
+#include "catch.hpp"
+#include "romm/zip_stream.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+void put16(std::string& s, uint16_t v) {
+    s.push_back(static_cast<char>(v & 0xFF));
+    s.push_back(static_cast<char>(v >> 8));
+}
+void put32(std::string& s, uint32_t v) {
+    put16(s, static_cast<uint16_t>(v & 0xFFFF));
+    put16(s, static_cast<uint16_t>(v >> 16));
+}
+void put64(std::string& s, uint64_t v) {
+    put32(s, static_cast<uint32_t>(v));
+    put32(s, static_cast<uint32_t>(v >> 32));
+}
+
+std::string rawDeflate(const std::string& in) {
+    z_stream z{};
+    REQUIRE(deflateInit2(&z, 6, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+    std::string out(deflateBound(&z, static_cast<uLong>(in.size())), '\0');
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    z.avail_in = static_cast<uInt>(in.size());
+    z.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    z.avail_out = static_cast<uInt>(out.size());
+    REQUIRE(deflate(&z, Z_FINISH) == Z_STREAM_END);
+    out.resize(z.total_out);
+    deflateEnd(&z);
+    return out;
+}
+
+struct EntrySpec {
+    std::string name;
+    std::string data;
+    bool deflate{false};
+    bool descriptor{false};    // sizes/crc after the data (bit 3)
+    bool descriptorSig{true};
+    bool zip64{false};         // 0xFFFFFFFF sizes + zip64 extra
+};
+
+std::string buildZip(const std::vector<EntrySpec>& entries) {
+    std::string zip;
+    for (const auto& e : entries) {
+        const std::string payload = e.deflate ? rawDeflate(e.data) : e.data;
+        const uint32_t crc = static_cast<uint32_t>(
+            crc32(0L, reinterpret_cast<const Bytef*>(e.data.data()), static_cast<uInt>(e.data.size())));
+        put32(zip, 0x04034b50);
+        put16(zip, e.zip64 ? 45 : 20);
+        put16(zip, e.descriptor ? 0x0008 : 0);
+        put16(zip, e.deflate ? 8 : 0);
+        put32(zip, 0); // time/date
+        put32(zip, e.descriptor ? 0 : crc);
+        if (e.zip64) {
+            put32(zip, 0xFFFFFFFFu);
+            put32(zip, 0xFFFFFFFFu);
+        } else {
+            put32(zip, e.descriptor ? 0 : static_cast<uint32_t>(payload.size()));
+            put32(zip, e.descriptor ? 0 : static_cast<uint32_t>(e.data.size()));
+        }
+        put16(zip, static_cast<uint16_t>(e.name.size()));
+        put16(zip, e.zip64 ? 20 : 0);
+        zip += e.name;
+        if (e.zip64) {
+            put16(zip, 0x0001);
+            put16(zip, 16);
+            put64(zip, e.data.size());
+            put64(zip, payload.size());
+        }
+        zip += payload;
+        if (e.descriptor) {
+            if (e.descriptorSig) put32(zip, 0x08074b50);
+            put32(zip, crc);
+            if (e.zip64) {
+                put64(zip, payload.size());
+                put64(zip, e.data.size());
+            } else {
+                put32(zip, static_cast<uint32_t>(payload.size()));
+                put32(zip, static_cast<uint32_t>(e.data.size()));
+            }
+        }
+    }
+    put32(zip, 0x02014b50); // central directory: the reader stops here
+    zip += std::string(42, '\0');
+    return zip;
+}
+
+std::string pattern(size_t n, unsigned seed) {
+    std::string s(n, '\0');
+    uint32_t x = seed * 2654435761u + 1;
+    for (size_t i = 0; i < n; ++i) {
+        x = x * 1103515245u + 12345u;
+        // Half compressible text, half noise.
+        s[i] = (i / 4096) % 2 ? static_cast<char>(x >> 24) : static_cast<char>('a' + (i % 23));
+    }
+    return s;
+}
+
+struct Collected {
+    std::map<std::string, std::string> files;
+    std::vector<std::string> order;
+    std::string current;
+};
+
+romm::ZipStreamReader::Handler collector(Collected& c, const std::vector<std::string>& skip = {},
+                                         uint64_t hint = 0) {
+    romm::ZipStreamReader::Handler h;
+    h.onEntry = [&c, skip, hint](const romm::ZipEntry& e, bool& skipIt, uint64_t& sizeHint) {
+        skipIt = std::find(skip.begin(), skip.end(), e.name) != skip.end();
+        sizeHint = hint;
+        c.current = e.name;
+        return true;
+    };
+    h.onData = [&c](const char* data, size_t len) {
+        c.files[c.current].append(data, len);
+        return true;
+    };
+    h.onEntryEnd = [&c](const romm::ZipEntry& e) {
+        c.order.push_back(e.name);
+        return true;
+    };
+    return h;
+}
+
+// Feed in uneven chunks so headers, descriptors and deflate blocks straddle calls.
+bool feedChunked(romm::ZipStreamReader& r, const std::string& zip, std::string& err) {
+    const size_t sizes[] = {1, 7, 29, 4096, 3, 65536, 13};
+    size_t pos = 0;
+    for (size_t i = 0; pos < zip.size(); ++i) {
+        const size_t n = std::min(sizes[i % 7], zip.size() - pos);
+        if (!r.feed(zip.data() + pos, n, err)) return false;
+        pos += n;
+    }
+    return true;
+}
+
+} // namespace
+
+TEST_CASE("ZipStreamReader extracts stored and deflate entries") {
+    const std::string a = pattern(200000, 1);
+    const std::string b = pattern(70000, 2);
+    const std::string zip = buildZip({{"Game [base].nsp", a, false}, {"dlc/Game [dlc].nsp", b, true}, {"empty.txt", "", false}});
+    Collected c;
+    romm::ZipStreamReader r(collector(c));
+    std::string err;
+    REQUIRE(feedChunked(r, zip, err));
+    REQUIRE(r.finished());
+    REQUIRE(r.entriesSeen() == 3);
+    REQUIRE(c.order == std::vector<std::string>{"Game [base].nsp", "dlc/Game [dlc].nsp", "empty.txt"});
+    REQUIRE(c.files["Game [base].nsp"] == a);
+    REQUIRE(c.files["dlc/Game [dlc].nsp"] == b);
+}
+
+TEST_CASE("ZipStreamReader handles data descriptors and zip64 sizes") {
+    const std::string a = pattern(150000, 3);
+    const std::string b = pattern(90000, 4);
+    const std::string d = pattern(5000, 5);
+    EntrySpec e1{"a.bin", a, true, true, true, false};
+    EntrySpec e2{"b.bin", b, true, true, false, true};
+    EntrySpec e3{"c.bin", d, false, false, true, true};
+    const std::string zip = buildZip({e1, e2, e3});
+    Collected c;
+    romm::ZipStreamReader r(collector(c));
+    std::string err;
+    REQUIRE(feedChunked(r, zip, err));
+    REQUIRE(r.finished());
+    REQUIRE(c.files["a.bin"] == a);
+    REQUIRE(c.files["b.bin"] == b);
+    REQUIRE(c.files["c.bin"] == d);
+}
+
+TEST_CASE("ZipStreamReader needs a size hint for stored entries with descriptors") {
+    const std::string a = pattern(10000, 6);
+    EntrySpec e{"stored.bin", a, false, true};
+    const std::string zip = buildZip({e});
+    SECTION("no hint") {
+        Collected c;
+        romm::ZipStreamReader r(collector(c));
+        std::string err;
+        REQUIRE_FALSE(feedChunked(r, zip, err));
+        REQUIRE(err.find("without sizes") != std::string::npos);
+    }
+    SECTION("hint from the bundle") {
+        Collected c;
+        romm::ZipStreamReader r(collector(c, {}, a.size()));
+        std::string err;
+        REQUIRE(feedChunked(r, zip, err));
+        REQUIRE(c.files["stored.bin"] == a);
+    }
+}
+
+TEST_CASE("ZipStreamReader skips entries and rejects corrupt data") {
+    const std::string a = pattern(30000, 7);
+    const std::string b = pattern(30000, 8);
+    SECTION("skipped entries produce no data") {
+        const std::string zip = buildZip({{"readme.txt", a, true}, {"game.xci", b, false}});
+        Collected c;
+        romm::ZipStreamReader r(collector(c, {"readme.txt"}));
+        std::string err;
+        REQUIRE(feedChunked(r, zip, err));
+        REQUIRE(c.files.count("readme.txt") == 0);
+        REQUIRE(c.order == std::vector<std::string>{"game.xci"});
+        REQUIRE(c.files["game.xci"] == b);
+    }
+    SECTION("CRC mismatch") {
+        std::string zip = buildZip({{"game.xci", a, false}});
+        zip[30 + 8 + 100] ^= 0x55; // flip a data byte
+        Collected c;
+        romm::ZipStreamReader r(collector(c));
+        std::string err;
+        REQUIRE_FALSE(feedChunked(r, zip, err));
+        REQUIRE(err.find("CRC") != std::string::npos);
+        REQUIRE(c.order.empty());
+    }
+    SECTION("garbage instead of a header") {
+        Collected c;
+        romm::ZipStreamReader r(collector(c));
+        std::string err;
+        REQUIRE_FALSE(r.feed("<html>", 6, err));
+        REQUIRE(err.find("signature") != std::string::npos);
+    }
+    SECTION("unsupported method") {
+        std::string zip = buildZip({{"game.xci", a, false}});
+        zip[8] = 12; // bzip2
+        Collected c;
+        romm::ZipStreamReader r(collector(c));
+        std::string err;
+        REQUIRE_FALSE(feedChunked(r, zip, err));
+        REQUIRE(err.find("method 12") != std::string::npos);
+    }
+}